@@ -23,6 +23,33 @@
 /* Private typedef -----------------------------------------------------------*/
 typedef void (*pFunction)(void);
 
+typedef enum
+{
+  SWAP_STEP_BEGIN = 1,  /* Swap started, value is the number of sectors to process  */
+  SWAP_STEP_BACKUP,     /* Application sector copied to its backup sector           */
+  SWAP_STEP_APP,        /* HOTA sector copied to the application sector             */
+  SWAP_STEP_HOTA,       /* Backup copied to the HOTA sector, the sector is swapped  */
+  SWAP_STEP_END         /* All sectors swapped                                      */
+} swap_step_t;
+
+/* One flash quad-word, programmed once */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t step;
+  uint32_t value;
+  uint32_t check;
+} swap_record_t;
+
+typedef struct
+{
+  uint32_t next_record;
+  uint32_t nb_sectors;
+  uint32_t sector;      /* Sector to resume from         */
+  uint32_t step;        /* Last step done on that sector */
+  bool in_progress;
+} swap_journal_t;
+
 /* Private define ------------------------------------------------------------*/
 #define RESERVED_OTA_SECTORS             96 /* Number of sectors reserved for HOTA */
 #define RESERVED_BOOT_SECTORS            8  /* Bootloader size in sectors */
@@ -31,6 +58,19 @@ typedef void (*pFunction)(void);
 #define SCRATCH_SECTOR                   (RESERVED_OTA_SECTORS + RESERVED_BOOT_SECTORS)
 #define SCRATCH_SECTOR_BANK              FLASH_BANK_1
 
+/* Image header, in the reserved entries of the application vector table (see the
+ * application startup file and linker script) */
+#define IMAGE_HEADER_OFFSET              0x20UL
+#define IMAGE_MAGIC                      0x474D4948UL /* "HIMG" */
+
+/* The swap journal is kept in the scratch sector. Each swapped application sector is
+ * backed up in one of the sectors that follow it, in turn to spread their wear. */
+#define SWAP_JOURNAL_ADDRESS             (FLASH_BASE + (FLASH_SECTOR_SIZE * SCRATCH_SECTOR))
+#define SWAP_JOURNAL_MAGIC               0x4C4E4A53UL /* "SJNL" */
+#define SWAP_JOURNAL_RECORDS             (FLASH_SECTOR_SIZE / sizeof(swap_record_t))
+#define SWAP_BACKUP_SECTORS              4
+#define SWAP_BACKUP_SECTOR( index )      (SCRATCH_SECTOR + 1 + ((index) % SWAP_BACKUP_SECTORS))
+
 #define NUM_QUAD_WORDS( length )         ( length >> 4UL )
 #define NUM_REMAINING_BYTES( length )    ( length & 0x0F )
 #define vPetWatchdog()
@@ -47,9 +87,14 @@ static bool prvWriteToFlash(uint8_t *pSource, uint32_t destination,  uint32_t ul
 static bool prvEraseSectors(uint32_t Nb_Bank, uint32_t Nb_Sectors, uint32_t StartSector);
 static void copy_from_flash_to_buffer(uint8_t *dest, const uint32_t src_flash_addr, uint32_t size);
 
-
-static bool prvEraseApplication(void);
-static bool prvEraseOTA(void);
+static uint32_t image_sectors(uint32_t image_address);
+#if (SWAP_APPLICATION_AND_OTA == 1)
+static void journal_read(swap_journal_t *journal);
+static bool journal_write(swap_journal_t *journal, uint32_t step, uint32_t value);
+static bool swap_sector(swap_journal_t *journal, uint32_t sector_idx, uint32_t step);
+#else
+static bool prvEraseOTA(uint32_t nb_sectors);
+#endif
 
 /* Private user code ---------------------------------------------------------*/
 
@@ -120,77 +165,257 @@ HAL_ICACHE_Disable();
 HAL_ICACHE_Enable();
 #endif
 
+#if (SWAP_APPLICATION_AND_OTA == 1)
+  /* The first HOTA sector is erased for a moment when it is swapped, finish an
+   * interrupted swap even then */
+  if (!xReseult)
+  {
+    swap_journal_t journal;
+
+    journal_read(&journal);
+    xReseult = journal.in_progress;
+  }
+#endif
+
   return xReseult;
 }
 
-#if (SWAP_APPLICATION_AND_OTA == 1)
 uint8_t dst_buffer    [FLASH_SECTOR_SIZE];
-#endif
 uint8_t src_buffer    [FLASH_SECTOR_SIZE];
 
+/**
+ * @brief Copies the HOTA image to the application area.
+ *
+ * Only the sectors used by the new image, or by the current application when it is
+ * swapped to the HOTA area, are processed and sectors that are identical on both
+ * sides are left untouched. Each step of the swap is recorded in a journal so a swap
+ * interrupted by a reset is resumed where it stopped.
+ */
 void copy_hota(void)
 {
-  uint32_t total_sectors = RESERVED_OTA_SECTORS;
-  uint32_t dst_address = 0;     /* first APP sector address */
-  uint32_t src_address = 0;
+  uint32_t new_sectors = image_sectors(HOTA_START_ADDRESS);
+  uint32_t sector_idx;
+  uint32_t changed = 0;
 
 #if (SWAP_APPLICATION_AND_OTA == 1)
-  uint32_t dest_sector = RESERVED_BOOT_SECTORS; /* APP sectors start after bootloader sectors                */
-  uint32_t dest_bank   = FLASH_BANK_1;
+  swap_journal_t journal;
+  uint32_t old_sectors = image_sectors(APP_START_ADDRESS);
 
-  uint32_t src_sector  = 0;                     /* HOTA sectors start at sector 0 in bank 1                  */
-  uint32_t src_bank    = FLASH_BANK_2;
-#endif
+  journal_read(&journal);
 
+  if (!journal.in_progress)
+  {
+    journal.next_record = 0;
+    journal.nb_sectors  = (new_sectors > old_sectors) ? new_sectors : old_sectors;
+    journal.sector      = 0;
+    journal.step        = SWAP_STEP_BEGIN;
 
-#if (SWAP_APPLICATION_AND_OTA == 0)
-  prvEraseApplication();
-#endif
+    if (!prvEraseSectors(SCRATCH_SECTOR_BANK, 1, SCRATCH_SECTOR) ||
+        !journal_write(&journal, SWAP_STEP_BEGIN, journal.nb_sectors))
+    {
+      return;
+    }
+  }
+  else
+  {
+    PRINTF_INFO("Resuming swap at sector %u of %u\r\n", journal.sector, journal.nb_sectors);
+  }
 
   /* Swap sectors */
-  for (uint32_t sector_idx = 0; sector_idx < total_sectors; sector_idx++)
+  for (sector_idx = journal.sector; sector_idx < journal.nb_sectors; sector_idx++)
+  {
+    uint32_t step = (sector_idx == journal.sector) ? journal.step : SWAP_STEP_BEGIN;
+    uint32_t records = journal.next_record;
+
+    if (!swap_sector(&journal, sector_idx, step))
+    {
+      return;
+    }
+
+    changed += (journal.next_record != records) ? 1 : 0;
+  }
+
+  (void) journal_write(&journal, SWAP_STEP_END, journal.nb_sectors);
+
+  PRINTF_INFO("Swapped %u of %u sectors\r\n", changed, journal.nb_sectors);
+#else
+  /* Copy sectors, the HOTA image is kept until the end so an interrupted copy
+   * just starts again */
+  for (sector_idx = 0; sector_idx < new_sectors; sector_idx++)
   {
-    src_address = HOTA_START_ADDRESS + (sector_idx * FLASH_SECTOR_SIZE);
-    dst_address = APP_START_ADDRESS  + (sector_idx * FLASH_SECTOR_SIZE);
+    uint32_t src_address = HOTA_START_ADDRESS + (sector_idx * FLASH_SECTOR_SIZE);
+    uint32_t dst_address = APP_START_ADDRESS  + (sector_idx * FLASH_SECTOR_SIZE);
 
-    /* Copy source sector (HOTA) to buffer */
     copy_from_flash_to_buffer(src_buffer, src_address, FLASH_SECTOR_SIZE);
+    copy_from_flash_to_buffer(dst_buffer, dst_address, FLASH_SECTOR_SIZE);
+
+    if (memcmp(src_buffer, dst_buffer, FLASH_SECTOR_SIZE) != 0)
+    {
+      /* Erase destination sector before writing */
+      if (!prvEraseSectors(FLASH_BANK_1, 1, RESERVED_BOOT_SECTORS + sector_idx) ||
+          !prvWriteToFlash(src_buffer, dst_address, FLASH_SECTOR_SIZE))
+      {
+        return;
+      }
+
+      changed++;
+    }
+  }
+
+  PRINTF_INFO("Copied %u of %u sectors\r\n", changed, new_sectors);
+
+  prvEraseOTA(new_sectors);
+#endif
+}
+
+/**
+ * @brief Returns the number of sectors used by the image at image_address, from
+ * its header. All the sectors of the area are used by an image without header.
+ */
+static uint32_t image_sectors(uint32_t image_address)
+{
+  uint32_t header[2];
+  uint32_t sectors = RESERVED_OTA_SECTORS;
+
+  copy_from_flash_to_buffer((uint8_t *) header, image_address + IMAGE_HEADER_OFFSET, sizeof(header));
+
+  if ((header[0] == IMAGE_MAGIC) &&
+      (header[1] > 0) &&
+      (header[1] <= (RESERVED_OTA_SECTORS * FLASH_SECTOR_SIZE)))
+  {
+    sectors = (header[1] + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+  }
+
+  return sectors;
+}
 
 #if (SWAP_APPLICATION_AND_OTA == 1)
-    copy_from_flash_to_buffer(dst_buffer, dst_address, FLASH_SECTOR_SIZE);
+/**
+ * @brief Reads the swap journal back and finds where an interrupted swap stopped.
+ */
+static void journal_read(swap_journal_t *journal)
+{
+  swap_record_t record;
+  bool started = false;
+  bool ended = false;
+
+  memset(journal, 0, sizeof(swap_journal_t));
 
+  for (uint32_t i = 0; i < SWAP_JOURNAL_RECORDS; i++)
+  {
+    copy_from_flash_to_buffer((uint8_t *) &record, SWAP_JOURNAL_ADDRESS + (i * sizeof(swap_record_t)), sizeof(swap_record_t));
 
-    /* Erase destination sector before writing */
-    if (!prvEraseSectors(dest_bank, 1, dest_sector + sector_idx))
+    if ((record.magic == 0xFFFFFFFFU) && (record.step == 0xFFFFFFFFU) &&
+        (record.value == 0xFFFFFFFFU) && (record.check == 0xFFFFFFFFU))
     {
-      return;
+      break;
     }
-#endif
-    /* Write buffer to destination sector (APP) */
-    if (!prvWriteToFlash(src_buffer, dst_address,FLASH_SECTOR_SIZE))
+
+    /* A record torn by a reset is skipped, its quad-word cannot be programmed again */
+    journal->next_record = i + 1;
+
+    if ((record.magic != SWAP_JOURNAL_MAGIC) ||
+        (record.check != ~(record.magic ^ record.step ^ record.value)))
     {
-      return;
+      continue;
     }
 
-#if (SWAP_APPLICATION_AND_OTA == 1)
-    /* Erase source sector */
-    if (!prvEraseSectors(src_bank, 1, src_sector + sector_idx))
+    if (record.step == SWAP_STEP_BEGIN)
     {
-      return;
+      started = (i == 0) && (record.value <= RESERVED_OTA_SECTORS);
+      journal->nb_sectors = record.value;
+      journal->sector = 0;
+      journal->step = SWAP_STEP_BEGIN;
+    }
+    else if (record.step == SWAP_STEP_END)
+    {
+      ended = true;
+    }
+    else if (record.step == SWAP_STEP_HOTA)
+    {
+      journal->sector = record.value + 1;
+      journal->step = SWAP_STEP_BEGIN;
+    }
+    else
+    {
+      journal->sector = record.value;
+      journal->step = record.step;
     }
+  }
+
+  journal->in_progress = started && !ended;
+}
+
+static bool journal_write(swap_journal_t *journal, uint32_t step, uint32_t value)
+{
+  swap_record_t record;
+
+  if (journal->next_record >= SWAP_JOURNAL_RECORDS)
+  {
+    return false;
+  }
+
+  record.magic = SWAP_JOURNAL_MAGIC;
+  record.step  = step;
+  record.value = value;
+  record.check = ~(record.magic ^ record.step ^ record.value);
+
+  return prvWriteToFlash((uint8_t *) &record,
+                         SWAP_JOURNAL_ADDRESS + (journal->next_record++ * sizeof(swap_record_t)),
+                         sizeof(swap_record_t));
+}
+
+/**
+ * @brief Swaps one application sector with the HOTA sector at the same index,
+ * starting after the given step.
+ */
+static bool swap_sector(swap_journal_t *journal, uint32_t sector_idx, uint32_t step)
+{
+  uint32_t app_address    = APP_START_ADDRESS  + (sector_idx * FLASH_SECTOR_SIZE);
+  uint32_t hota_address   = HOTA_START_ADDRESS + (sector_idx * FLASH_SECTOR_SIZE);
+  uint32_t backup_sector  = SWAP_BACKUP_SECTOR(sector_idx);
+  uint32_t backup_address = FLASH_BASE + (backup_sector * FLASH_SECTOR_SIZE);
+  bool xResult = true;
 
+  if (step == SWAP_STEP_BEGIN)
+  {
+    copy_from_flash_to_buffer(src_buffer, hota_address, FLASH_SECTOR_SIZE);
+    copy_from_flash_to_buffer(dst_buffer, app_address, FLASH_SECTOR_SIZE);
 
-    if (!prvWriteToFlash(dst_buffer, src_address, FLASH_SECTOR_SIZE))
+    if (memcmp(src_buffer, dst_buffer, FLASH_SECTOR_SIZE) == 0)
     {
-      return;
+      /* Identical sectors, nothing to swap */
+      return true;
     }
-#endif
+
+    xResult = prvEraseSectors(SCRATCH_SECTOR_BANK, 1, backup_sector) &&
+              prvWriteToFlash(dst_buffer, backup_address, FLASH_SECTOR_SIZE) &&
+              journal_write(journal, SWAP_STEP_BACKUP, sector_idx);
+  }
+  else if (step == SWAP_STEP_BACKUP)
+  {
+    copy_from_flash_to_buffer(src_buffer, hota_address, FLASH_SECTOR_SIZE);
   }
 
-#if (SWAP_APPLICATION_AND_OTA == 0)
-  prvEraseOTA();
-#endif
+  if (xResult && (step <= SWAP_STEP_BACKUP))
+  {
+    xResult = prvEraseSectors(FLASH_BANK_1, 1, RESERVED_BOOT_SECTORS + sector_idx) &&
+              prvWriteToFlash(src_buffer, app_address, FLASH_SECTOR_SIZE) &&
+              journal_write(journal, SWAP_STEP_APP, sector_idx);
+  }
+
+  if (xResult && (step <= SWAP_STEP_APP))
+  {
+    copy_from_flash_to_buffer(dst_buffer, backup_address, FLASH_SECTOR_SIZE);
+
+    xResult = prvEraseSectors(FLASH_BANK_2, 1, sector_idx) &&
+              prvWriteToFlash(dst_buffer, hota_address, FLASH_SECTOR_SIZE) &&
+              journal_write(journal, SWAP_STEP_HOTA, sector_idx);
+  }
+
+  return xResult;
 }
+#endif
 
 /**
  * @brief Copies data from flash memory to a destination buffer.
@@ -353,13 +578,10 @@ static bool prvEraseSectors(uint32_t Nb_Bank, uint32_t Nb_Sectors, uint32_t Star
   return xResult;
 }
 
-static bool prvEraseApplication(void)
-{
-  return prvEraseSectors(FLASH_BANK_1, RESERVED_OTA_SECTORS, RESERVED_BOOT_SECTORS) == HAL_OK;
-}
-
-static bool prvEraseOTA(void)
+#if (SWAP_APPLICATION_AND_OTA == 0)
+static bool prvEraseOTA(uint32_t nb_sectors)
 {
-  return prvEraseSectors(FLASH_BANK_2, RESERVED_OTA_SECTORS, 0) == HAL_OK;
+  return prvEraseSectors(FLASH_BANK_2, nb_sectors, 0);
 }
+#endif
 
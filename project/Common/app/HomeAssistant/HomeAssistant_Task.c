@@ -50,6 +50,8 @@
 
 #include "ota_appversion32.h"
 
+LOG_MODULE_DEFINE();
+
 # define MAXT_TOPIC_LENGTH 128
 static char publish_topic[MAXT_TOPIC_LENGTH];
 
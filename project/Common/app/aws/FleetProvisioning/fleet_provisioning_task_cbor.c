@@ -109,6 +109,8 @@
 #include "cli.h"
 #include "cli_prv.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * These configurations are required. Throw compilation error if it is not
  * defined.
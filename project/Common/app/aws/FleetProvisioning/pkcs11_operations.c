@@ -55,6 +55,8 @@
 #include "mbedtls/x509_crt.h"
 #include "mbedtls/x509_csr.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 /**
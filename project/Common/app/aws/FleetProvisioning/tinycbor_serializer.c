@@ -38,6 +38,9 @@
 
 /* Header include. */
 #include "tinycbor_serializer.h"
+
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 bool xGenerateCsrRequest( uint8_t * pucBuffer,
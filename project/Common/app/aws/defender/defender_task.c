@@ -77,6 +77,8 @@
 
 #include "cbor.h"
 
+LOG_MODULE_DEFINE();
+
 #define TCP_PORTS_MAX                      10
 #define UDP_PORTS_MAX                      10
 #define CONNECTIONS_MAX                    10
@@ -353,7 +355,7 @@ static void prvUnsubscribeFromDefenderTopics( DefenderAgentCtx_t * pxCtx )
 static void prvPrintHex( const uint8_t * pcPayload,
                          size_t xPayloadLen )
 {
-    #if ( LOG_LEVEL >= LOG_DEBUG )
+    #if ( LOG_LEVEL_COMPILED >= LOG_DEBUG )
         for( uint32_t i = 0; i < xPayloadLen; i += 16 )
         {
             LogDebug( "\t%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X%02X",
@@ -362,10 +364,10 @@ static void prvPrintHex( const uint8_t * pcPayload,
                       pcPayload[ i + 8 ], pcPayload[ i + 9 ], pcPayload[ i + 10 ], pcPayload[ i + 11 ],
                       pcPayload[ i + 12 ], pcPayload[ i + 13 ], pcPayload[ i + 14 ], pcPayload[ i + 15 ] );
         }
-    #else /* LOG_LEVEL >= LOG_DEBUG */
+    #else /* LOG_LEVEL_COMPILED >= LOG_DEBUG */
         ( void ) pcPayload;
         ( void ) xPayloadLen;
-    #endif /* LOG_LEVEL < LOG_DEBUG */
+    #endif /* LOG_LEVEL_COMPILED < LOG_DEBUG */
 }
 
 /*-----------------------------------------------------------*/
@@ -45,6 +45,8 @@
 /* Lwip configuration includes. */
 #include "lwipopts.h"
 
+LOG_MODULE_DEFINE();
+
 #if !defined( LWIP_TCPIP_CORE_LOCKING ) || ( LWIP_TCPIP_CORE_LOCKING == 0 )
     #error "Network metrics are only supported in core locking mode. Please define LWIP_TCPIP_CORE_LOCKING to 1 in lwipopts.h."
 #endif
@@ -0,0 +1,662 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_http_w6x.c
+ * @brief OTA data plane over HTTP(S) using the ST67W6X HTTP client.
+ *
+ * Implements the OTA library HTTP data interface (ota_http_private.h). The image is
+ * fetched from the pre-signed URL of the job document with several concurrent range
+ * requests, each one covering a run of missing blocks of the receive bitmap. Each
+ * W6X HTTP request runs in its own client task; the data callback cuts the body into
+ * OTA blocks and hands them to the OTA agent, which writes them to the inactive bank
+ * through otaPal_WriteBlock in any order.
+ *
+ * When the job document carries no usable URL or the server cannot be resolved, the
+ * transfer falls back to the MQTT stream of the same job.
+ *
+ * The server certificate is not pinned: the W6X client has no access to the PKCS#11
+ * root CA, and the image signature is checked by the PAL before activation.
+ */
+
+#include "logging_levels.h"
+/* define LOG_LEVEL here if you want to modify the logging level from the default */
+
+#define LOG_LEVEL    LOG_INFO
+
+#include "logging.h"
+
+#if defined( ST67W6X_NCP )
+
+/* Standard includes. */
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ota_config.h"
+
+/* OTA library includes. */
+#include "ota.h"
+#include "ota_private.h"
+#include "ota_http_private.h"
+#include "ota_mqtt_private.h"
+
+/* W6X driver includes. */
+#include "w6x_api.h"
+
+#include "ota_update_task.h"
+
+LOG_MODULE_DEFINE();
+
+/**
+ * @brief Number of range requests in flight at a time.
+ */
+#ifndef otaconfigHTTP_PARALLEL_RANGES
+    #define otaconfigHTTP_PARALLEL_RANGES    3U
+#endif
+
+/**
+ * @brief Maximum number of blocks covered by one range request.
+ */
+#ifndef otaconfigHTTP_BLOCKS_PER_RANGE
+    #define otaconfigHTTP_BLOCKS_PER_RANGE    16U
+#endif
+
+/**
+ * @brief Maximum time an HTTP client task waits for a free OTA data buffer.
+ */
+#define otahttpBUFFER_WAIT_MS              ( 10 * 1000U )
+
+/**
+ * @brief Maximum length of the server name of the pre-signed URL.
+ */
+#define otahttpMAX_SERVER_NAME_SIZE        ( 128U )
+
+#define otahttpHTTPS_PORT                  ( 443U )
+#define otahttpHTTP_PORT                   ( 80U )
+
+/**
+ * @brief Size of the block index that precedes the block data in OTA event buffers.
+ */
+#define OTA_HTTP_BLOCK_HEADER_SIZE         ( sizeof( uint32_t ) )
+
+/**
+ * @brief One range request and the block it is assembling.
+ */
+typedef struct OtaHttpRange
+{
+    volatile BaseType_t xActive; /**< pdTRUE while the W6X client task runs. */
+    BaseType_t xAccepted;        /**< pdTRUE once the response is a 206 starting at the requested offset. */
+    uint32_t ulFirstBlock;       /**< Index of the first block of the range. */
+    uint32_t ulLength;           /**< Length of the range in bytes. */
+    uint32_t ulReceived;         /**< Bytes of the range received so far. */
+    uint32_t ulFill;             /**< Bytes of the current block in ucMessage. */
+    uint8_t ucMessage[ OTA_HTTP_BLOCK_HEADER_SIZE + OTA_FILE_BLOCK_SIZE ];
+} OtaHttpRange_t;
+
+/**
+ * @brief State of the HTTP data plane for the current file.
+ */
+typedef struct OtaHttpContext
+{
+    BaseType_t xUseMqtt;                                   /**< pdTRUE once the transfer fell back to MQTT. */
+    ip_addr_t xServer;                                     /**< Resolved server address. */
+    uint16_t usPort;                                       /**< Server port, 443 for https. */
+    char cServerName[ otahttpMAX_SERVER_NAME_SIZE ];       /**< Server name, for SNI and the Host header. */
+    const char * pcPath;                                   /**< Path and query of the URL, in the file context. */
+    uint32_t ulFileSize;                                   /**< Size of the file being received. */
+    volatile BaseType_t xRoundPending;                     /**< pdTRUE when a request round waits for running ranges. */
+    OtaHttpRange_t xRanges[ otaconfigHTTP_PARALLEL_RANGES ];
+} OtaHttpContext_t;
+
+static OtaHttpContext_t xHttpContext = { 0 };
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseUrl( const char * pcUrl )
+{
+    BaseType_t xResult = pdFAIL;
+    const char * pcHost = NULL;
+    const char * pcPath = NULL;
+    size_t uxHostLength;
+
+    if( strncmp( pcUrl, "https://", 8 ) == 0 )
+    {
+        pcHost = &pcUrl[ 8 ];
+        xHttpContext.usPort = otahttpHTTPS_PORT;
+    }
+    else if( strncmp( pcUrl, "http://", 7 ) == 0 )
+    {
+        pcHost = &pcUrl[ 7 ];
+        xHttpContext.usPort = otahttpHTTP_PORT;
+    }
+
+    if( pcHost != NULL )
+    {
+        pcPath = strchr( pcHost, '/' );
+    }
+
+    if( pcPath != NULL )
+    {
+        uxHostLength = ( size_t ) ( pcPath - pcHost );
+
+        if( ( uxHostLength > 0 ) && ( uxHostLength < sizeof( xHttpContext.cServerName ) ) )
+        {
+            memcpy( xHttpContext.cServerName, pcHost, uxHostLength );
+            xHttpContext.cServerName[ uxHostLength ] = '\0';
+            xHttpContext.pcPath = pcPath;
+            xResult = pdPASS;
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvSendBlock( OtaHttpRange_t * pxRange )
+{
+    uint32_t ulBlock = pxRange->ulFirstBlock +
+                       ( ( pxRange->ulReceived - pxRange->ulFill ) >> otaconfigLOG2_FILE_BLOCK_SIZE );
+
+    memcpy( pxRange->ucMessage, &ulBlock, sizeof( ulBlock ) );
+
+    return xOTAUpdateSignalFileBlock( pxRange->ucMessage,
+                                      OTA_HTTP_BLOCK_HEADER_SIZE + pxRange->ulFill,
+                                      pdMS_TO_TICKS( otahttpBUFFER_WAIT_MS ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvParseRangeStart( const uint8_t * pucHeader,
+                                      size_t uxHeaderLength,
+                                      uint32_t * pulStart )
+{
+    static const char cField[] = "\r\nContent-Range: bytes ";
+    const size_t uxFieldLength = sizeof( cField ) - 1U;
+    BaseType_t xResult = pdFAIL;
+    size_t uxIdx;
+    size_t uxPos;
+    uint32_t ulStart;
+
+    for( uxIdx = 0; ( xResult == pdFAIL ) && ( ( uxIdx + uxFieldLength ) < uxHeaderLength ); uxIdx++ )
+    {
+        if( strncmp( ( const char * ) &pucHeader[ uxIdx ], cField, uxFieldLength ) == 0 )
+        {
+            ulStart = 0;
+
+            for( uxPos = uxIdx + uxFieldLength;
+                 ( uxPos < uxHeaderLength ) && ( pucHeader[ uxPos ] >= '0' ) && ( pucHeader[ uxPos ] <= '9' ) &&
+                 ( ulStart <= ( ( UINT32_MAX - 9U ) / 10U ) );
+                 uxPos++ )
+            {
+                ulStart = ( ulStart * 10U ) + ( uint32_t ) ( pucHeader[ uxPos ] - '0' );
+            }
+
+            if( ( uxPos > ( uxIdx + uxFieldLength ) ) && ( uxPos < uxHeaderLength ) && ( pucHeader[ uxPos ] == '-' ) )
+            {
+                *pulStart = ulStart;
+                xResult = pdPASS;
+            }
+        }
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvRangeHeaders( W6X_HTTP_state_t * pxConnection,
+                                void * pvArg,
+                                uint8_t * pucHeader,
+                                uint16_t usHeaderLength,
+                                uint32_t ulContentLength )
+{
+    OtaHttpRange_t * pxRange = ( OtaHttpRange_t * ) pvArg;
+    uint32_t ulStart = 0;
+
+    ( void ) pxConnection;
+    ( void ) ulContentLength;
+
+    /* A server that ignores the Range header answers the whole file from offset 0 */
+    pxRange->xAccepted = ( BaseType_t ) ( ( prvParseRangeStart( pucHeader, usHeaderLength, &ulStart ) == pdPASS ) &&
+                                          ( ulStart == ( pxRange->ulFirstBlock << otaconfigLOG2_FILE_BLOCK_SIZE ) ) );
+
+    return 0;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRangeResult( void * pvArg,
+                            W6X_HTTP_Status_Code_e xStatus,
+                            uint32_t ulContentLength,
+                            uint32_t ulServerResult,
+                            int32_t lErr )
+{
+    OtaHttpRange_t * pxRange = ( OtaHttpRange_t * ) pvArg;
+
+    ( void ) ulContentLength;
+    ( void ) ulServerResult;
+
+    /* Called once the status line is parsed, and again with an error when the request fails */
+    if( ( lErr == 0 ) && ( xStatus != PARTIAL_CONTENT ) )
+    {
+        LogWarn( ( "HTTP range at block %lu answered with status %d.",
+                   ( unsigned long ) pxRange->ulFirstBlock, ( int ) xStatus ) );
+        pxRange->xAccepted = pdFALSE;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRangesActive( void )
+{
+    BaseType_t xActive = pdFALSE;
+    uint32_t ulIdx;
+
+    for( ulIdx = 0; ulIdx < otaconfigHTTP_PARALLEL_RANGES; ulIdx++ )
+    {
+        if( xHttpContext.xRanges[ ulIdx ].xActive == pdTRUE )
+        {
+            xActive = pdTRUE;
+        }
+    }
+
+    return xActive;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRangeRelease( OtaHttpRange_t * pxRange )
+{
+    OtaEventMsg_t xEventMsg = { 0 };
+    BaseType_t xSignal = pdFALSE;
+
+    taskENTER_CRITICAL();
+    {
+        pxRange->xActive = pdFALSE;
+
+        if( ( xHttpContext.xRoundPending == pdTRUE ) && ( prvRangesActive() == pdFALSE ) )
+        {
+            xHttpContext.xRoundPending = pdFALSE;
+            xSignal = pdTRUE;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    /* The agent asked for the next round, usually on the last block of this one, while
+     * ranges were still running. Ask again now rather than on the request timer. */
+    if( xSignal == pdTRUE )
+    {
+        xEventMsg.eventId = OtaAgentEventRequestFileBlock;
+        ( void ) OTA_SignalEvent( &xEventMsg );
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvRangeData( void * pvArg,
+                             W6X_HTTP_buffer_t * pxBuffer,
+                             int32_t lErr )
+{
+    OtaHttpRange_t * pxRange = ( OtaHttpRange_t * ) pvArg;
+    int32_t lResult = 0;
+    uint32_t ulOffset = 0;
+    uint32_t ulChunk;
+    BaseType_t xBlockEnd;
+    BaseType_t xDone = pdFALSE;
+
+    if( pxBuffer == NULL )
+    {
+        /* End of the request. The missing blocks of a failed or short range stay set in the
+         * receive bitmap, and the next request round asks for them again. */
+        if( ( lErr != 0 ) || ( pxRange->ulReceived < pxRange->ulLength ) )
+        {
+            LogWarn( ( "HTTP range at block %lu failed after %lu of %lu bytes.",
+                       ( unsigned long ) pxRange->ulFirstBlock,
+                       ( unsigned long ) pxRange->ulReceived,
+                       ( unsigned long ) pxRange->ulLength ) );
+        }
+
+        xDone = pdTRUE;
+    }
+    else if( pxRange->xAccepted == pdFALSE )
+    {
+        LogWarn( ( "HTTP range at block %lu rejected, not a partial content response for the requested offset.",
+                   ( unsigned long ) pxRange->ulFirstBlock ) );
+        lResult = -1;
+    }
+
+    while( ( xDone == pdFALSE ) && ( lResult == 0 ) &&
+           ( ulOffset < ( uint32_t ) pxBuffer->length ) &&
+           ( pxRange->ulReceived < pxRange->ulLength ) )
+    {
+        ulChunk = ( uint32_t ) pxBuffer->length - ulOffset;
+
+        if( ulChunk > ( OTA_FILE_BLOCK_SIZE - pxRange->ulFill ) )
+        {
+            ulChunk = OTA_FILE_BLOCK_SIZE - pxRange->ulFill;
+        }
+
+        if( ulChunk > ( pxRange->ulLength - pxRange->ulReceived ) )
+        {
+            ulChunk = pxRange->ulLength - pxRange->ulReceived;
+        }
+
+        memcpy( &pxRange->ucMessage[ OTA_HTTP_BLOCK_HEADER_SIZE + pxRange->ulFill ],
+                &pxBuffer->data[ ulOffset ], ulChunk );
+        pxRange->ulFill += ulChunk;
+        pxRange->ulReceived += ulChunk;
+        ulOffset += ulChunk;
+
+        xBlockEnd = ( BaseType_t ) ( ( pxRange->ulFill == OTA_FILE_BLOCK_SIZE ) ||
+                                     ( pxRange->ulReceived == pxRange->ulLength ) );
+
+        if( xBlockEnd == pdTRUE )
+        {
+            if( prvSendBlock( pxRange ) == pdPASS )
+            {
+                pxRange->ulFill = 0;
+            }
+            else
+            {
+                LogError( ( "No OTA data buffer for HTTP block, dropping the range." ) );
+                lResult = -1;
+            }
+        }
+    }
+
+    /* The client task makes no further call once the callback returned an error. The range
+     * is only released on the last call, so that a new round cannot reuse it while the task
+     * still runs. */
+    if( ( xDone == pdTRUE ) || ( lResult != 0 ) )
+    {
+        prvRangeRelease( pxRange );
+    }
+
+    return lResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvRequestRange( OtaHttpRange_t * pxRange,
+                                   uint32_t ulFirstBlock,
+                                   uint32_t ulNumBlocks )
+{
+    W6X_HTTP_connection_t xSettings = { 0 };
+    uint32_t ulStart = ulFirstBlock << otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulEnd = ( ( ulFirstBlock + ulNumBlocks ) << otaconfigLOG2_FILE_BLOCK_SIZE ) - 1U;
+    BaseType_t xResult = pdFAIL;
+
+    if( ulEnd >= xHttpContext.ulFileSize )
+    {
+        ulEnd = xHttpContext.ulFileSize - 1U;
+    }
+
+    pxRange->ulFirstBlock = ulFirstBlock;
+    pxRange->ulLength = ulEnd - ulStart + 1U;
+    pxRange->ulReceived = 0;
+    pxRange->ulFill = 0;
+    pxRange->xAccepted = pdFALSE;
+    pxRange->xActive = pdTRUE;
+
+    xSettings.server_name = xHttpContext.cServerName;
+    xSettings.headers_done_fn = prvRangeHeaders;
+    xSettings.result_fn = prvRangeResult;
+    xSettings.recv_fn = prvRangeData;
+    xSettings.recv_fn_arg = pxRange;
+    xSettings.callback_arg = pxRange;
+    xSettings.use_range = 1;
+    xSettings.range_start = ulStart;
+    xSettings.range_end = ulEnd;
+
+    if( W6X_HTTP_Client_Request( &xHttpContext.xServer, xHttpContext.usPort, xHttpContext.pcPath, "GET",
+                                 NULL, 0, NULL, NULL, NULL, NULL, &xSettings ) == W6X_STATUS_OK )
+    {
+        LogDebug( ( "HTTP range bytes %lu-%lu requested.", ( unsigned long ) ulStart, ( unsigned long ) ulEnd ) );
+        xResult = pdPASS;
+    }
+    else
+    {
+        pxRange->xActive = pdFALSE;
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvBlockMissing( const OtaFileContext_t * pxFile,
+                                   uint32_t ulBlock )
+{
+    return ( BaseType_t ) ( ( pxFile->pRxBlockBitmap[ ulBlock >> 3 ] & ( 1U << ( ulBlock & 7U ) ) ) != 0U );
+}
+
+/*-----------------------------------------------------------*/
+
+OtaErr_t initFileTransfer_Http( const OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t xErr = OtaErrInitFileTransferFailed;
+    const OtaFileContext_t * pxFile = &( pAgentCtx->fileContext );
+    uint8_t ucAddr[ 4 ] = { 0 };
+    BaseType_t xFallback = pdTRUE;
+
+    xHttpContext.xUseMqtt = pdFALSE;
+    xHttpContext.xRoundPending = pdFALSE;
+    xHttpContext.ulFileSize = pxFile->fileSize;
+
+    if( prvRangesActive() == pdTRUE )
+    {
+        /* The agent retries the initialization when its request timer expires. */
+        LogWarn( ( "HTTP ranges of the previous transfer still running." ) );
+        xFallback = pdFALSE;
+    }
+    else if( ( pxFile->pUpdateUrlPath == NULL ) ||
+             ( prvParseUrl( ( const char * ) pxFile->pUpdateUrlPath ) != pdPASS ) )
+    {
+        LogWarn( ( "No usable pre-signed URL in the job document." ) );
+    }
+    else if( W6X_Net_GetHostAddress( xHttpContext.cServerName, ucAddr ) != W6X_STATUS_OK )
+    {
+        LogWarn( ( "Could not resolve %s.", xHttpContext.cServerName ) );
+    }
+    else
+    {
+        memset( &xHttpContext.xServer, 0, sizeof( xHttpContext.xServer ) );
+        memcpy( &xHttpContext.xServer.u_addr.ip4, ucAddr, sizeof( ucAddr ) );
+        LogInfo( ( "OTA data over HTTP from %s, %u ranges of up to %u blocks in flight.",
+                   xHttpContext.cServerName,
+                   otaconfigHTTP_PARALLEL_RANGES,
+                   otaconfigHTTP_BLOCKS_PER_RANGE ) );
+        xErr = OtaErrNone;
+    }
+
+    if( ( xErr != OtaErrNone ) && ( xFallback == pdTRUE ) &&
+        ( pxFile->pStreamName != NULL ) && ( pxFile->pStreamName[ 0 ] != '\0' ) )
+    {
+        LogWarn( ( "Falling back to the MQTT stream %s.", pxFile->pStreamName ) );
+        xHttpContext.xUseMqtt = pdTRUE;
+        xErr = initFileTransfer_Mqtt( pAgentCtx );
+    }
+
+    return xErr;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaErr_t requestDataBlock_Http( OtaAgentContext_t * pAgentCtx )
+{
+    const OtaFileContext_t * pxFile = &( pAgentCtx->fileContext );
+    uint32_t ulNumBlocks = ( pxFile->fileSize + ( OTA_FILE_BLOCK_SIZE - 1U ) ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulBlock = 0;
+    uint32_t ulRun;
+    uint32_t ulIdx;
+    uint32_t ulRequested = 0;
+    OtaErr_t xErr = OtaErrNone;
+
+    if( xHttpContext.xUseMqtt == pdTRUE )
+    {
+        return requestFileBlock_Mqtt( pAgentCtx );
+    }
+
+    /* Ranges of the previous round are still arriving, the last one to end asks again */
+    taskENTER_CRITICAL();
+    {
+        xHttpContext.xRoundPending = prvRangesActive();
+    }
+    taskEXIT_CRITICAL();
+
+    if( xHttpContext.xRoundPending == pdTRUE )
+    {
+        return OtaErrNone;
+    }
+
+    for( ulIdx = 0; ( ulIdx < otaconfigHTTP_PARALLEL_RANGES ) && ( ulBlock < ulNumBlocks ); ulIdx++ )
+    {
+        while( ( ulBlock < ulNumBlocks ) && ( prvBlockMissing( pxFile, ulBlock ) == pdFALSE ) )
+        {
+            ulBlock++;
+        }
+
+        ulRun = 0;
+
+        while( ( ( ulBlock + ulRun ) < ulNumBlocks ) &&
+               ( ulRun < otaconfigHTTP_BLOCKS_PER_RANGE ) &&
+               ( prvBlockMissing( pxFile, ulBlock + ulRun ) == pdTRUE ) )
+        {
+            ulRun++;
+        }
+
+        if( ulRun == 0 )
+        {
+            break;
+        }
+
+        if( prvRequestRange( &xHttpContext.xRanges[ ulIdx ], ulBlock, ulRun ) == pdPASS )
+        {
+            ulRequested += ulRun;
+        }
+
+        ulBlock += ulRun;
+    }
+
+    if( ulRequested > 0 )
+    {
+        pAgentCtx->numOfBlocksToReceive = ulRequested;
+    }
+    else
+    {
+        xErr = OtaErrRequestFileBlockFailed;
+    }
+
+    return xErr;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaErr_t decodeFileBlock_Http( const uint8_t * pMessageBuffer,
+                               size_t messageSize,
+                               int32_t * pFileId,
+                               int32_t * pBlockId,
+                               int32_t * pBlockSize,
+                               uint8_t * const * pPayload,
+                               size_t * pPayloadSize )
+{
+    OtaErr_t xErr = OtaErrInvalidArg;
+    uint32_t ulBlock;
+
+    if( xHttpContext.xUseMqtt == pdTRUE )
+    {
+        return decodeFileBlock_Mqtt( pMessageBuffer, messageSize, pFileId, pBlockId,
+                                     pBlockSize, pPayload, pPayloadSize );
+    }
+
+    if( ( pMessageBuffer != NULL ) && ( pFileId != NULL ) && ( pBlockId != NULL ) &&
+        ( pBlockSize != NULL ) && ( pPayload != NULL ) && ( *pPayload != NULL ) &&
+        ( pPayloadSize != NULL ) && ( messageSize > OTA_HTTP_BLOCK_HEADER_SIZE ) &&
+        ( ( messageSize - OTA_HTTP_BLOCK_HEADER_SIZE ) <= *pPayloadSize ) )
+    {
+        memcpy( &ulBlock, pMessageBuffer, sizeof( ulBlock ) );
+
+        *pFileId = 0;
+        *pBlockId = ( int32_t ) ulBlock;
+        *pBlockSize = ( int32_t ) ( messageSize - OTA_HTTP_BLOCK_HEADER_SIZE );
+        memcpy( *pPayload, &pMessageBuffer[ OTA_HTTP_BLOCK_HEADER_SIZE ], messageSize - OTA_HTTP_BLOCK_HEADER_SIZE );
+        *pPayloadSize = messageSize - OTA_HTTP_BLOCK_HEADER_SIZE;
+        xErr = OtaErrNone;
+    }
+
+    return xErr;
+}
+
+/*-----------------------------------------------------------*/
+
+OtaErr_t cleanupData_Http( const OtaAgentContext_t * pAgentCtx )
+{
+    OtaErr_t xErr = OtaErrNone;
+
+    if( xHttpContext.xUseMqtt == pdTRUE )
+    {
+        xErr = cleanupData_Mqtt( pAgentCtx );
+        xHttpContext.xUseMqtt = pdFALSE;
+    }
+
+    xHttpContext.xRoundPending = pdFALSE;
+
+    /* Running ranges end on their own, their blocks are then ignored as unexpected. */
+    return xErr;
+}
+
+/*-----------------------------------------------------------*/
+
+const char * OTA_HTTP_strerror( OtaHttpStatus_t status )
+{
+    const char * str = NULL;
+
+    switch( status )
+    {
+        case OtaHttpSuccess:
+            str = "OtaHttpSuccess";
+            break;
+
+        case OtaHttpInitFailed:
+            str = "OtaHttpInitFailed";
+            break;
+
+        case OtaHttpDeinitFailed:
+            str = "OtaHttpDeinitFailed";
+            break;
+
+        case OtaHttpRequestFailed:
+            str = "OtaHttpRequestFailed";
+            break;
+
+        default:
+            str = "InvalidErrorCode";
+            break;
+    }
+
+    return str;
+}
+
+#endif /* defined( ST67W6X_NCP ) */
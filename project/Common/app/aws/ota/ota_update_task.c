@@ -75,6 +75,9 @@
 #include "ota_os_freertos.h"
 #include "ota_mqtt_interface.h"
 
+/* Data protocol selection (OTA_DATA_OVER_MQTT / OTA_DATA_OVER_HTTP). */
+#include "ota_interface_private.h"
+
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
 
@@ -85,11 +88,14 @@
 
 #include "kvstore.h"
 
+#include "ota_update_task.h"
+
 #ifdef TFM_PSA_API
     #include "tfm_fwu_defs.h"
     #include "psa/update.h"
 #endif
 
+LOG_MODULE_DEFINE();
 
 /*------------- Demo configurations -------------------------*/
 #if DEMO_HOME_ASSISTANT
@@ -205,6 +211,16 @@ volatile AppVersion32_t newAppFirmwareVersion;
  */
 #define otaexampleAGENT_TASK_STACK_SIZE          ( 4096 )
 
+/**
+ * @brief Data block request window used for the first stream request of a file.
+ */
+#define otaexampleWINDOW_INITIAL_BLOCKS          ( 2U )
+
+/**
+ * @brief Substring identifying stream requests among the OTA agent publishes.
+ */
+#define OTA_STREAM_REQUEST_TOPIC_MARKER          "/streams/"
+
 static const char * pOtaAgentStateStrings[ OtaAgentStateAll + 1 ] =
 {
     "Init",
@@ -232,6 +248,7 @@ typedef struct OtaEventBufferPool
 {
     OtaEventData_t eventBuffer[ otaconfigMAX_NUM_OTA_DATA_BUFFERS ];
     SemaphoreHandle_t lock;
+    SemaphoreHandle_t freed; /* Given each time a buffer returns to the pool. */
 } OtaEventBufferPool_t;
 
 /**
@@ -271,9 +288,43 @@ typedef struct OtaAppStaticBuffer
      */
     uint8_t bitmap[ OTA_MAX_BLOCK_BITMAP_SIZE ];
 
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+
+        /**
+         * @brief Buffer used to store the pre-signed URL of the HTTP data plane.
+         * Buffer is passed to the OTA agent during initialization.
+         */
+        uint8_t updateUrl[ OTA_REQUEST_URL_MAX_SIZE ];
+    #endif
+
     OtaEventBufferPool_t eventBufferPool;
 } OtaAppStaticBuffer_t;
 
+/**
+ * @brief State of the adaptive data block request window.
+ *
+ * The window is the number of blocks asked for in each stream request. It starts at
+ * otaexampleWINDOW_INITIAL_BLOCKS, doubles while whole windows arrive up to the slow
+ * start threshold, then grows by one block per clean window. A short window or a block
+ * dropped for lack of a data buffer halves it. The round trip time of stream requests
+ * is smoothed as in RFC 6298 and sets the file request wait time.
+ */
+typedef struct OtaDataWindow
+{
+    uint32_t ulWindow;             /**< Blocks to ask for in the next stream request. */
+    uint32_t ulSlowStartThreshold; /**< Window above which growth is linear. */
+    uint32_t ulRequested;          /**< Blocks asked for by the outstanding request. */
+    uint32_t ulReceived;           /**< Blocks received since the outstanding request. */
+    uint32_t ulDropped;            /**< Blocks dropped since the outstanding request. */
+    uint32_t ulRequests;           /**< Stream requests sent for the current file. */
+    uint32_t ulBlocks;             /**< Blocks received for the current file. */
+    uint32_t ulSmoothedRttMs;      /**< Smoothed stream request round trip time, 0 until sampled. */
+    uint32_t ulRttVarMs;           /**< Round trip time variation. */
+    TickType_t xRequestTick;       /**< Tick count of the outstanding request. */
+    TickType_t xStartTick;         /**< Tick count of the first request of the current file. */
+    BaseType_t xRttPending;        /**< pdTRUE until the first block of the request arrives. */
+} OtaDataWindow_t;
+
 /**
  * @brief Defines the structure to use as the command callback context in this
  * demo.
@@ -455,12 +506,60 @@ static BaseType_t prvMatchClientIdentifierInTopic( const char * pTopic,
  */
 static inline BaseType_t xIsOtaAgentActive( void );
 
+/**
+ * @brief Returns pdTRUE if a substring occurs within a topic that is not null terminated.
+ *
+ * @param[in] pTopic Pointer to the topic.
+ * @param[in] topicNameLength Length of the topic.
+ * @param[in] pcNeedle Null terminated substring to look for.
+ * @return pdTRUE if pcNeedle is found in the topic.
+ */
+static BaseType_t prvTopicContains( const char * pTopic,
+                                    size_t topicNameLength,
+                                    const char * pcNeedle );
+
+/**
+ * @brief Returns the number of data buffers not held by the OTA agent.
+ *
+ * @param[in] pxBufferPool Pool of event buffers.
+ * @return Number of free event buffers.
+ */
+static uint32_t prvOTAEventBufferFreeCount( OtaEventBufferPool_t * pxBufferPool );
+
+/**
+ * @brief Resets the request window, logging the transfer summary of the previous file.
+ */
+static void prvDataWindowReset( void );
+
+/**
+ * @brief Updates the request window when the OTA agent sends a stream request.
+ *
+ * Called after the request is published, with the window the agent asked for.
+ */
+static void prvDataWindowOnRequest( void );
+
+/**
+ * @brief Accounts for a data block received, or dropped for lack of a buffer.
+ *
+ * @param[in] xDropped pdTRUE if the block could not be passed to the agent.
+ */
+static void prvDataWindowOnBlock( BaseType_t xDropped );
+
 /**
  * @brief Static buffer allocated by application and used by OTA Agent.
  * Buffer is allocated in the global scope outside of function call stack.
  */
 static OtaAppStaticBuffer_t xAppStaticBuffer = { 0 };
 
+/**
+ * @brief Adaptive data block request window.
+ */
+static OtaDataWindow_t xDataWindow =
+{
+    .ulWindow             = otaexampleWINDOW_INITIAL_BLOCKS,
+    .ulSlowStartThreshold = otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT
+};
+
 /**
  * @brief Pointer which holds the thing name received from key value store.
  */
@@ -483,8 +582,9 @@ static BaseType_t prvOTAEventBufferPoolInit( OtaEventBufferPool_t * pxBufferPool
     memset( pxBufferPool->eventBuffer, 0x00, sizeof( pxBufferPool->eventBuffer ) );
 
     pxBufferPool->lock = xSemaphoreCreateMutex();
+    pxBufferPool->freed = xSemaphoreCreateCounting( otaconfigMAX_NUM_OTA_DATA_BUFFERS, 0 );
 
-    if( pxBufferPool->lock != NULL )
+    if( ( pxBufferPool->lock != NULL ) && ( pxBufferPool->freed != NULL ) )
     {
         poolInit = pdTRUE;
     }
@@ -503,6 +603,7 @@ static void prvOTAEventBufferFree( OtaEventBufferPool_t * pxBufferPool,
     {
         pxBuffer->bufferUsed = false;
         ( void ) xSemaphoreGive( pxBufferPool->lock );
+        ( void ) xSemaphoreGive( pxBufferPool->freed );
     }
     else
     {
@@ -541,6 +642,203 @@ static OtaEventData_t * prvOTAEventBufferGet( OtaEventBufferPool_t * pxBufferPoo
     return pFreeBuffer;
 }
 
+/*-----------------------------------------------------------*/
+
+static uint32_t prvOTAEventBufferFreeCount( OtaEventBufferPool_t * pxBufferPool )
+{
+    uint32_t ulIndex = 0;
+    uint32_t ulFree = 0;
+
+    configASSERT( pxBufferPool != NULL );
+
+    if( xSemaphoreTake( pxBufferPool->lock, portMAX_DELAY ) == pdTRUE )
+    {
+        for( ulIndex = 0; ulIndex < otaconfigMAX_NUM_OTA_DATA_BUFFERS; ulIndex++ )
+        {
+            if( pxBufferPool->eventBuffer[ ulIndex ].bufferUsed == false )
+            {
+                ulFree++;
+            }
+        }
+
+        ( void ) xSemaphoreGive( pxBufferPool->lock );
+    }
+
+    return ulFree;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulOtaDataWindowGet( void )
+{
+    return xDataWindow.ulWindow;
+}
+
+/*-----------------------------------------------------------*/
+
+uint32_t ulOtaDataRequestWaitMs( void )
+{
+    uint32_t ulWaitMs = otaconfigFILE_REQUEST_WAIT_MAX_MS;
+
+    if( xDataWindow.ulSmoothedRttMs != 0 )
+    {
+        /* Retransmission timeout of RFC 6298, doubled to cover the transfer of a whole window. */
+        ulWaitMs = 2U * ( xDataWindow.ulSmoothedRttMs + ( 4U * xDataWindow.ulRttVarMs ) );
+
+        if( ulWaitMs < otaconfigFILE_REQUEST_WAIT_MIN_MS )
+        {
+            ulWaitMs = otaconfigFILE_REQUEST_WAIT_MIN_MS;
+        }
+        else if( ulWaitMs > otaconfigFILE_REQUEST_WAIT_MAX_MS )
+        {
+            ulWaitMs = otaconfigFILE_REQUEST_WAIT_MAX_MS;
+        }
+    }
+
+    return ulWaitMs;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDataWindowReset( void )
+{
+    TickType_t xElapsed;
+
+    if( xDataWindow.ulRequests > 0 )
+    {
+        xElapsed = xTaskGetTickCount() - xDataWindow.xStartTick;
+
+        LogInfo( ( "OTA data transfer: %lu blocks in %lu ms over %lu requests, window %lu, srtt %lu ms.",
+                   ( unsigned long ) xDataWindow.ulBlocks,
+                   ( unsigned long ) pdTICKS_TO_MS( xElapsed ),
+                   ( unsigned long ) xDataWindow.ulRequests,
+                   ( unsigned long ) xDataWindow.ulWindow,
+                   ( unsigned long ) xDataWindow.ulSmoothedRttMs ) );
+    }
+
+    taskENTER_CRITICAL();
+    memset( &xDataWindow, 0x00, sizeof( xDataWindow ) );
+    xDataWindow.ulWindow = otaexampleWINDOW_INITIAL_BLOCKS;
+    xDataWindow.ulSlowStartThreshold = otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT;
+    taskEXIT_CRITICAL();
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDataWindowOnRequest( void )
+{
+    uint32_t ulSent;
+    uint32_t ulWindow;
+    uint32_t ulFree;
+    BaseType_t xLoss;
+    BaseType_t xComplete;
+
+    ulFree = prvOTAEventBufferFreeCount( &xAppStaticBuffer.eventBufferPool );
+
+    taskENTER_CRITICAL();
+    {
+        ulSent = xDataWindow.ulWindow;
+        ulWindow = xDataWindow.ulWindow;
+        xLoss = ( BaseType_t ) ( xDataWindow.ulDropped > 0 );
+        xComplete = ( BaseType_t ) ( ( xDataWindow.ulRequested > 0 ) &&
+                                     ( xDataWindow.ulReceived >= xDataWindow.ulRequested ) );
+
+        if( xDataWindow.ulRequests == 0 )
+        {
+            xDataWindow.xStartTick = xTaskGetTickCount();
+        }
+        else if( ( xLoss == pdTRUE ) || ( xComplete == pdFALSE ) )
+        {
+            /* The previous window came back short: multiplicative decrease. */
+            xDataWindow.ulSlowStartThreshold = ( ulWindow > 2U ) ? ( ulWindow / 2U ) : 1U;
+            ulWindow = xDataWindow.ulSlowStartThreshold;
+        }
+        else if( ulWindow < xDataWindow.ulSlowStartThreshold )
+        {
+            ulWindow *= 2U;
+        }
+        else
+        {
+            ulWindow++;
+        }
+
+        /* One buffer stays reserved for job documents, the rest bound the window. */
+        if( ulWindow > otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT )
+        {
+            ulWindow = otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT;
+        }
+
+        if( ulWindow > ( otaconfigMAX_NUM_OTA_DATA_BUFFERS - 1U ) )
+        {
+            ulWindow = otaconfigMAX_NUM_OTA_DATA_BUFFERS - 1U;
+        }
+
+        if( ( ulFree > 1U ) && ( ulWindow > ( ulFree - 1U ) ) )
+        {
+            ulWindow = ulFree - 1U;
+        }
+
+        if( ulWindow == 0 )
+        {
+            ulWindow = 1U;
+        }
+
+        xDataWindow.ulWindow = ulWindow;
+        xDataWindow.ulRequested = ulSent;
+        xDataWindow.ulReceived = 0;
+        xDataWindow.ulDropped = 0;
+        xDataWindow.ulRequests++;
+        xDataWindow.xRequestTick = xTaskGetTickCount();
+        xDataWindow.xRttPending = pdTRUE;
+    }
+    taskEXIT_CRITICAL();
+
+    LogDebug( ( "Stream request for %lu blocks, next window %lu, %lu buffers free.",
+                ( unsigned long ) ulSent, ( unsigned long ) ulWindow, ( unsigned long ) ulFree ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvDataWindowOnBlock( BaseType_t xDropped )
+{
+    uint32_t ulSampleMs;
+    uint32_t ulDeltaMs;
+
+    taskENTER_CRITICAL();
+    {
+        if( xDropped == pdTRUE )
+        {
+            xDataWindow.ulDropped++;
+        }
+        else
+        {
+            xDataWindow.ulReceived++;
+            xDataWindow.ulBlocks++;
+        }
+
+        if( xDataWindow.xRttPending == pdTRUE )
+        {
+            xDataWindow.xRttPending = pdFALSE;
+            ulSampleMs = pdTICKS_TO_MS( xTaskGetTickCount() - xDataWindow.xRequestTick );
+
+            if( xDataWindow.ulSmoothedRttMs == 0 )
+            {
+                xDataWindow.ulSmoothedRttMs = ( ulSampleMs > 0 ) ? ulSampleMs : 1U;
+                xDataWindow.ulRttVarMs = ulSampleMs / 2U;
+            }
+            else
+            {
+                ulDeltaMs = ( ulSampleMs > xDataWindow.ulSmoothedRttMs ) ?
+                            ( ulSampleMs - xDataWindow.ulSmoothedRttMs ) :
+                            ( xDataWindow.ulSmoothedRttMs - ulSampleMs );
+                xDataWindow.ulRttVarMs = ( ( 3U * xDataWindow.ulRttVarMs ) + ulDeltaMs ) / 4U;
+                xDataWindow.ulSmoothedRttMs = ( ( 7U * xDataWindow.ulSmoothedRttMs ) + ulSampleMs ) / 8U;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
 /*-----------------------------------------------------------*/
 static void prvOTAAgentTask( void * pvParam )
 {
@@ -745,6 +1043,8 @@ static void otaAppCallback( OtaJobEvent_t event,
         case OtaJobEventActivate:
             LogInfo( ( "Received OtaJobEventActivate callback from OTA Agent." ) );
 
+            prvDataWindowReset();
+
             /**
              * Activate the new firmware image immediately. Applications can choose to postpone
              * the activation to a later stage if needed.
@@ -766,6 +1066,8 @@ static void otaAppCallback( OtaJobEvent_t event,
              */
             LogInfo( ( "Received an OtaJobEventFail notification from OTA Agent." ) );
 
+            prvDataWindowReset();
+
             break;
 
         case OtaJobEventStartTest:
@@ -857,8 +1159,6 @@ static void prvProcessIncomingData( void * pxContext,
                                     MQTTPublishInfo_t * pPublishInfo )
 {
     BaseType_t isMatch = pdFALSE;
-    OtaEventData_t * pData;
-    OtaEventMsg_t eventMsg = { 0 };
 
     ( void ) pxContext;
 
@@ -876,22 +1176,7 @@ static void prvProcessIncomingData( void * pxContext,
         {
             LogDebug( ( "Received OTA image block, size %d.\n\n", pPublishInfo->payloadLength ) );
 
-            pData = prvOTAEventBufferGet( &xAppStaticBuffer.eventBufferPool );
-
-            if( pData != NULL )
-            {
-                memcpy( pData->data, pPublishInfo->pPayload, pPublishInfo->payloadLength );
-                pData->dataLength = pPublishInfo->payloadLength;
-                eventMsg.eventId = OtaAgentEventReceivedFileBlock;
-                eventMsg.pEventData = pData;
-
-                /* Send job document received event. */
-                OTA_SignalEvent( &eventMsg );
-            }
-            else
-            {
-                LogError( ( "Error: No OTA data buffers available.\r\n" ) );
-            }
+            ( void ) xOTAUpdateSignalFileBlock( pPublishInfo->pPayload, pPublishInfo->payloadLength, 0 );
         }
         else
         {
@@ -910,6 +1195,69 @@ static void prvProcessIncomingData( void * pxContext,
 
 /*-----------------------------------------------------------*/
 
+BaseType_t xOTAUpdateSignalFileBlock( const uint8_t * pucData,
+                                      size_t uxLength,
+                                      TickType_t xTicksToWait )
+{
+    BaseType_t xResult = pdFAIL;
+    OtaEventData_t * pData;
+    OtaEventMsg_t eventMsg = { 0 };
+    TimeOut_t xTimeOut;
+    TickType_t xRemainingTicks = xTicksToWait;
+
+    if( uxLength > OTA_DATA_BLOCK_SIZE )
+    {
+        prvDataWindowOnBlock( pdTRUE );
+        LogError( ( "Dropping OTA data block of size %lu, larger than the maximum size %lu.",
+                    ( unsigned long ) uxLength, ( unsigned long ) OTA_DATA_BLOCK_SIZE ) );
+
+        return pdFAIL;
+    }
+
+    vTaskSetTimeOutState( &xTimeOut );
+
+    pData = prvOTAEventBufferGet( &xAppStaticBuffer.eventBufferPool );
+
+    /* Data planes that can hold off their sender wait for the agent to release a buffer.
+     * A give may be left over from a buffer another sender already took, so check again
+     * after each wakeup. */
+    while( ( pData == NULL ) &&
+           ( xTaskCheckForTimeOut( &xTimeOut, &xRemainingTicks ) == pdFALSE ) &&
+           ( xSemaphoreTake( xAppStaticBuffer.eventBufferPool.freed, xRemainingTicks ) == pdTRUE ) )
+    {
+        pData = prvOTAEventBufferGet( &xAppStaticBuffer.eventBufferPool );
+    }
+
+    if( pData != NULL )
+    {
+        memcpy( pData->data, pucData, uxLength );
+        pData->dataLength = uxLength;
+        eventMsg.eventId = OtaAgentEventReceivedFileBlock;
+        eventMsg.pEventData = pData;
+
+        prvDataWindowOnBlock( pdFALSE );
+
+        /* Send file block received event. */
+        if( OTA_SignalEvent( &eventMsg ) == true )
+        {
+            xResult = pdPASS;
+        }
+        else
+        {
+            prvOTAEventBufferFree( &xAppStaticBuffer.eventBufferPool, pData );
+        }
+    }
+    else
+    {
+        prvDataWindowOnBlock( pdTRUE );
+        LogError( ( "Error: No OTA data buffers available.\r\n" ) );
+    }
+
+    return xResult;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvProcessIncomingJobMessage( void * pxSubscriptionContext,
                                           MQTTPublishInfo_t * pPublishInfo )
 {
@@ -1037,6 +1385,28 @@ static BaseType_t prvMatchClientIdentifierInTopic( const char * pTopic,
 
 /*-----------------------------------------------------------*/
 
+static BaseType_t prvTopicContains( const char * pTopic,
+                                    size_t topicNameLength,
+                                    const char * pcNeedle )
+{
+    BaseType_t xFound = pdFALSE;
+    size_t uxNeedleLength = strlen( pcNeedle );
+    size_t idx;
+
+    for( idx = 0; ( idx + uxNeedleLength ) <= topicNameLength; idx++ )
+    {
+        if( strncmp( &pTopic[ idx ], pcNeedle, uxNeedleLength ) == 0 )
+        {
+            xFound = pdTRUE;
+            break;
+        }
+    }
+
+    return xFound;
+}
+
+/*-----------------------------------------------------------*/
+
 static void prvCommandCallback( MQTTAgentCommandContext_t * pCommandContext,
                                 MQTTAgentReturnInfo_t * pxReturnInfo )
 {
@@ -1136,6 +1506,13 @@ static OtaMqttStatus_t prvMQTTPublish( const char * const pacTopic,
     }
     else
     {
+        /* The first blocks may come back before the publish completes, so the window
+         * moves on to the request before it is sent. */
+        if( prvTopicContains( pacTopic, topicLen, OTA_STREAM_REQUEST_TOPIC_MARKER ) == pdTRUE )
+        {
+            prvDataWindowOnRequest();
+        }
+
         mqttStatus = MQTTAgent_Publish( xMQTTAgentHandle,
                                         &publishInfo,
                                         &xCommandParams );
@@ -1269,6 +1646,10 @@ static void prvSetOTAAppBuffer( OtaAppBuffer_t * pOtaAppBuffer )
     pOtaAppBuffer->decodeMemorySize = ( 1U << otaconfigLOG2_FILE_BLOCK_SIZE );
     pOtaAppBuffer->pFileBitmap = xAppStaticBuffer.bitmap;
     pOtaAppBuffer->fileBitmapSize = OTA_MAX_BLOCK_BITMAP_SIZE;
+    #if ( configENABLED_DATA_PROTOCOLS & OTA_DATA_OVER_HTTP )
+        pOtaAppBuffer->pUrl = xAppStaticBuffer.updateUrl;
+        pOtaAppBuffer->urlSize = OTA_REQUEST_URL_MAX_SIZE;
+    #endif
 }
 
 static inline BaseType_t xIsOtaAgentActive( void )
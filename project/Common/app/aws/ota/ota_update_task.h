@@ -0,0 +1,51 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _OTA_UPDATE_TASK_H_
+#define _OTA_UPDATE_TASK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+void vOTAUpdateTask( void * pvParam );
+
+void vSuspendOTAUpdate( void );
+
+void vResumeOTAUpdate( void );
+
+/**
+ * @brief Passes a received file block message to the OTA agent.
+ *
+ * Copies the message into a free OTA event buffer and signals it as a received file
+ * block. Used by the data planes that run outside of the MQTT agent.
+ *
+ * @param[in] pucData Message as expected by the active data interface decoder.
+ * @param[in] uxLength Length of the message.
+ * @param[in] xTicksToWait Time to wait for an event buffer to be freed by the agent.
+ * @return pdPASS if the block was queued to the agent.
+ */
+BaseType_t xOTAUpdateSignalFileBlock( const uint8_t * pucData,
+                                      size_t uxLength,
+                                      TickType_t xTicksToWait );
+
+#endif /* _OTA_UPDATE_TASK_H_ */
@@ -76,6 +76,8 @@
 
 #include "kvstore.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief Format string representing a Shadow document with a "reported" state.
  *
@@ -51,6 +51,8 @@
 
 #include "interrupt_handlers.h"
 
+LOG_MODULE_DEFINE();
+
 # define MAXT_TOPIC_LENGTH 64
 static char publish_topic[MAXT_TOPIC_LENGTH];
 #define BUTTON_RISING_EVENT    (1 << 0)
@@ -32,6 +32,8 @@
 #include "lwip/sockets.h"
 #endif
 
+LOG_MODULE_DEFINE();
+
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private Macro -------------------------------------------------------------*/
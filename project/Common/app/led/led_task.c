@@ -56,6 +56,8 @@
 /* JSON library includes. */
 #include "core_json.h"
 
+LOG_MODULE_DEFINE();
+
 # define MAXT_TOPIC_LENGTH 64
 static char subscribe_topic[MAXT_TOPIC_LENGTH];
 static char publish_topic[MAXT_TOPIC_LENGTH];
@@ -47,6 +47,8 @@
 /* Header include. */
 #include "freertos_command_pool.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief The pool of command structures used to hold information on commands (such
  * as PUBLISH or SUBSCRIBE) between the command being created by an API call and
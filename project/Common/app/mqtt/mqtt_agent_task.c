@@ -69,6 +69,8 @@
 #endif
 #include "sys_evt.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -21,6 +21,8 @@
 
 #include "kvstore.h"
 
+LOG_MODULE_DEFINE();
+
 #define PING_INTERVAL_MS   1000
 #define PING_PAYLOAD_SIZE  32
 #define PING_TIMEOUT_MS    1000
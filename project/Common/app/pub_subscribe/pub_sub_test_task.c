@@ -52,6 +52,8 @@
 
 #include "kvstore.h"
 
+LOG_MODULE_DEFINE();
+
 # define MAXT_TOPIC_LENGTH 64
 static char topic[MAXT_TOPIC_LENGTH];
 
@@ -66,6 +66,8 @@ static LPS22HH_Object_t LPS22HH_Obj;
 #define BSP_ERROR_NONE 0
 #endif
 
+LOG_MODULE_DEFINE();
+
 typedef struct
 {
   float_t fTemperature0;
@@ -94,6 +94,8 @@ typedef struct
 } MotionSensorData_t;
 #endif
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief Size of statically allocated buffers for holding topic names and
  * payloads.
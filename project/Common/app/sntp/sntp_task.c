@@ -35,6 +35,8 @@
 
 #include "sntp_task.h"
 
+LOG_MODULE_DEFINE();
+
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private define ------------------------------------------------------------*/
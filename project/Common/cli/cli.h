@@ -31,8 +31,6 @@
 
 #define CLI_UART_RX_READ_SZ_10MS      128
 
-#define CLI_UART_TX_WRITE_SZ_5MS      64
-
 #define CLI_UART_RX_STREAM_LEN        512
 
 #define CLI_UART_TX_STREAM_LEN        2304
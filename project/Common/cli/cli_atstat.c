@@ -0,0 +1,117 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#if defined( ST67W6X_NCP )
+
+#include "w61_at_api.h"
+
+static void vAtStatCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_atstat =
+{
+    "atstat",
+    "atstat [reset]\r\n"
+    "    Display the AT commands sent to the Wi-Fi module, their rate and how\r\n"
+    "    long they held the command channel. \"reset\" clears the counters\r\n"
+    "    after displaying them.\r\n\n",
+    vAtStatCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintStats( ConsoleIO_t * const pxCIO,
+                           const W61_AT_Stats_t * pxStats )
+{
+    uint32_t ulElapsedMs = pdTICKS_TO_MS( xTaskGetTickCount() - pxStats->StartTick );
+    uint32_t ulCmdPerSec = 0;
+    uint32_t ulAvgHoldMs = 0;
+    int lRslt;
+
+    if( ulElapsedMs > 0 )
+    {
+        ulCmdPerSec = ( uint32_t ) ( ( ( uint64_t ) pxStats->Commands * 1000ULL ) / ulElapsedMs );
+    }
+
+    if( pxStats->Commands > 0 )
+    {
+        ulAvgHoldMs = pxStats->HoldTimeTotalMs / pxStats->Commands;
+    }
+
+    lRslt = snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "commands      %lu in %lu ms (%lu/s)\r\n"
+                      "contended     %lu\r\n"
+                      "busy          %lu\r\n"
+                      "stale resp    %lu\r\n"
+                      "hold ms       avg %lu max %lu\r\n",
+                      ( unsigned long ) pxStats->Commands,
+                      ( unsigned long ) ulElapsedMs,
+                      ( unsigned long ) ulCmdPerSec,
+                      ( unsigned long ) pxStats->LockContended,
+                      ( unsigned long ) pxStats->LockBusy,
+                      ( unsigned long ) pxStats->StaleResponses,
+                      ( unsigned long ) ulAvgHoldMs,
+                      ( unsigned long ) pxStats->HoldTimeMaxMs );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+static void vAtStatCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] )
+{
+    W61_AT_Stats_t xStats;
+
+    if( ulArgc == 1 )
+    {
+        W61_AT_GetStats( W61_ObjGet(), &xStats, 0 );
+        prvPrintStats( pxCIO, &xStats );
+    }
+    else if( ( ulArgc == 2 ) && ( strcmp( ppcArgv[ 1 ], "reset" ) == 0 ) )
+    {
+        W61_AT_GetStats( W61_ObjGet(), &xStats, 1 );
+        prvPrintStats( pxCIO, &xStats );
+    }
+    else
+    {
+        pxCIO->print( xCommandDef_atstat.pcHelpString );
+    }
+}
+
+#endif /* ST67W6X_NCP */
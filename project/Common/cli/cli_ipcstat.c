@@ -0,0 +1,113 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#if defined( MXCHIP )
+
+#include "mx_ipc.h"
+
+static void vIpcStatCommand( ConsoleIO_t * const pxCIO,
+                             uint32_t ulArgc,
+                             char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_ipcstat =
+{
+    "ipcstat",
+    "ipcstat [reset]\r\n"
+    "    Display the control plane requests sent to the Wi-Fi module, how many\r\n"
+    "    were outstanding at once and their response times. \"reset\" clears\r\n"
+    "    the counters after displaying them.\r\n\n",
+    vIpcStatCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintStats( ConsoleIO_t * const pxCIO,
+                           const IPCStats_t * pxStats )
+{
+    uint32_t ulAvgLatencyMs = 0;
+    int lRslt;
+
+    if( pxStats->ulResponses > 0 )
+    {
+        ulAvgLatencyMs = pxStats->ulTotalLatencyMs / pxStats->ulResponses;
+    }
+
+    lRslt = snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "requests      %lu\r\n"
+                      "responses     %lu\r\n"
+                      "timeouts      %lu\r\n"
+                      "dropped       %lu\r\n"
+                      "outstanding   %lu (max %lu of %lu contexts)\r\n"
+                      "context waits %lu\r\n"
+                      "latency ms    avg %lu max %lu\r\n",
+                      ( unsigned long ) pxStats->ulRequests,
+                      ( unsigned long ) pxStats->ulResponses,
+                      ( unsigned long ) pxStats->ulTimeouts,
+                      ( unsigned long ) pxStats->ulDropped,
+                      ( unsigned long ) pxStats->ulOutstanding,
+                      ( unsigned long ) pxStats->ulMaxOutstanding,
+                      ( unsigned long ) pxStats->ulContexts,
+                      ( unsigned long ) pxStats->ulContextWaits,
+                      ( unsigned long ) ulAvgLatencyMs,
+                      ( unsigned long ) pxStats->ulMaxLatencyMs );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+static void vIpcStatCommand( ConsoleIO_t * const pxCIO,
+                             uint32_t ulArgc,
+                             char * ppcArgv[] )
+{
+    IPCStats_t xStats;
+
+    if( ulArgc == 1 )
+    {
+        mx_GetIPCStats( &xStats, pdFALSE );
+        prvPrintStats( pxCIO, &xStats );
+    }
+    else if( ( ulArgc == 2 ) && ( strcmp( ppcArgv[ 1 ], "reset" ) == 0 ) )
+    {
+        mx_GetIPCStats( &xStats, pdTRUE );
+        prvPrintStats( pxCIO, &xStats );
+    }
+    else
+    {
+        pxCIO->print( xCommandDef_ipcstat.pcHelpString );
+    }
+}
+
+#endif /* MXCHIP */
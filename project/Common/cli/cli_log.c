@@ -0,0 +1,302 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+#include "logging.h"
+
+static void vLogCommand( ConsoleIO_t * const pxCIO,
+                         uint32_t ulArgc,
+                         char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_log =
+{
+    "log",
+    "log\r\n"
+    "    log stats [reset]\r\n"
+    "        Display the number of log calls and their cost in CPU cycles,\r\n"
+    "        for lines formatted by the caller and lines deferred to the\r\n"
+    "        formatter task, and the number of lines suppressed by the rate\r\n"
+    "        limit or as repeats. \"reset\" clears the statistics.\r\n\n"
+    "    log mode [deferred | direct]\r\n"
+    "        Display or select where log lines are formatted.\r\n\n"
+    "    log level\r\n"
+    "        List the modules that logged so far with their level.\r\n\n"
+    "    log level <module | *> <none | error | warn | info | debug | default>\r\n"
+    "        Set the level of a module, named after its source file with or\r\n"
+    "        without extension, or of all modules with \"*\".\r\n\n"
+    "    log level save\r\n"
+    "        Save the levels set with \"log level\" to the key value store.\r\n\n"
+    "    log crash [clear]\r\n"
+    "        Display the crash log: the latest log lines, resets and hard faults\r\n"
+    "        kept in RAM across warm resets. \"clear\" empties it.\r\n\n",
+    vLogCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintPathStats( ConsoleIO_t * const pxCIO,
+                               const char * pcName,
+                               const LoggingPathStats_t * pxStats )
+{
+    int lRslt = 0;
+    unsigned long ulAverage = 0;
+
+    if( pxStats->ulCalls > 0 )
+    {
+        ulAverage = ( unsigned long ) ( pxStats->ullCycles / pxStats->ulCalls );
+    }
+
+    lRslt = snprintf( pcCliScratchBuffer,
+                      CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "%-10s %10lu %10lu %10lu %10lu\r\n",
+                      pcName,
+                      ( unsigned long ) pxStats->ulCalls,
+                      ( unsigned long ) pxStats->ulDropped,
+                      ulAverage,
+                      ( unsigned long ) pxStats->ulMaxCycles );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+static void prvLogStats( ConsoleIO_t * const pxCIO )
+{
+    LoggingStats_t xStats;
+    int lRslt = 0;
+
+    vLoggingGetStats( &xStats );
+
+    pxCIO->print( "path            calls    dropped avg cycles max cycles\r\n" );
+    prvPrintPathStats( pxCIO, "direct", &xStats.xDirect );
+    prvPrintPathStats( pxCIO, "deferred", &xStats.xDeferred );
+
+    lRslt = snprintf( pcCliScratchBuffer,
+                      CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "deferred ring: %lu / %lu bytes pending, high water %lu bytes\r\n",
+                      ( unsigned long ) xStats.ulDeferredPending,
+                      ( unsigned long ) dlLOGGING_DEFERRED_BUFFER_SIZE,
+                      ( unsigned long ) xStats.ulDeferredHighWater );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+
+    lRslt = snprintf( pcCliScratchBuffer,
+                      CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "suppressed: %lu by the rate limit, %lu repeated lines\r\n",
+                      ( unsigned long ) xStats.ulRateLimited,
+                      ( unsigned long ) xStats.ulRepeated );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+static void prvLogLevels( ConsoleIO_t * const pxCIO )
+{
+    #if ( LOGGING_RUNTIME_LEVELS == 1 )
+        pxCIO->print( "module                           level    default\r\n" );
+
+        for( LogModule_t * pxModule = pxLoggingModuleNext( NULL );
+             pxModule != NULL;
+             pxModule = pxLoggingModuleNext( pxModule ) )
+        {
+            int lRslt = snprintf( pcCliScratchBuffer,
+                                  CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                  "%-32s %-8s %s\r\n",
+                                  pxModule->pcName,
+                                  pcLoggingLevelName( pxModule->ucLevel ),
+                                  pcLoggingLevelName( pxModule->ucDefaultLevel ) );
+
+            if( ( lRslt > 0 ) &&
+                ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+            {
+                pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+            }
+        }
+    #else
+        pxCIO->print( "Error: Built with LOGGING_RUNTIME_LEVELS 0.\r\n" );
+    #endif
+}
+
+static void prvLogLevelCommand( ConsoleIO_t * const pxCIO,
+                                uint32_t ulArgc,
+                                char * ppcArgv[] )
+{
+    if( ulArgc == 2 )
+    {
+        prvLogLevels( pxCIO );
+    }
+    else if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "save" ) == 0 ) )
+    {
+        if( xLoggingSaveLevels() == pdTRUE )
+        {
+            pxCIO->print( "Log levels saved to NVM.\r\n" );
+        }
+        else
+        {
+            pxCIO->print( "Error: Could not save log levels to NVM.\r\n" );
+        }
+    }
+    else if( ulArgc == 4 )
+    {
+        uint8_t ucLevel = ucLoggingLevelFromName( ppcArgv[ 3 ] );
+
+        if( ucLevel == LOG_LEVEL_INVALID )
+        {
+            pxCIO->print( "Error: Unrecognized level: " );
+            pxCIO->print( ppcArgv[ 3 ] );
+            pxCIO->print( "\r\n" );
+        }
+        else if( xLoggingSetModuleLevel( ppcArgv[ 2 ], ucLevel ) != pdTRUE )
+        {
+            pxCIO->print( "Error: Too many module levels, or module name too long.\r\n" );
+        }
+        else
+        {
+            pxCIO->print( "Log level set.\r\n" );
+        }
+    }
+    else
+    {
+        pxCIO->print( "Usage: log level [save | <module | *> <level>]\r\n" );
+    }
+}
+
+static void prvLogCrash( ConsoleIO_t * const pxCIO )
+{
+    #if ( LOGGING_CRASH_LOG == 1 )
+        /* Deferred records are formatted like any log line, which may be longer than the scratch buffer */
+        char * pcLine = pvPortMalloc( dlMAX_LOG_LINE_LENGTH + CLI_OUTPUT_EOL_LEN );
+        uint32_t ulCursor = 0;
+        size_t uxLength = 0;
+
+        if( pcLine == NULL )
+        {
+            pxCIO->print( "Error: Out of memory.\r\n" );
+        }
+        else
+        {
+            while( ( uxLength = xLoggingCrashLogNext( &ulCursor, pcLine, dlMAX_LOG_LINE_LENGTH ) ) != 0 )
+            {
+                pcLine[ uxLength++ ] = '\r';
+                pcLine[ uxLength++ ] = '\n';
+                pxCIO->write( pcLine, uxLength );
+            }
+
+            vPortFree( pcLine );
+        }
+    #else
+        pxCIO->print( "Error: Built with LOGGING_CRASH_LOG 0.\r\n" );
+    #endif
+}
+
+static void vLogCommand( ConsoleIO_t * const pxCIO,
+                         uint32_t ulArgc,
+                         char * ppcArgv[] )
+{
+    if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "stats" ) == 0 ) )
+    {
+        if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "reset" ) == 0 ) )
+        {
+            vLoggingResetStats();
+            pxCIO->print( "Log statistics cleared.\r\n" );
+        }
+        else if( ulArgc == 2 )
+        {
+            prvLogStats( pxCIO );
+        }
+        else
+        {
+            pxCIO->print( "Usage: log stats [reset]\r\n" );
+        }
+    }
+    else if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "mode" ) == 0 ) )
+    {
+        if( ulArgc == 3 )
+        {
+            if( strcmp( ppcArgv[ 2 ], "deferred" ) == 0 )
+            {
+                #if ( LOGGING_DEFERRED == 1 )
+                    vLoggingSetDeferred( pdTRUE );
+                #else
+                    pxCIO->print( "Error: Built with LOGGING_DEFERRED 0.\r\n" );
+                #endif
+            }
+            else if( strcmp( ppcArgv[ 2 ], "direct" ) == 0 )
+            {
+                vLoggingSetDeferred( pdFALSE );
+            }
+            else
+            {
+                pxCIO->print( "Error: Unrecognized argument: " );
+                pxCIO->print( ppcArgv[ 2 ] );
+                pxCIO->print( "\r\n" );
+            }
+        }
+
+        pxCIO->print( ( xLoggingIsDeferred() == pdTRUE ) ? "Log mode: deferred\r\n" : "Log mode: direct\r\n" );
+    }
+    else if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "level" ) == 0 ) )
+    {
+        prvLogLevelCommand( pxCIO, ulArgc, ppcArgv );
+    }
+    else if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "crash" ) == 0 ) )
+    {
+        if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "clear" ) == 0 ) )
+        {
+            #if ( LOGGING_CRASH_LOG == 1 )
+                vLoggingCrashLogClear();
+            #endif
+            pxCIO->print( "Crash log cleared.\r\n" );
+        }
+        else if( ulArgc == 2 )
+        {
+            prvLogCrash( pxCIO );
+        }
+        else
+        {
+            pxCIO->print( "Usage: log crash [clear]\r\n" );
+        }
+    }
+    else
+    {
+        pxCIO->print( xCommandDef_log.pcHelpString );
+    }
+}
@@ -30,6 +30,8 @@
 
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
 typedef struct xCOMMAND_INPUT_LIST
 {
     const CLI_Command_Definition_t * pxCommandLineDefinition;
@@ -350,6 +352,15 @@ void Task_CLI( void * pvParameters )
     FreeRTOS_CLIRegisterCommand( &xCommandDef_uptime );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_rngtest );
     FreeRTOS_CLIRegisterCommand( &xCommandDef_assert );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_log );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_perf );
+#if defined(MXCHIP)
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_ipcstat );
+#endif
+#if defined(ST67W6X_NCP)
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_atstat );
+    FreeRTOS_CLIRegisterCommand( &xCommandDef_mqttrx );
+#endif
 
     char * pcCommandBuffer = NULL;
 
@@ -0,0 +1,129 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+
+#if defined( ST67W6X_NCP )
+
+#include "w6x_mqtt_rx.h"
+
+static void vMqttRxCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_mqttrx =
+{
+    "mqttrx",
+    "mqttrx [reset]\r\n"
+    "    Display the MQTT publishes received through the Wi-Fi module, their\r\n"
+    "    rate, the publishes dropped by the receive buffer and the heap\r\n"
+    "    fragmentation. \"reset\" clears the counters after displaying them.\r\n\n",
+    vMqttRxCommand
+};
+
+/* Heap operation counts when the counters were last reset */
+static size_t uxAllocsAtReset = 0;
+static size_t uxFreesAtReset = 0;
+
+/*-----------------------------------------------------------*/
+
+static void prvPrintStats( ConsoleIO_t * const pxCIO,
+                           const W6XMqttRxStats_t * pxStats,
+                           const HeapStats_t * pxHeapStats )
+{
+    uint32_t ulElapsedMs = pdTICKS_TO_MS( xTaskGetTickCount() - pxStats->xStartTick );
+    uint32_t ulPerSec = 0;
+    int lRslt;
+
+    if( ulElapsedMs > 0 )
+    {
+        ulPerSec = ( uint32_t ) ( ( ( uint64_t ) pxStats->ulReceived * 1000ULL ) / ulElapsedMs );
+    }
+
+    lRslt = snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                      "publishes     %lu in %lu ms (%lu/s)\r\n"
+                      "overflow      %lu\r\n"
+                      "oversize      %lu\r\n"
+                      "buffer        max %lu of %lu bytes\r\n"
+                      "heap free     %lu, min %lu\r\n"
+                      "heap blocks   %lu free, largest %lu, smallest %lu\r\n"
+                      "heap ops      %lu allocs, %lu frees\r\n",
+                      ( unsigned long ) pxStats->ulReceived,
+                      ( unsigned long ) ulElapsedMs,
+                      ( unsigned long ) ulPerSec,
+                      ( unsigned long ) pxStats->ulOverflow,
+                      ( unsigned long ) pxStats->ulOversize,
+                      ( unsigned long ) pxStats->ulHighWater,
+                      ( unsigned long ) pxStats->ulBufferSize,
+                      ( unsigned long ) pxHeapStats->xAvailableHeapSpaceInBytes,
+                      ( unsigned long ) pxHeapStats->xMinimumEverFreeBytesRemaining,
+                      ( unsigned long ) pxHeapStats->xNumberOfFreeBlocks,
+                      ( unsigned long ) pxHeapStats->xSizeOfLargestFreeBlockInBytes,
+                      ( unsigned long ) pxHeapStats->xSizeOfSmallestFreeBlockInBytes,
+                      ( unsigned long ) ( pxHeapStats->xNumberOfSuccessfulAllocations - uxAllocsAtReset ),
+                      ( unsigned long ) ( pxHeapStats->xNumberOfSuccessfulFrees - uxFreesAtReset ) );
+
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+static void vMqttRxCommand( ConsoleIO_t * const pxCIO,
+                            uint32_t ulArgc,
+                            char * ppcArgv[] )
+{
+    W6XMqttRxStats_t xStats;
+    HeapStats_t xHeapStats;
+
+    if( ulArgc == 1 )
+    {
+        vW6XMqttRxGetStats( &xStats, 0 );
+        vPortGetHeapStats( &xHeapStats );
+        prvPrintStats( pxCIO, &xStats, &xHeapStats );
+    }
+    else if( ( ulArgc == 2 ) && ( strcmp( ppcArgv[ 1 ], "reset" ) == 0 ) )
+    {
+        vW6XMqttRxGetStats( &xStats, 1 );
+        vPortGetHeapStats( &xHeapStats );
+        prvPrintStats( pxCIO, &xStats, &xHeapStats );
+        uxAllocsAtReset = xHeapStats.xNumberOfSuccessfulAllocations;
+        uxFreesAtReset = xHeapStats.xNumberOfSuccessfulFrees;
+    }
+    else
+    {
+        pxCIO->print( xCommandDef_mqttrx.pcHelpString );
+    }
+}
+
+#endif /* ST67W6X_NCP */
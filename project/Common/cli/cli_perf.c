@@ -0,0 +1,352 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "cli.h"
+#include "cli_prv.h"
+#include "perf_monitor.h"
+
+#define PERF_TOP_DEFAULT_SECONDS    5UL
+#define PERF_TOP_MAX_SECONDS        60UL
+
+static void vPerfCommand( ConsoleIO_t * const pxCIO,
+                          uint32_t ulArgc,
+                          char * ppcArgv[] );
+
+const CLI_Command_Definition_t xCommandDef_perf =
+{
+    "perf",
+    "perf\r\n"
+    "    perf top [seconds]\r\n"
+    "        Display the CPU usage of each task over the next few seconds\r\n"
+    "        (5 by default), busiest first, and the share of interrupts.\r\n\n"
+    "    perf irq [reset]\r\n"
+    "        Display the number of runs, the average and maximum CPU cycles\r\n"
+    "        and the CPU share of each interrupt since the last reset.\r\n\n"
+    "    perf profile start [hz] [samples]\r\n"
+    "        Sample the program counter hz times per second (997 by default)\r\n"
+    "        until the buffer of samples (2048 by default) is full.\r\n\n"
+    "    perf profile stop\r\n"
+    "        Stop sampling before the buffer is full.\r\n\n"
+    "    perf profile dump\r\n"
+    "        Print the samples for tools/perf/perf_report.py.\r\n\n",
+    vPerfCommand
+};
+
+/*-----------------------------------------------------------*/
+
+static int32_t prvParseUnsigned( const char * pcArg,
+                                 uint32_t * pulValue )
+{
+    int32_t lResult = -1;
+    char * pcEnd = NULL;
+    unsigned long ulValue = strtoul( pcArg, &pcEnd, 10 );
+
+    if( ( pcEnd != pcArg ) && ( *pcEnd == '\0' ) )
+    {
+        *pulValue = ( uint32_t ) ulValue;
+        lResult = 0;
+    }
+
+    return lResult;
+}
+
+static void prvPrintLine( ConsoleIO_t * const pxCIO,
+                          int lRslt )
+{
+    if( ( lRslt > 0 ) &&
+        ( lRslt < CLI_OUTPUT_SCRATCH_BUF_LEN ) )
+    {
+        pxCIO->write( pcCliScratchBuffer, ( size_t ) lRslt );
+    }
+}
+
+/* Percentage with one decimal, in tenths */
+static unsigned long prvPermille( uint64_t ullPart,
+                                  uint64_t ullTotal )
+{
+    return ( ullTotal > 0 ) ? ( unsigned long ) ( ( ullPart * 1000U ) / ullTotal ) : 0UL;
+}
+
+static void prvPerfTop( ConsoleIO_t * const pxCIO,
+                        uint32_t ulSeconds )
+{
+    /* Room for tasks created during the window */
+    UBaseType_t uxMaxTasks = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t * pxBefore = ( TaskStatus_t * ) pvPortMalloc( sizeof( TaskStatus_t ) * uxMaxTasks );
+    TaskStatus_t * pxAfter = ( TaskStatus_t * ) pvPortMalloc( sizeof( TaskStatus_t ) * uxMaxTasks );
+
+    if( ( pxBefore == NULL ) || ( pxAfter == NULL ) )
+    {
+        pxCIO->print( "Error: Not enough memory to complete the operation\r\n" );
+    }
+    else
+    {
+        configRUN_TIME_COUNTER_TYPE xTotalBefore = 0;
+        configRUN_TIME_COUNTER_TYPE xTotalAfter = 0;
+        uint64_t ullIrqBefore = ullPerfIrqTotalCycles();
+        TickType_t xStart = xTaskGetTickCount();
+        UBaseType_t uxBefore = uxTaskGetSystemState( pxBefore, uxMaxTasks, &xTotalBefore );
+        UBaseType_t uxAfter = 0;
+        uint64_t ullWindowCycles = 0;
+        uint64_t ullIrqCycles = 0;
+        configRUN_TIME_COUNTER_TYPE xTotal = 0;
+
+        vTaskDelay( pdMS_TO_TICKS( ulSeconds * 1000UL ) );
+
+        uxAfter = uxTaskGetSystemState( pxAfter, uxMaxTasks, &xTotalAfter );
+        ullIrqCycles = ullPerfIrqTotalCycles() - ullIrqBefore;
+        ullWindowCycles = ( ( uint64_t ) ( xTaskGetTickCount() - xStart ) * SystemCoreClock ) / configTICK_RATE_HZ;
+        xTotal = xTotalAfter - xTotalBefore;
+
+        /* Keep the run time of each task during the window in ulRunTimeCounter */
+        for( UBaseType_t i = 0; i < uxAfter; i++ )
+        {
+            for( UBaseType_t j = 0; j < uxBefore; j++ )
+            {
+                if( pxBefore[ j ].xTaskNumber == pxAfter[ i ].xTaskNumber )
+                {
+                    pxAfter[ i ].ulRunTimeCounter -= pxBefore[ j ].ulRunTimeCounter;
+                    break;
+                }
+            }
+        }
+
+        /* Busiest first */
+        for( UBaseType_t i = 1; i < uxAfter; i++ )
+        {
+            TaskStatus_t xTask = pxAfter[ i ];
+            UBaseType_t j = i;
+
+            while( ( j > 0 ) && ( pxAfter[ j - 1 ].ulRunTimeCounter < xTask.ulRunTimeCounter ) )
+            {
+                pxAfter[ j ] = pxAfter[ j - 1 ];
+                j--;
+            }
+
+            pxAfter[ j ] = xTask;
+        }
+
+        prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                       "CPU usage over %lu s:\r\n", ( unsigned long ) ulSeconds ) );
+        pxCIO->print( "  ID  Task Name          %CPU\r\n" );
+
+        for( UBaseType_t i = 0; i < uxAfter; i++ )
+        {
+            unsigned long ulPermille = prvPermille( pxAfter[ i ].ulRunTimeCounter, xTotal );
+
+            prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                           "%4lu  %-16s %3lu.%lu\r\n",
+                                           ( unsigned long ) pxAfter[ i ].xTaskNumber,
+                                           pxAfter[ i ].pcTaskName,
+                                           ulPermille / 10, ulPermille % 10 ) );
+        }
+
+        /* The run time counters charge interrupts to the task they preempted */
+        {
+            unsigned long ulPermille = prvPermille( ullIrqCycles, ullWindowCycles );
+
+            prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                           "Interrupts: %lu.%lu%% (included in the tasks above)\r\n",
+                                           ulPermille / 10, ulPermille % 10 ) );
+        }
+    }
+
+    vPortFree( pxBefore );
+    vPortFree( pxAfter );
+}
+
+static void prvPerfIrq( ConsoleIO_t * const pxCIO )
+{
+    uint64_t ullElapsed = ullPerfIrqElapsedCycles();
+    uint64_t ullTotal = 0;
+
+    pxCIO->print( "interrupt                      count avg cycles max cycles   %CPU\r\n" );
+
+    for( PerfIrqStats_t * pxStats = pxPerfIrqNext( NULL );
+         pxStats != NULL;
+         pxStats = pxPerfIrqNext( pxStats ) )
+    {
+        uint32_t ulCount = pxStats->ulCount;
+        uint64_t ullCycles = pxStats->ullCycles;
+        unsigned long ulAverage = ( ulCount > 0 ) ? ( unsigned long ) ( ullCycles / ulCount ) : 0UL;
+        unsigned long ulPermille = prvPermille( ullCycles, ullElapsed );
+
+        ullTotal += ullCycles;
+
+        prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                       "%-24s %11lu %10lu %10lu %4lu.%lu\r\n",
+                                       pxStats->pcName,
+                                       ( unsigned long ) ulCount,
+                                       ulAverage,
+                                       ( unsigned long ) pxStats->ulMaxCycles,
+                                       ulPermille / 10, ulPermille % 10 ) );
+    }
+
+    {
+        unsigned long ulPermille = prvPermille( ullTotal, ullElapsed );
+
+        prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                       "total over %lu ms: %lu.%lu%%\r\n",
+                                       ( unsigned long ) ( ( ullElapsed * 1000U ) / SystemCoreClock ),
+                                       ulPermille / 10, ulPermille % 10 ) );
+    }
+}
+
+static void prvPerfProfileDump( ConsoleIO_t * const pxCIO )
+{
+    size_t uxCount = 0;
+    uint32_t ulRateHz = 0;
+    long xRunning = pdFALSE;
+    const PerfSample_t * pxSamples = pxPerfProfileSamples( &uxCount, &ulRateHz, &xRunning );
+
+    if( xRunning != pdFALSE )
+    {
+        pxCIO->print( "Error: The profiler is running, stop it first.\r\n" );
+    }
+    else if( ( pxSamples == NULL ) || ( uxCount == 0 ) )
+    {
+        pxCIO->print( "Error: No samples, run \"perf profile start\" first.\r\n" );
+    }
+    else
+    {
+        prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                       "-----BEGIN PERF SAMPLES----- %lu Hz %lu samples\r\n",
+                                       ( unsigned long ) ulRateHz,
+                                       ( unsigned long ) uxCount ) );
+
+        /* Several samples per line, not to spend the whole dump in console overhead */
+        for( size_t i = 0; i < uxCount; )
+        {
+            int lLength = 0;
+
+            for( size_t j = 0; ( j < 8 ) && ( i < uxCount ); j++, i++ )
+            {
+                lLength += snprintf( &pcCliScratchBuffer[ lLength ], CLI_OUTPUT_SCRATCH_BUF_LEN - lLength,
+                                     "%08lx:%08lx ",
+                                     ( unsigned long ) pxSamples[ i ].ulPC,
+                                     ( unsigned long ) pxSamples[ i ].ulLR );
+            }
+
+            pcCliScratchBuffer[ lLength - 1 ] = '\r';
+            pcCliScratchBuffer[ lLength++ ] = '\n';
+            pxCIO->write( pcCliScratchBuffer, ( size_t ) lLength );
+        }
+
+        pxCIO->print( "-----END PERF SAMPLES-----\r\n" );
+    }
+}
+
+static void prvPerfProfileCommand( ConsoleIO_t * const pxCIO,
+                                   uint32_t ulArgc,
+                                   char * ppcArgv[] )
+{
+    if( ( ulArgc >= 3 ) && ( ulArgc <= 5 ) && ( strcmp( ppcArgv[ 2 ], "start" ) == 0 ) )
+    {
+        uint32_t ulRateHz = PERF_PROFILE_DEFAULT_RATE_HZ;
+        uint32_t ulSamples = PERF_PROFILE_DEFAULT_SAMPLES;
+
+        if( ( ( ulArgc >= 4 ) && ( prvParseUnsigned( ppcArgv[ 3 ], &ulRateHz ) != 0 ) ) ||
+            ( ( ulArgc == 5 ) && ( prvParseUnsigned( ppcArgv[ 4 ], &ulSamples ) != 0 ) ) )
+        {
+            pxCIO->print( "Usage: perf profile start [hz] [samples]\r\n" );
+        }
+        else if( xPerfProfileStart( ulRateHz, ulSamples ) != pdTRUE )
+        {
+            pxCIO->print( "Error: Could not start the profiler: already running, out of memory, or rate out of range.\r\n" );
+        }
+        else
+        {
+            prvPrintLine( pxCIO, snprintf( pcCliScratchBuffer, CLI_OUTPUT_SCRATCH_BUF_LEN,
+                                           "Profiling at %lu Hz for %lu ms.\r\n",
+                                           ( unsigned long ) ulRateHz,
+                                           ( unsigned long ) ( ( ( uint64_t ) ulSamples * 1000U ) / ulRateHz ) ) );
+        }
+    }
+    else if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "stop" ) == 0 ) )
+    {
+        vPerfProfileStop();
+        pxCIO->print( "Profiler stopped.\r\n" );
+    }
+    else if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "dump" ) == 0 ) )
+    {
+        prvPerfProfileDump( pxCIO );
+    }
+    else
+    {
+        pxCIO->print( "Usage: perf profile <start [hz] [samples] | stop | dump>\r\n" );
+    }
+}
+
+static void vPerfCommand( ConsoleIO_t * const pxCIO,
+                          uint32_t ulArgc,
+                          char * ppcArgv[] )
+{
+    if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "top" ) == 0 ) )
+    {
+        uint32_t ulSeconds = PERF_TOP_DEFAULT_SECONDS;
+
+        if( ( ulArgc > 3 ) ||
+            ( ( ulArgc == 3 ) && ( prvParseUnsigned( ppcArgv[ 2 ], &ulSeconds ) != 0 ) ) ||
+            ( ulSeconds == 0 ) || ( ulSeconds > PERF_TOP_MAX_SECONDS ) )
+        {
+            pxCIO->print( "Usage: perf top [seconds], up to 60 seconds\r\n" );
+        }
+        else
+        {
+            prvPerfTop( pxCIO, ulSeconds );
+        }
+    }
+    else if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "irq" ) == 0 ) )
+    {
+        if( ( ulArgc == 3 ) && ( strcmp( ppcArgv[ 2 ], "reset" ) == 0 ) )
+        {
+            vPerfIrqReset();
+            pxCIO->print( "Interrupt statistics cleared.\r\n" );
+        }
+        else if( ulArgc == 2 )
+        {
+            prvPerfIrq( pxCIO );
+        }
+        else
+        {
+            pxCIO->print( "Usage: perf irq [reset]\r\n" );
+        }
+    }
+    else if( ( ulArgc >= 2 ) && ( strcmp( ppcArgv[ 1 ], "profile" ) == 0 ) )
+    {
+        prvPerfProfileCommand( pxCIO, ulArgc, ppcArgv );
+    }
+    else
+    {
+        pxCIO->print( xCommandDef_perf.pcHelpString );
+    }
+}
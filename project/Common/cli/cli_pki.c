@@ -62,6 +62,7 @@
 #include "pk_wrap.h"
 #include "mbedtls/ecp.h"
 
+LOG_MODULE_DEFINE();
 
 #define LABEL_PUB_IDX          3
 #define LABEL_PRV_IDX          4
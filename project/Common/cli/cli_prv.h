@@ -133,5 +133,14 @@ extern const CLI_Command_Definition_t xCommandDef_reset;
 extern const CLI_Command_Definition_t xCommandDef_uptime;
 extern const CLI_Command_Definition_t xCommandDef_rngtest;
 extern const CLI_Command_Definition_t xCommandDef_assert;
+extern const CLI_Command_Definition_t xCommandDef_log;
+extern const CLI_Command_Definition_t xCommandDef_perf;
+#if defined( MXCHIP )
+extern const CLI_Command_Definition_t xCommandDef_ipcstat;
+#endif
+#if defined( ST67W6X_NCP )
+extern const CLI_Command_Definition_t xCommandDef_atstat;
+extern const CLI_Command_Definition_t xCommandDef_mqttrx;
+#endif
 
 #endif /* _CLI_PRIV */
@@ -33,7 +33,7 @@
 
 #include <string.h>
 
-#define HW_FIFO_LEN    8
+LOG_MODULE_DEFINE();
 
 extern volatile StreamBufferHandle_t xLogMBuf;
 
@@ -43,10 +43,17 @@ static SemaphoreHandle_t xUartTxSem = NULL;
 static volatile BaseType_t xPartialCommand = pdFALSE;
 /*static volatile BaseType_t xCliStreamInterrupted = pdFALSE; */
 
-#define BUFFER_READ_TIMEOUT_MS    pdMS_TO_TICKS( 5 )
-
 StreamBufferHandle_t xUartRxStream = NULL;
-StreamBufferHandle_t xUartTxStream = NULL;
+
+/* Transmit ring, the DMA reads straight out of it. Writers append at the head
+ * under xTxRingMutex, the DMA callbacks release bytes at the tail. */
+static uint8_t pucTxRing[ CLI_UART_TX_STREAM_LEN ];
+static volatile size_t uxTxHead = 0;
+static volatile size_t uxTxTail = 0;
+static volatile size_t uxTxDmaLength = 0;   /* Length of the transfer in progress, 0 when idle */
+static volatile size_t uxTxDmaReleased = 0; /* Bytes of it released at half transfer */
+static SemaphoreHandle_t xTxRingMutex = NULL;
+static SemaphoreHandle_t xTxSpaceSem = NULL;
 
 static char pcInputBuffer[ CLI_INPUT_LINE_LEN_MAX ] = { 0 };
 static volatile uint32_t ulInBufferIdx = 0;
@@ -59,6 +66,7 @@ static TaskHandle_t xTxThreadHandle = NULL;
 extern UART_HandleTypeDef xConsoleHandle;
 
 static void txCompleteCallback( UART_HandleTypeDef * pxUartHandle );
+static void txHalfCompleteCallback( UART_HandleTypeDef * pxUartHandle );
 static void vTxThread( void * pvParameters );
 static void vRxThread( void * pvParameters );
 static void rxEventCallback( UART_HandleTypeDef * pxUartHandle,
@@ -68,6 +76,13 @@ static void rxErrorCallback( UART_HandleTypeDef * pxUartHandle );
 /* Should only be called before the scheduler has been initialized / after an assertion has occurred */
 UART_HandleTypeDef * vInitUartEarly( void )
 {
+    /* Blocking transmits fail while a DMA transfer is in progress */
+    if( xConsoleHandle.gState == HAL_UART_STATE_BUSY_TX )
+    {
+        ( void ) HAL_UART_AbortTransmit( &xConsoleHandle );
+        uxTxDmaLength = 0;
+    }
+
     return &xConsoleHandle;
 }
 
@@ -76,11 +91,12 @@ BaseType_t xInitConsoleUart( void )
     HAL_StatusTypeDef xHalRslt = HAL_OK;
 
     xUartTxSem = xSemaphoreCreateBinary();
+    xTxRingMutex = xSemaphoreCreateMutex();
+    xTxSpaceSem = xSemaphoreCreateBinary();
 
     ( void ) HAL_UART_DeInit( &xConsoleHandle );
 
     xUartRxStream = xStreamBufferCreate( CLI_UART_RX_STREAM_LEN, 1 );
-    xUartTxStream = xStreamBufferCreate( CLI_UART_TX_STREAM_LEN, HW_FIFO_LEN ); /*TODO maybe increase this */
 
     if( xHalRslt == HAL_OK )
     {
@@ -92,6 +108,7 @@ BaseType_t xInitConsoleUart( void )
     if( xHalRslt == HAL_OK )
     {
         xHalRslt |= HAL_UART_RegisterCallback( &xConsoleHandle, HAL_UART_TX_COMPLETE_CB_ID, txCompleteCallback );
+        xHalRslt |= HAL_UART_RegisterCallback( &xConsoleHandle, HAL_UART_TX_HALFCOMPLETE_CB_ID, txHalfCompleteCallback );
 
         xHalRslt |= HAL_UART_RegisterCallback( &xConsoleHandle, HAL_UART_ERROR_CB_ID, rxErrorCallback );
         xHalRslt |= HAL_UART_RegisterRxEventCallback( &xConsoleHandle, rxEventCallback );
@@ -135,11 +152,20 @@ static uint8_t * pucNextBuffer = NULL;
 #define FLAGS_MASK       ( ERROR_FLAG | BUFFER_A_FLAG | BUFFER_B_FLAG )
 #define READ_LEN_MASK    ( ~FLAGS_MASK )
 
+/* Period at which a writer waiting for the transmit ring retries a transfer that failed to start */
+#define TX_RETRY_MS      ( 10 )
+
 /* */
 static void rxErrorCallback( UART_HandleTypeDef * pxUartHandle )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
+    /* Drop the transfer that failed and carry on with the rest of the ring */
+    if( ( pxUartHandle->ErrorCode & HAL_UART_ERROR_DMA ) != 0 )
+    {
+        txCompleteCallback( pxUartHandle );
+    }
+
     ( void ) xTaskNotifyIndexedFromISR( xRxThreadHandle,
                                         1,
                                         ERROR_FLAG,
@@ -239,95 +265,154 @@ static void vRxThread( void * pvParameters )
     }
 }
 
-/* */
-static void txCompleteCallback( UART_HandleTypeDef * pxUartHandle )
+/* Start a transfer of the pending bytes up to the end of the ring, if none is in progress.
+ * Called from the DMA callbacks or with them masked. */
+static void prvTxStart( void )
+{
+    size_t uxHead = uxTxHead;
+    size_t uxTail = uxTxTail;
+
+    if( ( uxTxDmaLength == 0 ) && ( uxHead != uxTail ) )
+    {
+        size_t uxLength = ( uxHead > uxTail ) ? ( uxHead - uxTail ) : ( CLI_UART_TX_STREAM_LEN - uxTail );
+
+        uxTxDmaLength = uxLength;
+        uxTxDmaReleased = 0;
+
+        if( HAL_UART_Transmit_DMA( &xConsoleHandle, &( pucTxRing[ uxTail ] ), ( uint16_t ) uxLength ) != HAL_OK )
+        {
+            /* Retried on the next write, or by a writer waiting for space */
+            uxTxDmaLength = 0;
+        }
+    }
+}
+
+static void prvTxSpaceFromISR( void )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    ( void ) vTaskNotifyGiveIndexedFromISR( xTxThreadHandle, 1, &xHigherPriorityTaskWoken );
+    ( void ) xSemaphoreGiveFromISR( xTxSpaceSem, &xHigherPriorityTaskWoken );
 
     portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
 }
 
-/* Uart transmit thread */
-static void vTxThread( void * pvParameters )
+/* The DMA read the first half of the transfer, writers may reuse it already */
+static void txHalfCompleteCallback( UART_HandleTypeDef * pxUartHandle )
 {
-    uint8_t pucTxBuffer[ CLI_UART_TX_WRITE_SZ_5MS ] = { 0 };
-    HAL_StatusTypeDef xHalStatus = HAL_OK;
+    size_t uxHalf = uxTxDmaLength / 2;
 
-    size_t xBytes = 0;
+    ( void ) pxUartHandle;
 
-    while( !xExitFlag )
+    uxTxTail = ( uxTxTail + uxHalf ) % CLI_UART_TX_STREAM_LEN;
+    uxTxDmaReleased = uxHalf;
+
+    prvTxSpaceFromISR();
+}
+
+static void txCompleteCallback( UART_HandleTypeDef * pxUartHandle )
+{
+    size_t uxRemaining = uxTxDmaLength - uxTxDmaReleased;
+
+    ( void ) pxUartHandle;
+
+    if( uxTxDmaLength > 0 )
     {
-        /* Read up to 64 bytes
-         * wait up to BUFFER_READ_TIMEOUT before getting less than 64 */
-        xBytes = xStreamBufferReceive( xUartTxStream,
-                                       pucTxBuffer,
-                                       CLI_UART_TX_WRITE_SZ_5MS,
-                                       BUFFER_READ_TIMEOUT_MS );
-
-        /* If tx buffer is empty */
-        if( xBytes == 0 )
-        {
-            /* Take the uart write semaphore (non-blocking) */
-            if( xSemaphoreTake( xUartTxSem, 0 ) == pdTRUE )
-            {
-                xBytes = xMessageBufferReceive( xLogMBuf, ucLogLineTxBuff, dlMAX_PRINT_STRING_LENGTH, 0 );
+        uxTxTail = ( uxTxTail + uxRemaining ) % CLI_UART_TX_STREAM_LEN;
+        uxTxDmaLength = 0;
 
-                /* All log messages should be less than the maximum length */
-                configASSERT( ( xBytes + CLI_OUTPUT_EOL_LEN + CLI_INPUT_LINE_LEN_MAX ) <= CLI_UART_TX_STREAM_LEN );
+        /* Chain the next transfer right away, whatever was written meanwhile */
+        prvTxStart();
+        prvTxSpaceFromISR();
+    }
+}
 
-                /* If we got a log message to output, add it to the stream buffer to be processed */
-                if( xBytes > 0 )
-                {
-                    if( xPartialCommand == pdTRUE )
-                    {
-                        /* Overwrite existing line contents */
-                        ( void ) xStreamBufferSend( xUartTxStream, "\r\033[K", 4, 0 );
-                    }
+static void prvTxWrite( const uint8_t * pucData,
+                        size_t uxLength )
+{
+    ( void ) xSemaphoreTake( xTxRingMutex, portMAX_DELAY );
 
-                    /* enqueue the log message */
-                    ( void ) xStreamBufferSend( xUartTxStream, ucLogLineTxBuff, xBytes, 0 );
+    while( uxLength > 0 )
+    {
+        size_t uxHead = uxTxHead;
+        size_t uxFree = ( uxTxTail + CLI_UART_TX_STREAM_LEN - uxHead - 1 ) % CLI_UART_TX_STREAM_LEN;
+        size_t uxChunk = CLI_UART_TX_STREAM_LEN - uxHead;
 
-                    /* Add CRLF */
-                    ( void ) xStreamBufferSend( xUartTxStream, CLI_OUTPUT_EOL, CLI_OUTPUT_EOL_LEN, 0 );
+        if( uxChunk > uxFree )
+        {
+            uxChunk = uxFree;
+        }
 
-                    if( xPartialCommand == pdTRUE )
-                    {
-                        ( void ) xStreamBufferSend( xUartTxStream, CLI_PROMPT_STR, CLI_PROMPT_LEN, 0 );
+        if( uxChunk > uxLength )
+        {
+            uxChunk = uxLength;
+        }
 
-                        /* Restore current command line contents */
-                        if( ulInBufferIdx > 0 )
-                        {
-                            ( void ) xStreamBufferSend( xUartTxStream, pcInputBuffer, ulInBufferIdx, 0 );
-                        }
-                    }
+        if( uxChunk == 0 )
+        {
+            /* Wait for the DMA to release some of the ring. With no transfer in
+             * progress nothing would, start one again until it succeeds. */
+            taskENTER_CRITICAL();
+            prvTxStart();
+            taskEXIT_CRITICAL();
 
-                    ( void ) xSemaphoreGive( xUartTxSem );
-                    xBytes = xStreamBufferReceive( xUartTxStream,
-                                                   pucTxBuffer,
-                                                   CLI_UART_TX_WRITE_SZ_5MS,
-                                                   0 );
-                }
-                else
-                {
-                    ( void ) xSemaphoreGive( xUartTxSem );
-                }
-            }
+            ( void ) xSemaphoreTake( xTxSpaceSem, pdMS_TO_TICKS( TX_RETRY_MS ) );
+        }
+        else
+        {
+            ( void ) memcpy( &( pucTxRing[ uxHead ] ), pucData, uxChunk );
+            pucData += uxChunk;
+            uxLength -= uxChunk;
+
+            uxTxHead = ( uxHead + uxChunk ) % CLI_UART_TX_STREAM_LEN;
+
+            taskENTER_CRITICAL();
+            prvTxStart();
+            taskEXIT_CRITICAL();
         }
+    }
 
-        /* Transmit if bytes available to transmit */
-        if( xBytes > 0 )
+    ( void ) xSemaphoreGive( xTxRingMutex );
+}
+
+/* Moves log lines to the transmit ring */
+static void vTxThread( void * pvParameters )
+{
+    size_t xBytes = 0;
+
+    while( !xExitFlag )
+    {
+        xBytes = xMessageBufferReceive( xLogMBuf, ucLogLineTxBuff, dlMAX_PRINT_STRING_LENGTH, portMAX_DELAY );
+
+        /* All log messages should be less than the maximum length */
+        configASSERT( ( xBytes + CLI_OUTPUT_EOL_LEN + CLI_INPUT_LINE_LEN_MAX ) <= CLI_UART_TX_STREAM_LEN );
+
+        if( ( xBytes > 0 ) &&
+            ( xSemaphoreTake( xUartTxSem, portMAX_DELAY ) == pdTRUE ) )
         {
-            ( void ) xTaskNotifyStateClearIndexed( NULL, 1 );
-            xHalStatus = HAL_UART_Transmit_IT( &xConsoleHandle, pucTxBuffer, ( uint16_t ) xBytes );
-/*			configASSERT( xHalStatus == HAL_OK ); */
+            if( xPartialCommand == pdTRUE )
+            {
+                /* Overwrite existing line contents */
+                prvTxWrite( ( const uint8_t * ) "\r\033[K", 4 );
+            }
+
+            /* enqueue the log message */
+            prvTxWrite( ( const uint8_t * ) ucLogLineTxBuff, xBytes );
 
-            if( xHalStatus == HAL_OK )
+            /* Add CRLF */
+            prvTxWrite( ( const uint8_t * ) CLI_OUTPUT_EOL, CLI_OUTPUT_EOL_LEN );
+
+            if( xPartialCommand == pdTRUE )
             {
-                /* Wait for completion event (should be within 1 or 2 ms) */
-                ( void ) ulTaskNotifyTakeIndexed( 1, pdTRUE, portMAX_DELAY );
+                prvTxWrite( ( const uint8_t * ) CLI_PROMPT_STR, CLI_PROMPT_LEN );
+
+                /* Restore current command line contents */
+                if( ulInBufferIdx > 0 )
+                {
+                    prvTxWrite( ( const uint8_t * ) pcInputBuffer, ulInBufferIdx );
+                }
             }
+
+            ( void ) xSemaphoreGive( xUartTxSem );
         }
     }
 }
@@ -335,23 +420,11 @@ static void vTxThread( void * pvParameters )
 static void uart_write( const void * const pvOutputBuffer,
                         uint32_t xOutputBufferLen )
 {
-    size_t xBytesSent = 0;
-
-    const uint8_t * const pcBuffer = ( uint8_t * const ) pvOutputBuffer;
-
     if( ( pvOutputBuffer != NULL ) &&
         ( xOutputBufferLen > 0 ) )
     {
-        while( xBytesSent < xOutputBufferLen )
-        {
-            xBytesSent += xStreamBufferSend( xUartTxStream,
-                                             ( const void * ) &( pcBuffer[ xBytesSent ] ),
-                                             xOutputBufferLen - xBytesSent,
-                                             portMAX_DELAY );
-        }
+        prvTxWrite( ( const uint8_t * ) pvOutputBuffer, xOutputBufferLen );
     }
-
-    configASSERT( xBytesSent == xOutputBufferLen );
 }
 
 /* Get at least once byte, possibly up to pcInputBuffer if the uart stays busy */
@@ -30,28 +30,138 @@
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
 
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
 #include "message_buffer.h"
 #include "cli_prv.h"
+#include "kvstore.h"
 
 /* Project Includes */
 #include "logging.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 /* todo take into account maximum cli line length */
 #if ( CLI_UART_TX_STREAM_LEN < dlMAX_LOG_LINE_LENGTH )
     #error "CLI_UART_TX_STREAM_LEN must be >= dlMAX_LOG_LINE_LENGTH"
 #endif
 
+/* Longest string value of the key value store */
+#if defined( KVSTORE_VAL_MAX_LEN )
+    #define dlLOGGING_LEVELS_STRING_LENGTH    KVSTORE_VAL_MAX_LEN
+#else
+    #define dlLOGGING_LEVELS_STRING_LENGTH    64 /* STSAFE_KVSTORE_VAL_MAX_LEN */
+#endif
+
 volatile StreamBufferHandle_t xLogMBuf = NULL;
 
 UART_HandleTypeDef * pxEarlyUart = NULL;
 
 static char pcPrintBuff[ dlMAX_LOG_LINE_LENGTH ];
 
+#if ( LOGGING_DEFERRED == 1 )
+
+/* Deferred records are kept in a ring of dlLOGGING_DEFERRED_BUFFER_SIZE bytes.
+ * Producers reserve space with a compare and swap on ulDeferredWrite and publish
+ * the record by writing its header last. The formatter task is the only consumer. */
+#define dlDEFERRED_HDR_COMMITTED      ( 0x80000000UL )
+#define dlDEFERRED_HDR_PADDING        ( 0x40000000UL )
+#define dlDEFERRED_HDR_LENGTH_MASK    ( 0x0000FFFFUL )
+#define dlDEFERRED_TASK_NAME_LEN      ( 12 )
+#define dlDEFERRED_ALIGN( x )         ( ( ( x ) + sizeof( uint32_t ) - 1 ) & ~( sizeof( uint32_t ) - 1 ) )
+
+#if ( ( dlLOGGING_DEFERRED_BUFFER_SIZE & ( dlLOGGING_DEFERRED_BUFFER_SIZE - 1 ) ) != 0 )
+    #error "dlLOGGING_DEFERRED_BUFFER_SIZE must be a power of 2"
+#endif
+
+typedef enum
+{
+    eArgNone = 0,
+    eArgInt,
+    eArgLong,
+    eArgLongLong,
+    eArgIntMax,
+    eArgSize,
+    eArgPtrDiff,
+    eArgDouble,
+    eArgLongDouble,
+    eArgPointer,
+    eArgString
+} DeferredArgType_t;
+
+typedef struct
+{
+    DeferredArgType_t xType;
+    uint8_t ucStars;         /* '*' width and precision arguments */
+    uint8_t ucPrecisionStar; /* 1 + index of the '*' giving the precision, 0 if none */
+    int32_t lPrecision;      /* Precision given by digits, -1 if none */
+    size_t uxSpecLength;     /* Including the '%' */
+} DeferredSpec_t;
+
+typedef struct
+{
+    uint32_t ulHeader;
+    const char * pcFormat;
+    const char * pcLogLevel;
+    const char * pcFileName;
+    uint32_t ulLineNumber;
+    uint32_t ulTimestamp;
+    char pcTaskName[ dlDEFERRED_TASK_NAME_LEN ];
+    uint8_t ucArgs[]; /* Arguments, strings are copied inline */
+} DeferredRecord_t;
+
+static uint32_t ulDeferredRing[ dlLOGGING_DEFERRED_BUFFER_SIZE / sizeof( uint32_t ) ];
+static uint32_t ulDeferredWrite = 0;
+static uint32_t ulDeferredRead = 0;
+static uint32_t ulDeferredDropped = 0;
+
+static char pcDeferredBuff[ dlMAX_LOG_LINE_LENGTH ];
+
+static TaskHandle_t xDeferredTask = NULL;
+
+/* Wakes the formatter task, from a task or from an interrupt */
+static void prvDeferredWake( void )
+{
+    if( xDeferredTask != NULL )
+    {
+        if( xPortIsInsideInterrupt() == pdTRUE )
+        {
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+            vTaskNotifyGiveFromISR( xDeferredTask, &xHigherPriorityTaskWoken );
+            portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        }
+        else
+        {
+            ( void ) xTaskNotifyGive( xDeferredTask );
+        }
+    }
+}
+
+#endif /* LOGGING_DEFERRED == 1 */
+
+static BaseType_t xDeferredMode = ( LOGGING_DEFERRED == 1 ) ? pdTRUE : pdFALSE;
+
+static LoggingStats_t xLoggingStats = { 0 };
+
+#if ( LOGGING_CRASH_LOG == 1 )
+static void prvCrashLogInit( void );
+static void prvCrashLogAppend( uint8_t ucType,
+                               const void * pvData,
+                               size_t uxLength,
+                               const void * pvData2,
+                               size_t uxLength2 );
+    #if ( LOGGING_DEFERRED == 1 )
+static void prvCrashLogAppendRecord( const DeferredRecord_t * pxRecord,
+                                     size_t uxLength );
+    #endif
+#endif /* LOGGING_CRASH_LOG == 1 */
+
 /* Should only be called during an assert with the scheduler suspended. */
 void vDyingGasp( void )
 {
@@ -73,6 +183,16 @@ void vDyingGasp( void )
     }
     while( xNumBytes != 0 );
 
+    #if ( LOGGING_DEFERRED == 1 )
+        /* Then whatever the formatter task did not get to */
+        while( ( xNumBytes = xLoggingDeferredFormatNext( pcPrintBuff, sizeof( pcPrintBuff ) ) ) != 0 )
+        {
+            ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) pcPrintBuff, xNumBytes, 10 * 1000 );
+            ( void ) HAL_UART_Transmit( pxEarlyUart, ( uint8_t * ) "\r\n", 2, 10 * 1000 );
+            vPetWatchdog();
+        }
+    #endif
+
     HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_GREEN_Pin, GPIO_PIN_SET );
     HAL_GPIO_WritePin( LED_RED_GPIO_Port, LED_RED_Pin, GPIO_PIN_RESET );
 }
@@ -105,6 +225,15 @@ static void vSendLogMessageEarly( const char * buffer,
 
 void vInitLoggingEarly( void )
 {
+    #if ( LOGGING_CRASH_LOG == 1 )
+        UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+        /* Record the reset before the log of the previous boot can be overwritten */
+        prvCrashLogInit();
+
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+    #endif
+
     pxEarlyUart = vInitUartEarly();
     vSendLogMessageEarly( "\r\n", 2 );
 }
@@ -165,122 +294,1759 @@ static void vSendLogMessage( const char * buffer,
     }
 }
 
+#if ( LOGGING_DEFERRED == 1 )
+static void prvDeferredLogTask( void * pvParameters );
+#endif
+
 void vLoggingInit( void )
 {
     xLogMBuf = xMessageBufferCreate( dlLOGGING_STREAM_LENGTH );
+
+    /* Cycle counter for the logging statistics */
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    #if ( LOGGING_DEFERRED == 1 )
+        ( void ) xTaskCreate( prvDeferredLogTask, "LogFmt", dlLOGGING_DEFERRED_TASK_STACK, NULL,
+                              dlLOGGING_DEFERRED_TASK_PRIORITY, &xDeferredTask );
+    #endif
 }
 
 /*-----------------------------------------------------------*/
 
-void vLoggingPrintf( const char * const pcLogLevel,
-                     const char * const pcFileName,
-                     const unsigned long ulLineNumber,
-                     const char * const pcFormat,
-                     ... )
+static size_t prvFormatPrefix( char * pcBuffer,
+                               const char * pcLogLevel,
+                               uint32_t ulTimestamp,
+                               const char * pcTaskName )
 {
-    uint32_t ulLenTotal = 0;
     int32_t lLenPart = -1;
-    va_list args;
-    const char * pcTaskName = NULL;
-    BaseType_t xSchedulerWasSuspended = pdFALSE;
 
-    /* Additional info to place at the start of the log line */
-    if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+    pcBuffer[ 0 ] = '\0';
+    lLenPart = snprintf( pcBuffer,
+                         dlMAX_PRINT_STRING_LENGTH,
+                         "<%-3.3s> %8lu [%-10.10s] ",
+                         pcLogLevel,
+                         ( ( unsigned long ) ulTimestamp / portTICK_PERIOD_MS ) & 0xFFFFFF,
+                         pcTaskName );
+
+    configASSERT( lLenPart > 0 );
+
+    return ( lLenPart < dlMAX_PRINT_STRING_LENGTH ) ? ( size_t ) lLenPart : dlMAX_PRINT_STRING_LENGTH;
+}
+
+static size_t prvFormatTrailer( char * pcBuffer,
+                                size_t uxLength,
+                                const char * pcFileName,
+                                unsigned long ulLineNumber )
+{
+    int32_t lLenPart = -1;
+
+    /* remove any \r\n\0 characters at the end of the message */
+    while( uxLength > 0 &&
+           ( pcBuffer[ uxLength - 1 ] == '\r' ||
+             pcBuffer[ uxLength - 1 ] == '\n' ||
+             pcBuffer[ uxLength - 1 ] == '\0' ) )
     {
-        pcTaskName = pcTaskGetName( NULL );
+        pcBuffer[ uxLength - 1 ] = '\0';
+        uxLength--;
     }
-    else
+
+    if( ( pcFileName != NULL ) &&
+        ( ulLineNumber > 0 ) &&
+        ( uxLength < dlMAX_LOG_LINE_LENGTH ) )
     {
-        pcTaskName = "None";
+        /* Add the trailer including file name and line number */
+        lLenPart = snprintf( &pcBuffer[ uxLength ],
+                             ( dlMAX_LOG_LINE_LENGTH - uxLength ),
+                             " (%s:%lu)",
+                             pcFileName,
+                             ulLineNumber );
+
+        configASSERT( lLenPart > 0 );
+
+        if( lLenPart + uxLength < dlMAX_LOG_LINE_LENGTH )
+        {
+            uxLength += lLenPart;
+        }
+        else
+        {
+            uxLength = dlMAX_LOG_LINE_LENGTH;
+        }
     }
 
-    if( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING )
+    return uxLength;
+}
+
+/* Not synchronized, the statistics are only for diagnostics */
+static void prvAddStats( LoggingPathStats_t * pxStats,
+                         uint32_t ulStartCycles )
+{
+    uint32_t ulCycles = DWT->CYCCNT - ulStartCycles;
+
+    pxStats->ulCalls++;
+    pxStats->ullCycles += ulCycles;
+
+    if( ulCycles > pxStats->ulMaxCycles )
     {
-        xSchedulerWasSuspended = pdTRUE;
-        /* Suspend the scheduler to access pcPrintBuff */
-        vTaskSuspendAll();
+        pxStats->ulMaxCycles = ulCycles;
     }
+}
 
-    pcPrintBuff[ 0 ] = '\0';
-    lLenPart = snprintf( pcPrintBuff,
-                         dlMAX_PRINT_STRING_LENGTH,
-                         "<%-3.3s> %8lu [%-10.10s] ",
-                         pcLogLevel,
-                         ( ( unsigned long ) xTaskGetTickCount() / portTICK_PERIOD_MS ) & 0xFFFFFF,
-                         pcTaskName );
+#if ( LOGGING_RATE_LIMIT == 1 )
+
+/* Position of the timestamp in the prefix written by prvFormatPrefix, "<LVL> %8lu " */
+#define dlLOG_TIMESTAMP_OFFSET    ( 6 )
+#define dlLOG_TIMESTAMP_END       ( 15 )
+#define dlLOG_REPEAT_NOTE_LENGTH  ( 64 )
+
+typedef struct
+{
+    const char * pcFileName;
+    uint32_t ulLineNumber;
+    TickType_t xNextTick;
+    uint32_t ulSuppressed;
+} LogRateSite_t;
+
+typedef struct
+{
+    uint32_t ulHash; /* Of the last line printed, without its timestamp */
+    size_t uxLength;
+    char pcLogLevel[ 4 ];
+    uint32_t ulRepeats;
+    TickType_t xFirstTick; /* Of the first repeat not reported yet */
+} LogRepeat_t;
+
+static LogRateSite_t xRateSites[ dlLOGGING_RATE_LIMIT_SITES ] = { 0 };
+static LogRepeat_t xLogRepeat = { 0 };
+
+static void prvLoggingPrintfUnlimited( const char * const pcLogLevel,
+                                       const char * const pcFormat,
+                                       ... );
+
+/* Generic cell rate algorithm: a line is allowed when it does not arrive more than
+ * ( burst - 1 ) periods ahead of its theoretical arrival time xNextTick. */
+static BaseType_t prvRateLimitAllow( const char * pcFileName,
+                                     uint32_t ulLineNumber,
+                                     uint32_t * pulSuppressed )
+{
+    const TickType_t xPeriod = pdMS_TO_TICKS( 1000 / dlLOGGING_RATE_LIMIT_PER_SEC );
+    const TickType_t xTolerance = xPeriod * ( dlLOGGING_RATE_LIMIT_BURST - 1 );
+    uint32_t ulIndex = ( ( ( ulLineNumber ^ ( uint32_t ) ( uintptr_t ) pcFileName ) * 2654435761UL ) >> 16 ) &
+                       ( dlLOGGING_RATE_LIMIT_SITES - 1 );
+    LogRateSite_t * pxSite = &xRateSites[ ulIndex ];
+    BaseType_t xAllow = pdFALSE;
+    BaseType_t xFirstSuppressed = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    TickType_t xNow = xTaskGetTickCount();
+
+    /* A new call site takes over the slot. A site idle for long enough has its
+     * xNextTick in the past, restart it from now. */
+    if( ( pxSite->pcFileName != pcFileName ) ||
+        ( pxSite->ulLineNumber != ulLineNumber ) ||
+        ( ( TickType_t ) ( pxSite->xNextTick - xNow ) > ( xTolerance + xPeriod ) ) )
+    {
+        if( ( pxSite->pcFileName != pcFileName ) ||
+            ( pxSite->ulLineNumber != ulLineNumber ) )
+        {
+            pxSite->pcFileName = pcFileName;
+            pxSite->ulLineNumber = ulLineNumber;
+            pxSite->ulSuppressed = 0;
+        }
+
+        pxSite->xNextTick = xNow;
+    }
+
+    if( ( TickType_t ) ( pxSite->xNextTick - xNow ) <= xTolerance )
+    {
+        pxSite->xNextTick += xPeriod;
+        *pulSuppressed = pxSite->ulSuppressed;
+        pxSite->ulSuppressed = 0;
+        xAllow = pdTRUE;
+    }
+    else
+    {
+        xFirstSuppressed = ( pxSite->ulSuppressed++ == 0 ) ? pdTRUE : pdFALSE;
+        xLoggingStats.ulRateLimited++;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    #if ( LOGGING_DEFERRED == 1 )
+        /* The formatter task reports the suppressed lines once the site may log again */
+        if( xFirstSuppressed == pdTRUE )
+        {
+            prvDeferredWake();
+        }
+    #else
+        ( void ) xFirstSuppressed;
+    #endif
+
+    return xAllow;
+}
+
+static size_t prvFormatRepeatNote( char * pcNote,
+                                   const char * pcLogLevel,
+                                   uint32_t ulRepeats )
+{
+    int32_t lLenPart = snprintf( pcNote,
+                                 dlLOG_REPEAT_NOTE_LENGTH,
+                                 "<%-3.3s> %8lu [%-10.10s] Last message repeated %lu times",
+                                 pcLogLevel,
+                                 ( ( unsigned long ) xTaskGetTickCount() / portTICK_PERIOD_MS ) & 0xFFFFFF,
+                                 "Log",
+                                 ( unsigned long ) ulRepeats );
 
     configASSERT( lLenPart > 0 );
 
-    if( lLenPart < dlMAX_PRINT_STRING_LENGTH )
+    return ( lLenPart < dlLOG_REPEAT_NOTE_LENGTH ) ? ( size_t ) lLenPart : dlLOG_REPEAT_NOTE_LENGTH - 1;
+}
+
+/* Returns pdTRUE when the line at pcLine only differs from the previous one by its
+ * timestamp, it should not be printed. Otherwise formats in pcNote the line to print
+ * before it if the previous line was repeated, *puxNoteLength is 0 if not. */
+static BaseType_t prvLogRepeated( const char * pcLine,
+                                  size_t uxLength,
+                                  char * pcNote,
+                                  size_t * puxNoteLength )
+{
+    uint32_t ulHash = 2166136261UL;
+    uint32_t ulRepeats = 0;
+    char pcLogLevel[ sizeof( xLogRepeat.pcLogLevel ) ];
+    BaseType_t xRepeated = pdFALSE;
+    BaseType_t xFirstRepeat = pdFALSE;
+    UBaseType_t uxSavedInterruptStatus;
+
+    for( size_t i = 0; i < uxLength; i++ )
+    {
+        if( ( i < dlLOG_TIMESTAMP_OFFSET ) || ( i >= dlLOG_TIMESTAMP_END ) )
+        {
+            ulHash = ( ulHash ^ ( uint8_t ) pcLine[ i ] ) * 16777619UL;
+        }
+    }
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    if( ( ulHash == xLogRepeat.ulHash ) && ( uxLength == xLogRepeat.uxLength ) )
     {
-        ulLenTotal = lLenPart;
+        if( xLogRepeat.ulRepeats++ == 0 )
+        {
+            xLogRepeat.xFirstTick = xTaskGetTickCount();
+            xFirstRepeat = pdTRUE;
+        }
+
+        xLoggingStats.ulRepeated++;
+        xRepeated = pdTRUE;
     }
     else
     {
-        ulLenTotal = dlMAX_PRINT_STRING_LENGTH;
+        ulRepeats = xLogRepeat.ulRepeats;
+        ( void ) memcpy( pcLogLevel, xLogRepeat.pcLogLevel, sizeof( pcLogLevel ) );
+
+        xLogRepeat.ulRepeats = 0;
+        xLogRepeat.ulHash = ulHash;
+        xLogRepeat.uxLength = uxLength;
+        /* The level, "<LVL>" */
+        ( void ) strncpy( xLogRepeat.pcLogLevel, ( uxLength > 4 ) ? &pcLine[ 1 ] : "", sizeof( xLogRepeat.pcLogLevel ) - 1 );
     }
 
-    if( ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    #if ( LOGGING_DEFERRED == 1 )
+        /* The formatter task reports the repeats after dlLOGGING_REPEAT_FLUSH_MS */
+        if( xFirstRepeat == pdTRUE )
+        {
+            prvDeferredWake();
+        }
+    #else
+        ( void ) xFirstRepeat;
+    #endif
+
+    *puxNoteLength = ( ulRepeats > 0 ) ? prvFormatRepeatNote( pcNote, pcLogLevel, ulRepeats ) : 0;
+
+    return xRepeated;
+}
+
+#if ( LOGGING_DEFERRED == 1 )
+    /* Reports the lines suppressed at a call site that did not log since its rate
+     * allows it again, returns pdFALSE when there is none */
+    static BaseType_t prvRateLimitFlush( void )
     {
-        /* There are a variable number of parameters. */
-        va_start( args, pcFormat );
-        lLenPart = vsnprintf( &pcPrintBuff[ ulLenTotal ],
-                              ( dlMAX_PRINT_STRING_LENGTH - ulLenTotal ),
-                              pcFormat,
-                              args );
-        va_end( args );
+        LogRateSite_t xSite = { 0 };
+        UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+        TickType_t xNow = xTaskGetTickCount();
 
-        configASSERT( lLenPart > 0 );
+        for( size_t i = 0; i < dlLOGGING_RATE_LIMIT_SITES; i++ )
+        {
+            if( ( xRateSites[ i ].ulSuppressed > 0 ) &&
+                ( ( int32_t ) ( xNow - xRateSites[ i ].xNextTick ) >= 0 ) )
+            {
+                xSite = xRateSites[ i ];
+                xRateSites[ i ].ulSuppressed = 0;
+                break;
+            }
+        }
 
-        if( lLenPart + ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+        if( xSite.ulSuppressed > 0 )
         {
-            ulLenTotal += lLenPart;
+            prvLoggingPrintfUnlimited( "WRN", "%lu lines from %s:%lu suppressed by the rate limit",
+                                       ( unsigned long ) xSite.ulSuppressed, xSite.pcFileName,
+                                       ( unsigned long ) xSite.ulLineNumber );
         }
-        else
+
+        return ( xSite.ulSuppressed > 0 ) ? pdTRUE : pdFALSE;
+    }
+
+    /* Formats the "repeated" line of repeats older than dlLOGGING_REPEAT_FLUSH_MS,
+     * returns 0 when there is none */
+    static size_t prvLogRepeatFlush( char * pcNote )
+    {
+        uint32_t ulRepeats = 0;
+        char pcLogLevel[ sizeof( xLogRepeat.pcLogLevel ) ];
+        UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+        if( ( xLogRepeat.ulRepeats > 0 ) &&
+            ( ( xTaskGetTickCount() - xLogRepeat.xFirstTick ) >= pdMS_TO_TICKS( dlLOGGING_REPEAT_FLUSH_MS ) ) )
         {
-            ulLenTotal = dlMAX_PRINT_STRING_LENGTH;
+            ulRepeats = xLogRepeat.ulRepeats;
+            ( void ) memcpy( pcLogLevel, xLogRepeat.pcLogLevel, sizeof( pcLogLevel ) );
+            xLogRepeat.ulRepeats = 0;
         }
+
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+        return ( ulRepeats > 0 ) ? prvFormatRepeatNote( pcNote, pcLogLevel, ulRepeats ) : 0;
     }
 
-    /* remove any \r\n\0 characters at the end of the message */
-    while( ulLenTotal > 0 &&
-           ( pcPrintBuff[ ulLenTotal - 1 ] == '\r' ||
-             pcPrintBuff[ ulLenTotal - 1 ] == '\n' ||
-             pcPrintBuff[ ulLenTotal - 1 ] == '\0' ) )
+    /* Ticks until prvRateLimitFlush or prvLogRepeatFlush have a line to report,
+     * portMAX_DELAY when none is pending */
+    static TickType_t prvRateLimitNextFlush( void )
     {
-        pcPrintBuff[ ulLenTotal - 1 ] = '\0';
-        ulLenTotal--;
+        TickType_t xWait = portMAX_DELAY;
+        UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+        TickType_t xNow = xTaskGetTickCount();
+
+        if( xLogRepeat.ulRepeats > 0 )
+        {
+            TickType_t xElapsed = xNow - xLogRepeat.xFirstTick;
+
+            xWait = ( xElapsed < pdMS_TO_TICKS( dlLOGGING_REPEAT_FLUSH_MS ) ) ?
+                    ( pdMS_TO_TICKS( dlLOGGING_REPEAT_FLUSH_MS ) - xElapsed ) : 0;
+        }
+
+        for( size_t i = 0; i < dlLOGGING_RATE_LIMIT_SITES; i++ )
+        {
+            if( xRateSites[ i ].ulSuppressed > 0 )
+            {
+                int32_t lDue = ( int32_t ) ( xRateSites[ i ].xNextTick - xNow );
+
+                if( lDue <= 0 )
+                {
+                    xWait = 0;
+                }
+                else if( ( TickType_t ) lDue < xWait )
+                {
+                    xWait = ( TickType_t ) lDue;
+                }
+            }
+        }
+
+        taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+        return xWait;
     }
+#endif /* LOGGING_DEFERRED == 1 */
 
-    if( ( pcFileName != NULL ) &&
-        ( ulLineNumber > 0 ) &&
-        ( ulLenTotal < dlMAX_LOG_LINE_LENGTH ) )
+#endif /* LOGGING_RATE_LIMIT == 1 */
+
+/*-----------------------------------------------------------*/
+
+#if ( LOGGING_DEFERRED == 1 )
+
+/* Parses the conversion specification at pcSpec, which points after a '%' */
+static const char * prvParseSpec( const char * pcSpec,
+                                  DeferredSpec_t * pxSpec )
+{
+    const char * pcStart = pcSpec - 1;
+    uint8_t ucLength = 0; /* 1: l, 2: ll, 'j', 'z', 't' or 'L' */
+
+    pxSpec->xType = eArgNone;
+    pxSpec->ucStars = 0;
+    pxSpec->ucPrecisionStar = 0;
+    pxSpec->lPrecision = -1;
+
+    while( ( *pcSpec != '\0' ) && ( strchr( "-+ #0", *pcSpec ) != NULL ) )
     {
-        /* Add the trailer including file name and line number */
-        lLenPart = snprintf( &pcPrintBuff[ ulLenTotal ],
-                             ( dlMAX_LOG_LINE_LENGTH - ulLenTotal ),
-                             " (%s:%lu)",
-                             pcFileName,
-                             ulLineNumber );
+        pcSpec++;
+    }
 
-        configASSERT( lLenPart > 0 );
+    for( uint8_t ucField = 0; ucField < 2; ucField++ )
+    {
+        if( *pcSpec == '*' )
+        {
+            pxSpec->ucStars++;
+            pxSpec->ucPrecisionStar = ( ucField == 1 ) ? pxSpec->ucStars : 0;
+            pcSpec++;
+        }
+        else
+        {
+            while( isdigit( ( unsigned char ) *pcSpec ) )
+            {
+                if( ( ucField == 1 ) && ( pxSpec->lPrecision < 0x10000 ) )
+                {
+                    pxSpec->lPrecision = ( pxSpec->lPrecision * 10 ) + ( *pcSpec - '0' );
+                }
 
-        if( lLenPart + ulLenTotal < dlMAX_LOG_LINE_LENGTH )
+                pcSpec++;
+            }
+        }
+
+        if( ( ucField == 0 ) && ( *pcSpec == '.' ) )
         {
-            ulLenTotal += lLenPart;
+            /* "%.s" is a precision of 0 */
+            pxSpec->lPrecision = 0;
+            pcSpec++;
         }
         else
         {
-            ulLenTotal = dlMAX_LOG_LINE_LENGTH;
+            break;
         }
     }
 
-    vSendLogMessage( ( void * ) pcPrintBuff, ulLenTotal );
+    while( ( *pcSpec != '\0' ) && ( strchr( "hljztL", *pcSpec ) != NULL ) )
+    {
+        ucLength = ( ( *pcSpec == 'l' ) && ( ucLength == 1 ) ) ? 2 :
+                   ( *pcSpec == 'l' ) ? 1 :
+                   ( *pcSpec == 'h' ) ? ucLength : ( uint8_t ) *pcSpec;
+        pcSpec++;
+    }
 
-    if( xSchedulerWasSuspended == pdTRUE )
+    switch( *pcSpec )
     {
-        xTaskResumeAll();
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'c':
+            pxSpec->xType = ( ucLength == 1 ) ? eArgLong :
+                            ( ucLength == 2 ) ? eArgLongLong :
+                            ( ucLength == 'j' ) ? eArgIntMax :
+                            ( ucLength == 'z' ) ? eArgSize :
+                            ( ucLength == 't' ) ? eArgPtrDiff : eArgInt;
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            pxSpec->xType = ( ucLength == 'L' ) ? eArgLongDouble : eArgDouble;
+            break;
+
+        case 's':
+            pxSpec->xType = eArgString;
+            break;
+
+        case 'p':
+        case 'n':
+            pxSpec->xType = eArgPointer;
+            break;
+
+        default:
+            /* "%%", or a specification that is not understood */
+            break;
     }
+
+    if( *pcSpec != '\0' )
+    {
+        pcSpec++;
+    }
+
+    pxSpec->uxSpecLength = ( size_t ) ( pcSpec - pcStart );
+
+    return pcSpec;
+}
+
+static size_t prvArgSize( DeferredArgType_t xType )
+{
+    size_t uxSize = 0;
+
+    switch( xType )
+    {
+        case eArgInt:        uxSize = sizeof( int ); break;
+        case eArgLong:       uxSize = sizeof( long ); break;
+        case eArgLongLong:   uxSize = sizeof( long long ); break;
+        case eArgIntMax:     uxSize = sizeof( intmax_t ); break;
+        case eArgSize:       uxSize = sizeof( size_t ); break;
+        case eArgPtrDiff:    uxSize = sizeof( ptrdiff_t ); break;
+        case eArgDouble:     uxSize = sizeof( double ); break;
+        case eArgLongDouble: uxSize = sizeof( long double ); break;
+        case eArgPointer:    uxSize = sizeof( void * ); break;
+        default:             break;
+    }
+
+    return dlDEFERRED_ALIGN( uxSize );
+}
+
+/* Walks the arguments of pcFormat, copying them to pucArgs when not NULL.
+ * Returns the size of the copied arguments. */
+static size_t prvCopyArgs( const char * pcFormat,
+                           va_list * pxArgs,
+                           uint8_t * pucArgs )
+{
+    size_t uxSize = 0;
+    DeferredSpec_t xSpec;
+
+    while( ( pcFormat = strchr( pcFormat, '%' ) ) != NULL )
+    {
+        pcFormat = prvParseSpec( pcFormat + 1, &xSpec );
+
+        for( uint8_t ucStar = 0; ucStar < xSpec.ucStars; ucStar++ )
+        {
+            int lValue = va_arg( *pxArgs, int );
+
+            if( ( ucStar + 1 ) == xSpec.ucPrecisionStar )
+            {
+                /* A negative precision is taken as if it were omitted */
+                xSpec.lPrecision = ( lValue >= 0 ) ? lValue : -1;
+            }
+
+            if( pucArgs != NULL )
+            {
+                ( void ) memcpy( &pucArgs[ uxSize ], &lValue, sizeof( int ) );
+            }
+
+            uxSize += dlDEFERRED_ALIGN( sizeof( int ) );
+        }
+
+        if( xSpec.xType == eArgString )
+        {
+            const char * pcString = va_arg( *pxArgs, const char * );
+            size_t uxLength;
+
+            pcString = ( pcString != NULL ) ? pcString : "(null)";
+
+            /* With a precision, the string may not be terminated within its buffer */
+            uxLength = ( xSpec.lPrecision >= 0 ) ? strnlen( pcString, ( size_t ) xSpec.lPrecision ) : strlen( pcString );
+
+            if( pucArgs != NULL )
+            {
+                ( void ) memcpy( &pucArgs[ uxSize ], pcString, uxLength );
+                pucArgs[ uxSize + uxLength ] = '\0';
+            }
+
+            uxSize += dlDEFERRED_ALIGN( uxLength + 1 );
+        }
+        else if( xSpec.xType != eArgNone )
+        {
+            union
+            {
+                int i;
+                long l;
+                long long ll;
+                intmax_t j;
+                size_t z;
+                ptrdiff_t t;
+                double d;
+                long double ld;
+                void * p;
+            } xValue;
+
+            switch( xSpec.xType )
+            {
+                case eArgInt:        xValue.i = va_arg( *pxArgs, int ); break;
+                case eArgLong:       xValue.l = va_arg( *pxArgs, long ); break;
+                case eArgLongLong:   xValue.ll = va_arg( *pxArgs, long long ); break;
+                case eArgIntMax:     xValue.j = va_arg( *pxArgs, intmax_t ); break;
+                case eArgSize:       xValue.z = va_arg( *pxArgs, size_t ); break;
+                case eArgPtrDiff:    xValue.t = va_arg( *pxArgs, ptrdiff_t ); break;
+                case eArgDouble:     xValue.d = va_arg( *pxArgs, double ); break;
+                case eArgLongDouble: xValue.ld = va_arg( *pxArgs, long double ); break;
+                default:             xValue.p = va_arg( *pxArgs, void * ); break;
+            }
+
+            if( pucArgs != NULL )
+            {
+                ( void ) memcpy( &pucArgs[ uxSize ], &xValue, prvArgSize( xSpec.xType ) );
+            }
+
+            uxSize += prvArgSize( xSpec.xType );
+        }
+    }
+
+    return uxSize;
+}
+
+/* Reserves uxLength bytes in the ring, returns NULL when it is full */
+static DeferredRecord_t * prvDeferredReserve( size_t uxLength )
+{
+    uint32_t ulWrite = __atomic_load_n( &ulDeferredWrite, __ATOMIC_RELAXED );
+    uint32_t ulOffset;
+    uint32_t ulPadding;
+
+    do
+    {
+        /* A record does not wrap around, pad the end of the ring instead */
+        ulOffset = ulWrite & ( dlLOGGING_DEFERRED_BUFFER_SIZE - 1UL );
+        ulPadding = ( ( ulOffset + uxLength ) > dlLOGGING_DEFERRED_BUFFER_SIZE ) ?
+                    ( dlLOGGING_DEFERRED_BUFFER_SIZE - ulOffset ) : 0UL;
+
+        if( ( ulWrite + ulPadding + uxLength - __atomic_load_n( &ulDeferredRead, __ATOMIC_ACQUIRE ) ) >
+            dlLOGGING_DEFERRED_BUFFER_SIZE )
+        {
+            return NULL;
+        }
+    }
+    while( !__atomic_compare_exchange_n( &ulDeferredWrite, &ulWrite, ulWrite + ulPadding + uxLength,
+                                         pdTRUE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) );
+
+    if( ( ulWrite + ulPadding + uxLength - ulDeferredRead ) > xLoggingStats.ulDeferredHighWater )
+    {
+        xLoggingStats.ulDeferredHighWater = ulWrite + ulPadding + uxLength - ulDeferredRead;
+    }
+
+    if( ulPadding > 0UL )
+    {
+        __atomic_store_n( &ulDeferredRing[ ulOffset / sizeof( uint32_t ) ],
+                          ulPadding | dlDEFERRED_HDR_PADDING | dlDEFERRED_HDR_COMMITTED, __ATOMIC_RELEASE );
+        ulOffset = 0;
+    }
+
+    return ( DeferredRecord_t * ) &ulDeferredRing[ ulOffset / sizeof( uint32_t ) ];
+}
+
+/* Records keep pointers to the format, level and file name strings, which must
+ * then still be valid when the record is formatted: only strings of the image are. */
+static BaseType_t prvIsImagePointer( const char * pc )
+{
+    return ( ( pc == NULL ) ||
+             ( ( ( uintptr_t ) pc >= FLASH_BASE ) && ( ( uintptr_t ) pc < ( FLASH_BASE + FLASH_SIZE ) ) ) ) ? pdTRUE : pdFALSE;
+}
+
+/* Returns pdFALSE when the line must be formatted right away */
+static BaseType_t prvDeferredWrite( const char * pcLogLevel,
+                                    const char * pcFileName,
+                                    unsigned long ulLineNumber,
+                                    const char * pcTaskName,
+                                    const char * pcFormat,
+                                    va_list xArgs )
+{
+    va_list xArgsCopy;
+    size_t uxLength;
+    DeferredRecord_t * pxRecord = NULL;
+
+    if( ( prvIsImagePointer( pcFormat ) == pdFALSE ) ||
+        ( prvIsImagePointer( pcLogLevel ) == pdFALSE ) ||
+        ( prvIsImagePointer( pcFileName ) == pdFALSE ) )
+    {
+        return pdFALSE;
+    }
+
+    va_copy( xArgsCopy, xArgs );
+    uxLength = sizeof( DeferredRecord_t ) + prvCopyArgs( pcFormat, &xArgsCopy, NULL );
+    va_end( xArgsCopy );
+
+    if( uxLength > dlLOGGING_DEFERRED_MAX_RECORD )
+    {
+        return pdFALSE;
+    }
+
+    pxRecord = prvDeferredReserve( uxLength );
+
+    if( pxRecord == NULL )
+    {
+        ( void ) __atomic_add_fetch( &ulDeferredDropped, 1UL, __ATOMIC_RELAXED );
+        prvDeferredWake();
+    }
+    else
+    {
+        pxRecord->pcFormat = pcFormat;
+        pxRecord->pcLogLevel = pcLogLevel;
+        pxRecord->pcFileName = pcFileName;
+        pxRecord->ulLineNumber = ( uint32_t ) ulLineNumber;
+        pxRecord->ulTimestamp = ( uint32_t ) xTaskGetTickCount();
+        ( void ) strncpy( pxRecord->pcTaskName, pcTaskName, dlDEFERRED_TASK_NAME_LEN - 1 );
+        pxRecord->pcTaskName[ dlDEFERRED_TASK_NAME_LEN - 1 ] = '\0';
+
+        va_copy( xArgsCopy, xArgs );
+        ( void ) prvCopyArgs( pcFormat, &xArgsCopy, pxRecord->ucArgs );
+        va_end( xArgsCopy );
+
+        /* Publish the record */
+        __atomic_store_n( &pxRecord->ulHeader, ( uint32_t ) uxLength | dlDEFERRED_HDR_COMMITTED, __ATOMIC_RELEASE );
+        prvDeferredWake();
+    }
+
+    return pdTRUE;
+}
+
+#define FORMAT_ARG( type )                                                                           \
+    do {                                                                                             \
+        type xValue;                                                                                 \
+        ( void ) memcpy( &xValue, &pucArgs[ uxArg ], sizeof( type ) );                               \
+        uxArg += dlDEFERRED_ALIGN( sizeof( type ) );                                                 \
+        lLenPart = ( xSpec.ucStars == 0 ) ? snprintf( pcOut, uxRemaining, pcSpec, xValue ) :          \
+                   ( xSpec.ucStars == 1 ) ? snprintf( pcOut, uxRemaining, pcSpec, lStars[ 0 ], xValue ) : \
+                   snprintf( pcOut, uxRemaining, pcSpec, lStars[ 0 ], lStars[ 1 ], xValue );          \
+    } while( 0 )
+
+/* Formats the message of pxRecord, as vsnprintf would have */
+static size_t prvFormatRecordMessage( const DeferredRecord_t * pxRecord,
+                                      char * pcBuffer,
+                                      size_t uxBufferLength )
+{
+    const uint8_t * pucArgs = pxRecord->ucArgs;
+    const char * pcFormat = pxRecord->pcFormat;
+    size_t uxLength = 0;
+    size_t uxArg = 0;
+    DeferredSpec_t xSpec;
+    char pcSpec[ 24 ];
+
+    while( ( *pcFormat != '\0' ) && ( uxLength + 1 < uxBufferLength ) )
+    {
+        const char * pcPercent = strchr( pcFormat, '%' );
+        size_t uxText = ( pcPercent != NULL ) ? ( size_t ) ( pcPercent - pcFormat ) : strlen( pcFormat );
+        char * pcOut;
+        size_t uxRemaining;
+        int32_t lLenPart = 0;
+        int lStars[ 2 ] = { 0 };
+
+        /* Literal text up to the next specification */
+        uxText = ( uxText < ( uxBufferLength - 1 - uxLength ) ) ? uxText : ( uxBufferLength - 1 - uxLength );
+        ( void ) memcpy( &pcBuffer[ uxLength ], pcFormat, uxText );
+        uxLength += uxText;
+        pcFormat += uxText;
+
+        if( ( pcPercent == NULL ) || ( pcFormat != pcPercent ) )
+        {
+            break;
+        }
+
+        pcFormat = prvParseSpec( pcPercent + 1, &xSpec );
+        pcOut = &pcBuffer[ uxLength ];
+        uxRemaining = uxBufferLength - uxLength;
+
+        for( uint8_t ucStar = 0; ucStar < xSpec.ucStars; ucStar++ )
+        {
+            ( void ) memcpy( &lStars[ ucStar ], &pucArgs[ uxArg ], sizeof( int ) );
+            uxArg += dlDEFERRED_ALIGN( sizeof( int ) );
+        }
+
+        if( xSpec.uxSpecLength >= sizeof( pcSpec ) )
+        {
+            break;
+        }
+
+        ( void ) memcpy( pcSpec, pcPercent, xSpec.uxSpecLength );
+        pcSpec[ xSpec.uxSpecLength ] = '\0';
+
+        switch( xSpec.xType )
+        {
+            case eArgInt:        FORMAT_ARG( int ); break;
+            case eArgLong:       FORMAT_ARG( long ); break;
+            case eArgLongLong:   FORMAT_ARG( long long ); break;
+            case eArgIntMax:     FORMAT_ARG( intmax_t ); break;
+            case eArgSize:       FORMAT_ARG( size_t ); break;
+            case eArgPtrDiff:    FORMAT_ARG( ptrdiff_t ); break;
+            case eArgDouble:     FORMAT_ARG( double ); break;
+            case eArgLongDouble: FORMAT_ARG( long double ); break;
+
+            case eArgPointer:
+                if( pcSpec[ xSpec.uxSpecLength - 1 ] == 'n' )
+                {
+                    /* Nothing to write back to */
+                    uxArg += prvArgSize( eArgPointer );
+                }
+                else
+                {
+                    FORMAT_ARG( void * );
+                }
+
+                break;
+
+            case eArgString:
+            {
+                /* Copied terminated by prvCopyArgs, cut to the precision if any */
+                const char * pcString = ( const char * ) &pucArgs[ uxArg ];
+
+                uxArg += dlDEFERRED_ALIGN( strlen( pcString ) + 1 );
+                lLenPart = ( xSpec.ucStars == 0 ) ? snprintf( pcOut, uxRemaining, pcSpec, pcString ) :
+                           ( xSpec.ucStars == 1 ) ? snprintf( pcOut, uxRemaining, pcSpec, lStars[ 0 ], pcString ) :
+                           snprintf( pcOut, uxRemaining, pcSpec, lStars[ 0 ], lStars[ 1 ], pcString );
+                break;
+            }
+
+            default:
+                lLenPart = snprintf( pcOut, uxRemaining, "%s", ( strcmp( pcSpec, "%%" ) == 0 ) ? "%" : pcSpec );
+                break;
+        }
+
+        if( lLenPart > 0 )
+        {
+            uxLength += ( ( size_t ) lLenPart < uxRemaining ) ? ( size_t ) lLenPart : ( uxRemaining - 1 );
+        }
+    }
+
+    pcBuffer[ uxLength ] = '\0';
+
+    return uxLength;
+}
+
+size_t xLoggingDeferredFormatNext( char * pcBuffer,
+                                   size_t uxBufferLength )
+{
+    size_t uxLength = 0;
+    uint32_t ulDropped = __atomic_exchange_n( &ulDeferredDropped, 0UL, __ATOMIC_RELAXED );
+
+    configASSERT( uxBufferLength >= dlMAX_PRINT_STRING_LENGTH );
+
+    if( ulDropped > 0 )
+    {
+        xLoggingStats.xDeferred.ulDropped += ulDropped;
+        uxLength = prvFormatPrefix( pcBuffer, "WRN", ( uint32_t ) xTaskGetTickCount(), "LogFmt" );
+        uxLength += snprintf( &pcBuffer[ uxLength ], uxBufferLength - uxLength,
+                              "%lu log messages dropped, the deferred log buffer was full.", ( unsigned long ) ulDropped );
+    }
+
+    while( ( uxLength == 0 ) &&
+           ( ulDeferredRead != __atomic_load_n( &ulDeferredWrite, __ATOMIC_ACQUIRE ) ) )
+    {
+        uint32_t ulOffset = ulDeferredRead & ( dlLOGGING_DEFERRED_BUFFER_SIZE - 1UL );
+        DeferredRecord_t * pxRecord = ( DeferredRecord_t * ) &ulDeferredRing[ ulOffset / sizeof( uint32_t ) ];
+        uint32_t ulHeader = __atomic_load_n( &pxRecord->ulHeader, __ATOMIC_ACQUIRE );
+        uint32_t ulRecordLength = ulHeader & dlDEFERRED_HDR_LENGTH_MASK;
+
+        if( ( ulHeader & dlDEFERRED_HDR_COMMITTED ) == 0UL )
+        {
+            /* Still being written */
+            break;
+        }
+
+        if( ( ulHeader & dlDEFERRED_HDR_PADDING ) == 0UL )
+        {
+            uxLength = prvFormatPrefix( pcBuffer, pxRecord->pcLogLevel, pxRecord->ulTimestamp, pxRecord->pcTaskName );
+
+            if( uxLength < dlMAX_PRINT_STRING_LENGTH )
+            {
+                uxLength += prvFormatRecordMessage( pxRecord, &pcBuffer[ uxLength ], dlMAX_PRINT_STRING_LENGTH - uxLength );
+            }
+
+            uxLength = prvFormatTrailer( pcBuffer, uxLength, pxRecord->pcFileName, pxRecord->ulLineNumber );
+
+            #if ( LOGGING_CRASH_LOG == 1 )
+                prvCrashLogAppendRecord( pxRecord, ulRecordLength );
+            #endif
+        }
+
+        /* Headers of later records may land anywhere in this space */
+        ( void ) memset( pxRecord, 0, ulRecordLength );
+        __atomic_store_n( &ulDeferredRead, ulDeferredRead + ulRecordLength, __ATOMIC_RELEASE );
+    }
+
+    return uxLength;
+}
+
+static void prvDeferredLogTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        size_t uxLength = xLoggingDeferredFormatNext( pcDeferredBuff, sizeof( pcDeferredBuff ) );
+
+        #if ( LOGGING_RATE_LIMIT == 1 )
+            char pcNote[ dlLOG_REPEAT_NOTE_LENGTH ];
+            size_t uxNoteLength = 0;
+
+            if( uxLength == 0 )
+            {
+                uxLength = prvLogRepeatFlush( pcDeferredBuff );
+
+                if( ( uxLength == 0 ) && ( prvRateLimitFlush() == pdTRUE ) )
+                {
+                    continue;
+                }
+            }
+            else if( prvLogRepeated( pcDeferredBuff, uxLength, pcNote, &uxNoteLength ) == pdTRUE )
+            {
+                continue;
+            }
+
+            if( uxNoteLength > 0 )
+            {
+                ( void ) xMessageBufferSend( xLogMBuf, pcNote, uxNoteLength, pdMS_TO_TICKS( LOGGING_TIMEOUT_MS ) );
+            }
+        #endif /* LOGGING_RATE_LIMIT == 1 */
+
+        if( uxLength > 0 )
+        {
+            /* Wait for room rather than dropping, this task only runs when the system is idle */
+            ( void ) xMessageBufferSend( xLogMBuf, pcDeferredBuff, uxLength, pdMS_TO_TICKS( LOGGING_TIMEOUT_MS ) );
+        }
+        else
+        {
+            /* Sleep until a record is published, or a suppressed or repeated line is due */
+            #if ( LOGGING_RATE_LIMIT == 1 )
+                ( void ) ulTaskNotifyTake( pdTRUE, prvRateLimitNextFlush() );
+            #else
+                ( void ) ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+            #endif
+        }
+    }
+}
+
+#endif /* LOGGING_DEFERRED == 1 */
+
+/*-----------------------------------------------------------*/
+
+#if ( LOGGING_CRASH_LOG == 1 )
+
+/* The crash log keeps the most recent log lines in RAM that is neither
+ * initialized nor used by the bootloader, so they survive a warm reset
+ * (watchdog, fault, assert, software reset). Deferred lines are stored as the
+ * binary records of the deferred ring and only formatted when the log is read. */
+#define dlCRASH_LOG_MAGIC            ( 0x474F4C43UL ) /* "CLOG" */
+#define dlCRASH_LOG_DATA_SIZE        ( dlLOGGING_CRASH_LOG_SIZE - 4 * sizeof( uint32_t ) )
+#define dlCRASH_LOG_MAX_RECORD       ( sizeof( CrashRecordHeader_t ) + sizeof( uint32_t ) + dlLOGGING_DEFERRED_MAX_RECORD )
+
+typedef enum
+{
+    eCrashRecordBoot = 1,
+    eCrashRecordText,
+    eCrashRecordDeferred,
+    eCrashRecordFault
+} CrashRecordType_t;
+
+typedef struct
+{
+    uint16_t usLength; /* Including this header */
+    uint8_t ucType;
+    uint8_t ucReserved;
+} CrashRecordHeader_t;
+
+typedef struct
+{
+    uint32_t ulBootCount;
+    uint32_t ulResetFlags; /* RCC->RSR */
+} CrashBootRecord_t;
+
+typedef struct
+{
+    uint32_t ulRegisters[ 8 ]; /* r0-r3, r12, lr, pc and psr stacked by the fault */
+    uint32_t ulCfsr;
+    uint32_t ulHfsr;
+    uint32_t ulMmfar;
+    uint32_t ulBfar;
+    char pcTaskName[ dlDEFERRED_TASK_NAME_LEN ];
+} CrashFaultRecord_t;
+
+typedef struct
+{
+    uint32_t ulMagic;
+    uint32_t ulStart; /* Sequence number of the oldest byte */
+    uint32_t ulEnd;   /* Sequence number following the newest byte */
+    uint32_t ulBootCount;
+    uint8_t ucData[ dlCRASH_LOG_DATA_SIZE ];
+} CrashLog_t;
+
+/* Placed in the CRASHLOG region of the linker script */
+static CrashLog_t xCrashLog __attribute__( ( section( ".crash_log" ) ) );
+
+static BaseType_t xCrashLogReady = pdFALSE;
+
+static void prvCrashLogRead( uint32_t ulSeq,
+                             void * pvData,
+                             size_t uxLength )
+{
+    for( size_t i = 0; i < uxLength; i++ )
+    {
+        ( ( uint8_t * ) pvData )[ i ] = xCrashLog.ucData[ ( ulSeq + i ) % dlCRASH_LOG_DATA_SIZE ];
+    }
+}
+
+static void prvCrashLogWrite( uint32_t ulSeq,
+                              const void * pvData,
+                              size_t uxLength )
+{
+    uint32_t ulOffset = ulSeq % dlCRASH_LOG_DATA_SIZE;
+    size_t uxFirst = dlCRASH_LOG_DATA_SIZE - ulOffset;
+
+    uxFirst = ( uxFirst < uxLength ) ? uxFirst : uxLength;
+    ( void ) memcpy( &xCrashLog.ucData[ ulOffset ], pvData, uxFirst );
+    ( void ) memcpy( xCrashLog.ucData, ( const uint8_t * ) pvData + uxFirst, uxLength - uxFirst );
+}
+
+/* Validates the log left by the previous boot and records this one, must be
+ * called with interrupts masked */
+static void prvCrashLogInit( void )
+{
+    uint32_t ulSeq;
+    CrashBootRecord_t xBoot;
+    CrashRecordHeader_t xHeader;
+
+    if( xCrashLogReady == pdFALSE )
+    {
+        if( ( xCrashLog.ulMagic != dlCRASH_LOG_MAGIC ) ||
+            ( ( xCrashLog.ulEnd - xCrashLog.ulStart ) > dlCRASH_LOG_DATA_SIZE ) )
+        {
+            ( void ) memset( &xCrashLog, 0, sizeof( xCrashLog ) );
+            xCrashLog.ulMagic = dlCRASH_LOG_MAGIC;
+        }
+
+        /* Keep the records up to the first one that was not completely written */
+        ulSeq = xCrashLog.ulStart;
+
+        while( ulSeq != xCrashLog.ulEnd )
+        {
+            prvCrashLogRead( ulSeq, &xHeader, sizeof( xHeader ) );
+
+            if( ( xHeader.usLength < sizeof( xHeader ) ) ||
+                ( xHeader.usLength > dlCRASH_LOG_MAX_RECORD ) ||
+                ( xHeader.usLength > ( xCrashLog.ulEnd - ulSeq ) ) ||
+                ( xHeader.ucType < eCrashRecordBoot ) ||
+                ( xHeader.ucType > eCrashRecordFault ) )
+            {
+                xCrashLog.ulEnd = ulSeq;
+                break;
+            }
+
+            ulSeq += xHeader.usLength;
+        }
+
+        xCrashLogReady = pdTRUE;
+
+        xBoot.ulBootCount = ++xCrashLog.ulBootCount;
+        xBoot.ulResetFlags = RCC->RSR;
+        SET_BIT( RCC->RSR, RCC_RSR_RMVF );
+
+        prvCrashLogAppend( eCrashRecordBoot, &xBoot, sizeof( xBoot ), NULL, 0 );
+    }
+}
+
+/* Appends a record made of pvData followed by pvData2, dropping the oldest records to make room */
+static void prvCrashLogAppend( uint8_t ucType,
+                               const void * pvData,
+                               size_t uxLength,
+                               const void * pvData2,
+                               size_t uxLength2 )
+{
+    CrashRecordHeader_t xHeader = { 0 };
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    xHeader.usLength = ( uint16_t ) ( sizeof( xHeader ) + uxLength + uxLength2 );
+    xHeader.ucType = ucType;
+
+    prvCrashLogInit();
+
+    if( xHeader.usLength <= dlCRASH_LOG_MAX_RECORD )
+    {
+        while( ( dlCRASH_LOG_DATA_SIZE - ( xCrashLog.ulEnd - xCrashLog.ulStart ) ) < xHeader.usLength )
+        {
+            CrashRecordHeader_t xOldest;
+
+            prvCrashLogRead( xCrashLog.ulStart, &xOldest, sizeof( xOldest ) );
+            xCrashLog.ulStart += xOldest.usLength;
+        }
+
+        prvCrashLogWrite( xCrashLog.ulEnd, &xHeader, sizeof( xHeader ) );
+        prvCrashLogWrite( xCrashLog.ulEnd + sizeof( xHeader ), pvData, uxLength );
+
+        if( uxLength2 > 0 )
+        {
+            prvCrashLogWrite( xCrashLog.ulEnd + sizeof( xHeader ) + uxLength, pvData2, uxLength2 );
+        }
+
+        /* Publish the record once it is complete */
+        __DMB();
+        xCrashLog.ulEnd += xHeader.usLength;
+
+        /* Keep clear of the wrap around of the sequence numbers */
+        if( xCrashLog.ulEnd > 0x80000000UL )
+        {
+            uint32_t ulRebase = ( xCrashLog.ulStart / dlCRASH_LOG_DATA_SIZE ) * dlCRASH_LOG_DATA_SIZE;
+
+            xCrashLog.ulStart -= ulRebase;
+            xCrashLog.ulEnd -= ulRebase;
+        }
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+#if ( LOGGING_DEFERRED == 1 )
+    /* FNV-1a of the strings a deferred record points to, checked before they are
+     * used again after a reset: the image may have changed in between. */
+    static uint32_t prvCrashRecordHash( const DeferredRecord_t * pxRecord )
+    {
+        const char * pcStrings[] = { pxRecord->pcFormat, pxRecord->pcLogLevel, pxRecord->pcFileName };
+        uint32_t ulHash = 2166136261UL;
+
+        for( size_t i = 0; i < ( sizeof( pcStrings ) / sizeof( pcStrings[ 0 ] ) ); i++ )
+        {
+            for( const char * pc = pcStrings[ i ]; ( pc != NULL ) && ( *pc != '\0' ); pc++ )
+            {
+                ulHash = ( ulHash ^ ( uint8_t ) *pc ) * 16777619UL;
+            }
+
+            ulHash = ( ulHash ^ 0xFFU ) * 16777619UL;
+        }
+
+        return ulHash;
+    }
+
+    static void prvCrashLogAppendRecord( const DeferredRecord_t * pxRecord,
+                                         size_t uxLength )
+    {
+        uint32_t ulHash = prvCrashRecordHash( pxRecord );
+
+        prvCrashLogAppend( eCrashRecordDeferred, &ulHash, sizeof( ulHash ), pxRecord, uxLength );
+    }
+#endif /* LOGGING_DEFERRED == 1 */
+
+void vLoggingCrashLogFault( const uint32_t * pulFaultStackAddress )
+{
+    CrashFaultRecord_t xFault;
+
+    ( void ) memcpy( xFault.ulRegisters, pulFaultStackAddress, sizeof( xFault.ulRegisters ) );
+    xFault.ulCfsr = SCB->CFSR;
+    xFault.ulHfsr = SCB->HFSR;
+    xFault.ulMmfar = SCB->MMFAR;
+    xFault.ulBfar = SCB->BFAR;
+    ( void ) strncpy( xFault.pcTaskName,
+                      ( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED ) ? pcTaskGetName( NULL ) : "None",
+                      sizeof( xFault.pcTaskName ) - 1 );
+    xFault.pcTaskName[ sizeof( xFault.pcTaskName ) - 1 ] = '\0';
+
+    #if ( LOGGING_DEFERRED == 1 )
+        /* Keep the lines the formatter task did not get to, without formatting them */
+        while( ulDeferredRead != ulDeferredWrite )
+        {
+            uint32_t ulOffset = ulDeferredRead & ( dlLOGGING_DEFERRED_BUFFER_SIZE - 1UL );
+            DeferredRecord_t * pxRecord = ( DeferredRecord_t * ) &ulDeferredRing[ ulOffset / sizeof( uint32_t ) ];
+            uint32_t ulRecordLength = pxRecord->ulHeader & dlDEFERRED_HDR_LENGTH_MASK;
+
+            if( ( ( pxRecord->ulHeader & dlDEFERRED_HDR_COMMITTED ) == 0UL ) ||
+                ( ulRecordLength == 0UL ) ||
+                ( ulRecordLength > ( dlLOGGING_DEFERRED_BUFFER_SIZE - ulOffset ) ) )
+            {
+                break;
+            }
+
+            if( ( ( pxRecord->ulHeader & dlDEFERRED_HDR_PADDING ) == 0UL ) &&
+                ( ulRecordLength <= dlLOGGING_DEFERRED_MAX_RECORD ) )
+            {
+                prvCrashLogAppendRecord( pxRecord, ulRecordLength );
+            }
+
+            ulDeferredRead += ulRecordLength;
+        }
+    #endif /* LOGGING_DEFERRED == 1 */
+
+    prvCrashLogAppend( eCrashRecordFault, &xFault, sizeof( xFault ), NULL, 0 );
+}
+
+size_t xLoggingCrashLogNext( uint32_t * pulCursor,
+                             char * pcBuffer,
+                             size_t uxBufferLength )
+{
+    union
+    {
+        CrashRecordHeader_t xHeader;
+        uint32_t ulAlign;
+        uint8_t ucBytes[ dlCRASH_LOG_MAX_RECORD ];
+    } xRecord;
+    const void * pvPayload = &xRecord.ucBytes[ sizeof( CrashRecordHeader_t ) ];
+    size_t uxPayload;
+    size_t uxLength = 0;
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    prvCrashLogInit();
+
+    /* Older records may have been dropped since the last call */
+    if( ( *pulCursor - xCrashLog.ulStart ) > ( xCrashLog.ulEnd - xCrashLog.ulStart ) )
+    {
+        *pulCursor = xCrashLog.ulStart;
+    }
+
+    xRecord.xHeader.usLength = 0;
+
+    if( *pulCursor != xCrashLog.ulEnd )
+    {
+        prvCrashLogRead( *pulCursor, &xRecord.xHeader, sizeof( xRecord.xHeader ) );
+        prvCrashLogRead( *pulCursor, xRecord.ucBytes, xRecord.xHeader.usLength );
+        *pulCursor += xRecord.xHeader.usLength;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    if( xRecord.xHeader.usLength == 0 )
+    {
+        return 0;
+    }
+
+    uxPayload = xRecord.xHeader.usLength - sizeof( CrashRecordHeader_t );
+    pcBuffer[ 0 ] = '\0';
+
+    switch( xRecord.xHeader.ucType )
+    {
+        case eCrashRecordBoot:
+        {
+            const CrashBootRecord_t * pxBoot = pvPayload;
+
+            uxLength = snprintf( pcBuffer, uxBufferLength,
+                                 "----- boot %lu, reset flags 0x%08lx%s%s%s%s%s%s -----",
+                                 ( unsigned long ) pxBoot->ulBootCount,
+                                 ( unsigned long ) pxBoot->ulResetFlags,
+                                 ( pxBoot->ulResetFlags & RCC_RSR_PINRSTF ) ? " pin" : "",
+                                 ( pxBoot->ulResetFlags & RCC_RSR_BORRSTF ) ? " brown-out" : "",
+                                 ( pxBoot->ulResetFlags & RCC_RSR_SFTRSTF ) ? " software" : "",
+                                 ( pxBoot->ulResetFlags & RCC_RSR_IWDGRSTF ) ? " iwdg" : "",
+                                 ( pxBoot->ulResetFlags & RCC_RSR_WWDGRSTF ) ? " wwdg" : "",
+                                 ( pxBoot->ulResetFlags & RCC_RSR_LPWRRSTF ) ? " low-power" : "" );
+            break;
+        }
+
+        case eCrashRecordFault:
+        {
+            const CrashFaultRecord_t * pxFault = pvPayload;
+
+            uxLength = snprintf( pcBuffer, uxBufferLength,
+                                 "<FLT> HardFault in task %.*s: pc 0x%08lx lr 0x%08lx psr 0x%08lx "
+                                 "cfsr 0x%08lx hfsr 0x%08lx mmfar 0x%08lx bfar 0x%08lx",
+                                 ( int ) sizeof( pxFault->pcTaskName ), pxFault->pcTaskName,
+                                 ( unsigned long ) pxFault->ulRegisters[ 6 ],
+                                 ( unsigned long ) pxFault->ulRegisters[ 5 ],
+                                 ( unsigned long ) pxFault->ulRegisters[ 7 ],
+                                 ( unsigned long ) pxFault->ulCfsr,
+                                 ( unsigned long ) pxFault->ulHfsr,
+                                 ( unsigned long ) pxFault->ulMmfar,
+                                 ( unsigned long ) pxFault->ulBfar );
+            break;
+        }
+
+        case eCrashRecordText:
+            uxLength = ( uxPayload < uxBufferLength ) ? uxPayload : uxBufferLength - 1;
+            ( void ) memcpy( pcBuffer, pvPayload, uxLength );
+            pcBuffer[ uxLength ] = '\0';
+            break;
+
+        #if ( LOGGING_DEFERRED == 1 )
+            case eCrashRecordDeferred:
+            {
+                uint32_t ulHash;
+                DeferredRecord_t * pxRecord = ( DeferredRecord_t * ) &xRecord.ucBytes[ sizeof( CrashRecordHeader_t ) + sizeof( ulHash ) ];
+
+                ( void ) memcpy( &ulHash, pvPayload, sizeof( ulHash ) );
+                pxRecord->pcTaskName[ dlDEFERRED_TASK_NAME_LEN - 1 ] = '\0';
+
+                if( ( prvIsImagePointer( pxRecord->pcFormat ) == pdTRUE ) &&
+                    ( prvIsImagePointer( pxRecord->pcLogLevel ) == pdTRUE ) &&
+                    ( prvIsImagePointer( pxRecord->pcFileName ) == pdTRUE ) &&
+                    ( pxRecord->pcFormat != NULL ) && ( pxRecord->pcLogLevel != NULL ) &&
+                    ( prvCrashRecordHash( pxRecord ) == ulHash ) &&
+                    ( uxBufferLength >= dlMAX_LOG_LINE_LENGTH ) )
+                {
+                    uxLength = prvFormatPrefix( pcBuffer, pxRecord->pcLogLevel, pxRecord->ulTimestamp, pxRecord->pcTaskName );
+
+                    if( uxLength < dlMAX_PRINT_STRING_LENGTH )
+                    {
+                        uxLength += prvFormatRecordMessage( pxRecord, &pcBuffer[ uxLength ], dlMAX_PRINT_STRING_LENGTH - uxLength );
+                    }
+
+                    uxLength = prvFormatTrailer( pcBuffer, uxLength, pxRecord->pcFileName, pxRecord->ulLineNumber );
+                }
+                else
+                {
+                    uxLength = snprintf( pcBuffer, uxBufferLength,
+                                         "<UNK> %8lu [%-10.10s] Line logged by another image, format 0x%08lx",
+                                         ( ( unsigned long ) pxRecord->ulTimestamp / portTICK_PERIOD_MS ) & 0xFFFFFF,
+                                         pxRecord->pcTaskName,
+                                         ( unsigned long ) pxRecord->pcFormat );
+                }
+
+                break;
+            }
+        #endif /* LOGGING_DEFERRED == 1 */
+
+        default:
+            uxLength = snprintf( pcBuffer, uxBufferLength, "Unknown crash log record type %u", xRecord.xHeader.ucType );
+            break;
+    }
+
+    /* Never report the end of the log for a record that did not format */
+    if( uxLength == 0 )
+    {
+        pcBuffer[ 0 ] = ' ';
+        uxLength = 1;
+    }
+
+    return ( uxLength < uxBufferLength ) ? uxLength : uxBufferLength - 1;
+}
+
+void vLoggingCrashLogClear( void )
+{
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    xCrashLog.ulStart = xCrashLog.ulEnd;
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+#endif /* LOGGING_CRASH_LOG == 1 */
+
+/*-----------------------------------------------------------*/
+
+void vLoggingSetDeferred( BaseType_t xDeferred )
+{
+    #if ( LOGGING_DEFERRED == 1 )
+        xDeferredMode = xDeferred;
+    #else
+        ( void ) xDeferred;
+    #endif
+}
+
+BaseType_t xLoggingIsDeferred( void )
+{
+    return xDeferredMode;
+}
+
+void vLoggingGetStats( LoggingStats_t * pxStats )
+{
+    *pxStats = xLoggingStats;
+
+    #if ( LOGGING_DEFERRED == 1 )
+        pxStats->ulDeferredPending = ulDeferredWrite - ulDeferredRead;
+    #endif
+}
+
+void vLoggingResetStats( void )
+{
+    ( void ) memset( &xLoggingStats, 0, sizeof( xLoggingStats ) );
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvLoggingVPrintf( const char * const pcLogLevel,
+                               const char * const pcFileName,
+                               const unsigned long ulLineNumber,
+                               BaseType_t xRateLimit,
+                               const char * const pcFormat,
+                               va_list args )
+{
+    uint32_t ulStartCycles = DWT->CYCCNT;
+    uint32_t ulLenTotal = 0;
+    int32_t lLenPart = -1;
+    const char * pcTaskName = NULL;
+    BaseType_t xSchedulerWasSuspended = pdFALSE;
+
+    #if ( LOGGING_RATE_LIMIT == 1 )
+        char pcNote[ dlLOG_REPEAT_NOTE_LENGTH ];
+        size_t uxNoteLength = 0;
+        uint32_t ulSuppressed = 0;
+
+        if( xRateLimit == pdTRUE )
+        {
+            if( prvRateLimitAllow( pcFileName, ulLineNumber, &ulSuppressed ) == pdFALSE )
+            {
+                return;
+            }
+
+            if( ulSuppressed > 0 )
+            {
+                /* pcFileName and ulLineNumber are in the text */
+                prvLoggingPrintfUnlimited( pcLogLevel, "%lu lines from %s:%lu suppressed by the rate limit",
+                                           ( unsigned long ) ulSuppressed, pcFileName, ( unsigned long ) ulLineNumber );
+            }
+        }
+    #else
+        ( void ) xRateLimit;
+    #endif /* LOGGING_RATE_LIMIT == 1 */
+
+    /* Additional info to place at the start of the log line */
+    if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+    {
+        pcTaskName = pcTaskGetName( NULL );
+    }
+    else
+    {
+        pcTaskName = "None";
+    }
+
+    #if ( LOGGING_DEFERRED == 1 )
+        if( ( xDeferredMode == pdTRUE ) &&
+            ( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED ) )
+        {
+            if( prvDeferredWrite( pcLogLevel, pcFileName, ulLineNumber, pcTaskName, pcFormat, args ) == pdTRUE )
+            {
+                prvAddStats( &xLoggingStats.xDeferred, ulStartCycles );
+                return;
+            }
+        }
+    #endif
+
+    if( xTaskGetSchedulerState() == taskSCHEDULER_RUNNING )
+    {
+        xSchedulerWasSuspended = pdTRUE;
+        /* Suspend the scheduler to access pcPrintBuff */
+        vTaskSuspendAll();
+    }
+
+    ulLenTotal = prvFormatPrefix( pcPrintBuff, pcLogLevel, ( uint32_t ) xTaskGetTickCount(), pcTaskName );
+
+    if( ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+    {
+        /* There are a variable number of parameters. */
+        lLenPart = vsnprintf( &pcPrintBuff[ ulLenTotal ],
+                              ( dlMAX_PRINT_STRING_LENGTH - ulLenTotal ),
+                              pcFormat,
+                              args );
+
+        configASSERT( lLenPart > 0 );
+
+        if( lLenPart + ulLenTotal < dlMAX_PRINT_STRING_LENGTH )
+        {
+            ulLenTotal += lLenPart;
+        }
+        else
+        {
+            ulLenTotal = dlMAX_PRINT_STRING_LENGTH;
+        }
+    }
+
+    ulLenTotal = prvFormatTrailer( pcPrintBuff, ulLenTotal, pcFileName, ulLineNumber );
+
+    #if ( LOGGING_RATE_LIMIT == 1 )
+        if( prvLogRepeated( pcPrintBuff, ulLenTotal, pcNote, &uxNoteLength ) == pdFALSE )
+        {
+            if( uxNoteLength > 0 )
+            {
+                vSendLogMessage( pcNote, uxNoteLength );
+            }
+
+            vSendLogMessage( ( void * ) pcPrintBuff, ulLenTotal );
+        }
+    #else
+        vSendLogMessage( ( void * ) pcPrintBuff, ulLenTotal );
+    #endif
+
+    #if ( LOGGING_CRASH_LOG == 1 )
+        prvCrashLogAppend( eCrashRecordText, pcPrintBuff,
+                           ( ulLenTotal < dlLOGGING_CRASH_LOG_MAX_TEXT ) ? ulLenTotal : dlLOGGING_CRASH_LOG_MAX_TEXT,
+                           NULL, 0 );
+    #endif
+
+    prvAddStats( &xLoggingStats.xDirect, ulStartCycles );
+
+    if( xSchedulerWasSuspended == pdTRUE )
+    {
+        xTaskResumeAll();
+    }
+}
+
+void vLoggingPrintf( const char * const pcLogLevel,
+                     const char * const pcFileName,
+                     const unsigned long ulLineNumber,
+                     const char * const pcFormat,
+                     ... )
+{
+    va_list args;
+
+    va_start( args, pcFormat );
+    prvLoggingVPrintf( pcLogLevel, pcFileName, ulLineNumber, pdTRUE, pcFormat, args );
+    va_end( args );
+}
+
+#if ( LOGGING_RATE_LIMIT == 1 )
+    /* The notes of the rate limit are not a call site of their own, they all would
+     * share the slot of NULL:0 and suppress each other */
+    static void prvLoggingPrintfUnlimited( const char * const pcLogLevel,
+                                           const char * const pcFormat,
+                                           ... )
+    {
+        va_list args;
+
+        va_start( args, pcFormat );
+        prvLoggingVPrintf( pcLogLevel, NULL, 0, pdFALSE, pcFormat, args );
+        va_end( args );
+    }
+#endif /* LOGGING_RATE_LIMIT == 1 */
+
+/*-----------------------------------------------------------*/
+
+/* Level set at run time for a module name, or for all modules with "*" */
+typedef struct
+{
+    char pcName[ dlLOGGING_MODULE_NAME_LENGTH ];
+    uint8_t ucLevel;
+} LogLevelOverride_t;
+
+static LogModule_t * volatile pxLogModules = NULL;
+
+static LogLevelOverride_t xLevelOverrides[ dlLOGGING_MAX_LEVEL_OVERRIDES ] = { 0 };
+
+static const char * const pcLevelNames[] = { "none", "error", "warn", "info", "debug" };
+
+const char * pcLoggingLevelName( uint8_t ucLevel )
+{
+    return ( ucLevel <= LOG_DEBUG ) ? pcLevelNames[ ucLevel ] : "default";
+}
+
+uint8_t ucLoggingLevelFromName( const char * pcName )
+{
+    uint8_t ucLevel = LOG_LEVEL_INVALID;
+
+    for( uint8_t i = 0; i <= LOG_DEBUG; i++ )
+    {
+        if( strcmp( pcName, pcLevelNames[ i ] ) == 0 )
+        {
+            ucLevel = i;
+        }
+    }
+
+    if( strcmp( pcName, "default" ) == 0 )
+    {
+        ucLevel = LOG_LEVEL_DEFAULT;
+    }
+    else if( ( pcName[ 0 ] >= '0' ) && ( pcName[ 0 ] <= ( '0' + LOG_DEBUG ) ) && ( pcName[ 1 ] == '\0' ) )
+    {
+        ucLevel = ( uint8_t ) ( pcName[ 0 ] - '0' );
+    }
+
+    return ucLevel;
+}
+
+/* pcName is either the module name, or the module name without its extension */
+static BaseType_t prvModuleMatches( const LogModule_t * pxModule,
+                                    const char * pcName )
+{
+    size_t uxLength = strlen( pcName );
+
+    return ( strncmp( pxModule->pcName, pcName, uxLength ) == 0 ) &&
+           ( ( pxModule->pcName[ uxLength ] == '\0' ) || ( pxModule->pcName[ uxLength ] == '.' ) );
+}
+
+/* Must be called with interrupts masked */
+static uint8_t prvModuleLevel( const LogModule_t * pxModule )
+{
+    uint8_t ucLevel = pxModule->ucDefaultLevel;
+
+    for( uint32_t i = 0; i < dlLOGGING_MAX_LEVEL_OVERRIDES; i++ )
+    {
+        if( xLevelOverrides[ i ].pcName[ 0 ] == '\0' )
+        {
+            continue;
+        }
+        else if( strcmp( xLevelOverrides[ i ].pcName, "*" ) == 0 )
+        {
+            ucLevel = xLevelOverrides[ i ].ucLevel;
+        }
+        else if( prvModuleMatches( pxModule, xLevelOverrides[ i ].pcName ) )
+        {
+            /* A module level wins over "*" */
+            ucLevel = xLevelOverrides[ i ].ucLevel;
+            break;
+        }
+    }
+
+    return ucLevel;
+}
+
+/* Must be called with interrupts masked */
+static void prvModuleSetLevel( LogModule_t * pxModule )
+{
+    pxModule->ucLevel = prvModuleLevel( pxModule );
+    pxModule->ucMuted = ( uint8_t ) ( 0xFFU << ( pxModule->ucLevel + 1U ) );
+}
+
+/* pcName, the name of the source file, and ucDefaultLevel come from the first line
+ * logged, LOG_MODULE_DEFINE() only reserves a zeroed module */
+static void prvRegisterModule( LogModule_t * pxModule,
+                               const char * pcName,
+                               uint8_t ucDefaultLevel )
+{
+    /* Masking interrupts works from tasks, ISRs and before the scheduler starts */
+    UBaseType_t uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    if( pxModule->pcName == NULL )
+    {
+        pxModule->pcName = pcName;
+        pxModule->ucDefaultLevel = ucDefaultLevel;
+        prvModuleSetLevel( pxModule );
+        pxModule->pxNext = pxLogModules;
+        pxLogModules = pxModule;
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+
+void vLoggingModulePrintf( LogModule_t * pxModule,
+                           uint8_t ucLevels,
+                           const char * const pcLogLevel,
+                           const char * const pcFileName,
+                           const unsigned long ulLineNumber,
+                           const char * const pcFormat,
+                           ... )
+{
+    va_list args;
+    uint8_t ucLevel = ucLevels & 0x0FU;
+
+    if( pxModule->pcName == NULL )
+    {
+        prvRegisterModule( pxModule, ( pcFileName != NULL ) ? pcFileName : "unknown", ucLevels >> 4 );
+    }
+
+    if( ucLevel <= pxModule->ucLevel )
+    {
+        va_start( args, pcFormat );
+        prvLoggingVPrintf( pcLogLevel, pcFileName, ulLineNumber, pdTRUE, pcFormat, args );
+        va_end( args );
+    }
+}
+
+LogModule_t * pxLoggingModuleNext( LogModule_t * pxModule )
+{
+    return ( pxModule == NULL ) ? pxLogModules : pxModule->pxNext;
+}
+
+BaseType_t xLoggingSetModuleLevel( const char * pcName,
+                                   uint8_t ucLevel )
+{
+    BaseType_t xResult = pdTRUE;
+    BaseType_t xAll = ( strcmp( pcName, "*" ) == 0 ) ? pdTRUE : pdFALSE;
+    LogLevelOverride_t * pxFree = NULL;
+    UBaseType_t uxSavedInterruptStatus;
+
+    if( ( strlen( pcName ) >= dlLOGGING_MODULE_NAME_LENGTH ) ||
+        ( ( ucLevel > LOG_DEBUG ) && ( ucLevel != LOG_LEVEL_DEFAULT ) ) )
+    {
+        return pdFALSE;
+    }
+
+    uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    for( uint32_t i = 0; i < dlLOGGING_MAX_LEVEL_OVERRIDES; i++ )
+    {
+        /* Setting all modules drops the levels set for single modules */
+        if( ( xAll == pdTRUE ) || ( strcmp( xLevelOverrides[ i ].pcName, pcName ) == 0 ) )
+        {
+            xLevelOverrides[ i ].pcName[ 0 ] = '\0';
+        }
+
+        if( ( pxFree == NULL ) && ( xLevelOverrides[ i ].pcName[ 0 ] == '\0' ) )
+        {
+            pxFree = &xLevelOverrides[ i ];
+        }
+    }
+
+    if( ucLevel != LOG_LEVEL_DEFAULT )
+    {
+        if( pxFree != NULL )
+        {
+            ( void ) strcpy( pxFree->pcName, pcName );
+            pxFree->ucLevel = ucLevel;
+        }
+        else
+        {
+            xResult = pdFALSE;
+        }
+    }
+
+    for( LogModule_t * pxModule = pxLogModules; pxModule != NULL; pxModule = pxModule->pxNext )
+    {
+        prvModuleSetLevel( pxModule );
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+
+    return xResult;
+}
+
+/* Stored as "name=level,name=level", "*" first */
+void vLoggingLoadLevels( void )
+{
+    char pcLevels[ dlLOGGING_LEVELS_STRING_LENGTH ] = { 0 };
+    char * pcNext = pcLevels;
+
+    ( void ) KVStore_getString( CS_LOG_LEVELS, pcLevels, sizeof( pcLevels ) );
+
+    while( ( pcNext != NULL ) && ( *pcNext != '\0' ) )
+    {
+        char * pcEntry = pcNext;
+        char * pcLevel = NULL;
+
+        pcNext = strchr( pcEntry, ',' );
+
+        if( pcNext != NULL )
+        {
+            *pcNext++ = '\0';
+        }
+
+        pcLevel = strchr( pcEntry, '=' );
+
+        if( pcLevel != NULL )
+        {
+            *pcLevel++ = '\0';
+
+            if( xLoggingSetModuleLevel( pcEntry, ucLoggingLevelFromName( pcLevel ) ) != pdTRUE )
+            {
+                LogWarn( "Ignoring saved log level %s for module %s.", pcLevel, pcEntry );
+            }
+        }
+    }
+}
+
+BaseType_t xLoggingSaveLevels( void )
+{
+    char pcLevels[ dlLOGGING_LEVELS_STRING_LENGTH ] = { 0 };
+    size_t uxLength = 0;
+    BaseType_t xResult = pdTRUE;
+
+    /* "*" first, loading it clears the levels of single modules */
+    for( uint32_t ulPass = 0; ( ulPass < 2 ) && ( xResult == pdTRUE ); ulPass++ )
+    {
+        for( uint32_t i = 0; i < dlLOGGING_MAX_LEVEL_OVERRIDES; i++ )
+        {
+            const LogLevelOverride_t * pxOverride = &xLevelOverrides[ i ];
+            int lLen;
+
+            if( ( pxOverride->pcName[ 0 ] == '\0' ) ||
+                ( ( strcmp( pxOverride->pcName, "*" ) == 0 ) != ( ulPass == 0 ) ) )
+            {
+                continue;
+            }
+
+            lLen = snprintf( &pcLevels[ uxLength ], sizeof( pcLevels ) - uxLength, "%s%s=%s",
+                             ( uxLength > 0 ) ? "," : "", pxOverride->pcName,
+                             pcLoggingLevelName( pxOverride->ucLevel ) );
+
+            if( ( lLen < 0 ) || ( ( size_t ) lLen >= ( sizeof( pcLevels ) - uxLength ) ) )
+            {
+                xResult = pdFALSE;
+                break;
+            }
+
+            uxLength += ( size_t ) lLen;
+        }
+    }
+
+    if( xResult == pdTRUE )
+    {
+        xResult = KVStore_setString( CS_LOG_LEVELS, pcLevels );
+    }
+
+    if( xResult == pdTRUE )
+    {
+        xResult = KVStore_xCommitChanges();
+    }
+
+    return xResult;
 }
 
 /*-----------------------------------------------------------*/
@@ -29,6 +29,7 @@
 
 /* Standard Include. */
 #include <stdio.h>
+#include <stdint.h>
 
 /* Include header for logging level macros. */
 #include "logging_levels.h"
@@ -46,10 +47,70 @@
 
 #define LOGGING_TIMEOUT_MS    100
 
+/* Deferred logging: vLoggingPrintf only copies the format string pointer and the
+ * arguments to a ring, a low priority task formats the line later. Lines with
+ * more arguments than fit dlLOGGING_DEFERRED_MAX_RECORD, and lines logged before
+ * the scheduler starts, are formatted right away. */
+#ifndef LOGGING_DEFERRED
+    #define LOGGING_DEFERRED                    1
+#endif
+
+#define dlLOGGING_DEFERRED_BUFFER_SIZE          4096 /* Must be a power of 2 */
+#define dlLOGGING_DEFERRED_MAX_RECORD           256
+#define dlLOGGING_DEFERRED_TASK_STACK           1024
+#define dlLOGGING_DEFERRED_TASK_PRIORITY        1
+
+/* Crash log: the latest log lines, resets and hard faults are also kept in a RAM
+ * ring that is not initialized at boot (the CRASHLOG region of the linker
+ * script), so they can be read back after a warm reset, see "log crash". */
+#ifndef LOGGING_CRASH_LOG
+    #define LOGGING_CRASH_LOG                   1
+#endif
+
+#define dlLOGGING_CRASH_LOG_SIZE                4096 /* Must match the CRASHLOG region */
+#define dlLOGGING_CRASH_LOG_MAX_TEXT            160  /* Direct lines are truncated to this length */
+
+/* Rate limiting: each call site (file and line) may log dlLOGGING_RATE_LIMIT_BURST
+ * lines at once, then dlLOGGING_RATE_LIMIT_PER_SEC lines per second. A line that
+ * only differs from the previous one by its timestamp is not printed, a
+ * "Last message repeated N times" line is printed instead once a different line
+ * is logged or after dlLOGGING_REPEAT_FLUSH_MS. */
+#ifndef LOGGING_RATE_LIMIT
+    #define LOGGING_RATE_LIMIT                  1
+#endif
+
+#define dlLOGGING_RATE_LIMIT_SITES              32 /* Must be a power of 2 */
+#define dlLOGGING_RATE_LIMIT_BURST              20
+#define dlLOGGING_RATE_LIMIT_PER_SEC            10
+#define dlLOGGING_REPEAT_FLUSH_MS               1000
+
 #ifndef LOG_LEVEL
     #define LOG_LEVEL         LOG_INFO
 #endif
 
+/* Runtime log levels: every source file is a log module named after the file,
+ * LOG_LEVEL is only its default level. Lines up to LOG_LEVEL_MAX, or up to the
+ * LOG_LEVEL of the file when higher, are compiled in and filtered at run time
+ * against the level of the module, see the "log level" CLI command. Define
+ * LOG_LEVEL_MAX to LOG_DEBUG in the build to be able to raise any module to
+ * debug, at the cost of the flash taken by the debug strings. */
+#ifndef LOGGING_RUNTIME_LEVELS
+    #define LOGGING_RUNTIME_LEVELS    1
+#endif
+
+#ifndef LOG_LEVEL_MAX
+    #define LOG_LEVEL_MAX             LOG_INFO
+#endif
+
+#if ( LOGGING_RUNTIME_LEVELS == 1 )
+    #define LOG_LEVEL_COMPILED        ( ( LOG_LEVEL > LOG_LEVEL_MAX ) ? LOG_LEVEL : LOG_LEVEL_MAX )
+#else
+    #define LOG_LEVEL_COMPILED        LOG_LEVEL
+#endif
+
+#define dlLOGGING_MAX_LEVEL_OVERRIDES    16
+#define dlLOGGING_MODULE_NAME_LENGTH     32
+
 /* Get rid of extra C89 style parentheses generated by core FreeRTOS libraries */
 
 #define REMOVE_PARENS( ... )    STR( OVE __VA_ARGS__ )
@@ -69,6 +130,87 @@ void vLoggingDeInit( void );
 void vDyingGasp( void );
 void vInitLoggingEarly( void );
 
+/* Per call cost of vLoggingPrintf, in CPU cycles */
+typedef struct
+{
+    uint32_t ulCalls;
+    uint32_t ulDropped;
+    uint64_t ullCycles;
+    uint32_t ulMaxCycles;
+} LoggingPathStats_t;
+
+typedef struct
+{
+    LoggingPathStats_t xDirect;
+    LoggingPathStats_t xDeferred;
+    uint32_t ulDeferredPending;   /* Bytes waiting in the deferred ring */
+    uint32_t ulDeferredHighWater; /* Most bytes ever used in the deferred ring */
+    uint32_t ulRateLimited;       /* Lines dropped by the per call site rate limit */
+    uint32_t ulRepeated;          /* Lines dropped as repeats of the previous line */
+} LoggingStats_t;
+
+void vLoggingGetStats( LoggingStats_t * pxStats );
+void vLoggingResetStats( void );
+
+/* BaseType_t, which is not defined yet when FreeRTOSConfig.h includes this file */
+void vLoggingSetDeferred( long xDeferred );
+long xLoggingIsDeferred( void );
+
+/* Formats the oldest deferred record into pcBuffer, returns 0 when there is none */
+size_t xLoggingDeferredFormatNext( char * pcBuffer,
+                                   size_t uxBufferLength );
+
+/* Formats the crash log record at *pulCursor (0 to start with the oldest one) and
+ * moves the cursor to the next one, returns 0 at the end of the log.
+ * uxBufferLength must be at least dlMAX_LOG_LINE_LENGTH. */
+size_t xLoggingCrashLogNext( uint32_t * pulCursor,
+                             char * pcBuffer,
+                             size_t uxBufferLength );
+void vLoggingCrashLogClear( void );
+
+/* Called by the HardFault handler with the stacked exception frame */
+void vLoggingCrashLogFault( const uint32_t * pulFaultStackAddress );
+
+#define LOG_LEVEL_DEFAULT          0xFF /* Revert to the LOG_LEVEL of the module */
+#define LOG_LEVEL_INVALID          0xFE
+
+/* Zero until the first line of the module is logged, the module registers then */
+typedef struct LogModule
+{
+    const char * pcName;
+    volatile uint8_t ucMuted; /* Bit n set when the lines of level n are filtered out */
+    uint8_t ucLevel;
+    uint8_t ucDefaultLevel;
+    struct LogModule * pxNext;
+} LogModule_t;
+
+/* ucLevels holds the level of the line in its low nibble, and the LOG_LEVEL of
+ * the file, the default level of the module, in its high nibble */
+void vLoggingModulePrintf( LogModule_t * pxModule,
+                           uint8_t ucLevels,
+                           const char * const pcLogLevel,
+                           const char * const pcFileName,
+                           const unsigned long ulLineNumber,
+                           const char * const pcFormat,
+                           ... );
+
+/* Iterates over the modules that logged at least once, pass NULL to get the first one */
+LogModule_t * pxLoggingModuleNext( LogModule_t * pxModule );
+
+/* Sets the level of the modules matching pcName, "*" matches all of them.
+ * ucLevel LOG_LEVEL_DEFAULT reverts them to their default level. */
+long xLoggingSetModuleLevel( const char * pcName,
+                             uint8_t ucLevel );
+
+/* Loads and saves the module levels set at run time in the key value store, key "log_levels" */
+void vLoggingLoadLevels( void );
+long xLoggingSaveLevels( void );
+
+const char * pcLoggingLevelName( uint8_t ucLevel );
+
+/* Accepts "none" to "debug", "0" to "4" and "default", returns LOG_LEVEL_INVALID otherwise */
+uint8_t ucLoggingLevelFromName( const char * pcName );
+
 /* task.h cannot be included here because this file is included by FreeRTOSConfig.h */
 extern void vTaskSuspendAll( void );
 
@@ -84,6 +226,28 @@ extern void vTaskSuspendAll( void );
 
 #define SdkLog( level, ... )    do { vLoggingPrintf( level, __NAME_ARG__, __LINE__, __VA_ARGS__ ); } while( 0 )
 
+#if ( LOGGING_RUNTIME_LEVELS == 1 )
+
+    /* Declares the log module of the source file, named after it. Expanded after the
+     * includes of each source file that logs through LogError to LogDebug. Being a
+     * tentative definition, it may be expanded again, e.g. by the configuration
+     * header of a library whose sources cannot expand it. */
+    #define LOG_MODULE_DEFINE()    static LogModule_t xLogModule __attribute__( ( unused ) )
+
+    /* The level check is all that a disabled line costs */
+    #define SdkLogModule( level, pcLevel, ... )                                                   \
+    do {                                                                                          \
+        if( ( xLogModule.ucMuted & ( 1U << ( level ) ) ) == 0U )                                  \
+        {                                                                                         \
+            vLoggingModulePrintf( &xLogModule, ( uint8_t ) ( ( level ) | ( LOG_LEVEL << 4 ) ),    \
+                                  pcLevel, __NAME_ARG__, __LINE__, __VA_ARGS__ );                 \
+        }                                                                                         \
+    } while( 0 )
+#else
+    #define LOG_MODULE_DEFINE()                    extern int xLogModuleUnused
+    #define SdkLogModule( level, pcLevel, ... )    SdkLog( pcLevel, __VA_ARGS__ )
+#endif
+
 #define LogAssert( ... )        do { SdkLog( "ASRT", __VA_ARGS__ ); } while( 0 )
 
 #define LogSys( ... )           do { vLoggingPrintf( "SYS", __NAME_ARG__, __LINE__, __VA_ARGS__ ); } while( 0 )
@@ -100,26 +264,26 @@ extern void vTaskSuspendAll( void );
     #error "Please define LOG_LEVEL as either LOG_NONE, LOG_ERROR, LOG_WARN, LOG_INFO, or LOG_DEBUG."
 #else
 
-    #if ( LOG_LEVEL >= LOG_ERROR )
-        #define LogError( ... )    SdkLog( "ERR", REMOVE_PARENS( __VA_ARGS__ ) )
+    #if ( LOG_LEVEL_COMPILED >= LOG_ERROR )
+        #define LogError( ... )    SdkLogModule( LOG_ERROR, "ERR", REMOVE_PARENS( __VA_ARGS__ ) )
     #else
         #define LogError( ... )
     #endif
 
-    #if ( LOG_LEVEL >= LOG_WARN )
-        #define LogWarn( ... )    SdkLog( "WRN", REMOVE_PARENS( __VA_ARGS__ ) )
+    #if ( LOG_LEVEL_COMPILED >= LOG_WARN )
+        #define LogWarn( ... )    SdkLogModule( LOG_WARN, "WRN", REMOVE_PARENS( __VA_ARGS__ ) )
     #else
         #define LogWarn( ... )
     #endif
 
-    #if ( LOG_LEVEL >= LOG_INFO )
-        #define LogInfo( ... )    SdkLog( "INF", REMOVE_PARENS( __VA_ARGS__ ) )
+    #if ( LOG_LEVEL_COMPILED >= LOG_INFO )
+        #define LogInfo( ... )    SdkLogModule( LOG_INFO, "INF", REMOVE_PARENS( __VA_ARGS__ ) )
     #else
         #define LogInfo( ... )
     #endif
 
-    #if ( LOG_LEVEL >= LOG_DEBUG )
-        #define LogDebug( ... )    SdkLog( "DBG", REMOVE_PARENS( __VA_ARGS__ ) )
+    #if ( LOG_LEVEL_COMPILED >= LOG_DEBUG )
+        #define LogDebug( ... )    SdkLogModule( LOG_DEBUG, "DBG", REMOVE_PARENS( __VA_ARGS__ ) )
     #else
         #define LogDebug( ... )
     #endif
@@ -81,6 +81,20 @@
  */
 #define MQTT_AGENT_NETWORK_BUFFER_SIZE               ( 6 * 1024 )
 
+/**
+ * @brief Size of the stream buffer holding the publishes received through the
+ * ST67W6X module until the subscription task has delivered them.
+ *
+ * @note Specified in bytes. Each publish takes 8 bytes more than its topic and
+ * payload. Publishes arriving while the buffer lacks the space are dropped and
+ * counted as overflows. The subscription task also copies the publish it
+ * delivers out of the buffer, in MQTT_AGENT_NETWORK_BUFFER_SIZE bytes, the
+ * most the module delivers per publish: 14 KB of RAM in total by default.
+ */
+#ifndef W6X_MQTT_RX_BUFFER_SIZE
+    #define W6X_MQTT_RX_BUFFER_SIZE                  ( 8 * 1024 )
+#endif
+
 
 #define MQTT_AGENT_MAX_EVENT_QUEUE_WAIT_TIME         ( 1 )
 
@@ -61,6 +61,10 @@
     #endif
 #endif
 
+#ifndef LOG_LEVELS_DFLT
+    #define LOG_LEVELS_DFLT             "" /* Default Runtime Log Levels    */
+#endif
+
 #if defined(ST67W6X_NCP)
     #define MQTT_SECURITY_DFLT          0  /* Default MQTT Security for ST67W6X_NCP */
 #endif
@@ -86,6 +90,7 @@ typedef enum KvStoreEnum
     CS_PROVISIONED,              /* Provisioned State Key      */
     CS_THING_GROUP_NAME,         /* Thing Group Name Key       */
 #endif
+    CS_LOG_LEVELS,               /* Runtime Log Levels Key     */
     CS_NUM_KEYS                  /* Total Number of Keys       */
 } KVStoreKey_t;
 
@@ -97,6 +102,7 @@ typedef enum KvStoreEnum
     CS_PROVISIONED,              /* Provisioned State Key      */
     CS_THING_GROUP_NAME,         /* Thing Group Name Key       */
 #endif
+    CS_LOG_LEVELS,               /* Runtime Log Levels Key     */
     CS_NUM_KEYS                  /* Total Number of Keys       */
 } KVStoreKey_t;
 
@@ -110,6 +116,7 @@ typedef enum KvStoreEnum
     CS_PROVISIONED,              /* Provisioned State Key      */
     CS_THING_GROUP_NAME,         /* Thing Group Name Key       */
 #endif
+    CS_LOG_LEVELS,               /* Runtime Log Levels Key     */
     CS_NUM_KEYS                  /* Total Number of Keys       */
 } KVStoreKey_t;
 
@@ -134,7 +141,8 @@ typedef enum KvStoreEnum
         "wifi_credential",      /* WiFi Credential String      */ \
         "mqtt_security",        /* MQTT Security String        */ \
         "provision_state",      /* Provisioned State           */ \
-        "group_name"            /* Thing Group Name String     */ \
+        "group_name",           /* Thing Group Name String     */ \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #else
 #define KV_STORE_STRINGS                                          \
@@ -142,7 +150,8 @@ typedef enum KvStoreEnum
         COMMON_KV_STORE_STRINGS,                                  \
         "wifi_ssid",            /* WiFi SSID String            */ \
         "wifi_credential",      /* WiFi Credential String      */ \
-        "mqtt_security"         /* MQTT Security String        */ \
+        "mqtt_security",        /* MQTT Security String        */ \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #endif
 #elif defined(ETHERNET)
@@ -151,12 +160,14 @@ typedef enum KvStoreEnum
     {                                                             \
         COMMON_KV_STORE_STRINGS,                                  \
         "provision_state",      /* Provisioned State           */ \
-        "group_name"            /* Thing Group Name String     */ \
+        "group_name",           /* Thing Group Name String     */ \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #else
 #define KV_STORE_STRINGS                                          \
     {                                                             \
-        COMMON_KV_STORE_STRINGS                                   \
+        COMMON_KV_STORE_STRINGS,                                  \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #endif
 
@@ -168,14 +179,16 @@ typedef enum KvStoreEnum
         "wifi_ssid",            /* WiFi SSID String            */ \
         "wifi_credential",      /* WiFi Credential String      */ \
         "provision_state",      /* Provisioned State           */ \
-        "group_name"            /* Thing Group Name String     */ \
+        "group_name",           /* Thing Group Name String     */ \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #else
 #define KV_STORE_STRINGS                                          \
     {                                                             \
         COMMON_KV_STORE_STRINGS,                                  \
         "wifi_ssid",            /* WiFi SSID String            */ \
-        "wifi_credential"       /* WiFi Credential String      */ \
+        "wifi_credential",      /* WiFi Credential String      */ \
+        "log_levels"            /* Runtime Log Levels String   */ \
     }
 #endif
 #endif
@@ -199,7 +212,8 @@ typedef enum KvStoreEnum
         KV_DFLT(KV_TYPE_STRING, WIFI_PASSWORD_DFLT),     /* Default WiFi Password     */   \
         KV_DFLT(KV_TYPE_UINT32, MQTT_SECURITY_DFLT),     /* Default MQTT Security     */   \
         KV_DFLT(KV_TYPE_UINT32, PROVISIONED_DEFAULT),    /* Default Provisioned State */   \
-        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT)   /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT),  /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #else
 #define KV_STORE_DEFAULTS                                                                  \
@@ -207,7 +221,8 @@ typedef enum KvStoreEnum
         COMMON_KV_STORE_DEFAULTS,                                                          \
         KV_DFLT(KV_TYPE_STRING, WIFI_SSID_DFLT),         /* Default WiFi SSID         */   \
         KV_DFLT(KV_TYPE_STRING, WIFI_PASSWORD_DFLT),     /* Default WiFi Password     */   \
-        KV_DFLT(KV_TYPE_UINT32, MQTT_SECURITY_DFLT)      /* Default MQTT Security     */   \
+        KV_DFLT(KV_TYPE_UINT32, MQTT_SECURITY_DFLT),     /* Default MQTT Security     */   \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #endif
 /* Defaults for ETHERNET platform */
@@ -217,12 +232,14 @@ typedef enum KvStoreEnum
     {                                                                                      \
         COMMON_KV_STORE_DEFAULTS,                                                          \
         KV_DFLT(KV_TYPE_UINT32, PROVISIONED_DEFAULT),    /* Default Provisioned State */   \
-        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT)   /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT),  /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #else
 #define KV_STORE_DEFAULTS                                                                  \
     {                                                                                      \
-        COMMON_KV_STORE_DEFAULTS                                                           \
+        COMMON_KV_STORE_DEFAULTS,                                                          \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #endif
 
@@ -235,14 +252,16 @@ typedef enum KvStoreEnum
         KV_DFLT(KV_TYPE_STRING, WIFI_SSID_DFLT),         /* Default WiFi SSID         */   \
         KV_DFLT(KV_TYPE_STRING, WIFI_PASSWORD_DFLT),     /* Default WiFi Password     */   \
         KV_DFLT(KV_TYPE_UINT32, PROVISIONED_DEFAULT),    /* Default Provisioned State */   \
-        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT)   /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, THING_GROUP_NAME_DFLT),  /* Default Thing Group Name  */   \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #else
 #define KV_STORE_DEFAULTS                                                                  \
     {                                                                                      \
         COMMON_KV_STORE_DEFAULTS,                                                          \
         KV_DFLT(KV_TYPE_STRING, WIFI_SSID_DFLT),         /* Default WiFi SSID         */   \
-        KV_DFLT(KV_TYPE_STRING, WIFI_PASSWORD_DFLT)      /* Default WiFi Password     */   \
+        KV_DFLT(KV_TYPE_STRING, WIFI_PASSWORD_DFLT),     /* Default WiFi Password     */   \
+        KV_DFLT(KV_TYPE_STRING, LOG_LEVELS_DFLT)         /* Default Log Levels        */   \
     }
 #endif
 #endif
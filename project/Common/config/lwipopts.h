@@ -20,6 +20,32 @@
 #ifndef LWIP_HDR_LWIPOPTS_H
 #define LWIP_HDR_LWIPOPTS_H
 
+/* Memory and TCP window tuning, select with LWIP_TUNING_PROFILE in the build flags.
+ * THROUGHPUT sizes the TCP windows and buffers so the Ethernet link stays busy while
+ * waiting for ACKs, LOW_RAM trims pools and windows to what MQTT/TLS traffic needs. */
+#define LWIP_PROFILE_DEFAULT       0
+#define LWIP_PROFILE_THROUGHPUT    1
+#define LWIP_PROFILE_LOW_RAM       2
+
+#ifndef LWIP_TUNING_PROFILE
+#define LWIP_TUNING_PROFILE    LWIP_PROFILE_DEFAULT
+#endif
+
+#if ( LWIP_TUNING_PROFILE == LWIP_PROFILE_THROUGHPUT )
+#define TCP_WND                  ( 8 * TCP_MSS )
+#define TCP_SND_BUF              ( 8 * TCP_MSS )
+#define MEM_SIZE                 ( 24 * 1024 )
+#define PBUF_POOL_SIZE           48
+#elif ( LWIP_TUNING_PROFILE == LWIP_PROFILE_LOW_RAM )
+#define TCP_WND                  ( 2 * TCP_MSS )
+#define TCP_SND_BUF              ( 2 * TCP_MSS )
+#define PBUF_POOL_SIZE           8
+#define MEMP_NUM_TCP_PCB         8
+#define MEMP_NUM_TCP_PCB_LISTEN  4
+#define MEMP_NUM_TCP_SEG         32
+#define MEMP_NUM_NETCONN         12
+#endif
+
 #include "lwipopts_freertos.h"
 
 /*#define LWIP_IPV6                       1 */
@@ -121,7 +147,16 @@
 #define TCP_SND_QUEUELEN    ( 4 * TCP_SND_BUF / TCP_MSS )
 
 /* TCP receive window. */
+#ifndef PBUF_POOL_SIZE
 #define PBUF_POOL_SIZE      40
+#endif
+
+/* The Ethernet driver receives into its own pool of custom pbufs */
+#define LWIP_SUPPORT_CUSTOM_PBUF    1
+
+/* Checksums stay compiled in for the Wi-Fi interfaces. The Ethernet netif turns
+ * them off, the MAC inserts and verifies them (see prvInitNetInterface() in eth_lwip.c). */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF    1
 
 
 #define TCP_MSL             20 * 1000UL /* The maximum segment lifetime in milliseconds */
@@ -36,6 +36,7 @@
 #endif
 
 #include "logging.h"
+#include <stdint.h>
 #include "test_param_config.h"
 #include "test_execution_config.h"
 
@@ -110,9 +111,17 @@
  * @brief Milliseconds to wait before requesting data blocks from the OTA service if nothing is happening.
  *
  * The wait timer is reset whenever a data block is received from the OTA service so we will only send
- * the request message after being idle for this amount of time.
+ * the request message after being idle for this amount of time. The OTA update task derives it from
+ * the measured stream request round trip time, bounded by otaconfigFILE_REQUEST_WAIT_MIN_MS and
+ * otaconfigFILE_REQUEST_WAIT_MAX_MS.
  */
-#define otaconfigFILE_REQUEST_WAIT_MS           10000U
+#define otaconfigFILE_REQUEST_WAIT_MS           ( ulOtaDataRequestWaitMs() )
+
+/**
+ * @brief Bounds of the adaptive file request wait time.
+ */
+#define otaconfigFILE_REQUEST_WAIT_MIN_MS       2000U
+#define otaconfigFILE_REQUEST_WAIT_MAX_MS       10000U
 
 /**
  * @brief The maximum allowed length of the thing name used by the OTA agent.
@@ -136,7 +145,17 @@
  *  Please note that this must be set larger than zero.
  *
  */
-#define otaconfigMAX_NUM_BLOCKS_REQUEST         2U
+#define otaconfigMAX_NUM_BLOCKS_REQUEST         ( ulOtaDataWindowGet() )
+
+/**
+ * @brief Upper bound of the adaptive data block request window.
+ *
+ * The OTA update task grows the number of blocks requested per stream request while
+ * whole windows arrive, and halves it when blocks are lost or no data buffer is free.
+ * The window is also bounded by the free data buffers less the one kept for job documents,
+ * see otaconfigMAX_NUM_OTA_DATA_BUFFERS.
+ */
+#define otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT   8U
 
 /**
  * @brief The maximum number of requests allowed to send without a response before we abort.
@@ -152,8 +171,13 @@
  *
  * This configurations parameter sets the maximum number of static data buffers used by
  * the OTA agent for job and file data blocks received.
+ *
+ * Each buffer takes OTA_DATA_BLOCK_SIZE bytes of static RAM, the block size plus 1.5 KB
+ * for a presigned URL, about 3.5 KB with 2 KB blocks. The default of 5 buffers costs
+ * about 17.5 KB and lets the request window reach 4 blocks. Up to
+ * ( otaconfigMAX_NUM_BLOCKS_REQUEST_LIMIT + 1 ) buffers, about 31.5 KB, allow the full window.
  */
-#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       ( otaconfigMAX_NUM_BLOCKS_REQUEST + 1 )
+#define otaconfigMAX_NUM_OTA_DATA_BUFFERS       5U
 
 /**
  * @brief How frequently the device will report its OTA progress to the cloud.
@@ -206,8 +230,15 @@
  * Enable data over MQTT - ( OTA_DATA_OVER_MQTT )
  * Enable data over HTTP - ( OTA_DATA_OVER_HTTP)
  * Enable data over both MQTT & HTTP ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
+ *
+ * HTTP is provided by ota_http_w6x.c on top of the ST67W6X HTTP client and falls back
+ * to MQTT streams when the job has no usable pre-signed URL.
  */
-#define configENABLED_DATA_PROTOCOLS      ( OTA_DATA_OVER_MQTT )
+#if defined( ST67W6X_NCP )
+    #define configENABLED_DATA_PROTOCOLS  ( OTA_DATA_OVER_MQTT | OTA_DATA_OVER_HTTP )
+#else
+    #define configENABLED_DATA_PROTOCOLS  ( OTA_DATA_OVER_MQTT )
+#endif
 
 /**
  * @brief The preferred protocol selected for OTA data operations.
@@ -218,7 +249,34 @@
  *
  * Note - use OTA_DATA_OVER_HTTP for HTTP as primary data protocol.
  */
+#if defined( ST67W6X_NCP )
+    #define configOTA_PRIMARY_DATA_PROTOCOL    OTA_DATA_OVER_HTTP
+#else
+    #define configOTA_PRIMARY_DATA_PROTOCOL    OTA_DATA_OVER_MQTT
+#endif
 
-#define configOTA_PRIMARY_DATA_PROTOCOL    OTA_DATA_OVER_MQTT
+/**
+ * @brief Number of concurrent HTTP range requests, and blocks per range, of the HTTP data plane.
+ */
+#define otaconfigHTTP_PARALLEL_RANGES      3U
+#define otaconfigHTTP_BLOCKS_PER_RANGE     16U
+
+/**
+ * @brief Period in milliseconds at which the OTA PAL saves the list of received blocks.
+ *
+ * A download interrupted by a reset resumes from the last save, blocks received since
+ * then are downloaded again. Set to 0 to always restart downloads from the beginning.
+ */
+#define otapalconfigRESUME_SAVE_PERIOD_MS  5000U
+
+/**
+ * @brief Current data block request window, implemented by the OTA update task.
+ */
+uint32_t ulOtaDataWindowGet( void );
+
+/**
+ * @brief Current file request wait time in milliseconds, implemented by the OTA update task.
+ */
+uint32_t ulOtaDataRequestWaitMs( void );
 
 #endif /* OTA_CONFIG_H_ */
@@ -36,6 +36,9 @@
 
 #include "core_pkcs11_pal.h"
 #include "core_pkcs11_pal_utils.h"
+
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 PkiStatus_t xPrvMbedtlsErrToPkiStatus( int lError )
@@ -56,6 +56,7 @@
     #include "pk_wrap.h"
     #include "mbedtls/ecp.h"
 
+LOG_MODULE_DEFINE();
 
     static CK_RV xPrvExportPubKeyDer( CK_SESSION_HANDLE xSession,
                                       CK_OBJECT_HANDLE xPublicKeyHandle,
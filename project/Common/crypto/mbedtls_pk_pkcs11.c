@@ -49,6 +49,7 @@
     #include "core_pkcs11_config.h"
     #include "core_pkcs11.h"
 
+LOG_MODULE_DEFINE();
 
     typedef struct P11PkCtx
     {
@@ -29,6 +29,8 @@
 #include "kvstore_prv.h"
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
 static SemaphoreHandle_t xKvMutex = NULL;
 
 #if KV_STORE_CACHE_ENABLE
@@ -27,6 +27,8 @@
 #include "kvstore_prv.h"
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
 #if KV_STORE_CACHE_ENABLE
 
     typedef struct
@@ -35,6 +35,8 @@
     #include "lfs.h"
     #include "lfs_port.h"
 
+LOG_MODULE_DEFINE();
+
     #define KVSTORE_PREFIX        "/cfg/"
     #define KVSTORE_MAX_FNANME    ( sizeof( KVSTORE_PREFIX ) + KVSTORE_KEY_MAX_LEN )
 
@@ -33,6 +33,8 @@
 #if KV_STORE_NVIMPL_ARM_PSA
     #include "psa/internal_trusted_storage.h"
 
+LOG_MODULE_DEFINE();
+
     #define KVSTORE_UID_OFFSET    0x1234
 
     typedef struct
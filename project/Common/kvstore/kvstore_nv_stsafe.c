@@ -33,6 +33,8 @@
 #if (KV_STORE_NVIMPL_STSAFE) && (defined(__USE_STSAFE__))
 #include <stsafe_key_value_store.h>
 
+LOG_MODULE_DEFINE();
+
 /*
  * @brief Get the length of a value stored in the KVStore implementation
  * @param[in] xKey Key to lookup
@@ -29,6 +29,9 @@
 #include "kvstore.h"
 
 #include <string.h>
+
+LOG_MODULE_DEFINE();
+
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private Macro -------------------------------------------------------------*/
@@ -37,12 +37,15 @@
 
 #include "interrupt_handlers.h"
 #if MQTT_ENABLED
-#include "core_mqtt_serializer.h"
+#include "w6x_mqtt_rx.h"
 #endif
 
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
+
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 
 /* Private typedef -----------------------------------------------------------*/
@@ -61,8 +64,6 @@ static EventGroupHandle_t scan_event_flags = NULL; /*!< Wi-Fi scan event flags *
 #if MQTT_ENABLED
 /* MQTT structure to receive subscribed message from the ST67W6X_NCP Driver */
 extern W6X_MQTT_Data_t *pxMQTTRecvData;
-
-extern QueueHandle_t xSubMsgQueue;
 #endif
 
 static   W61_WiFi_Connect_Opts_t ConnectOpts = { 0 };
@@ -370,7 +371,7 @@ static void APP_mqtt_cb(W6X_event_id_t event_id, void *event_args)
 {
 #if MQTT_ENABLED
   W6X_MQTT_CbParamData_t *p_param_mqtt_data = (W6X_MQTT_CbParamData_t *) event_args;
-  MQTTPublishInfo_t mqtt_data;
+  uint16_t topic_length;
 
   switch (event_id)
   {
@@ -383,30 +384,12 @@ static void APP_mqtt_cb(W6X_event_id_t event_id, void *event_args)
       break;
 
     case W6X_MQTT_EVT_SUBSCRIPTION_RECEIVED_ID:
-      mqtt_data.qos    = 0;
-      mqtt_data.retain = false;
-      mqtt_data.dup    = false;
-
-      /* Get the received topic length */
-      mqtt_data.topicNameLength = p_param_mqtt_data->topic_length - 2;
-
-      /* Allocate a memory buffer to store the topic string in the sub_msg_queue */
-      mqtt_data.pTopicName = pvPortMalloc(mqtt_data.topicNameLength);
-
-      /* Copy the received topic in allocated buffer */
-      memcpy((char *)mqtt_data.pTopicName, pxMQTTRecvData->p_recv_data +1,  mqtt_data.topicNameLength);
-
-      /* Get the received message length */
-      mqtt_data.payloadLength = p_param_mqtt_data->message_length;
-
-      /* Allocate a memory buffer to store the message string in the sub_msg_queue */
-      mqtt_data.pPayload = pvPortMalloc(mqtt_data.payloadLength);
-
-      /* Copy the received message in allocated buffer */
-      memcpy(mqtt_data.pPayload, pxMQTTRecvData->p_recv_data + mqtt_data.topicNameLength + 3, mqtt_data.payloadLength);
+      /* The received data is "<topic>",<message>, the topic length includes the quotes */
+      topic_length = p_param_mqtt_data->topic_length - 2;
 
-      /* Push the new mqtt_data into the xSubMsgQueue */
-      xQueueSendToBack(xSubMsgQueue, &mqtt_data, 0);
+      /* Copy the topic and the message in the receive buffer, the driver buffer is reused for the next publish */
+      (void) xW6XMqttRxPush((const char *)pxMQTTRecvData->p_recv_data + 1, topic_length,
+                            pxMQTTRecvData->p_recv_data + topic_length + 3, p_param_mqtt_data->message_length);
       break;
 
     default:
@@ -41,30 +41,46 @@
 
 #include "eth_prv.h"
 
-#define EVT_ETH_DONE        0x8
+#include "lwip/stats.h"
+
+LOG_MODULE_DEFINE();
+
 #define EVT_ETH_ERROR       0x10
 #define ETH_EVT_DMA_IDX     1
 
+/* heth.Init.RxBuffLen, the DMA may fill all of it */
+#define ETH_RX_BUFFER_LEN   1536U
+
+/* Rx buffers are lwIP custom pbufs living next to their payload, so a received
+ * frame goes up the stack without a copy and returns here when lwIP frees it. */
+typedef struct EthRxBuffer
+{
+    struct pbuf_custom xPbuf;
+    struct EthRxBuffer * pxNextFree;
+    uint8_t ucPayload[ ETH_RX_BUFFER_LEN ] __ALIGNED( 32 );
+} EthRxBuffer_t;
+
 static EthDataplaneCtx_t * volatile pxEthCtx = NULL;
-static uint32_t u32_pbuf_payload_offset = 0;
+
+static EthRxBuffer_t xRxBuffers[ ETH_RX_BUFFER_CNT ];
+static EthRxBuffer_t * pxRxFreeList = NULL;
+static size_t uxRxUnused = 0;
+static volatile BaseType_t xRxStarved = pdFALSE;
 
 extern ETH_TxPacketConfigTypeDef TxConfig;
 
 /* Callback functions */
 
+/* Transmitted packets are released by the dataplane thread, pbuf_free() is not interrupt safe */
 static void eth_transfer_done_callback( ETH_HandleTypeDef *heth )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    BaseType_t rslt = pdFALSE;
 
     if( pxEthCtx != NULL )
     {
-        rslt = xTaskNotifyIndexedFromISR( pxEthCtx->xDataPlaneTaskHandle,
-                                          ETH_EVT_DMA_IDX,
-                                          EVT_ETH_DONE,
-                                          eSetBits,
-                                          &xHigherPriorityTaskWoken );
-        configASSERT( rslt == pdTRUE );
+        vTaskNotifyGiveIndexedFromISR( pxEthCtx->xDataPlaneTaskHandle,
+                                       DATA_WAITING_IDX,
+                                       &xHigherPriorityTaskWoken );
 
         portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
     }
@@ -85,6 +101,10 @@ static void eth_transfer_error_callback( ETH_HandleTypeDef *heth )
                                           &xHigherPriorityTaskWoken );
         configASSERT( rslt == pdTRUE );
 
+        vTaskNotifyGiveIndexedFromISR( pxEthCtx->xDataPlaneTaskHandle,
+                                       DATA_WAITING_IDX,
+                                       &xHigherPriorityTaskWoken );
+
         portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
     }
 }
@@ -105,74 +125,187 @@ static void eth_notify_callback( void * pvContext )
     }
 }
 
-static inline BaseType_t xWaitForEthEvent( TickType_t xTimeout )
+static EthRxBuffer_t * prvRxBufferAlloc( void )
 {
-    BaseType_t xWaitResult = pdFALSE;
-    BaseType_t xReturnValue = pdFALSE;
-    uint32_t ulNotifiedValue = 0;
+    EthRxBuffer_t * pxBuffer = NULL;
+
+    taskENTER_CRITICAL();
+
+    if( pxRxFreeList != NULL )
+    {
+        pxBuffer = pxRxFreeList;
+        pxRxFreeList = pxBuffer->pxNextFree;
+    }
+    else if( uxRxUnused < ETH_RX_BUFFER_CNT )
+    {
+        pxBuffer = &( xRxBuffers[ uxRxUnused++ ] );
+    }
+    else
+    {
+        xRxStarved = pdTRUE;
+    }
+
+    taskEXIT_CRITICAL();
+
+    return pxBuffer;
+}
+
+/* Called by pbuf_free() from whichever thread releases the last reference */
+static void prvRxBufferFree( struct pbuf * pxPbuf )
+{
+    EthRxBuffer_t * pxBuffer = ( EthRxBuffer_t * ) pxPbuf;
+    BaseType_t xWasStarved;
+
+    taskENTER_CRITICAL();
+
+    pxBuffer->pxNextFree = pxRxFreeList;
+    pxRxFreeList = pxBuffer;
 
-    LogDebug( "Starting wait for Eth DMA event, Timeout=%d", xTimeout );
+    xWasStarved = xRxStarved;
+    xRxStarved = pdFALSE;
 
-    xWaitResult = xTaskNotifyWaitIndexed( ETH_EVT_DMA_IDX, 0, 0xFFFFFFFF, &ulNotifiedValue, xTimeout );
+    taskEXIT_CRITICAL();
 
-    if( xWaitResult == pdTRUE )
+    /* Let the dataplane thread give the buffer back to the Rx descriptors */
+    if( ( xWasStarved == pdTRUE ) && ( pxEthCtx != NULL ) )
     {
-        if( ulNotifiedValue & EVT_ETH_DONE )
+        ( void ) xTaskNotifyGiveIndexed( pxEthCtx->xDataPlaneTaskHandle, DATA_WAITING_IDX );
+    }
+}
+
+/* Hand every frame the DMA completed to lwIP, up to ETH_RX_BATCH per call.
+ * Each HAL_ETH_ReadData() also refills the descriptors it consumed. */
+static void vReceiveReady( EthDataplaneCtx_t * pxCtx )
+{
+    PacketBuffer_t * pxRxBuff = NULL;
+    uint32_t ulFrames = 0;
+    uint32_t ulMissed;
+
+    while( ( ulFrames < ETH_RX_BATCH ) &&
+           ( HAL_ETH_ReadData( pxCtx->pxEthHandle, ( void ** ) &pxRxBuff ) == HAL_OK ) )
+    {
+        ulFrames++;
+
+        /* Feed LwIP the received packet. */
+        if( prvxLinkInput( pxCtx->pxNetif, pxRxBuff ) != pdTRUE )
         {
-            LogDebug( "Eth done event received." );
-            xReturnValue = pdTRUE;
+            LogDebug( "Decreasing reference count of pxRxBuff %p from %d to %d", pxRxBuff, pxRxBuff->ref, ( pxRxBuff->ref - 1 ) );
+            PBUF_FREE( pxRxBuff );
         }
 
+        pxRxBuff = NULL;
+    }
+
+    /* More may be waiting, come back once Tx had its turn */
+    if( ulFrames == ETH_RX_BATCH )
+    {
+        ( void ) xTaskNotifyGiveIndexed( pxCtx->xDataPlaneTaskHandle, DATA_WAITING_IDX );
+    }
+
+    /* The missed packet counter clears on read */
+    ulMissed = READ_REG( pxCtx->pxEthHandle->Instance->DMACMFCR ) & ETH_DMACMFCR_MFC;
+
+    if( ulMissed > 0 )
+    {
+        pxCtx->ulRxDropped += ulMissed;
+        LINK_STATS_INC( link.drop );
+        LogWarn( "Dropped %lu received frames, no Rx buffer (%lu total).", ulMissed, pxCtx->ulRxDropped );
+    }
+}
+
+static void vCheckEthErrors( void )
+{
+    uint32_t ulNotifiedValue = 0;
+
+    if( xTaskNotifyWaitIndexed( ETH_EVT_DMA_IDX, 0, 0xFFFFFFFF, &ulNotifiedValue, 0 ) == pdTRUE )
+    {
         if( ulNotifiedValue & EVT_ETH_ERROR )
         {
             LogError( "Eth error event received." );
-            xReturnValue = pdFALSE;
-        }
-
-        if( ( ulNotifiedValue & ( EVT_ETH_ERROR | EVT_ETH_DONE ) ) == 0 )
-        {
-            LogError( "Timeout while waiting for Eth event." );
-            xReturnValue = pdFALSE;
         }
     }
-
-    return xReturnValue;
 }
 
+/* Queue one frame to the Tx DMA. Returns pdFALSE if the descriptor ring is full. */
 static inline BaseType_t xTransmitMessage( EthDataplaneCtx_t * pxCtx,
-                                           uint8_t * pucTxBuffer,
-                                           uint32_t usTxDataLen )
+                                           PacketBuffer_t * pxTxBuff )
 {
-    HAL_StatusTypeDef xHalStatus = HAL_OK;
+    /* The HAL copies the list into the descriptors, it does not need to outlive the call */
+    ETH_BufferTypeDef xTxBuffers[ ETH_TX_MAX_FRAGMENTS ] = { 0 };
+    uint32_t ulFragments = 0;
 
     configASSERT( pxCtx != NULL );
-    configASSERT( pucTxBuffer != NULL );
-    configASSERT( usTxDataLen > 0 );
+    configASSERT( pxTxBuff->tot_len > 0 );
+
+    for( PacketBuffer_t * pxFrag = pxTxBuff; pxFrag != NULL; pxFrag = pxFrag->next )
+    {
+        if( pxFrag->len == 0 )
+        {
+            continue;
+        }
 
-    ( void ) xTaskNotifyStateClearIndexed( NULL, ETH_EVT_DMA_IDX );
+        /* Longer chains were copied by prvxLinkOutput() */
+        configASSERT( ulFragments < ETH_TX_MAX_FRAGMENTS );
+        configASSERT( pxFrag->payload != NULL );
 
-    ETH_BufferTypeDef Txbuffer = { 0 };
+        xTxBuffers[ ulFragments ].buffer = pxFrag->payload;
+        xTxBuffers[ ulFragments ].len = pxFrag->len;
 
-    Txbuffer.buffer = pucTxBuffer;
-    Txbuffer.len = usTxDataLen;
+        if( ulFragments > 0 )
+        {
+            xTxBuffers[ ulFragments - 1 ].next = &( xTxBuffers[ ulFragments ] );
+        }
 
-    TxConfig.Length =  usTxDataLen;
-    TxConfig.TxBuffer = &Txbuffer;
+        ulFragments++;
 
 #if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
-    /* NB: May only clean if the payload is cache line - aligned (32 bytes). */
-/*  configASSERT( ( ((int)pucTxBuffer) & 0x1F ) == 0 ); */
-    SCB_CleanDCache_by_Addr((uint32_t*)pucTxBuffer, usTxDataLen);
+        /* NB: May only clean if the payload is cache line - aligned (32 bytes). */
+/*      configASSERT( ( ((int)pxFrag->payload) & 0x1F ) == 0 ); */
+        SCB_CleanDCache_by_Addr((uint32_t*)pxFrag->payload, pxFrag->len);
 #endif
+    }
+
+    TxConfig.Length = pxTxBuff->tot_len;
+    TxConfig.TxBuffer = &( xTxBuffers[ 0 ] );
+
+    /* Handed back to HAL_ETH_TxFreeCallback() once transmitted */
+    TxConfig.pData = pxTxBuff;
+
+    return( HAL_ETH_Transmit_IT( pxCtx->pxEthHandle, &TxConfig ) == HAL_OK );
+}
 
-    if( HAL_ETH_Transmit_IT(pxCtx->pxEthHandle, &TxConfig) != HAL_OK )
+/* Move as many queued frames as the descriptor ring takes, without waiting for any
+ * of them to complete. A frame that did not fit is kept for the next pass. */
+static void vTransmitQueued( EthDataplaneCtx_t * pxCtx )
+{
+    BaseType_t xRingFull = pdFALSE;
+
+    while( xRingFull == pdFALSE )
     {
-      while(1) { ; }
-    }
+        if( ( pxCtx->pxTxPending == NULL ) &&
+            ( xQueueReceive( pxCtx->xDataPlaneSendQueue, &( pxCtx->pxTxPending ), 0 ) != pdTRUE ) )
+        {
+            break;
+        }
 
-    xHalStatus |= ( xWaitForEthEvent( ETH_EVENT_TIMEOUT ) == pdTRUE ) ? HAL_OK : HAL_ERROR;
+        configASSERT( pxCtx->pxTxPending != NULL );
+        configASSERT( pxCtx->pxTxPending->ref > 0 );
 
-    return xHalStatus == HAL_OK;
+        if( pxCtx->pxEthHandle->gState != HAL_ETH_STATE_STARTED )
+        {
+            LogDebug( "Dropping TX packet, interface stopped." );
+            HAL_ETH_TxFreeCallback( ( uint32_t * ) pxCtx->pxTxPending );
+            pxCtx->pxTxPending = NULL;
+        }
+        else if( xTransmitMessage( pxCtx, pxCtx->pxTxPending ) == pdTRUE )
+        {
+            pxCtx->pxTxPending = NULL;
+        }
+        else
+        {
+            xRingFull = pdTRUE;
+        }
+    }
 }
 
 void vInitCallbacks( EthDataplaneCtx_t * pxCtx )
@@ -196,108 +329,21 @@ void vDataplaneThread( void * pvParameters )
 
     while( exitFlag == pdFALSE )
     {
-        PacketBuffer_t * pxTxBuff = NULL;
-        PacketBuffer_t * pxRxBuff = NULL;
-
-        if( pxCtx->ulTxPacketsWaiting == 0 )
-        {
-            LogDebug( "Starting wait for DATA_WAITING_IDX event" );
-            ulTaskNotifyTakeIndexed( DATA_WAITING_IDX,
-                                     pdFALSE,
-                                     500 );
-        }
-
-        BaseType_t xResult = pdTRUE;
-        uint16_t usTxLen = 0;
-
-        QueueHandle_t xSourceQueue = NULL;
-
-        if( xQueuePeek( pxCtx->xDataPlaneSendQueue, &pxTxBuff, 0 ) == pdTRUE )
-        {
-            configASSERT( pxTxBuff != NULL );
-            configASSERT( pxTxBuff->ref > 0 );
-            usTxLen = pxTxBuff->tot_len;
-            xSourceQueue = pxCtx->xDataPlaneSendQueue;
-            LogDebug( "Preparing dataplane message for transmission" );
-        }
-        else
-        {
-            /* Empty, no TX packets */
-        }
-
-        if( ( pxTxBuff == NULL ) &&
-            ( pxCtx->ulTxPacketsWaiting != 0 ) )
-        {
-            LogWarn( "Mismatch between ulTxPacketsWaiting and queue contents. Resetting ulTxPacketsWaiting" );
-            pxCtx->ulTxPacketsWaiting = 0;
-        }
-
-        /* Read from the queue */
-        if( ( xResult == pdTRUE ) &&
-            ( xSourceQueue != NULL ) )
-        {
-            xResult = xQueueReceive( xSourceQueue, &pxTxBuff, 0 );
-            configASSERT( pxTxBuff != NULL );
-            configASSERT( xResult == pdTRUE );
-        }
-        else if( pxTxBuff != NULL )
-        {
-            pxTxBuff = NULL;
-        }
+        /* Woken by Tx queueing, Tx and Rx completion and Rx buffers coming back.
+         * Each pass services all of them, so the count is cleared. */
+        LogDebug( "Starting wait for DATA_WAITING_IDX event" );
+        ( void ) ulTaskNotifyTakeIndexed( DATA_WAITING_IDX,
+                                          pdTRUE,
+                                          500 );
 
-        /* Transmit / receive packet data */
-        if( xResult == pdTRUE )
-        {
-            /* Transmit case */
-            if( usTxLen > 0 )
-            {
-                configASSERT( pxTxBuff );
-                xResult = xTransmitMessage( pxCtx, pxTxBuff->payload, usTxLen );
-            }
-        }
-        if( xResult == pdTRUE )
-        {
-            /* Check also for RX packets. It does not cost much, and saves an additional event queue.
-             * The pbuf was allocated by HAL_ETH_RxAllocateCallback(). */
+        vCheckEthErrors();
 
-          ( void ) xTaskNotifyStateClearIndexed( NULL, ETH_EVT_DMA_IDX );
+        /* Free the packets transmitted since the last pass, then refill the ring */
+        ( void ) HAL_ETH_ReleaseTxPacket( pxCtx->pxEthHandle );
 
-            if( HAL_ETH_ReadData(pxCtx->pxEthHandle, (void **) &pxRxBuff) != HAL_OK )
-            {
-              xResult = pdFALSE;
-            }
-        }
+        vTransmitQueued( pxCtx );
 
-        if( pxTxBuff != NULL )
-        {
-            /* Decrement TX packets waiting counter */
-            ( void ) Atomic_Decrement_u32( &( pxEthCtx->ulTxPacketsWaiting ) );
-
-            /* Free the TX buffer */
-            LogDebug( "Decreasing reference count of pxTxBuff %p from %d to %d", pxTxBuff, pxTxBuff->ref, ( pxTxBuff->ref - 1 ) );
-            PBUF_FREE( pxTxBuff );
-            pxTxBuff = NULL;
-        }
-
-        if( ( xResult == pdTRUE ) &&
-            ( pxRxBuff != NULL ) )
-        {
-            /* Feed LwIP the received packet. */
-            if( prvxLinkInput( pxCtx->pxNetif, pxRxBuff ) == pdTRUE )
-            {
-              pxRxBuff = NULL;
-            }
-        }
-
-        if( pxRxBuff != NULL )
-        {
-            LogDebug( "Decreasing reference count of pxRxBuff %p from %d to %d", pxRxBuff, pxRxBuff->ref, ( pxRxBuff->ref - 1 ) );
-            PBUF_FREE( pxRxBuff );
-            pxRxBuff = NULL;
-        }
-
-        configASSERT( pxTxBuff == NULL );
-        configASSERT( pxRxBuff == NULL );
+        vReceiveReady( pxCtx );
     }
 }
 
@@ -310,12 +356,12 @@ void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff, uint16_t
 
 #if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
   /* NB: May only invalidate if the payload is cache line - aligned (32 bytes) */
-  configASSERT( ( ((uint32_t)*pStart) & 0x1F ) == 0 );
-  SCB_InvalidateDCache_by_Addr((uint32_t*)(*pStart), ETH_RX_BUFFER_SIZE);
+  configASSERT( ( ((uint32_t)buff) & 0x1F ) == 0 );
+  SCB_InvalidateDCache_by_Addr((uint32_t*)buff, Length);
 #endif
 
   /* Compute the pbuf address from the start address of the RX payload */
-  pxRxBuff = ( PacketBuffer_t *) ( (uint32_t) buff - u32_pbuf_payload_offset );
+  pxRxBuff = ( PacketBuffer_t *) ( buff - offsetof( EthRxBuffer_t, ucPayload ) );
 
   pxRxBuff->len = Length;
   pxRxBuff->next = NULL;
@@ -334,24 +380,26 @@ void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff, uint16_t
 
 void HAL_ETH_RxAllocateCallback(uint8_t ** buff)
 {
-  PacketBuffer_t * pxRxBuff = NULL;
-  pxRxBuff = PBUF_ALLOC_RX( ETH_RX_BUFFER_SIZE );
-  if( pxRxBuff != NULL )
+  EthRxBuffer_t * pxBuffer = prvRxBufferAlloc();
+
+  if( pxBuffer != NULL )
   {
+    pxBuffer->xPbuf.custom_free_function = prvRxBufferFree;
+    ( void ) pbuf_alloced_custom( PBUF_RAW, 0, PBUF_REF, &( pxBuffer->xPbuf ),
+                                  pxBuffer->ucPayload, ETH_RX_BUFFER_LEN );
 #if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
-    /* NB: May only invalidate if the payload is cache line - aligned (32 bytes) */
-    configASSERT( ( ((int)pxRxBuff->payload) & 0x1F ) == 0 );
-    SCB_InvalidateDCache_by_Addr((uint32_t*)pxRxBuff->payload, ETH_RX_BUFFER_SIZE);
+    SCB_InvalidateDCache_by_Addr((uint32_t*)pxBuffer->ucPayload, ETH_RX_BUFFER_LEN);
 #endif
-    *buff = pxRxBuff->payload;
-    if( u32_pbuf_payload_offset == 0 )
-    {
-      u32_pbuf_payload_offset = ( uint32_t )( pxRxBuff->payload ) - ( uint32_t ) pxRxBuff;
-    }
+    *buff = pxBuffer->ucPayload;
   }
   else
   {
-    /* Rx Buffer Pool is exhausted. */
+    /* Rx Buffer Pool is exhausted, retried once a buffer is freed. */
+    if( pxEthCtx != NULL )
+    {
+      pxEthCtx->ulRxNoBuffer++;
+    }
+    LINK_STATS_INC( link.memerr );
     *buff = NULL;
   }
 }
@@ -365,6 +413,19 @@ void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth)
   }
 }
 
+void HAL_ETH_TxFreeCallback(uint32_t *buff)
+{
+  PacketBuffer_t * pxTxBuff = ( PacketBuffer_t * ) buff;
+
+  configASSERT( pxTxBuff != NULL );
+
+  /* Decrement TX packets waiting counter */
+  ( void ) Atomic_Decrement_u32( &( pxEthCtx->ulTxPacketsWaiting ) );
+
+  LogDebug( "Decreasing reference count of pxTxBuff %p from %d to %d", pxTxBuff, pxTxBuff->ref, ( pxTxBuff->ref - 1 ) );
+  PBUF_FREE( pxTxBuff );
+}
+
 void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth)
 {
   eth_transfer_done_callback( heth );
@@ -37,6 +37,8 @@
 #include "atomic.h"
 #include "eth_prv.h"
 
+LOG_MODULE_DEFINE();
+
 /* Callback for lwip netif events
  * netif_set_status_callback metif_set_link_callback */
 static void vLwipStatusCallback( struct netif * pxNetif )
@@ -92,6 +94,26 @@ static void vLwipStatusCallback( struct netif * pxNetif )
 }
 
 /* Network output function for lwip */
+static BaseType_t prvxTxNeedsCopy( PacketBuffer_t * pxPbuf )
+{
+    BaseType_t xNeedsCopy = pdFALSE;
+
+    if( pbuf_clen( pxPbuf ) > ETH_TX_MAX_FRAGMENTS )
+    {
+        xNeedsCopy = pdTRUE;
+    }
+
+    for( PacketBuffer_t * pxFrag = pxPbuf; ( pxFrag != NULL ) && ( xNeedsCopy == pdFALSE ); pxFrag = pxFrag->next )
+    {
+        if( PBUF_NEEDS_COPY( pxFrag ) )
+        {
+            xNeedsCopy = pdTRUE;
+        }
+    }
+
+    return xNeedsCopy;
+}
+
 err_t prvxLinkOutput( NetInterface_t * pxNetif,
                       PacketBuffer_t * pxPbuf )
 {
@@ -103,9 +125,9 @@ err_t prvxLinkOutput( NetInterface_t * pxNetif,
     {
         xError = ERR_VAL;
     }
-    /* Handle any chained packets */
-    else if( ( pxPbuf->len != pxPbuf->tot_len ) ||
-             ( pxPbuf->next != NULL ) )
+    /* Chains are sent fragment by fragment, only copy the ones the DMA cannot take
+     * as is, or whose payload the sender may modify once this function returns */
+    else if( prvxTxNeedsCopy( pxPbuf ) == pdTRUE )
     {
         pxPbufToSend = pbuf_clone( PBUF_RAW, PBUF_RAM, pxPbuf );
 
@@ -241,6 +263,11 @@ err_t prvInitNetInterface( NetInterface_t * pxNetif )
 
     pxNetif->flags = ( NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET );
 
+    /* The MAC inserts the IP header and TCP/UDP/ICMP checksums on transmit
+     * (TxConfig.ChecksumCtrl) and drops received frames whose checksums are wrong
+     * (HAL default ChecksumOffload and DropTCPIPChecksumErrorPacket) */
+    NETIF_SET_CHECKSUM_CTRL( pxNetif, NETIF_CHECKSUM_DISABLE_ALL );
+
     netif_set_status_callback( pxNetif, vLwipStatusCallback );
     netif_set_link_callback( pxNetif, vLwipStatusCallback );
 
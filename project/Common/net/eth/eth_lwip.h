@@ -31,6 +31,9 @@
 #include "lwip/netifapi.h"
 #include "lwip/prot/dhcp.h"
 
+/* For the inline helpers below, which log */
+LOG_MODULE_DEFINE();
+
 /* Define "generic" types */
 typedef struct netif      NetInterface_t;
 typedef struct pbuf       PacketBuffer_t;
@@ -54,6 +54,8 @@
 
 #include "sys_evt.h"
 
+LOG_MODULE_DEFINE();
+
 #define MACADDR_RETRY_WAIT_TIME_TICKS    pdMS_TO_TICKS( 10 * 1000 )
 
 static TaskHandle_t xNetTaskHandle = NULL;
@@ -61,7 +63,7 @@ static EthDataplaneCtx_t xDataPlaneCtx;
 
 extern ETH_HandleTypeDef heth;
 
-#if LOG_LEVEL == LOG_DEBUG
+#if ( LOG_LEVEL_COMPILED >= LOG_DEBUG )
 
 /*
  * @brief Converts from a EthStatus_t to a C string.
@@ -95,7 +97,7 @@ static const char * pcEthStatusToString( EthStatus_t xStatus )
 
     return pcReturn;
 }
-#endif /* if LOG_LEVEL == LOG_DEBUG */
+#endif /* if ( LOG_LEVEL_COMPILED >= LOG_DEBUG ) */
 
 /* Wait for all bits in ulTargetBits */
 static uint32_t ulWaitForNotifyBits( BaseType_t uxIndexToWaitOn,
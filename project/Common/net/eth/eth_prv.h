@@ -66,6 +66,20 @@ extern "C"
 
 #define DATA_PLANE_QUEUE_LEN             10
 
+/* Received frames lwIP may hold on to on top of the ones owned by the Rx descriptors,
+ * at least the TCP window of the lwIP tuning profile */
+#if ( LWIP_TUNING_PROFILE == LWIP_PROFILE_LOW_RAM )
+#define ETH_RX_BUFFER_CNT                ( ETH_RX_DESC_CNT + 4U )
+#else
+#define ETH_RX_BUFFER_CNT                ( ETH_RX_DESC_CNT + 8U )
+#endif
+
+/* Frames handed to lwIP per pass before Tx is serviced again */
+#define ETH_RX_BATCH                     ETH_RX_DESC_CNT
+
+/* Longest pbuf chain sent without a copy, each Tx descriptor takes two fragments */
+#define ETH_TX_MAX_FRAGMENTS             4U
+
 
 typedef enum
 {
@@ -83,6 +97,9 @@ typedef struct
     volatile uint32_t ulLastRequestId;
     NetInterface_t * pxNetif;
     QueueHandle_t xDataPlaneSendQueue;
+    PacketBuffer_t * pxTxPending; /* Dequeued, waiting for a free Tx descriptor */
+    volatile uint32_t ulRxNoBuffer; /* Rx descriptor refills that found the buffer pool empty */
+    uint32_t ulRxDropped;           /* Frames the DMA dropped for lack of an Rx descriptor */
 } EthDataplaneCtx_t;
 
 typedef struct
@@ -102,15 +102,15 @@ typedef u32_t      sys_prot_t;
     do { LogAssert( "Assertion \"%s\" failed.", message ); portDISABLE_INTERRUPTS(); while( 1 ) { __NOP(); } } while( 0 )
 
 
-#define LWIP_ERROR( message, expression, handler )                 \
-    do                                                             \
-    {                                                              \
-        if( !( expression ) )                                      \
-        {                                                          \
-            LogError( "Assert_Continue \"%s\" failed.", message ); \
-            handler;                                               \
-        }                                                          \
-    }                                                              \
+#define LWIP_ERROR( message, expression, handler )                      \
+    do                                                                  \
+    {                                                                   \
+        if( !( expression ) )                                           \
+        {                                                               \
+            SdkLog( "ERR", "Assert_Continue \"%s\" failed.", message ); \
+            handler;                                                    \
+        }                                                               \
+    }                                                                   \
     while( 0 )
 
 
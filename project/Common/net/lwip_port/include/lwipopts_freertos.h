@@ -91,7 +91,9 @@
  * MEM_SIZE: the size of the heap memory. If the application will send
  * a lot of data that needs to be copied, this should be set high.
  */
+#ifndef MEM_SIZE
 #define MEM_SIZE    ( 4 * 1600 )
+#endif
 
 /*
  * ------------------------------------------------
@@ -105,15 +107,21 @@
 
 /* MEMP_NUM_TCP_PCB: the number of simultaneously active TCP
  * connections. */
+#ifndef MEMP_NUM_TCP_PCB
 #define MEMP_NUM_TCP_PCB           32
+#endif
 
 /* MEMP_NUM_TCP_PCB_LISTEN: the number of listening TCP
  * connections. */
+#ifndef MEMP_NUM_TCP_PCB_LISTEN
 #define MEMP_NUM_TCP_PCB_LISTEN    32 /*16 original */
+#endif
 
 /* MEMP_NUM_TCP_SEG: the number of simultaneously queued TCP
  * segments. */
+#ifndef MEMP_NUM_TCP_SEG
 #define MEMP_NUM_TCP_SEG           255
+#endif
 
 /* MEMP_NUM_ARP_QUEUE: the number of simulateously queued outgoing
  * packets (pbufs) that are waiting for an ARP request (to resolve
@@ -124,7 +132,9 @@
  * MEMP_NUM_NETCONN: the number of struct netconns.
  * (only needed if you use the sequential API, like api_lib.c)
  */
+#ifndef MEMP_NUM_NETCONN
 #define MEMP_NUM_NETCONN           32
+#endif
 
 /*
  * ----------------------------------
@@ -148,10 +158,14 @@
 #define TCP_MSS        1476
 
 /* TCP sender buffer space (bytes). */
+#ifndef TCP_SND_BUF
 #define TCP_SND_BUF    ( 4 * TCP_MSS )        /*(12 * 1024) */
+#endif
 
 /* TCP receive window. */
+#ifndef TCP_WND
 #define TCP_WND        ( 3 * TCP_MSS )
+#endif
 
 /*
  * ---------------------------------
@@ -61,6 +61,8 @@
     #include "core_pkcs11.h"
 #endif
 
+LOG_MODULE_DEFINE();
+
 typedef struct
 {
     TaskHandle_t xTaskHandle;
@@ -1824,6 +1826,6 @@ int32_t mbedtls_transport_send( NetworkContext_t * pxNetworkContext,
         pcLogLevel = pcMbedtlsLevelToFrLevel( lLevel );
         pcFileBaseName = pcPathToBasename( pcFileName );
 
-        vLoggingPrintf( pcLogLevel, pcFileBaseName, lLineNumber, pcErrStr );
+        vLoggingPrintf( pcLogLevel, pcFileBaseName, lLineNumber, "%s", pcErrStr );
     }
 #endif /* ifdef MBEDTLS_DEBUG_C */
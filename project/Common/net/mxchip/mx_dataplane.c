@@ -38,6 +38,8 @@
 #include "mx_ipc.h"
 #include "mx_prv.h"
 
+LOG_MODULE_DEFINE();
+
 #define EVT_SPI_DONE        0x8
 #define EVT_SPI_ERROR       0x10
 
@@ -46,7 +48,18 @@
 #define SPI_EVT_DMA_IDX     1
 #define SPI_EVT_FLOW_IDX    2
 
+/* Remainder of a payload exchange with unequal Tx and Rx lengths. It is started
+ * from the completion interrupt of the full duplex part, so the dataplane thread
+ * is only woken once per message. */
+typedef struct
+{
+    uint8_t * pucTxBuffer;
+    uint8_t * pucRxBuffer;
+    uint16_t usLen;
+} SpiTail_t;
+
 static MxDataplaneCtx_t * volatile pxSpiCtx = NULL;
+static volatile SpiTail_t xSpiTail = { 0 };
 
 uint32_t prvGetNextRequestID( void )
 {
@@ -67,22 +80,50 @@ uint32_t prvGetNextRequestID( void )
 }
 
 
+static HAL_StatusTypeDef prvStartSpiTail( SPI_HandleTypeDef * hspi )
+{
+    HAL_StatusTypeDef xHalStatus;
+    uint16_t usLen = xSpiTail.usLen;
+
+    xSpiTail.usLen = 0;
+
+    if( xSpiTail.pucTxBuffer != NULL )
+    {
+        xHalStatus = HAL_SPI_Transmit_DMA( hspi, xSpiTail.pucTxBuffer, usLen );
+    }
+    else
+    {
+        xHalStatus = HAL_SPI_Receive_DMA( hspi, xSpiTail.pucRxBuffer, usLen );
+    }
+
+    return xHalStatus;
+}
+
 /* Callback functions */
 static void spi_transfer_done_callback( SPI_HandleTypeDef * hspi )
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     BaseType_t rslt = pdFALSE;
+    uint32_t ulEvent = EVT_SPI_DONE;
 
     if( pxSpiCtx != NULL )
     {
-        rslt = xTaskNotifyIndexedFromISR( pxSpiCtx->xDataPlaneTaskHandle,
-                                          SPI_EVT_DMA_IDX,
-                                          EVT_SPI_DONE,
-                                          eSetBits,
-                                          &xHigherPriorityTaskWoken );
-        configASSERT( rslt == pdTRUE );
+        if( xSpiTail.usLen > 0 )
+        {
+            ulEvent = ( prvStartSpiTail( hspi ) == HAL_OK ) ? 0 : EVT_SPI_ERROR;
+        }
 
-        portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        if( ulEvent != 0 )
+        {
+            rslt = xTaskNotifyIndexedFromISR( pxSpiCtx->xDataPlaneTaskHandle,
+                                              SPI_EVT_DMA_IDX,
+                                              ulEvent,
+                                              eSetBits,
+                                              &xHigherPriorityTaskWoken );
+            configASSERT( rslt == pdTRUE );
+
+            portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+        }
     }
 }
 
@@ -92,6 +133,8 @@ static void spi_transfer_error_callback( SPI_HandleTypeDef * hspi )
 
     BaseType_t rslt = pdFALSE;
 
+    xSpiTail.usLen = 0;
+
     if( pxSpiCtx != NULL )
     {
         rslt = xTaskNotifyIndexedFromISR( pxSpiCtx->xDataPlaneTaskHandle,
@@ -306,6 +349,7 @@ static inline BaseType_t xTransmitReceiveMessage( MxDataplaneCtx_t * pxCtx,
                                                   uint32_t usRxDataLen )
 {
     HAL_StatusTypeDef xHalStatus;
+    uint32_t ulDuplexLen;
 
     configASSERT( pxCtx != NULL );
     configASSERT( pucTxBuffer != NULL );
@@ -313,45 +357,42 @@ static inline BaseType_t xTransmitReceiveMessage( MxDataplaneCtx_t * pxCtx,
     configASSERT( pucRxBuffer != NULL );
     configASSERT( usRxDataLen > 0 );
 
-    /* Split into two dma transactions */
+    /* The longer side continues as a one way transfer from the completion interrupt */
     if( usTxDataLen > usRxDataLen )
     {
-        ( void ) xTaskNotifyStateClearIndexed( NULL, SPI_EVT_DMA_IDX );
-
-        xHalStatus = HAL_SPI_TransmitReceive_DMA( pxCtx->pxSpiHandle,
-                                                  pucTxBuffer,
-                                                  pucRxBuffer,
-                                                  usRxDataLen );
-
-        xHalStatus |= ( xWaitForSPIEvent( MX_SPI_EVENT_TIMEOUT ) == pdTRUE ) ? HAL_OK : HAL_ERROR;
-
-        xHalStatus |= xTransmitMessage( pxCtx,
-                                        &pucTxBuffer[ usRxDataLen ],
-                                        usTxDataLen - usRxDataLen );
+        ulDuplexLen = usRxDataLen;
+        xSpiTail.pucTxBuffer = &pucTxBuffer[ usRxDataLen ];
+        xSpiTail.pucRxBuffer = NULL;
+        xSpiTail.usLen = ( uint16_t ) ( usTxDataLen - usRxDataLen );
     }
     else if( usTxDataLen < usRxDataLen )
     {
-        ( void ) xTaskNotifyStateClearIndexed( NULL, SPI_EVT_DMA_IDX );
+        ulDuplexLen = usTxDataLen;
+        xSpiTail.pucTxBuffer = NULL;
+        xSpiTail.pucRxBuffer = &pucRxBuffer[ usTxDataLen ];
+        xSpiTail.usLen = ( uint16_t ) ( usRxDataLen - usTxDataLen );
+    }
+    else /* usTxDataLen == usRxDataLen */
+    {
+        ulDuplexLen = usTxDataLen;
+        xSpiTail.usLen = 0;
+    }
 
-        xHalStatus = HAL_SPI_TransmitReceive_DMA( pxCtx->pxSpiHandle,
-                                                  pucTxBuffer,
-                                                  pucRxBuffer,
-                                                  usTxDataLen );
+    ( void ) xTaskNotifyStateClearIndexed( NULL, SPI_EVT_DMA_IDX );
 
-        xHalStatus |= ( xWaitForSPIEvent( MX_SPI_EVENT_TIMEOUT ) == pdTRUE ) ? HAL_OK : HAL_ERROR;
+    xHalStatus = HAL_SPI_TransmitReceive_DMA( pxCtx->pxSpiHandle,
+                                              pucTxBuffer,
+                                              pucRxBuffer,
+                                              ulDuplexLen );
 
-        xHalStatus |= xReceiveMessage( pxCtx,
-                                       &pucRxBuffer[ usTxDataLen ],
-                                       usRxDataLen - usTxDataLen );
-    }
-    else /* usTxDataLen == usRxDataLen */
+    if( xHalStatus == HAL_OK )
     {
-        xHalStatus = HAL_SPI_TransmitReceive_DMA( pxCtx->pxSpiHandle,
-                                                  pucTxBuffer,
-                                                  pucRxBuffer,
-                                                  usTxDataLen );
+        xHalStatus = ( xWaitForSPIEvent( MX_SPI_EVENT_TIMEOUT ) == pdTRUE ) ? HAL_OK : HAL_ERROR;
+    }
 
-        xHalStatus |= ( xWaitForSPIEvent( MX_SPI_EVENT_TIMEOUT ) == pdTRUE ) ? HAL_OK : HAL_ERROR;
+    if( xHalStatus != HAL_OK )
+    {
+        xSpiTail.usLen = 0;
     }
 
     return xHalStatus == HAL_OK;
@@ -36,19 +36,34 @@
 #include "lwip/pbuf.h"
 #include "mx_prv.h"
 
+LOG_MODULE_DEFINE();
 
 /* Local types and enumerations */
-typedef struct
+typedef struct IPCRequestCtx
 {
     volatile uint32_t ulRequestID;
     PacketBuffer_t * pxTxPbuf;
     PacketBuffer_t * pxRxPbuf;
     TaskHandle_t xWaitingTask;
+    TickType_t xStartTick;
+    struct IPCRequestCtx * pxNextFree;
 } IPCRequestCtx_t;
 
+#if ( ( NUM_IPC_REQUEST_CTX & ( NUM_IPC_REQUEST_CTX - 1 ) ) != 0 )
+#error "NUM_IPC_REQUEST_CTX must be a power of two"
+#endif
+
+/* The low bits of a request ID are the index of its context, a response is routed
+ * with a single lookup. The upper bits are a sequence number, so a late response to
+ * an earlier request in the same context does not match. */
+#define IPC_CTX_INDEX_MASK    ( NUM_IPC_REQUEST_CTX - 1UL )
+
 /* Static variables */
-IPCRequestCtx_t xIPCRequestCtxArray[ NUM_IPC_REQUEST_CTX ];
-static SemaphoreHandle_t xContextArrayMutex = NULL;     /* Mutex that must be held while modifying the xIPCRequestCtxArray */
+/* The free list, the request IDs and the statistics are only accessed in a critical section */
+static IPCRequestCtx_t xIPCRequestCtxArray[ NUM_IPC_REQUEST_CTX ];
+static IPCRequestCtx_t * pxFreeCtxList = NULL;
+static uint32_t ulIPCSequence = 0;
+static IPCStats_t xIPCStats = { 0 };
 static SemaphoreHandle_t xContextCountSemaphore = NULL; /* Allow clients to block while waiting for an IPCRequestCtx_t. */
 static ControlPlaneCtx_t * pxControlPlaneCtx = NULL;
 
@@ -56,38 +71,40 @@ static void vClearCtx( IPCRequestCtx_t * pxRequestCtx )
 {
     if( pxRequestCtx != NULL )
     {
-        /* Acquire mutex before freeing the context */
         BaseType_t xResult;
-        xResult = xSemaphoreTake( xContextArrayMutex,
-                                  pdMS_TO_TICKS( MX_DEFAULT_TIMEOUT_MS ) );
+        PacketBuffer_t * pxTxPbuf;
+        PacketBuffer_t * pxRxPbuf;
 
-        configASSERT( xResult == pdTRUE );
+        taskENTER_CRITICAL();
 
-        /* Clear request ID to mark the context as available */
+        /* Clear request ID so that late responses are dropped */
         pxRequestCtx->ulRequestID = 0;
+        pxRequestCtx->xWaitingTask = NULL;
 
-        /* Free the request buffer pbuf and clear the pointer */
-        if( pxRequestCtx->pxTxPbuf != NULL )
-        {
-            LogDebug( "Decreasing reference count of pbuf %p from %d to %d", pxRequestCtx->pxTxPbuf, pxRequestCtx->pxTxPbuf->ref, ( pxRequestCtx->pxTxPbuf->ref - 1 ) );
-            PBUF_FREE( pxRequestCtx->pxTxPbuf );
-            pxRequestCtx->pxTxPbuf = NULL;
-        }
+        pxTxPbuf = pxRequestCtx->pxTxPbuf;
+        pxRxPbuf = pxRequestCtx->pxRxPbuf;
+        pxRequestCtx->pxTxPbuf = NULL;
+        pxRequestCtx->pxRxPbuf = NULL;
 
-        /* Clear the handle of the waiting task */
-        pxRequestCtx->xWaitingTask = NULL;
+        pxRequestCtx->pxNextFree = pxFreeCtxList;
+        pxFreeCtxList = pxRequestCtx;
 
-        /* Free the response buffer pbuf and clear the pointer */
-        if( pxRequestCtx->pxRxPbuf != NULL )
+        xIPCStats.ulOutstanding--;
+
+        taskEXIT_CRITICAL();
+
+        /* Free the request and response buffers */
+        if( pxTxPbuf != NULL )
         {
-            LogDebug( "Decreasing reference count of pbuf %p from %d to %d", pxRequestCtx->pxRxPbuf, pxRequestCtx->pxRxPbuf->ref, ( pxRequestCtx->pxRxPbuf->ref - 1 ) );
-            PBUF_FREE( pxRequestCtx->pxRxPbuf );
-            pxRequestCtx->pxRxPbuf = NULL;
+            LogDebug( "Decreasing reference count of pbuf %p from %d to %d", pxTxPbuf, pxTxPbuf->ref, ( pxTxPbuf->ref - 1 ) );
+            PBUF_FREE( pxTxPbuf );
         }
 
-        xResult = xSemaphoreGive( xContextArrayMutex );
-
-        configASSERT( xResult == pdTRUE );
+        if( pxRxPbuf != NULL )
+        {
+            LogDebug( "Decreasing reference count of pbuf %p from %d to %d", pxRxPbuf, pxRxPbuf->ref, ( pxRxPbuf->ref - 1 ) );
+            PBUF_FREE( pxRxPbuf );
+        }
 
         /* Add a token the to counting semaphore */
         xResult = xSemaphoreGive( xContextCountSemaphore );
@@ -104,62 +121,91 @@ static IPCRequestCtx_t * pxFindAvailableCtx( TickType_t xTimeout,
 
     configASSERT( xContextCountSemaphore != NULL );
 
+    if( uxSemaphoreGetCount( xContextCountSemaphore ) == 0 )
+    {
+        taskENTER_CRITICAL();
+        xIPCStats.ulContextWaits++;
+        taskEXIT_CRITICAL();
+    }
+
     /* Wait for a context to become available, then take a token from xContextCountSemaphore */
     xResult = xSemaphoreTake( xContextCountSemaphore, xTimeout );
 
-    configASSERT( xResult == pdTRUE );
-
-    configASSERT( xContextArrayMutex != NULL );
-
-    xResult = xSemaphoreTake( xContextArrayMutex, xTimeout );
-
     if( xResult == pdTRUE )
     {
-        for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
-        {
-            if( xIPCRequestCtxArray[ i ].ulRequestID == 0 )
-            {
-                xIPCRequestCtxArray[ i ].ulRequestID = prvGetNextRequestID();
+        uint32_t ulIndex;
 
-                pxRequestCtx = &( xIPCRequestCtxArray[ i ] );
+        taskENTER_CRITICAL();
 
-                if( pxRequestCtx->pxRxPbuf != NULL )
-                {
-                    PBUF_FREE( pxRequestCtx->pxRxPbuf );
-                    LogWarn( "pxRxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
-                }
+        /* Holding a token guarantees a free context */
+        pxRequestCtx = pxFreeCtxList;
+        configASSERT( pxRequestCtx != NULL );
+        pxFreeCtxList = pxRequestCtx->pxNextFree;
+        pxRequestCtx->pxNextFree = NULL;
 
-                if( pxRequestCtx->pxTxPbuf != NULL )
-                {
-                    PBUF_FREE( pxRequestCtx->pxTxPbuf );
-                    LogWarn( "pxTxPbuf for IPCRequestCtx %d was non-null upon re-use.", i );
-                }
+        ulIndex = ( uint32_t ) ( pxRequestCtx - xIPCRequestCtxArray );
 
-                if( pxRequestCtx->xWaitingTask != NULL )
-                {
-                    pxRequestCtx->xWaitingTask = NULL;
-                    LogWarn( "xWaitingTask for IPCRequestCtx %d was non-null upon re-use.", i );
-                }
+        /* Avoid ulRequestID == 0, reserved for event messages */
+        do
+        {
+            ulIPCSequence++;
+            pxRequestCtx->ulRequestID = ( ulIPCSequence * NUM_IPC_REQUEST_CTX ) | ulIndex;
+        } while( pxRequestCtx->ulRequestID == 0 );
 
-                /* Allocate a tx pbuf */
-                pxRequestCtx->pxTxPbuf = PBUF_ALLOC_TX( xPbufLen );
-/*                LogDebug( "Allocated pbuf: %p length: %d ref: %d",  pxRequestCtx->pxTxPbuf, pxRequestCtx->pxRxPbuf->tot_len, pxRequestCtx->pxRxPbuf->ref ); */
-                break;
-            }
+        xIPCStats.ulRequests++;
+        xIPCStats.ulOutstanding++;
+
+        if( xIPCStats.ulOutstanding > xIPCStats.ulMaxOutstanding )
+        {
+            xIPCStats.ulMaxOutstanding = xIPCStats.ulOutstanding;
         }
 
-        xResult = xSemaphoreGive( xContextArrayMutex );
+        taskEXIT_CRITICAL();
 
-        configASSERT( xResult == pdTRUE );
+        configASSERT( pxRequestCtx->pxTxPbuf == NULL );
+        configASSERT( pxRequestCtx->pxRxPbuf == NULL );
+
+        /* Allocate a tx pbuf */
+        pxRequestCtx->pxTxPbuf = PBUF_ALLOC_TX( xPbufLen );
+
+        if( pxRequestCtx->pxTxPbuf == NULL )
+        {
+            LogError( "Failed to allocate a request buffer." );
+            vClearCtx( pxRequestCtx );
+            pxRequestCtx = NULL;
+        }
     }
     else
     {
-        LogError( "Timed out while acquiring xContextArrayMutex." );
+        LogError( "Timed out while waiting for a free request context." );
     }
 
     return pxRequestCtx;
 }
 
+void mx_GetIPCStats( IPCStats_t * pxStats,
+                     BaseType_t xReset )
+{
+    configASSERT( pxStats != NULL );
+
+    taskENTER_CRITICAL();
+
+    *pxStats = xIPCStats;
+
+    if( xReset == pdTRUE )
+    {
+        uint32_t ulOutstanding = xIPCStats.ulOutstanding;
+
+        ( void ) memset( &xIPCStats, 0, sizeof( xIPCStats ) );
+        xIPCStats.ulOutstanding = ulOutstanding;
+        xIPCStats.ulMaxOutstanding = ulOutstanding;
+    }
+
+    taskEXIT_CRITICAL();
+
+    pxStats->ulContexts = NUM_IPC_REQUEST_CTX;
+}
+
 static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
                                    uint32_t ulTxPacketDataLen,
                                    void * pxResponse,
@@ -182,9 +228,6 @@ static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
     /* Allocate a request context */
     IPCRequestCtx_t * pxRequestCtx = pxFindAvailableCtx( xTimeout, ulTxPacketLen );
 
-    LogDebug( "Sending IPC packet with request_id: %d, api_id: %d, pktdatalen: %d, total_len: %d",
-              pxRequestCtx->ulRequestID, pxTxPkt->xHeader.usIPCApiId, ulTxPacketDataLen, ulTxPacketLen );
-
     if( pxRequestCtx == NULL )
     {
         LogError( "Timed out while finding a request context." );
@@ -192,10 +235,17 @@ static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
     }
     else
     {
+        LogDebug( "Sending IPC packet with request_id: %d, api_id: %d, pktdatalen: %d, total_len: %d",
+                  pxRequestCtx->ulRequestID, pxTxPkt->xHeader.usIPCApiId, ulTxPacketDataLen, ulTxPacketLen );
+
         /* Set request ID */
         pxTxPkt->xHeader.ulIPCRequestId = pxRequestCtx->ulRequestID;
 
+        /* Discard a notification left over by a response that came after an earlier timeout */
+        ( void ) xTaskNotifyStateClear( NULL );
+
         /* Set task handle */
+        pxRequestCtx->xStartTick = xTaskGetTickCount();
         pxRequestCtx->xWaitingTask = xTaskGetCurrentTaskHandle();
 
         /* Copy to pbuf */
@@ -235,16 +285,27 @@ static IPCError_t xSendIPCRequest( IPCPacket_t * pxTxPkt,
         /* Wait for notification */
         xResult = xTaskNotifyWait( 0, 0, NULL, xTimeout );
 
-        if( xResult == pdTRUE )
+        /* Stop the router from delivering to this context once the wait is over */
+        taskENTER_CRITICAL();
+
+        pxRequestCtx->xWaitingTask = NULL;
+
+        if( pxRequestCtx->pxRxPbuf != NULL )
         {
             pxResponsePacket = ( IPCPacket_t * ) pxRequestCtx->pxRxPbuf->payload;
         }
         else
         {
-            xReturnValue = IPC_TIMEOUT;
+            xIPCStats.ulTimeouts++;
         }
 
-        pxRequestCtx->xWaitingTask = NULL;
+        taskEXIT_CRITICAL();
+
+        if( pxResponsePacket == NULL )
+        {
+            LogError( "No response to request id=%d, notified: %d", pxRequestCtx->ulRequestID, xResult );
+            xReturnValue = IPC_TIMEOUT;
+        }
     }
 
     if( ( pxResponsePacket != NULL ) &&
@@ -495,25 +556,28 @@ void prvControlPlaneRouter( void * pvParameters )
     /* Export context to other functions in this file */
     pxControlPlaneCtx = pxCtx;
 
-    xContextArrayMutex = xSemaphoreCreateMutex();
+    BaseType_t xResult;
 
-    xContextCountSemaphore = xSemaphoreCreateCounting( NUM_IPC_REQUEST_CTX, NUM_IPC_REQUEST_CTX );
+    taskENTER_CRITICAL();
 
-    /* lock mutex, non-blocking */
-    BaseType_t xResult = xSemaphoreTake( xContextArrayMutex, 0 );
+    pxFreeCtxList = NULL;
 
-    /* Mutex should always be free at this point */
-    configASSERT( xResult == pdTRUE );
-
-    for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
+    for( uint32_t i = NUM_IPC_REQUEST_CTX; i > 0; i-- )
     {
-        xIPCRequestCtxArray[ i ].ulRequestID = 0;
-        xIPCRequestCtxArray[ i ].pxTxPbuf = NULL;
-        xIPCRequestCtxArray[ i ].pxRxPbuf = NULL;
-        xIPCRequestCtxArray[ i ].xWaitingTask = NULL;
+        IPCRequestCtx_t * pxRequestCtx = &( xIPCRequestCtxArray[ i - 1 ] );
+
+        pxRequestCtx->ulRequestID = 0;
+        pxRequestCtx->pxTxPbuf = NULL;
+        pxRequestCtx->pxRxPbuf = NULL;
+        pxRequestCtx->xWaitingTask = NULL;
+        pxRequestCtx->pxNextFree = pxFreeCtxList;
+        pxFreeCtxList = pxRequestCtx;
     }
 
-    xSemaphoreGive( xContextArrayMutex );
+    taskEXIT_CRITICAL();
+
+    xContextCountSemaphore = xSemaphoreCreateCounting( NUM_IPC_REQUEST_CTX, NUM_IPC_REQUEST_CTX );
+    configASSERT( xContextCountSemaphore != NULL );
 
     while( 1 )
     {
@@ -553,57 +617,54 @@ void prvControlPlaneRouter( void * pvParameters )
                              pxRxPacket->xHeader.usIPCApiId );
                 }
             }
-            /* Otherwise, message is a response, find the relevant IPCRequestCtx to send the packet to */
+            /* Otherwise, message is a response, the request ID locates the IPCRequestCtx to send the packet to */
             else
             {
-                /* Wait for xContextArrayMutex */
-                xResult = xSemaphoreTake( xContextArrayMutex, portMAX_DELAY );
-
-                configASSERT( xResult == pdTRUE );
+                uint32_t ulRequestId = pxRxPacket->xHeader.ulIPCRequestId;
+                IPCRequestCtx_t * pxTargetCtx = &( xIPCRequestCtxArray[ ulRequestId & IPC_CTX_INDEX_MASK ] );
+                TaskHandle_t xWaitingTask = NULL;
 
-                IPCRequestCtx_t * pxTargetCtx = NULL;
+                taskENTER_CRITICAL();
 
-                for( uint32_t i = 0; i < NUM_IPC_REQUEST_CTX; i++ )
-                {
-                    if( xIPCRequestCtxArray[ i ].ulRequestID == pxRxPacket->xHeader.ulIPCRequestId )
-                    {
-                        pxTargetCtx = &xIPCRequestCtxArray[ i ];
-                        break;
-                    }
-                }
-
-                /* Send packet to waiting thread */
-                if( ( pxTargetCtx != NULL ) &&
+                if( ( pxTargetCtx->ulRequestID == ulRequestId ) &&
                     ( pxTargetCtx->pxRxPbuf == NULL ) &&
                     ( pxTargetCtx->xWaitingTask != NULL ) )
                 {
-                    LogDebug( "Notifying waiting task %d of RX packet.", pxTargetCtx->xWaitingTask );
+                    TickType_t xLatency = xTaskGetTickCount() - pxTargetCtx->xStartTick;
+                    uint32_t ulLatencyMs = ( uint32_t ) ( xLatency * portTICK_PERIOD_MS );
+
+                    /* Increase pbuf reference count, the context owns a reference now */
+                    pbuf_ref( pxRxPbuf );
                     pxTargetCtx->pxRxPbuf = pxRxPbuf;
-                    xResult = xTaskNotify( pxTargetCtx->xWaitingTask, 0, eNoAction );
+                    xWaitingTask = pxTargetCtx->xWaitingTask;
 
-                    if( xResult == pdTRUE )
-                    {
-                        /* Increase pbuf reference count */
-                        pbuf_ref( pxRxPbuf );
-                    }
-                    else
+                    xIPCStats.ulResponses++;
+                    xIPCStats.ulTotalLatencyMs += ulLatencyMs;
+
+                    if( ulLatencyMs > xIPCStats.ulMaxLatencyMs )
                     {
-                        pxTargetCtx->pxRxPbuf = NULL;
-                        LogError( "Error delivering response message with AppId: %d and RequestId: %d",
-                                  pxRxPacket->xHeader.usIPCApiId,
-                                  pxRxPacket->xHeader.ulIPCRequestId );
+                        xIPCStats.ulMaxLatencyMs = ulLatencyMs;
                     }
                 }
                 else
+                {
+                    xIPCStats.ulDropped++;
+                }
+
+                taskEXIT_CRITICAL();
+
+                /* Send packet to waiting thread */
+                if( xWaitingTask != NULL )
+                {
+                    LogDebug( "Notifying waiting task %d of RX packet.", xWaitingTask );
+                    ( void ) xTaskNotify( xWaitingTask, 0, eNoAction );
+                }
+                else
                 {
                     LogWarn( "Dropping response packet with AppId: %d and RequestId: %d",
                              pxRxPacket->xHeader.usIPCApiId,
-                             pxRxPacket->xHeader.ulIPCRequestId );
+                             ulRequestId );
                 }
-
-                /* Return the mutex */
-                xResult = xSemaphoreGive( xContextArrayMutex );
-                configASSERT( xResult == pdTRUE );
             }
 
             LogDebug( "Decreasing reference count of pxRxPbuf %p from %d to %d", pxRxPbuf, pxRxPbuf->ref, ( pxRxPbuf->ref - 1 ) );
@@ -59,6 +59,21 @@ typedef enum
 typedef void ( * MxEventCallback_t )( MxStatus_t,
                                       void * );
 
+/* Control plane request statistics, see mx_GetIPCStats() */
+typedef struct
+{
+    uint32_t ulRequests;       /* Requests sent to the module */
+    uint32_t ulResponses;      /* Responses delivered to their request */
+    uint32_t ulTimeouts;       /* Requests that gave up waiting for their response */
+    uint32_t ulDropped;        /* Responses matching no outstanding request */
+    uint32_t ulContextWaits;   /* Requests that found all request contexts in use */
+    uint32_t ulOutstanding;    /* Requests waiting for their response now */
+    uint32_t ulMaxOutstanding; /* Highest ulOutstanding since the last reset */
+    uint32_t ulContexts;       /* NUM_IPC_REQUEST_CTX */
+    uint32_t ulTotalLatencyMs; /* Sum of request to response times of ulResponses */
+    uint32_t ulMaxLatencyMs;
+} IPCStats_t;
+
 IPCError_t mx_RequestVersion( char * pcVersionBuffer,
                               uint32_t ulVersionLength,
                               TickType_t xTimeout );
@@ -82,4 +97,8 @@ IPCError_t mx_SetBypassMode( BaseType_t xEnable,
 IPCError_t mx_RegisterEventCallback( MxEventCallback_t pvCallback,
                                      void * pxCallbackContext );
 
+/* Copy the request statistics, then clear them (except ulOutstanding) if xReset is pdTRUE */
+void mx_GetIPCStats( IPCStats_t * pxStats,
+                     BaseType_t xReset );
+
 #endif /* _MXFREE_IPC_ */
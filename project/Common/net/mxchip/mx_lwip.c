@@ -31,6 +31,8 @@
 #include "atomic.h"
 #include "mx_prv.h"
 
+LOG_MODULE_DEFINE();
+
 static void vAddMXHeaderToEthernetFrame( PacketBuffer_t * pxTxPacket )
 {
     configASSERT( pxTxPacket != NULL );
@@ -56,6 +56,8 @@
 
 #include "mx_gpio.h"
 
+LOG_MODULE_DEFINE();
+
 #define MACADDR_RETRY_WAIT_TIME_TICKS    pdMS_TO_TICKS( 10 * 1000 )
 
 static TaskHandle_t xNetTaskHandle = NULL;
@@ -65,7 +67,7 @@ static ControlPlaneCtx_t xControlPlaneCtx;
 extern SPI_HandleTypeDef MXCHIP_SPI;
 #define pxHndlSpi2 (&MXCHIP_SPI)
 
-#if LOG_LEVEL == LOG_DEBUG
+#if ( LOG_LEVEL_COMPILED >= LOG_DEBUG )
 
 /*
  * @brief Converts from a MxEvent_t to a C string.
@@ -107,7 +109,7 @@ extern SPI_HandleTypeDef MXCHIP_SPI;
 
         return pcReturn;
     }
-#endif /* if LOG_LEVEL == LOG_DEBUG */
+#endif /* if ( LOG_LEVEL_COMPILED >= LOG_DEBUG ) */
 
 /* Wait for all bits in ulTargetBits */
 static uint32_t ulWaitForNotifyBits( BaseType_t uxIndexToWaitOn,
@@ -60,7 +60,10 @@ extern "C"
 #define ASYNC_REQUEST_RECONNECT_BIT      0x80
 
 /* Constants */
+/* Control plane requests outstanding at once, a power of two */
+#ifndef NUM_IPC_REQUEST_CTX
 #define NUM_IPC_REQUEST_CTX              1
+#endif
 #define MX_DEFAULT_TIMEOUT_MS            100
 #define MX_DEFAULT_TIMEOUT_TICK          pdMS_TO_TICKS( MX_DEFAULT_TIMEOUT_MS )
 #define MX_TIMEOUT_CONNECT               pdMS_TO_TICKS( 120 * 1000 )
@@ -0,0 +1,246 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file perf_monitor.c
+ * @brief Interrupt time accounting and a statistical PC sampling profiler.
+ */
+
+#include "main.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "perf_monitor.h"
+
+/* Counter of the profiler timer */
+#define PERF_PROFILE_COUNTER_HZ    1000000UL
+
+static PerfIrqStats_t * pxIrqStatsHead = NULL;
+static TickType_t xIrqStatsResetTick = 0;
+
+static PerfSample_t * volatile pxSamples = NULL;
+static volatile size_t uxSamplesMax = 0;
+static volatile size_t uxSamplesCount = 0;
+static volatile long xProfileRunning = pdFALSE;
+static uint32_t ulProfileRateHz = 0;
+
+void vPerfIrqExit( PerfIrqStats_t * pxStats,
+                   uint32_t ulStartCycles )
+{
+    uint32_t ulCycles = DWT->CYCCNT - ulStartCycles;
+
+    /* Link the statistics of an interrupt on its first run. Interrupts may run above
+     * configMAX_SYSCALL_INTERRUPT_PRIORITY, so mask all of them. */
+    if( pxStats->xLinked == 0 )
+    {
+        uint32_t ulPrimask = __get_PRIMASK();
+
+        __disable_irq();
+
+        if( pxStats->xLinked == 0 )
+        {
+            pxStats->pxNext = pxIrqStatsHead;
+            pxIrqStatsHead = pxStats;
+            pxStats->xLinked = 1;
+        }
+
+        __set_PRIMASK( ulPrimask );
+    }
+
+    /* Not synchronized with vPerfIrqReset(), the statistics are only for diagnostics */
+    pxStats->ulCount++;
+    pxStats->ullCycles += ulCycles;
+
+    if( ulCycles > pxStats->ulMaxCycles )
+    {
+        pxStats->ulMaxCycles = ulCycles;
+    }
+}
+
+PerfIrqStats_t * pxPerfIrqNext( PerfIrqStats_t * pxStats )
+{
+    return ( pxStats == NULL ) ? pxIrqStatsHead : pxStats->pxNext;
+}
+
+void vPerfIrqReset( void )
+{
+    for( PerfIrqStats_t * pxStats = pxIrqStatsHead; pxStats != NULL; pxStats = pxStats->pxNext )
+    {
+        pxStats->ulCount = 0;
+        pxStats->ullCycles = 0;
+        pxStats->ulMaxCycles = 0;
+    }
+
+    xIrqStatsResetTick = xTaskGetTickCount();
+}
+
+/* Derived from the tick count, DWT->CYCCNT wraps every few seconds */
+uint64_t ullPerfIrqElapsedCycles( void )
+{
+    TickType_t xElapsed = xTaskGetTickCount() - xIrqStatsResetTick;
+
+    return ( ( uint64_t ) xElapsed * SystemCoreClock ) / configTICK_RATE_HZ;
+}
+
+uint64_t ullPerfIrqTotalCycles( void )
+{
+    uint64_t ullTotal = 0;
+
+    for( PerfIrqStats_t * pxStats = pxIrqStatsHead; pxStats != NULL; pxStats = pxStats->pxNext )
+    {
+        ullTotal += pxStats->ullCycles;
+    }
+
+    return ullTotal;
+}
+
+/* Timers on APB1 run at twice PCLK1 when APB1 is divided (RCC_CFGR1_TIMPRE cleared) */
+static uint32_t prvProfileTimerClock( void )
+{
+    uint32_t ulPclk1 = HAL_RCC_GetPCLK1Freq();
+
+    return ( ulPclk1 == HAL_RCC_GetHCLKFreq() ) ? ulPclk1 : ( 2UL * ulPclk1 );
+}
+
+long xPerfProfileStart( uint32_t ulRateHz,
+                        size_t uxSamples )
+{
+    long xResult = pdFALSE;
+
+    if( ( xProfileRunning == pdFALSE ) &&
+        ( ulRateHz >= ( PERF_PROFILE_COUNTER_HZ / 0x10000UL ) + 1UL ) &&
+        ( ulRateHz <= PERF_PROFILE_MAX_RATE_HZ ) &&
+        ( uxSamples > 0 ) )
+    {
+        PerfSample_t * pxBuffer = pxSamples;
+
+        pxSamples = NULL;
+        uxSamplesMax = 0;
+        uxSamplesCount = 0;
+        vPortFree( pxBuffer );
+
+        pxBuffer = ( PerfSample_t * ) pvPortMalloc( uxSamples * sizeof( PerfSample_t ) );
+
+        if( pxBuffer != NULL )
+        {
+            pxSamples = pxBuffer;
+            uxSamplesMax = uxSamples;
+            ulProfileRateHz = ulRateHz;
+
+            __HAL_RCC_TIM6_CLK_ENABLE();
+
+            PERF_PROFILE_TIMER->CR1 = 0;
+            PERF_PROFILE_TIMER->PSC = ( prvProfileTimerClock() / PERF_PROFILE_COUNTER_HZ ) - 1UL;
+            PERF_PROFILE_TIMER->ARR = ( PERF_PROFILE_COUNTER_HZ / ulRateHz ) - 1UL;
+            PERF_PROFILE_TIMER->CNT = 0;
+            PERF_PROFILE_TIMER->EGR = TIM_EGR_UG;
+            PERF_PROFILE_TIMER->SR = 0;
+            PERF_PROFILE_TIMER->DIER = TIM_DIER_UIE;
+
+            /* Above configMAX_SYSCALL_INTERRUPT_PRIORITY to sample critical sections too,
+             * the handler does not use the FreeRTOS API. */
+            NVIC_SetPriority( PERF_PROFILE_TIMER_IRQn, 0 );
+            NVIC_ClearPendingIRQ( PERF_PROFILE_TIMER_IRQn );
+            NVIC_EnableIRQ( PERF_PROFILE_TIMER_IRQn );
+
+            xProfileRunning = pdTRUE;
+            PERF_PROFILE_TIMER->CR1 = TIM_CR1_CEN;
+            xResult = pdTRUE;
+        }
+    }
+
+    return xResult;
+}
+
+static void prvProfileTimerStop( void )
+{
+    PERF_PROFILE_TIMER->CR1 = 0;
+    PERF_PROFILE_TIMER->DIER = 0;
+    NVIC_DisableIRQ( PERF_PROFILE_TIMER_IRQn );
+    xProfileRunning = pdFALSE;
+}
+
+void vPerfProfileStop( void )
+{
+    if( xProfileRunning != pdFALSE )
+    {
+        prvProfileTimerStop();
+    }
+}
+
+const PerfSample_t * pxPerfProfileSamples( size_t * puxCount,
+                                           uint32_t * pulRateHz,
+                                           long * pxRunning )
+{
+    *puxCount = uxSamplesCount;
+    *pulRateHz = ulProfileRateHz;
+    *pxRunning = xProfileRunning;
+
+    return pxSamples;
+}
+
+/* Called from TIM6_IRQHandler with the exception frame of the interrupted code */
+void vPerfProfileSample( const uint32_t * pulFrame,
+                         uint32_t ulExcReturn )
+{
+    PERF_PROFILE_TIMER->SR = ~TIM_SR_UIF;
+
+    if( uxSamplesCount < uxSamplesMax )
+    {
+        PerfSample_t * pxSample = &pxSamples[ uxSamplesCount ];
+
+        pxSample->ulPC = pulFrame[ 6 ];
+        pxSample->ulLR = pulFrame[ 5 ];
+
+        /* EXC_RETURN.Mode is cleared when returning to handler mode */
+        if( ( ulExcReturn & 0x8UL ) == 0 )
+        {
+            pxSample->ulPC |= PERF_SAMPLE_IN_HANDLER;
+        }
+
+        uxSamplesCount++;
+    }
+
+    if( uxSamplesCount >= uxSamplesMax )
+    {
+        prvProfileTimerStop();
+    }
+
+    /* Let the flag clear before returning, not to take the interrupt again */
+    __DSB();
+}
+
+void TIM6_IRQHandler( void ) __attribute__( ( naked ) );
+
+void TIM6_IRQHandler( void )
+{
+    __asm volatile
+    (
+        " tst lr, #4                \n"
+        " ite eq                    \n"
+        " mrseq r0, msp             \n"
+        " mrsne r0, psp             \n"
+        " mov r1, lr                \n"
+        " b vPerfProfileSample      \n"
+    );
+}
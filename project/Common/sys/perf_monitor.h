@@ -0,0 +1,109 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/**
+ * @file perf_monitor.h
+ * @brief Interrupt time accounting and a statistical PC sampling profiler.
+ *
+ * Interrupt handlers are timed with the DWT cycle counter by placing
+ * PERF_IRQ_ENTER() at the start and PERF_IRQ_EXIT( <IRQn> ) at the end of the
+ * handler. The time of an interrupt includes the interrupts nested in it.
+ *
+ * The profiler samples the interrupted PC and LR from the exception frame in the
+ * handler of PERF_PROFILE_TIMER, which runs at the highest priority so that it also
+ * samples critical sections and other interrupts. The samples are read with the
+ * "perf profile dump" CLI command and symbolized on the host by
+ * tools/perf/perf_report.py.
+ */
+
+#ifndef PERF_MONITOR_H
+#define PERF_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef PERF_IRQ_STATS
+    #define PERF_IRQ_STATS    1
+#endif
+
+#define PERF_PROFILE_TIMER              TIM6
+#define PERF_PROFILE_TIMER_IRQn         TIM6_IRQn
+#define PERF_PROFILE_DEFAULT_RATE_HZ    997  /* Prime, not to beat with the tick */
+#define PERF_PROFILE_MAX_RATE_HZ        20000
+#define PERF_PROFILE_DEFAULT_SAMPLES    2048
+
+/* Set in the PC of a sample taken in an interrupt handler, the stacked PC is always even */
+#define PERF_SAMPLE_IN_HANDLER          0x1UL
+
+typedef struct PerfIrqStats
+{
+    const char * pcName;
+    uint32_t ulCount;
+    uint64_t ullCycles;
+    uint32_t ulMaxCycles;
+    long xLinked;
+    struct PerfIrqStats * pxNext;
+} PerfIrqStats_t;
+
+typedef struct
+{
+    uint32_t ulPC;
+    uint32_t ulLR;
+} PerfSample_t;
+
+#if ( PERF_IRQ_STATS == 1 )
+    #define PERF_IRQ_ENTER()    const uint32_t ulPerfIrqStart = DWT->CYCCNT
+
+    #define PERF_IRQ_EXIT( xIRQn )                                                   \
+    do {                                                                             \
+        static PerfIrqStats_t xPerfIrqStats = { .pcName = #xIRQn };                  \
+        vPerfIrqExit( &xPerfIrqStats, ulPerfIrqStart );                              \
+    } while( 0 )
+#else
+    #define PERF_IRQ_ENTER()
+    #define PERF_IRQ_EXIT( xIRQn )
+#endif
+
+void vPerfIrqExit( PerfIrqStats_t * pxStats,
+                   uint32_t ulStartCycles );
+
+/* Iterate over the interrupts that ran since boot, pass NULL to get the first one */
+PerfIrqStats_t * pxPerfIrqNext( PerfIrqStats_t * pxStats );
+
+void vPerfIrqReset( void );
+
+/* CPU cycles elapsed since the last vPerfIrqReset() and spent in all interrupts */
+uint64_t ullPerfIrqElapsedCycles( void );
+uint64_t ullPerfIrqTotalCycles( void );
+
+/* Starts sampling at ulRateHz into a buffer of uxSamples, allocated from the heap.
+ * Returns pdFALSE if it is already running or the buffer cannot be allocated. */
+long xPerfProfileStart( uint32_t ulRateHz,
+                        size_t uxSamples );
+void vPerfProfileStop( void );
+
+/* Returns the samples of the last run, valid until the next xPerfProfileStart() */
+const PerfSample_t * pxPerfProfileSamples( size_t * puxCount,
+                                           uint32_t * pulRateHz,
+                                           long * pxRunning );
+
+#endif /* PERF_MONITOR_H */
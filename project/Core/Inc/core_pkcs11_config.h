@@ -30,6 +30,9 @@
 #include "main.h"
 #include "FreeRTOS.h"
 
+/* corePKCS11 sources log through the logging.h macros pulled in above */
+LOG_MODULE_DEFINE();
+
 //#define PKCS11_PAL_LITTLEFS    1
 
 #if (PKCS11_PAL_LITTLEFS + PKCS11_PAL_STSAFE != 1)
@@ -256,6 +256,12 @@
  */
 #define USE_SPI_CRC                   0U
 
+/* ############################################ Ethernet peripheral configuration ################################### */
+
+/* Several frames are queued to the Tx DMA at once, each takes one descriptor when contiguous */
+#define ETH_TX_DESC_CNT               8U
+#define ETH_RX_DESC_CNT               4U
+
 /* Includes ----------------------------------------------------------------------------------------------------------*/
 
 /**
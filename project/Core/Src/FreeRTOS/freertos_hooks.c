@@ -25,6 +25,8 @@
 
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
 void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint32_t *pulTimerTaskStackSize)
 {
   static StaticTask_t timerTaskTCB;
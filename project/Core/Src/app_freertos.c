@@ -75,6 +75,9 @@
 #if (DEMO_PING && !defined(ST67W6X_NCP))
 #include "ping.h"
 #endif
+
+LOG_MODULE_DEFINE();
+
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -179,8 +182,8 @@ uint32_t checkAndClearResetFlags(void)
   {
     LogInfo("Reset source: BOR or POR/PDR");
   }
-
-
+
+
 
   if(reset_flags & RCC_RESET_FLAG_SW)
   {
@@ -282,6 +285,8 @@ void StartDefaultTask(void *argument)
 
     KVStore_init();
 
+    vLoggingLoadLevels();
+
     pucMqttEndpoint = KVStore_getStringHeap( CS_CORE_MQTT_ENDPOINT, &uxMqttEndpointLen );
 
 #if DEMO_OTA
@@ -517,6 +522,10 @@ static int fs_init(void)
 
   if (err == 0)
   {
+#if !defined(LFS_USE_INTERNAL_NOR) && defined(HAL_OSPI_MODULE_ENABLED)
+    vLfsPortOspiEnableEraseAhead(&xLfsCtx);
+#endif
+
     /* Export the FS context */
     pxLfsCtx = &xLfsCtx;
   }
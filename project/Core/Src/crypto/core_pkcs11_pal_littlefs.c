@@ -59,6 +59,7 @@
 #include "lfs.h"
 #include "lfs_port.h"
 
+LOG_MODULE_DEFINE();
 
 /*-----------------------------------------------------------*/
 extern lfs_t* pxGetDefaultFsCtx(void);
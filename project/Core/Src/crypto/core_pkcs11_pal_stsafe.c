@@ -59,6 +59,9 @@
 
 #include "stsafe.h"
 #include <string.h>
+
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 /*-----------------------------------------------------------*/
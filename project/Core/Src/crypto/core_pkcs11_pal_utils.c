@@ -37,6 +37,8 @@
 /* corePKCS11 header include. */
 #include "core_pkcs11_pal_utils.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @ingroup pkcs11_macros
  * @brief Macros for managing PKCS #11 objects in flash.
@@ -0,0 +1,330 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_delta.c
+ * @brief Streaming decoder for delta OTA images.
+ *
+ * The decoder keeps no more than one output chunk in RAM. COPY operations read the
+ * base image in place, ADD operations consume the literal bytes as they are fed, so
+ * the target image is produced while the delta file is still being received.
+ */
+
+#include <string.h>
+
+#include "ota_delta.h"
+
+#define DELTA_OP_COPY           ( 0x80U )
+#define DELTA_OP_LENGTH_MASK    ( 0x7FU )
+#define DELTA_OP_LENGTH_EXT     ( 0x7FU )
+#define DELTA_OP_LENGTH_BIAS    ( 128UL )
+#define DELTA_VARINT_MAX_SHIFT  ( 28U )
+
+typedef enum
+{
+    DELTA_STATE_OP = 0,
+    DELTA_STATE_LENGTH,
+    DELTA_STATE_OFFSET,
+    DELTA_STATE_ADD,
+    DELTA_STATE_DONE
+} DeltaState_t;
+
+static inline uint32_t prvReadU32( const uint8_t * pucData )
+{
+    return ( ( uint32_t ) pucData[ 0 ] ) |
+           ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+static inline uint16_t prvReadU16( const uint8_t * pucData )
+{
+    return ( uint16_t ) ( ( uint16_t ) pucData[ 0 ] | ( ( uint16_t ) pucData[ 1 ] << 8 ) );
+}
+
+static OtaDeltaStatus_t prvFlush( OtaDeltaContext_t * pxCtx )
+{
+    OtaDeltaStatus_t xStatus = OtaDeltaSuccess;
+
+    if( pxCtx->ulOutFill > 0 )
+    {
+        uint32_t ulOffset = pxCtx->ulOutOffset - pxCtx->ulOutFill;
+
+        if( pxCtx->xWrite( pxCtx->pvWriteCtx, ulOffset, pxCtx->ucOut, pxCtx->ulOutFill ) != 0 )
+        {
+            xStatus = OtaDeltaErrWrite;
+        }
+
+        pxCtx->ulOutFill = 0;
+    }
+
+    return xStatus;
+}
+
+static OtaDeltaStatus_t prvEmit( OtaDeltaContext_t * pxCtx,
+                                 const uint8_t * pucData,
+                                 uint32_t ulLength )
+{
+    OtaDeltaStatus_t xStatus = OtaDeltaSuccess;
+
+    while( ( ulLength > 0 ) && ( xStatus == OtaDeltaSuccess ) )
+    {
+        uint32_t ulChunk = OTA_DELTA_OUT_BUFFER_SIZE - pxCtx->ulOutFill;
+
+        if( ulChunk > ulLength )
+        {
+            ulChunk = ulLength;
+        }
+
+        ( void ) memcpy( &pxCtx->ucOut[ pxCtx->ulOutFill ], pucData, ulChunk );
+
+        pxCtx->ulOutFill += ulChunk;
+        pxCtx->ulOutOffset += ulChunk;
+        pucData += ulChunk;
+        ulLength -= ulChunk;
+
+        if( pxCtx->ulOutFill == OTA_DELTA_OUT_BUFFER_SIZE )
+        {
+            xStatus = prvFlush( pxCtx );
+        }
+    }
+
+    return xStatus;
+}
+
+/* Accumulate one LEB128 byte. Returns 1 once the varint is complete. */
+static int32_t prvVarintStep( OtaDeltaContext_t * pxCtx,
+                              uint8_t ucByte )
+{
+    int32_t lComplete = 0;
+
+    if( ( pxCtx->ucVarintShift > DELTA_VARINT_MAX_SHIFT ) ||
+        ( ( pxCtx->ucVarintShift == DELTA_VARINT_MAX_SHIFT ) && ( ( ucByte & 0x70U ) != 0 ) ) )
+    {
+        pxCtx->xStatus = OtaDeltaErrFormat;
+    }
+    else
+    {
+        pxCtx->ulVarint |= ( ( uint32_t ) ( ucByte & 0x7FU ) ) << pxCtx->ucVarintShift;
+        pxCtx->ucVarintShift += 7U;
+
+        if( ( ucByte & 0x80U ) == 0 )
+        {
+            lComplete = 1;
+        }
+    }
+
+    return lComplete;
+}
+
+static void prvStartOp( OtaDeltaContext_t * pxCtx )
+{
+    if( ( pxCtx->ulOutOffset + pxCtx->ulOpLength ) > pxCtx->ulTargetSize )
+    {
+        pxCtx->xStatus = OtaDeltaErrRange;
+    }
+    else if( pxCtx->ucCopy != 0U )
+    {
+        pxCtx->ulVarint = 0;
+        pxCtx->ucVarintShift = 0;
+        pxCtx->ucState = DELTA_STATE_OFFSET;
+    }
+    else
+    {
+        pxCtx->ucState = DELTA_STATE_ADD;
+    }
+}
+
+static void prvEndOp( OtaDeltaContext_t * pxCtx )
+{
+    pxCtx->ucState = ( pxCtx->ulOutOffset == pxCtx->ulTargetSize ) ? DELTA_STATE_DONE : DELTA_STATE_OP;
+}
+
+static void prvCopy( OtaDeltaContext_t * pxCtx )
+{
+    /* Zigzag decode the distance from the previous copy */
+    int32_t lDistance = ( int32_t ) ( pxCtx->ulVarint >> 1 ) ^ -( int32_t ) ( pxCtx->ulVarint & 1U );
+    int64_t llStart = ( int64_t ) pxCtx->ulBaseCursor + lDistance;
+
+    if( ( llStart < 0 ) ||
+        ( ( llStart + pxCtx->ulOpLength ) > ( int64_t ) pxCtx->ulBaseSize ) )
+    {
+        pxCtx->xStatus = OtaDeltaErrRange;
+    }
+    else
+    {
+        pxCtx->xStatus = prvEmit( pxCtx, &pxCtx->pucBase[ llStart ], pxCtx->ulOpLength );
+        pxCtx->ulBaseCursor = ( uint32_t ) llStart + pxCtx->ulOpLength;
+        prvEndOp( pxCtx );
+    }
+}
+
+OtaDeltaStatus_t xOtaDeltaParseHeader( const uint8_t * pucData,
+                                       size_t uxLength,
+                                       OtaDeltaHeader_t * pxHeader )
+{
+    OtaDeltaStatus_t xStatus = OtaDeltaSuccess;
+
+    if( ( pucData == NULL ) || ( pxHeader == NULL ) || ( uxLength < OTA_DELTA_HEADER_SIZE ) )
+    {
+        xStatus = OtaDeltaErrHeader;
+    }
+    else if( ( prvReadU32( &pucData[ 0 ] ) != OTA_DELTA_MAGIC ) ||
+             ( prvReadU16( &pucData[ 4 ] ) != OTA_DELTA_FORMAT_VERSION ) ||
+             ( prvReadU16( &pucData[ 6 ] ) != OTA_DELTA_HEADER_SIZE ) )
+    {
+        xStatus = OtaDeltaErrHeader;
+    }
+    else
+    {
+        pxHeader->ulBaseVersion = prvReadU32( &pucData[ 8 ] );
+        pxHeader->ulBaseSize = prvReadU32( &pucData[ 12 ] );
+        pxHeader->ulTargetSize = prvReadU32( &pucData[ 16 ] );
+        ( void ) memcpy( pxHeader->ucBaseHash, &pucData[ 20 ], OTA_DELTA_HASH_SIZE );
+        ( void ) memcpy( pxHeader->ucTargetHash, &pucData[ 20 + OTA_DELTA_HASH_SIZE ], OTA_DELTA_HASH_SIZE );
+
+        if( pxHeader->ulTargetSize == 0 )
+        {
+            xStatus = OtaDeltaErrHeader;
+        }
+    }
+
+    return xStatus;
+}
+
+void vOtaDeltaInit( OtaDeltaContext_t * pxCtx,
+                    const OtaDeltaHeader_t * pxHeader,
+                    const uint8_t * pucBase,
+                    OtaDeltaWrite_t xWrite,
+                    void * pvWriteCtx )
+{
+    ( void ) memset( pxCtx, 0, sizeof( OtaDeltaContext_t ) );
+
+    pxCtx->pucBase = pucBase;
+    pxCtx->ulBaseSize = pxHeader->ulBaseSize;
+    pxCtx->ulTargetSize = pxHeader->ulTargetSize;
+    pxCtx->xWrite = xWrite;
+    pxCtx->pvWriteCtx = pvWriteCtx;
+    pxCtx->xStatus = OtaDeltaSuccess;
+    pxCtx->ucState = DELTA_STATE_OP;
+}
+
+OtaDeltaStatus_t xOtaDeltaApply( OtaDeltaContext_t * pxCtx,
+                                 const uint8_t * pucData,
+                                 size_t uxLength )
+{
+    while( ( uxLength > 0 ) && ( pxCtx->xStatus == OtaDeltaSuccess ) )
+    {
+        switch( pxCtx->ucState )
+        {
+            case DELTA_STATE_OP:
+            {
+                uint8_t ucOp = *pucData++;
+                uxLength--;
+
+                pxCtx->ucCopy = ucOp & DELTA_OP_COPY;
+
+                if( ( ucOp & DELTA_OP_LENGTH_MASK ) == DELTA_OP_LENGTH_EXT )
+                {
+                    pxCtx->ulVarint = 0;
+                    pxCtx->ucVarintShift = 0;
+                    pxCtx->ucState = DELTA_STATE_LENGTH;
+                }
+                else
+                {
+                    pxCtx->ulOpLength = ( uint32_t ) ( ucOp & DELTA_OP_LENGTH_MASK ) + 1UL;
+                    prvStartOp( pxCtx );
+                }
+            }
+            break;
+
+            case DELTA_STATE_LENGTH:
+
+                if( prvVarintStep( pxCtx, *pucData++ ) != 0 )
+                {
+                    pxCtx->ulOpLength = pxCtx->ulVarint + DELTA_OP_LENGTH_BIAS;
+
+                    if( pxCtx->ulOpLength < DELTA_OP_LENGTH_BIAS )
+                    {
+                        pxCtx->xStatus = OtaDeltaErrRange;
+                    }
+                    else
+                    {
+                        prvStartOp( pxCtx );
+                    }
+                }
+
+                uxLength--;
+                break;
+
+            case DELTA_STATE_OFFSET:
+
+                if( prvVarintStep( pxCtx, *pucData++ ) != 0 )
+                {
+                    prvCopy( pxCtx );
+                }
+
+                uxLength--;
+                break;
+
+            case DELTA_STATE_ADD:
+            {
+                uint32_t ulChunk = ( uxLength < pxCtx->ulOpLength ) ? ( uint32_t ) uxLength : pxCtx->ulOpLength;
+
+                pxCtx->xStatus = prvEmit( pxCtx, pucData, ulChunk );
+                pxCtx->ulOpLength -= ulChunk;
+                pucData += ulChunk;
+                uxLength -= ulChunk;
+
+                if( pxCtx->ulOpLength == 0 )
+                {
+                    prvEndOp( pxCtx );
+                }
+            }
+            break;
+
+            case DELTA_STATE_DONE:
+            default:
+                /* Data past the end of the target image */
+                pxCtx->xStatus = OtaDeltaErrFormat;
+                break;
+        }
+    }
+
+    return pxCtx->xStatus;
+}
+
+OtaDeltaStatus_t xOtaDeltaFinish( OtaDeltaContext_t * pxCtx )
+{
+    if( pxCtx->xStatus == OtaDeltaSuccess )
+    {
+        if( pxCtx->ucState != DELTA_STATE_DONE )
+        {
+            pxCtx->xStatus = OtaDeltaErrIncomplete;
+        }
+        else
+        {
+            pxCtx->xStatus = prvFlush( pxCtx );
+        }
+    }
+
+    return pxCtx->xStatus;
+}
@@ -0,0 +1,145 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file  ota_delta.h
+ * @brief Streaming decoder for delta OTA images produced by tools/host-ota/hota_delta.py.
+ *
+ * A delta file is a fixed header followed by a stream of operations that rebuild the
+ * target image from the running (base) image:
+ *
+ *   COPY: op byte 1LLLLLLL [length varint] offset varint
+ *         Copy length bytes from the base image. The offset is the zigzag encoded
+ *         distance from the end of the previous COPY.
+ *   ADD:  op byte 0LLLLLLL [length varint] literal bytes
+ *         Append length literal bytes.
+ *
+ * L is the length minus one when below 0x7F. Otherwise L is 0x7F and a LEB128
+ * varint holding ( length - 128 ) follows the op byte.
+ *
+ * The header is little endian:
+ *   0  magic "ODLT"          4  format version (u16)   6  header size (u16)
+ *   8  base version (u32)   12  base size (u32)       16  target size (u32)
+ *  20  SHA-256 of the base image (the ulBaseSize bytes at the running image address)
+ *  52  SHA-256 of the target image
+ */
+
+#ifndef OTA_DELTA_H_
+#define OTA_DELTA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_DELTA_FILE_SUFFIX       ".delta"
+
+#define OTA_DELTA_MAGIC             ( 0x544C444FUL ) /* "ODLT" */
+#define OTA_DELTA_FORMAT_VERSION    ( 1U )
+#define OTA_DELTA_HEADER_SIZE       ( 84UL )
+#define OTA_DELTA_HASH_SIZE         ( 32UL )
+
+/* Output is handed to the write callback in chunks of this size, only the last
+ * chunk of the image may be shorter. Keep it a multiple of the 16 byte flash
+ * programming unit. */
+#ifndef OTA_DELTA_OUT_BUFFER_SIZE
+#define OTA_DELTA_OUT_BUFFER_SIZE   ( 512UL )
+#endif
+
+typedef enum
+{
+    OtaDeltaSuccess = 0,
+    OtaDeltaErrHeader,     /* Bad magic, format version or sizes. */
+    OtaDeltaErrFormat,     /* Malformed operation stream or trailing data. */
+    OtaDeltaErrRange,      /* Operation outside of the base or target image. */
+    OtaDeltaErrWrite,      /* The write callback failed. */
+    OtaDeltaErrIncomplete  /* The stream ended before the target image was complete. */
+} OtaDeltaStatus_t;
+
+typedef struct
+{
+    uint32_t ulBaseVersion;
+    uint32_t ulBaseSize;
+    uint32_t ulTargetSize;
+    uint8_t ucBaseHash[ OTA_DELTA_HASH_SIZE ];
+    uint8_t ucTargetHash[ OTA_DELTA_HASH_SIZE ];
+} OtaDeltaHeader_t;
+
+/**
+ * @brief Write ulLength bytes of the target image at ulOffset.
+ *
+ * ulOffset is always a multiple of OTA_DELTA_OUT_BUFFER_SIZE.
+ *
+ * @return 0 on success.
+ */
+typedef int32_t ( * OtaDeltaWrite_t )( void * pvWriteCtx,
+                                       uint32_t ulOffset,
+                                       const uint8_t * pucData,
+                                       uint32_t ulLength );
+
+typedef struct
+{
+    const uint8_t * pucBase;
+    uint32_t ulBaseSize;
+    uint32_t ulTargetSize;
+    OtaDeltaWrite_t xWrite;
+    void * pvWriteCtx;
+    OtaDeltaStatus_t xStatus;
+    uint32_t ulBaseCursor;
+    uint32_t ulOutOffset;
+    uint32_t ulOutFill;
+    uint32_t ulOpLength;
+    uint32_t ulVarint;
+    uint8_t ucVarintShift;
+    uint8_t ucState;
+    uint8_t ucCopy;
+    uint8_t ucOut[ OTA_DELTA_OUT_BUFFER_SIZE ];
+} OtaDeltaContext_t;
+
+/**
+ * @brief Decode and sanity check the OTA_DELTA_HEADER_SIZE bytes header at pucData.
+ */
+OtaDeltaStatus_t xOtaDeltaParseHeader( const uint8_t * pucData,
+                                       size_t uxLength,
+                                       OtaDeltaHeader_t * pxHeader );
+
+/**
+ * @brief Start rebuilding the target image described by pxHeader from the base
+ * image mapped at pucBase.
+ */
+void vOtaDeltaInit( OtaDeltaContext_t * pxCtx,
+                    const OtaDeltaHeader_t * pxHeader,
+                    const uint8_t * pucBase,
+                    OtaDeltaWrite_t xWrite,
+                    void * pvWriteCtx );
+
+/**
+ * @brief Feed the next uxLength bytes of the operation stream (the delta file
+ * without its header). Data may be split at any byte boundary.
+ */
+OtaDeltaStatus_t xOtaDeltaApply( OtaDeltaContext_t * pxCtx,
+                                 const uint8_t * pucData,
+                                 size_t uxLength );
+
+/**
+ * @brief Flush the tail of the target image once the whole stream was fed.
+ */
+OtaDeltaStatus_t xOtaDeltaFinish( OtaDeltaContext_t * pxCtx );
+
+#endif /* OTA_DELTA_H_ */
@@ -0,0 +1,280 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file ota_lzss.c
+ * @brief Streaming decoder for LZSS compressed OTA images.
+ */
+
+#include <string.h>
+
+#include "ota_lzss.h"
+
+typedef enum
+{
+    LZSS_STATE_TAG = 0,
+    LZSS_STATE_LITERAL,
+    LZSS_STATE_DISTANCE,
+    LZSS_STATE_LENGTH,
+    LZSS_STATE_DONE
+} LzssState_t;
+
+static inline uint32_t prvReadU32( const uint8_t * pucData )
+{
+    return ( ( uint32_t ) pucData[ 0 ] ) |
+           ( ( uint32_t ) pucData[ 1 ] << 8 ) |
+           ( ( uint32_t ) pucData[ 2 ] << 16 ) |
+           ( ( uint32_t ) pucData[ 3 ] << 24 );
+}
+
+static inline uint16_t prvReadU16( const uint8_t * pucData )
+{
+    return ( uint16_t ) ( ( uint16_t ) pucData[ 0 ] | ( ( uint16_t ) pucData[ 1 ] << 8 ) );
+}
+
+static void prvFlush( OtaLzssContext_t * pxCtx )
+{
+    if( pxCtx->ulOutFill > 0 )
+    {
+        uint32_t ulOffset = pxCtx->ulOutOffset - pxCtx->ulOutFill;
+
+        if( pxCtx->xWrite( pxCtx->pvWriteCtx, ulOffset, pxCtx->ucOut, pxCtx->ulOutFill ) != 0 )
+        {
+            pxCtx->xStatus = OtaLzssErrWrite;
+        }
+
+        pxCtx->ulOutFill = 0;
+    }
+}
+
+static inline void prvEmit( OtaLzssContext_t * pxCtx,
+                            uint8_t ucByte )
+{
+    if( pxCtx->ulOutOffset < OTA_LZSS_HEAD_SIZE )
+    {
+        pxCtx->ucHead[ pxCtx->ulOutOffset ] = ucByte;
+    }
+
+    pxCtx->ucOut[ pxCtx->ulOutFill++ ] = ucByte;
+    pxCtx->ulOutOffset++;
+
+    if( pxCtx->ulOutFill == OTA_LZSS_OUT_BUFFER_SIZE )
+    {
+        prvFlush( pxCtx );
+    }
+}
+
+static void prvCopyMatch( OtaLzssContext_t * pxCtx,
+                          uint32_t ulLength )
+{
+    uint32_t ulDistance = pxCtx->ulDistance;
+
+    if( ( ulDistance > pxCtx->ulOutOffset ) ||
+        ( ( pxCtx->ulOutOffset + ulLength ) > pxCtx->ulTargetSize ) )
+    {
+        pxCtx->xStatus = OtaLzssErrRange;
+    }
+    else
+    {
+        while( ( ulLength > 0 ) && ( pxCtx->xStatus == OtaLzssSuccess ) )
+        {
+            uint32_t ulSource = pxCtx->ulOutOffset - ulDistance;
+            uint32_t ulBuffered = pxCtx->ulOutOffset - pxCtx->ulOutFill;
+            uint8_t ucByte;
+
+            /* History older than the current chunk was already written out */
+            if( ulSource >= ulBuffered )
+            {
+                ucByte = pxCtx->ucOut[ ulSource - ulBuffered ];
+            }
+            else if( ulSource < OTA_LZSS_HEAD_SIZE )
+            {
+                ucByte = pxCtx->ucHead[ ulSource ];
+            }
+            else
+            {
+                ucByte = pxCtx->pucHistory[ ulSource ];
+            }
+
+            prvEmit( pxCtx, ucByte );
+            ulLength--;
+        }
+    }
+}
+
+OtaLzssStatus_t xOtaLzssParseHeader( const uint8_t * pucData,
+                                     size_t uxLength,
+                                     OtaLzssHeader_t * pxHeader )
+{
+    OtaLzssStatus_t xStatus = OtaLzssSuccess;
+
+    if( ( pucData == NULL ) || ( pxHeader == NULL ) || ( uxLength < OTA_LZSS_HEADER_SIZE ) )
+    {
+        xStatus = OtaLzssErrHeader;
+    }
+    else if( ( prvReadU32( &pucData[ 0 ] ) != OTA_LZSS_MAGIC ) ||
+             ( prvReadU16( &pucData[ 4 ] ) != OTA_LZSS_FORMAT_VERSION ) ||
+             ( prvReadU16( &pucData[ 6 ] ) != OTA_LZSS_HEADER_SIZE ) )
+    {
+        xStatus = OtaLzssErrHeader;
+    }
+    else
+    {
+        pxHeader->ucWindowBits = pucData[ 8 ];
+        pxHeader->ucLengthBits = pucData[ 9 ];
+        pxHeader->ulTargetSize = prvReadU32( &pucData[ 12 ] );
+
+        if( ( pxHeader->ucWindowBits == 0U ) || ( pxHeader->ucWindowBits > OTA_LZSS_MAX_WINDOW_BITS ) ||
+            ( pxHeader->ucLengthBits == 0U ) || ( pxHeader->ucLengthBits > OTA_LZSS_MAX_LENGTH_BITS ) ||
+            ( pxHeader->ulTargetSize == 0UL ) )
+        {
+            xStatus = OtaLzssErrHeader;
+        }
+    }
+
+    return xStatus;
+}
+
+void vOtaLzssInit( OtaLzssContext_t * pxCtx,
+                   const OtaLzssHeader_t * pxHeader,
+                   const uint8_t * pucHistory,
+                   OtaLzssWrite_t xWrite,
+                   void * pvWriteCtx )
+{
+    ( void ) memset( pxCtx, 0, sizeof( OtaLzssContext_t ) );
+
+    pxCtx->pucHistory = pucHistory;
+    pxCtx->ulTargetSize = pxHeader->ulTargetSize;
+    pxCtx->ucWindowBits = pxHeader->ucWindowBits;
+    pxCtx->ucLengthBits = pxHeader->ucLengthBits;
+    pxCtx->xWrite = xWrite;
+    pxCtx->pvWriteCtx = pvWriteCtx;
+    pxCtx->xStatus = OtaLzssSuccess;
+    pxCtx->ucState = LZSS_STATE_TAG;
+}
+
+OtaLzssStatus_t xOtaLzssApply( OtaLzssContext_t * pxCtx,
+                               const uint8_t * pucData,
+                               size_t uxLength )
+{
+    while( pxCtx->xStatus == OtaLzssSuccess )
+    {
+        uint8_t ucNeeded;
+        uint32_t ulValue;
+
+        switch( pxCtx->ucState )
+        {
+            case LZSS_STATE_TAG:
+                ucNeeded = 1U;
+                break;
+
+            case LZSS_STATE_LITERAL:
+                ucNeeded = 8U;
+                break;
+
+            case LZSS_STATE_DISTANCE:
+                ucNeeded = pxCtx->ucWindowBits;
+                break;
+
+            case LZSS_STATE_LENGTH:
+                ucNeeded = pxCtx->ucLengthBits;
+                break;
+
+            case LZSS_STATE_DONE:
+            default:
+                ucNeeded = 0U;
+                break;
+        }
+
+        if( ucNeeded == 0U )
+        {
+            /* Whole bytes past the end of the image */
+            if( uxLength > 0 )
+            {
+                pxCtx->xStatus = OtaLzssErrFormat;
+            }
+
+            break;
+        }
+
+        while( ( pxCtx->ucBitCount < ucNeeded ) && ( uxLength > 0 ) )
+        {
+            pxCtx->ulBits = ( pxCtx->ulBits << 8 ) | *pucData++;
+            pxCtx->ucBitCount += 8U;
+            uxLength--;
+        }
+
+        if( pxCtx->ucBitCount < ucNeeded )
+        {
+            break;
+        }
+
+        pxCtx->ucBitCount -= ucNeeded;
+        ulValue = ( pxCtx->ulBits >> pxCtx->ucBitCount ) & ( ( 1UL << ucNeeded ) - 1UL );
+
+        switch( pxCtx->ucState )
+        {
+            case LZSS_STATE_TAG:
+                pxCtx->ucState = ( ulValue != 0UL ) ? LZSS_STATE_LITERAL : LZSS_STATE_DISTANCE;
+                break;
+
+            case LZSS_STATE_LITERAL:
+                prvEmit( pxCtx, ( uint8_t ) ulValue );
+                pxCtx->ucState = LZSS_STATE_TAG;
+                break;
+
+            case LZSS_STATE_DISTANCE:
+                pxCtx->ulDistance = ulValue + 1UL;
+                pxCtx->ucState = LZSS_STATE_LENGTH;
+                break;
+
+            case LZSS_STATE_LENGTH:
+            default:
+                prvCopyMatch( pxCtx, ulValue + OTA_LZSS_MIN_MATCH );
+                pxCtx->ucState = LZSS_STATE_TAG;
+                break;
+        }
+
+        if( pxCtx->ulOutOffset == pxCtx->ulTargetSize )
+        {
+            pxCtx->ucState = LZSS_STATE_DONE;
+        }
+    }
+
+    return pxCtx->xStatus;
+}
+
+OtaLzssStatus_t xOtaLzssFinish( OtaLzssContext_t * pxCtx )
+{
+    if( pxCtx->xStatus == OtaLzssSuccess )
+    {
+        if( pxCtx->ucState != LZSS_STATE_DONE )
+        {
+            pxCtx->xStatus = OtaLzssErrIncomplete;
+        }
+        else
+        {
+            prvFlush( pxCtx );
+        }
+    }
+
+    return pxCtx->xStatus;
+}
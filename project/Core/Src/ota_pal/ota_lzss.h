@@ -0,0 +1,146 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file  ota_lzss.h
+ * @brief Streaming decoder for LZSS compressed OTA images produced by
+ * tools/host-ota/hota_compress.py.
+ *
+ * The header is little endian:
+ *   0  magic "OLZS"          4  format version (u16)   6  header size (u16)
+ *   8  window bits (u8)      9  length bits (u8)      10  reserved (u16)
+ *  12  image size (u32)
+ *
+ * It is followed by an MSB first bit stream of
+ *   1 <8 bit literal>
+ *   0 <window bits: distance - 1> <length bits: length - OTA_LZSS_MIN_MATCH>
+ *
+ * Matches refer back into the image already produced. The decoder only buffers the
+ * current output chunk and reads older history back from where the image was
+ * written, so its RAM use does not depend on the window size. The first
+ * OTA_LZSS_HEAD_SIZE bytes are kept in RAM as well: the OTA PAL only programs the
+ * start of the image once it is verified.
+ */
+
+#ifndef OTA_LZSS_H_
+#define OTA_LZSS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define OTA_LZSS_FILE_SUFFIX        ".lzss"
+
+#define OTA_LZSS_MAGIC              ( 0x535A4C4FUL ) /* "OLZS" */
+#define OTA_LZSS_FORMAT_VERSION     ( 1U )
+#define OTA_LZSS_HEADER_SIZE        ( 16UL )
+#define OTA_LZSS_MAX_WINDOW_BITS    ( 16U )
+#define OTA_LZSS_MAX_LENGTH_BITS    ( 8U )
+#define OTA_LZSS_MIN_MATCH          ( 3UL )
+#define OTA_LZSS_HEAD_SIZE          ( 16UL )
+
+/* Output is handed to the write callback in chunks of this size, only the last
+ * chunk of the image may be shorter. Keep it a multiple of the 16 byte flash
+ * programming unit. */
+#ifndef OTA_LZSS_OUT_BUFFER_SIZE
+#define OTA_LZSS_OUT_BUFFER_SIZE    ( 512UL )
+#endif
+
+typedef enum
+{
+    OtaLzssSuccess = 0,
+    OtaLzssErrHeader,     /* Bad magic, format version or parameters. */
+    OtaLzssErrFormat,     /* Trailing data after the end of the image. */
+    OtaLzssErrRange,      /* Match before the start or past the end of the image. */
+    OtaLzssErrWrite,      /* The write callback failed. */
+    OtaLzssErrIncomplete  /* The stream ended before the image was complete. */
+} OtaLzssStatus_t;
+
+typedef struct
+{
+    uint8_t ucWindowBits;
+    uint8_t ucLengthBits;
+    uint32_t ulTargetSize;
+} OtaLzssHeader_t;
+
+/**
+ * @brief Write ulLength bytes of the image at ulOffset.
+ *
+ * ulOffset is always a multiple of OTA_LZSS_OUT_BUFFER_SIZE.
+ *
+ * @return 0 on success.
+ */
+typedef int32_t ( * OtaLzssWrite_t )( void * pvWriteCtx,
+                                      uint32_t ulOffset,
+                                      const uint8_t * pucData,
+                                      uint32_t ulLength );
+
+typedef struct
+{
+    const uint8_t * pucHistory;
+    uint32_t ulTargetSize;
+    OtaLzssWrite_t xWrite;
+    void * pvWriteCtx;
+    OtaLzssStatus_t xStatus;
+    uint32_t ulOutOffset;
+    uint32_t ulOutFill;
+    uint32_t ulBits;
+    uint32_t ulDistance;
+    uint8_t ucBitCount;
+    uint8_t ucWindowBits;
+    uint8_t ucLengthBits;
+    uint8_t ucState;
+    uint8_t ucHead[ OTA_LZSS_HEAD_SIZE ];
+    uint8_t ucOut[ OTA_LZSS_OUT_BUFFER_SIZE ];
+} OtaLzssContext_t;
+
+/**
+ * @brief Decode and sanity check the OTA_LZSS_HEADER_SIZE bytes header at pucData.
+ */
+OtaLzssStatus_t xOtaLzssParseHeader( const uint8_t * pucData,
+                                     size_t uxLength,
+                                     OtaLzssHeader_t * pxHeader );
+
+/**
+ * @brief Start decoding the image described by pxHeader.
+ *
+ * pucHistory maps the destination of the write callback, matches further back than
+ * the current output chunk are read from there.
+ */
+void vOtaLzssInit( OtaLzssContext_t * pxCtx,
+                   const OtaLzssHeader_t * pxHeader,
+                   const uint8_t * pucHistory,
+                   OtaLzssWrite_t xWrite,
+                   void * pvWriteCtx );
+
+/**
+ * @brief Feed the next uxLength bytes of the bit stream (the file without its
+ * header). Data may be split at any byte boundary.
+ */
+OtaLzssStatus_t xOtaLzssApply( OtaLzssContext_t * pxCtx,
+                               const uint8_t * pucData,
+                               size_t uxLength );
+
+/**
+ * @brief Flush the tail of the image once the whole stream was fed.
+ */
+OtaLzssStatus_t xOtaLzssFinish( OtaLzssContext_t * pxCtx );
+
+#endif /* OTA_LZSS_H_ */
@@ -55,6 +55,10 @@
 #include "PkiObject.h"
 
 #include "ota_appversion32.h"
+#include "ota_delta.h"
+#include "ota_lzss.h"
+
+LOG_MODULE_DEFINE();
 
 #if DEMO_HOME_ASSISTANT
 #define OTA_UPDATE_AVAILABLE     (1 << 0)  // New OTA pending
@@ -65,12 +69,31 @@ extern AppVersion32_t newAppFirmwareVersion;
 #endif
 
 #define FLASH_START_INACTIVE_BANK        ( ( uint32_t ) ( FLASH_BASE + FLASH_BANK_SIZE ) )
+#define FLASH_START_ACTIVE_IMAGE         ( ( uint32_t ) SCB->VTOR )
 #define NUM_QUAD_WORDS( length )         ( length >> 4UL )
 #define NUM_REMAINING_BYTES( length )    ( length & 0x0F )
 #define OTA_IMAGE_MAX_SIZE               ( RESERVED_OTA_SECTORS * FLASH_SECTOR_SIZE )
 #define OTA_IMAGE_MIN_SIZE               ( 16 )
 
+/* Delta and compressed files are staged in whole sectors at the top of the OTA area */
+#define OTA_STAGING_SIZE( length )       ( ( ( length ) + FLASH_SECTOR_SIZE - 1UL ) & ~( FLASH_SECTOR_SIZE - 1UL ) )
+
+/* The bootloader installs the OTA area as soon as its first word is programmed, so
+ * the first quad-word of the image is held back until the image is verified. */
+#define OTA_IMAGE_HEAD_SIZE              ( 16UL )
+
+/* Received blocks, persisted to resume a download after a reboot */
+#define OTA_RX_BITMAP_SIZE               ( ( ( OTA_IMAGE_MAX_SIZE / OTA_FILE_BLOCK_SIZE ) + 7UL ) / 8UL )
+#define OTA_RX_BLOCKS_PER_SECTOR         ( FLASH_SECTOR_SIZE / OTA_FILE_BLOCK_SIZE )
+#define OTA_RX_STATE_MAGIC               ( 0x5352544FUL ) /* "OTRS" */
+#define OTA_RX_FILE_ID_SIZE              ( 32UL )
+
+#ifndef otapalconfigRESUME_SAVE_PERIOD_MS
+#define otapalconfigRESUME_SAVE_PERIOD_MS    ( 5000U )
+#endif
+
 #define IMAGE_CONTEXT_FILE_NAME    "/ota/image_state"
+#define RX_STATE_FILE_NAME         "/ota/rx_state"
 
 typedef enum
 {
@@ -102,6 +125,14 @@ static const char * ppcPalStateString[] =
     "Invalid"
 };
 
+typedef enum
+{
+    OTA_PAL_IMAGE_RAW = 0,
+    OTA_PAL_IMAGE_DELTA,
+    OTA_PAL_IMAGE_LZSS,
+    OTA_PAL_IMAGE_INVALID
+} OtaPalImageFormat_t;
+
 typedef struct
 {
     OtaPalState_t xPalState;
@@ -116,9 +147,40 @@ typedef struct
 #endif
     uint32_t ulBaseAddress;
     uint32_t ulImageSize;
+    uint32_t ulFileSize;
+    OtaPalImageFormat_t xImageFormat;
     OtaPalState_t xPalState;
 } OtaPalContext_t;
 
+typedef struct
+{
+    union
+    {
+        OtaDeltaContext_t xDelta;
+        OtaLzssContext_t xLzss;
+    } xDecoder;
+    union
+    {
+        OtaDeltaHeader_t xDelta;
+        OtaLzssHeader_t xLzss;
+    } xHeader;
+    BaseType_t xStarted;
+    BaseType_t xFailed;
+    uint32_t ulFileAddress;
+    uint32_t ulContiguous;
+    uint32_t ulFed;
+} OtaPalStagingContext_t;
+
+typedef struct
+{
+    uint32_t ulMagic;
+    uint32_t ulFileSize;
+    uint32_t ulImageFormat;
+    uint8_t ucFileId[ OTA_RX_FILE_ID_SIZE ];
+    uint8_t ucImageHead[ OTA_IMAGE_HEAD_SIZE ];
+    uint8_t ucBlockBitmap[ OTA_RX_BITMAP_SIZE ];
+} OtaPalRxState_t;
+
 const char OTA_JsonFileSignatureKey[] = "sig-sha256-ecdsa";
 
 static OtaPalContext_t xPalContext =
@@ -130,8 +192,16 @@ static OtaPalContext_t xPalContext =
 #endif
     .ulBaseAddress = 0,
     .ulImageSize   = 0,
+    .ulFileSize    = 0,
+    .xImageFormat  = OTA_PAL_IMAGE_RAW,
 };
 
+static OtaPalStagingContext_t xStagingContext;
+
+static OtaPalRxState_t xRxState;
+static TickType_t xRxStateSavedAt = 0;
+static BaseType_t xRxStateDirty = pdFALSE;
+
 static uint32_t ulBankAtBootup = 0;
 
 /* Static function forward declarations */
@@ -159,6 +229,35 @@ static HAL_StatusTypeDef prvWriteToFlash( uint32_t destination,
 
 static BaseType_t prvEraseBank( uint32_t bankNumber );
 
+static BaseType_t prvEraseSectors( uint32_t ulBank,
+                                   uint32_t ulFirstSector,
+                                   uint32_t ulNbSectors );
+
+/* Delta and compressed images */
+static OtaPalImageFormat_t prvGetImageFormat( const OtaFileContext_t * pxFileContext );
+static void prvStagedOpen( OtaPalContext_t * pxContext );
+static BaseType_t prvStagedWriteBlock( OtaPalContext_t * pxContext,
+                                       uint32_t ulOffset,
+                                       uint8_t * pucData,
+                                       uint32_t ulLength );
+static OtaPalStatus_t prvStagedFinish( OtaPalContext_t * pxContext );
+static void prvStagedRelease( OtaPalContext_t * pxContext );
+
+/* Image head and resumable downloads */
+static HAL_StatusTypeDef prvWriteImage( OtaPalContext_t * pxContext,
+                                        uint32_t ulOffset,
+                                        uint8_t * pucData,
+                                        uint32_t ulLength );
+static BaseType_t prvCalculateOtaImageHash( const OtaPalContext_t * pxContext,
+                                            unsigned char * pucHashBuffer,
+                                            size_t uxHashBufferLength,
+                                            size_t * puxHashLength );
+static BaseType_t prvRxStateResume( OtaPalContext_t * pxContext,
+                                    OtaFileContext_t * pxFileContext );
+static void prvRxStateMark( uint32_t ulOffset );
+static void prvRxStateUpdate( void );
+static void prvRxStateDelete( void );
+
 /* Verify signature */
 static OtaPalStatus_t prvValidateSignature( const char * pcPubKeyLabel,
                                             const unsigned char * pucSignature,
@@ -287,6 +386,8 @@ static BaseType_t prvInitializePalContext( OtaPalContext_t * pxContext )
 #endif
         pxContext->ulBaseAddress = 0;
         pxContext->ulImageSize = 0;
+        pxContext->ulFileSize = 0;
+        pxContext->xImageFormat = OTA_PAL_IMAGE_RAW;
 
         /* Open the file */
         xLfsErr = lfs_file_open( pxLfsCtx, &xFile, IMAGE_CONTEXT_FILE_NAME, LFS_O_RDONLY );
@@ -768,7 +869,8 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
 
         if( HAL_FLASHEx_Erase( &pEraseInit, &pageError ) != HAL_OK )
         {
-            LogError( "Failed to erase the flash bank, errorCode = %u, pageError = %u.", HAL_FLASH_GetError(), pageError );
+            LogError( "Failed to erase the flash bank, errorCode = %lu, pageError = %lu.",
+                      ( unsigned long ) HAL_FLASH_GetError(), ( unsigned long ) pageError );
             xResult = pdFALSE;
         }
 
@@ -776,7 +878,7 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
     }
     else
     {
-        LogError( "Failed to lock flash for erase, errorCode = %u.", HAL_FLASH_GetError() );
+        LogError( "Failed to unlock flash for erase, errorCode = %lu.", ( unsigned long ) HAL_FLASH_GetError() );
         xResult = pdFALSE;
     }
 
@@ -812,7 +914,8 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
 
             if( HAL_FLASHEx_Erase( &pEraseInit, &pageError ) != HAL_OK )
             {
-                LogError( "Failed to erase the flash bank, errorCode = %u, pageError = %u.", HAL_FLASH_GetError(), pageError );
+                LogError( "Failed to erase the flash bank, errorCode = %lu, pageError = %lu.",
+                          ( unsigned long ) HAL_FLASH_GetError(), ( unsigned long ) pageError );
                 xResult = pdFALSE;
             }
 
@@ -820,7 +923,7 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
         }
         else
         {
-            LogError( "Failed to lock flash for erase, errorCode = %u.", HAL_FLASH_GetError() );
+            LogError( "Failed to unlock flash for erase, errorCode = %lu.", ( unsigned long ) HAL_FLASH_GetError() );
             xResult = pdFALSE;
         }
 
@@ -837,6 +940,66 @@ static BaseType_t prvEraseBank( uint32_t bankNumber )
 #endif
 }
 
+static BaseType_t prvEraseSectors( uint32_t ulBank,
+                                   uint32_t ulFirstSector,
+                                   uint32_t ulNbSectors )
+{
+    BaseType_t xResult = pdTRUE;
+
+#if defined(HAL_ICACHE_MODULE_ENABLED)
+    HAL_ICACHE_Disable();
+#endif
+
+#if defined(__STM32H5xx_HAL_H) || defined(STM32L5xx_HAL_H)
+    uint32_t saved_flash_latency = __HAL_FLASH_GET_LATENCY();
+    __HAL_FLASH_SET_LATENCY(__HAL_FLASH_GET_LATENCY() + 2);
+    (void)__HAL_FLASH_GET_LATENCY();
+#endif
+
+    if( HAL_FLASH_Unlock() == HAL_OK )
+    {
+        uint32_t pageError = 0U;
+        FLASH_EraseInitTypeDef pEraseInit;
+#if defined(STM32H5)
+        pEraseInit.TypeErase = FLASH_TYPEERASE_SECTORS;
+        pEraseInit.Banks     = ulBank;
+        pEraseInit.NbSectors = ulNbSectors;
+        pEraseInit.Sector    = ulFirstSector;
+#else
+        pEraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+        pEraseInit.Banks     = ulBank;
+        pEraseInit.NbPages   = ulNbSectors;
+        pEraseInit.Page      = ulFirstSector;
+#endif
+
+        if( HAL_FLASHEx_Erase( &pEraseInit, &pageError ) != HAL_OK )
+        {
+            LogError( "Failed to erase sectors %lu to %lu, errorCode = %lu, pageError = %lu.",
+                      ( unsigned long ) ulFirstSector, ( unsigned long ) ( ulFirstSector + ulNbSectors - 1UL ),
+                      ( unsigned long ) HAL_FLASH_GetError(), ( unsigned long ) pageError );
+            xResult = pdFALSE;
+        }
+
+        ( void ) HAL_FLASH_Lock();
+    }
+    else
+    {
+        LogError( "Failed to unlock flash for erase, errorCode = %lu.", ( unsigned long ) HAL_FLASH_GetError() );
+        xResult = pdFALSE;
+    }
+
+#if defined(__STM32H5xx_HAL_H) || defined(STM32L5xx_HAL_H)
+    __HAL_FLASH_SET_LATENCY(saved_flash_latency);
+    (void)__HAL_FLASH_GET_LATENCY();
+#endif
+
+#if defined(HAL_ICACHE_MODULE_ENABLED)
+    HAL_ICACHE_Enable();
+#endif
+
+    return xResult;
+}
+
 static BaseType_t xCalculateImageHash( const unsigned char * pucImageAddress,
                                        const size_t uxImageLength,
                                        unsigned char * pucHashBuffer,
@@ -1024,10 +1187,684 @@ void waitForOtaStart(void)
 }
 #endif
 
+static OtaPalImageFormat_t prvGetImageFormat( const OtaFileContext_t * pxFileContext )
+{
+    OtaPalImageFormat_t xFormat = OTA_PAL_IMAGE_INVALID;
+    const char * pcFilePath = ( const char * ) pxFileContext->pFilePath;
+
+#if DEMO_HOME_ASSISTANT
+    if( strstr( pcFilePath, OTA_FILE_NAME OTA_DELTA_FILE_SUFFIX ) != NULL )
+    {
+        xFormat = OTA_PAL_IMAGE_DELTA;
+    }
+    else if( strstr( pcFilePath, OTA_FILE_NAME OTA_LZSS_FILE_SUFFIX ) != NULL )
+    {
+        xFormat = OTA_PAL_IMAGE_LZSS;
+    }
+    else if( strstr( pcFilePath, OTA_FILE_NAME ) != NULL )
+    {
+        xFormat = OTA_PAL_IMAGE_RAW;
+    }
+#else
+    if( strncmp( OTA_FILE_NAME, pcFilePath, pxFileContext->filePathMaxSize ) == 0 )
+    {
+        xFormat = OTA_PAL_IMAGE_RAW;
+    }
+    else if( strncmp( OTA_FILE_NAME OTA_DELTA_FILE_SUFFIX, pcFilePath, pxFileContext->filePathMaxSize ) == 0 )
+    {
+        xFormat = OTA_PAL_IMAGE_DELTA;
+    }
+    else if( strncmp( OTA_FILE_NAME OTA_LZSS_FILE_SUFFIX, pcFilePath, pxFileContext->filePathMaxSize ) == 0 )
+    {
+        xFormat = OTA_PAL_IMAGE_LZSS;
+    }
+#endif
+
+    return xFormat;
+}
+
+/*
+ * Image head and resumable downloads.
+ *
+ * The blocks written to flash are recorded in xRxState, which is saved to
+ * RX_STATE_FILE_NAME at most every otapalconfigRESUME_SAVE_PERIOD_MS. When the same
+ * file of the same job is opened again after a reboot, the sectors holding only
+ * recorded blocks are kept and the OTA library is told not to request those blocks.
+ * Every other sector of the OTA area is erased, as it may hold blocks written after
+ * the last save. Recorded blocks were checked by prvWriteToFlash when written, and
+ * the signature check on close covers the whole image.
+ */
+static uint32_t prvGetFileAddress( const OtaPalContext_t * pxContext )
+{
+    uint32_t ulFileAddress = pxContext->ulBaseAddress;
+
+    if( pxContext->xImageFormat != OTA_PAL_IMAGE_RAW )
+    {
+        ulFileAddress += OTA_IMAGE_MAX_SIZE - OTA_STAGING_SIZE( pxContext->ulFileSize );
+    }
+
+    return ulFileAddress;
+}
+
+static BaseType_t prvEraseOtaSectors( const OtaPalContext_t * pxContext,
+                                      uint32_t ulFirstSector,
+                                      uint32_t ulNbSectors )
+{
+#if !defined(LFS_USE_INTERNAL_NOR)
+    return prvEraseSectors( pxContext->ulTargetBank, ulFirstSector, ulNbSectors );
+#else
+    ( void ) pxContext;
+
+    return prvEraseSectors( FLASH_BANK_2, ulFirstSector, ulNbSectors );
+#endif
+}
+
+static HAL_StatusTypeDef prvWriteImage( OtaPalContext_t * pxContext,
+                                        uint32_t ulOffset,
+                                        uint8_t * pucData,
+                                        uint32_t ulLength )
+{
+    HAL_StatusTypeDef xStatus = HAL_OK;
+
+    if( ulOffset < OTA_IMAGE_HEAD_SIZE )
+    {
+        uint32_t ulHeadLength = OTA_IMAGE_HEAD_SIZE - ulOffset;
+
+        if( ulHeadLength > ulLength )
+        {
+            ulHeadLength = ulLength;
+        }
+
+        ( void ) memcpy( &xRxState.ucImageHead[ ulOffset ], pucData, ulHeadLength );
+
+        ulOffset += ulHeadLength;
+        pucData += ulHeadLength;
+        ulLength -= ulHeadLength;
+    }
+
+    if( ulLength > 0 )
+    {
+        xStatus = prvWriteToFlash( pxContext->ulBaseAddress + ulOffset, pucData, ulLength );
+    }
+
+    return xStatus;
+}
+
+static BaseType_t prvCalculateOtaImageHash( const OtaPalContext_t * pxContext,
+                                            unsigned char * pucHashBuffer,
+                                            size_t uxHashBufferLength,
+                                            size_t * puxHashLength )
+{
+    BaseType_t xResult = pdFALSE;
+    const mbedtls_md_info_t * pxMdInfo = mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 );
+    mbedtls_md_context_t xMdCtx;
+
+    configASSERT( pxContext->ulImageSize >= OTA_IMAGE_HEAD_SIZE );
+
+    mbedtls_md_init( &xMdCtx );
+
+    if( ( pxMdInfo == NULL ) ||
+        ( mbedtls_md_get_size( pxMdInfo ) > uxHashBufferLength ) )
+    {
+        LogError( "Failed to initialize mbedtls md_info object." );
+    }
+    else if( ( mbedtls_md_setup( &xMdCtx, pxMdInfo, 0 ) != 0 ) ||
+             ( mbedtls_md_starts( &xMdCtx ) != 0 ) ||
+             ( mbedtls_md_update( &xMdCtx, xRxState.ucImageHead, OTA_IMAGE_HEAD_SIZE ) != 0 ) ||
+             ( mbedtls_md_update( &xMdCtx, ( const unsigned char * ) ( pxContext->ulBaseAddress + OTA_IMAGE_HEAD_SIZE ),
+                                  pxContext->ulImageSize - OTA_IMAGE_HEAD_SIZE ) != 0 ) ||
+             ( mbedtls_md_finish( &xMdCtx, pucHashBuffer ) != 0 ) )
+    {
+        LogError( "Failed to compute hash of the staged firmware image." );
+    }
+    else
+    {
+        *puxHashLength = mbedtls_md_get_size( pxMdInfo );
+        xResult = pdTRUE;
+    }
+
+    mbedtls_md_free( &xMdCtx );
+
+    return xResult;
+}
+
+/* Identifies the file across reboots: the job, the file and its signature */
+static BaseType_t prvRxFileId( const OtaFileContext_t * pxFileContext,
+                               OtaPalImageFormat_t xImageFormat,
+                               uint8_t * pucFileId )
+{
+    BaseType_t xResult = pdFALSE;
+    const mbedtls_md_info_t * pxMdInfo = mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 );
+    mbedtls_md_context_t xMdCtx;
+    uint32_t ulFields[ 2 ] = { pxFileContext->fileSize, ( uint32_t ) xImageFormat };
+
+    mbedtls_md_init( &xMdCtx );
+
+    if( ( pxMdInfo != NULL ) &&
+        ( pxFileContext->pJobName != NULL ) &&
+        ( pxFileContext->pFilePath != NULL ) &&
+        ( pxFileContext->pSignature != NULL ) &&
+        ( mbedtls_md_setup( &xMdCtx, pxMdInfo, 0 ) == 0 ) &&
+        ( mbedtls_md_starts( &xMdCtx ) == 0 ) &&
+        ( mbedtls_md_update( &xMdCtx, pxFileContext->pJobName, strlen( ( const char * ) pxFileContext->pJobName ) ) == 0 ) &&
+        ( mbedtls_md_update( &xMdCtx, pxFileContext->pFilePath, strlen( ( const char * ) pxFileContext->pFilePath ) ) == 0 ) &&
+        ( mbedtls_md_update( &xMdCtx, ( const unsigned char * ) ulFields, sizeof( ulFields ) ) == 0 ) &&
+        ( mbedtls_md_update( &xMdCtx, pxFileContext->pSignature->data, pxFileContext->pSignature->size ) == 0 ) &&
+        ( mbedtls_md_finish( &xMdCtx, pucFileId ) == 0 ) )
+    {
+        xResult = pdTRUE;
+    }
+
+    mbedtls_md_free( &xMdCtx );
+
+    return xResult;
+}
+
+static BaseType_t prvRxStateLoad( void )
+{
+    BaseType_t xResult = pdFALSE;
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    lfs_file_t xFile = { 0 };
+
+    if( ( pxLfsCtx != NULL ) &&
+        ( lfs_file_open( pxLfsCtx, &xFile, RX_STATE_FILE_NAME, LFS_O_RDONLY ) == LFS_ERR_OK ) )
+    {
+        if( lfs_file_read( pxLfsCtx, &xFile, &xRxState, sizeof( OtaPalRxState_t ) ) == sizeof( OtaPalRxState_t ) )
+        {
+            xResult = pdTRUE;
+        }
+
+        ( void ) lfs_file_close( pxLfsCtx, &xFile );
+    }
+
+    return xResult;
+}
+
+static void prvRxStateSave( void )
+{
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    lfs_file_t xFile = { 0 };
+    lfs_ssize_t xLfsErr = LFS_ERR_CORRUPT;
+
+    if( pxLfsCtx == NULL )
+    {
+        LogError( "File system not ready." );
+    }
+    else
+    {
+        xLfsErr = lfs_file_open( pxLfsCtx, &xFile, RX_STATE_FILE_NAME, ( LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC ) );
+
+        if( xLfsErr == LFS_ERR_OK )
+        {
+            xLfsErr = lfs_file_write( pxLfsCtx, &xFile, &xRxState, sizeof( OtaPalRxState_t ) );
+
+            if( xLfsErr != sizeof( OtaPalRxState_t ) )
+            {
+                LogError( "Failed to save OTA receive state to file %s, error = %d.", RX_STATE_FILE_NAME, xLfsErr );
+            }
+
+            ( void ) lfs_file_close( pxLfsCtx, &xFile );
+        }
+        else
+        {
+            LogError( "Failed to open file %s to save OTA receive state, error = %d. ", RX_STATE_FILE_NAME, xLfsErr );
+        }
+    }
+}
+
+static void prvRxStateDelete( void )
+{
+    lfs_t * pxLfsCtx = pxGetDefaultFsCtx();
+    struct lfs_info xFileInfo = { 0 };
+
+    xRxState.ulMagic = 0;
+    xRxStateDirty = pdFALSE;
+
+    if( ( pxLfsCtx != NULL ) &&
+        ( lfs_stat( pxLfsCtx, RX_STATE_FILE_NAME, &xFileInfo ) == LFS_ERR_OK ) )
+    {
+        ( void ) lfs_remove( pxLfsCtx, RX_STATE_FILE_NAME );
+    }
+}
+
+static inline BaseType_t prvRxStateHasBlock( uint32_t ulBlock )
+{
+    return ( ( xRxState.ucBlockBitmap[ ulBlock >> 3 ] & ( 1U << ( ulBlock & 7UL ) ) ) != 0U ) ? pdTRUE : pdFALSE;
+}
+
+static void prvRxStateMark( uint32_t ulOffset )
+{
+    uint32_t ulBlock = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+    xRxState.ucBlockBitmap[ ulBlock >> 3 ] |= ( uint8_t ) ( 1U << ( ulBlock & 7UL ) );
+    xRxStateDirty = pdTRUE;
+}
+
+static void prvRxStateUpdate( void )
+{
+    TickType_t xNow = xTaskGetTickCount();
+
+    if( ( otapalconfigRESUME_SAVE_PERIOD_MS > 0U ) &&
+        ( xRxState.ulMagic == OTA_RX_STATE_MAGIC ) &&
+        ( xRxStateDirty == pdTRUE ) &&
+        ( ( xNow - xRxStateSavedAt ) >= pdMS_TO_TICKS( otapalconfigRESUME_SAVE_PERIOD_MS ) ) )
+    {
+        prvRxStateSave();
+        xRxStateSavedAt = xNow;
+        xRxStateDirty = pdFALSE;
+    }
+}
+
+static BaseType_t prvRxStateRestore( OtaPalContext_t * pxContext,
+                                     OtaFileContext_t * pxFileContext )
+{
+    BaseType_t xResult = pdTRUE;
+    uint32_t ulNumBlocks = ( pxContext->ulFileSize + OTA_FILE_BLOCK_SIZE - 1UL ) >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulFileSector = ( prvGetFileAddress( pxContext ) - pxContext->ulBaseAddress ) / FLASH_SECTOR_SIZE;
+    uint32_t ulFileSectors = OTA_STAGING_SIZE( pxContext->ulFileSize ) / FLASH_SECTOR_SIZE;
+    uint32_t ulEraseFirst = 0;
+    uint32_t ulEraseCount = 0;
+    uint32_t ulKept = 0;
+    uint32_t ulSector;
+    uint32_t ulBlock;
+
+    /* The library only closes the file after receiving a block, keep at least the
+     * last sector to download. */
+    for( ulBlock = 0; ( ulBlock < ulNumBlocks ) && ( prvRxStateHasBlock( ulBlock ) == pdTRUE ); ulBlock++ )
+    {
+    }
+
+    if( ulBlock == ulNumBlocks )
+    {
+        for( ulBlock = ( ulFileSectors - 1UL ) * OTA_RX_BLOCKS_PER_SECTOR; ulBlock < ulNumBlocks; ulBlock++ )
+        {
+            xRxState.ucBlockBitmap[ ulBlock >> 3 ] &= ( uint8_t ) ~( 1U << ( ulBlock & 7UL ) );
+        }
+    }
+
+    for( ulSector = 0; ( ulSector < RESERVED_OTA_SECTORS ) && ( xResult == pdTRUE ); ulSector++ )
+    {
+        BaseType_t xKeep = pdFALSE;
+
+        if( ( ulSector >= ulFileSector ) && ( ulSector < ( ulFileSector + ulFileSectors ) ) )
+        {
+            uint32_t ulFirst = ( ulSector - ulFileSector ) * OTA_RX_BLOCKS_PER_SECTOR;
+            uint32_t ulLast = ulFirst + OTA_RX_BLOCKS_PER_SECTOR;
+
+            if( ulLast > ulNumBlocks )
+            {
+                ulLast = ulNumBlocks;
+            }
+
+            xKeep = pdTRUE;
+
+            for( ulBlock = ulFirst; ulBlock < ulLast; ulBlock++ )
+            {
+                if( prvRxStateHasBlock( ulBlock ) == pdFALSE )
+                {
+                    xKeep = pdFALSE;
+                }
+            }
+
+            for( ulBlock = ulFirst; ulBlock < ulLast; ulBlock++ )
+            {
+                if( xKeep == pdTRUE )
+                {
+                    ulKept++;
+                }
+                else
+                {
+                    xRxState.ucBlockBitmap[ ulBlock >> 3 ] &= ( uint8_t ) ~( 1U << ( ulBlock & 7UL ) );
+                }
+            }
+        }
+
+        if( xKeep == pdFALSE )
+        {
+            ulEraseFirst = ( ulEraseCount == 0UL ) ? ulSector : ulEraseFirst;
+            ulEraseCount++;
+        }
+
+        /* Erase runs of sectors at once */
+        if( ( ulEraseCount > 0UL ) &&
+            ( ( xKeep == pdTRUE ) || ( ulSector == ( RESERVED_OTA_SECTORS - 1UL ) ) ) )
+        {
+            xResult = prvEraseOtaSectors( pxContext, ulEraseFirst, ulEraseCount );
+            ulEraseCount = 0;
+        }
+    }
+
+    if( xResult == pdTRUE )
+    {
+        for( ulBlock = 0; ulBlock < ulNumBlocks; ulBlock++ )
+        {
+            if( prvRxStateHasBlock( ulBlock ) == pdTRUE )
+            {
+                pxFileContext->pRxBlockBitmap[ ulBlock >> 3 ] &= ( uint8_t ) ~( 1U << ( ulBlock & 7UL ) );
+                pxFileContext->blocksRemaining--;
+            }
+        }
+
+        LogInfo( "Resuming download: %lu of %lu blocks already received.", ( unsigned long ) ulKept, ( unsigned long ) ulNumBlocks );
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvRxStateResume( OtaPalContext_t * pxContext,
+                                    OtaFileContext_t * pxFileContext )
+{
+    BaseType_t xResumed = pdFALSE;
+    uint8_t ucFileId[ OTA_RX_FILE_ID_SIZE ];
+    BaseType_t xHasId = prvRxFileId( pxFileContext, pxContext->xImageFormat, ucFileId );
+
+    if( ( otapalconfigRESUME_SAVE_PERIOD_MS > 0U ) &&
+        ( xHasId == pdTRUE ) &&
+        ( pxFileContext->pRxBlockBitmap != NULL ) &&
+        ( prvRxStateLoad() == pdTRUE ) &&
+        ( xRxState.ulMagic == OTA_RX_STATE_MAGIC ) &&
+        ( xRxState.ulFileSize == pxContext->ulFileSize ) &&
+        ( xRxState.ulImageFormat == ( uint32_t ) pxContext->xImageFormat ) &&
+        ( memcmp( xRxState.ucFileId, ucFileId, OTA_RX_FILE_ID_SIZE ) == 0 ) )
+    {
+        xResumed = prvRxStateRestore( pxContext, pxFileContext );
+    }
+
+    if( xResumed == pdFALSE )
+    {
+        ( void ) memset( &xRxState, 0, sizeof( xRxState ) );
+        ( void ) memset( xRxState.ucImageHead, 0xFF, OTA_IMAGE_HEAD_SIZE );
+
+        /* A file that cannot be identified is not resumable */
+        xRxState.ulMagic = ( xHasId == pdTRUE ) ? OTA_RX_STATE_MAGIC : 0UL;
+        xRxState.ulFileSize = pxContext->ulFileSize;
+        xRxState.ulImageFormat = ( uint32_t ) pxContext->xImageFormat;
+        ( void ) memcpy( xRxState.ucFileId, ucFileId, OTA_RX_FILE_ID_SIZE );
+    }
+
+    xRxStateDirty = pdFALSE;
+    xRxStateSavedAt = xTaskGetTickCount();
+
+    return xResumed;
+}
+
+/*
+ * Delta and compressed images.
+ *
+ * Both are staged as received at the top of the OTA area, so blocks may arrive in
+ * any order. Whenever the run of staged blocks from the start of the file grows,
+ * the new bytes are fed to the decoder, which writes the image at the bottom of
+ * the OTA area:
+ *  - a delta image rebuilds it from the running image. The signature covers the
+ *    delta file, the rebuilt image is checked against the target hash of the
+ *    delta header.
+ *  - a compressed image is decompressed, matches are read back from the image
+ *    already written. The signature covers the decompressed image.
+ * The staged file and the image must fit in the OTA area together.
+ */
+static int32_t prvStagedWrite( void * pvWriteCtx,
+                               uint32_t ulOffset,
+                               const uint8_t * pucData,
+                               uint32_t ulLength )
+{
+    OtaPalContext_t * pxContext = ( OtaPalContext_t * ) pvWriteCtx;
+
+    return ( prvWriteImage( pxContext, ulOffset, ( uint8_t * ) pucData, ulLength ) == HAL_OK ) ? 0 : -1;
+}
+
+static void prvStagedOpen( OtaPalContext_t * pxContext )
+{
+    ( void ) memset( &xStagingContext, 0, sizeof( xStagingContext ) );
+
+    xStagingContext.ulFileAddress = prvGetFileAddress( pxContext );
+    xStagingContext.xFailed = pdFALSE;
+
+    /* Known once the header is decoded */
+    pxContext->ulImageSize = 0;
+}
+
+static BaseType_t prvDeltaStart( OtaPalContext_t * pxContext )
+{
+    BaseType_t xResult = pdFALSE;
+    OtaDeltaHeader_t * pxHeader = &xStagingContext.xHeader.xDelta;
+
+    if( xOtaDeltaParseHeader( ( const uint8_t * ) xStagingContext.ulFileAddress, OTA_DELTA_HEADER_SIZE, pxHeader ) != OtaDeltaSuccess )
+    {
+        LogError( "Invalid delta image header." );
+    }
+    else if( ( pxHeader->ulBaseVersion != 0UL ) &&
+             ( pxHeader->ulBaseVersion != appFirmwareVersion.u.unsignedVersion32 ) )
+    {
+        LogError( "Delta image was built for version %lu.%lu.%lu, running version is %lu.%lu.%lu.",
+                  ( unsigned long ) ( pxHeader->ulBaseVersion >> 24 ),
+                  ( unsigned long ) ( ( pxHeader->ulBaseVersion >> 16 ) & 0xFFUL ),
+                  ( unsigned long ) ( pxHeader->ulBaseVersion & 0xFFFFUL ),
+                  ( unsigned long ) appFirmwareVersion.u.x.major,
+                  ( unsigned long ) appFirmwareVersion.u.x.minor,
+                  ( unsigned long ) appFirmwareVersion.u.x.build );
+    }
+    else if( ( pxHeader->ulBaseSize == 0UL ) ||
+             ( pxHeader->ulBaseSize > OTA_IMAGE_MAX_SIZE ) ||
+             ( pxHeader->ulTargetSize > ( xStagingContext.ulFileAddress - pxContext->ulBaseAddress ) ) )
+    {
+        LogError( "Delta image sizes do not fit the OTA area: base: %lu, target: %lu.",
+                  ( unsigned long ) pxHeader->ulBaseSize, ( unsigned long ) pxHeader->ulTargetSize );
+    }
+    else
+    {
+        unsigned char pucHashBuffer[ MBEDTLS_MD_MAX_SIZE ];
+        size_t uxHashLength = 0;
+
+        if( ( xCalculateImageHash( ( const unsigned char * ) FLASH_START_ACTIVE_IMAGE, pxHeader->ulBaseSize,
+                                   pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) != pdTRUE ) ||
+            ( uxHashLength != OTA_DELTA_HASH_SIZE ) ||
+            ( memcmp( pucHashBuffer, pxHeader->ucBaseHash, OTA_DELTA_HASH_SIZE ) != 0 ) )
+        {
+            LogError( "Delta image base does not match the running image." );
+        }
+        else
+        {
+            vOtaDeltaInit( &xStagingContext.xDecoder.xDelta, pxHeader, ( const uint8_t * ) FLASH_START_ACTIVE_IMAGE,
+                           prvStagedWrite, pxContext );
+
+            pxContext->ulImageSize = pxHeader->ulTargetSize;
+            xStagingContext.ulFed = OTA_DELTA_HEADER_SIZE;
+            xResult = pdTRUE;
+
+            LogInfo( "Applying delta image: %lu bytes -> %lu bytes image.",
+                     ( unsigned long ) pxContext->ulFileSize, ( unsigned long ) pxHeader->ulTargetSize );
+        }
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvLzssStart( OtaPalContext_t * pxContext )
+{
+    BaseType_t xResult = pdFALSE;
+    OtaLzssHeader_t * pxHeader = &xStagingContext.xHeader.xLzss;
+
+    if( xOtaLzssParseHeader( ( const uint8_t * ) xStagingContext.ulFileAddress, OTA_LZSS_HEADER_SIZE, pxHeader ) != OtaLzssSuccess )
+    {
+        LogError( "Invalid compressed image header." );
+    }
+    else if( ( pxHeader->ulTargetSize < OTA_IMAGE_MIN_SIZE ) ||
+             ( pxHeader->ulTargetSize > ( xStagingContext.ulFileAddress - pxContext->ulBaseAddress ) ) )
+    {
+        LogError( "Compressed image does not fit the OTA area: file: %lu, image: %lu.",
+                  ( unsigned long ) pxContext->ulFileSize, ( unsigned long ) pxHeader->ulTargetSize );
+    }
+    else
+    {
+        vOtaLzssInit( &xStagingContext.xDecoder.xLzss, pxHeader, ( const uint8_t * ) pxContext->ulBaseAddress,
+                      prvStagedWrite, pxContext );
+
+        pxContext->ulImageSize = pxHeader->ulTargetSize;
+        xStagingContext.ulFed = OTA_LZSS_HEADER_SIZE;
+        xResult = pdTRUE;
+
+        LogInfo( "Decompressing image: %lu bytes -> %lu bytes image, window: %lu bytes.",
+                 ( unsigned long ) pxContext->ulFileSize, ( unsigned long ) pxHeader->ulTargetSize,
+                 ( 1UL << pxHeader->ucWindowBits ) );
+    }
+
+    return xResult;
+}
+
+static BaseType_t prvStagedFeed( OtaPalContext_t * pxContext )
+{
+    BaseType_t xResult = pdTRUE;
+    const uint8_t * pucData = ( const uint8_t * ) ( xStagingContext.ulFileAddress + xStagingContext.ulFed );
+    size_t uxLength = xStagingContext.ulContiguous - xStagingContext.ulFed;
+
+    if( pxContext->xImageFormat == OTA_PAL_IMAGE_DELTA )
+    {
+        OtaDeltaStatus_t xStatus = xOtaDeltaApply( &xStagingContext.xDecoder.xDelta, pucData, uxLength );
+
+        if( xStatus != OtaDeltaSuccess )
+        {
+            LogError( "Failed to apply delta image, status: %d.", xStatus );
+            xResult = pdFALSE;
+        }
+    }
+    else
+    {
+        OtaLzssStatus_t xStatus = xOtaLzssApply( &xStagingContext.xDecoder.xLzss, pucData, uxLength );
+
+        if( xStatus != OtaLzssSuccess )
+        {
+            LogError( "Failed to decompress image, status: %d.", xStatus );
+            xResult = pdFALSE;
+        }
+    }
+
+    xStagingContext.ulFed = xStagingContext.ulContiguous;
+
+    return xResult;
+}
+
+static BaseType_t prvStagedWriteBlock( OtaPalContext_t * pxContext,
+                                       uint32_t ulOffset,
+                                       uint8_t * pucData,
+                                       uint32_t ulLength )
+{
+    BaseType_t xResult = pdFALSE;
+    uint32_t ulBlock = ulOffset >> otaconfigLOG2_FILE_BLOCK_SIZE;
+    uint32_t ulHeaderSize = ( pxContext->xImageFormat == OTA_PAL_IMAGE_DELTA ) ? OTA_DELTA_HEADER_SIZE : OTA_LZSS_HEADER_SIZE;
+
+    if( xStagingContext.xFailed == pdTRUE )
+    {
+        LogError( "Decoding of the staged image already failed." );
+    }
+    else if( prvWriteToFlash( xStagingContext.ulFileAddress + ulOffset, pucData, ulLength ) != HAL_OK )
+    {
+        LogError( "Failed to stage block at offset %lu.", ( unsigned long ) ulOffset );
+    }
+    else
+    {
+        prvRxStateMark( ulOffset );
+
+        /* Extend the run of staged blocks from the start of the file */
+        ulBlock = xStagingContext.ulContiguous >> otaconfigLOG2_FILE_BLOCK_SIZE;
+
+        while( ( xStagingContext.ulContiguous < pxContext->ulFileSize ) &&
+               ( ( xRxState.ucBlockBitmap[ ulBlock >> 3 ] & ( 1U << ( ulBlock & 7UL ) ) ) != 0U ) )
+        {
+            xStagingContext.ulContiguous += OTA_FILE_BLOCK_SIZE;
+            ulBlock++;
+        }
+
+        if( xStagingContext.ulContiguous > pxContext->ulFileSize )
+        {
+            xStagingContext.ulContiguous = pxContext->ulFileSize;
+        }
+
+        xResult = pdTRUE;
+
+        if( ( xStagingContext.xStarted == pdFALSE ) &&
+            ( xStagingContext.ulContiguous >= ulHeaderSize ) )
+        {
+            xResult = ( pxContext->xImageFormat == OTA_PAL_IMAGE_DELTA ) ? prvDeltaStart( pxContext ) : prvLzssStart( pxContext );
+            xStagingContext.xStarted = xResult;
+        }
+
+        if( ( xResult == pdTRUE ) &&
+            ( xStagingContext.xStarted == pdTRUE ) &&
+            ( xStagingContext.ulContiguous > xStagingContext.ulFed ) )
+        {
+            xResult = prvStagedFeed( pxContext );
+        }
+
+        if( xResult != pdTRUE )
+        {
+            xStagingContext.xFailed = pdTRUE;
+        }
+    }
+
+    return xResult;
+}
+
+static OtaPalStatus_t prvStagedFinish( OtaPalContext_t * pxContext )
+{
+    OtaPalStatus_t uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
+    unsigned char pucHashBuffer[ MBEDTLS_MD_MAX_SIZE ];
+    size_t uxHashLength = 0;
+    int32_t lStatus = 0;
+
+    if( ( xStagingContext.xStarted == pdFALSE ) ||
+        ( xStagingContext.xFailed == pdTRUE ) )
+    {
+        LogError( "Staged image is incomplete or could not be decoded." );
+        uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+    }
+    else if( pxContext->xImageFormat == OTA_PAL_IMAGE_LZSS )
+    {
+        lStatus = ( int32_t ) xOtaLzssFinish( &xStagingContext.xDecoder.xLzss );
+
+        if( lStatus != ( int32_t ) OtaLzssSuccess )
+        {
+            LogError( "Compressed image could not be decompressed, status: %ld.", ( long ) lStatus );
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+        }
+    }
+    else
+    {
+        lStatus = ( int32_t ) xOtaDeltaFinish( &xStagingContext.xDecoder.xDelta );
+
+        if( lStatus != ( int32_t ) OtaDeltaSuccess )
+        {
+            LogError( "Delta image could not be applied, status: %ld.", ( long ) lStatus );
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+        }
+        else if( ( prvCalculateOtaImageHash( pxContext, pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) != pdTRUE ) ||
+                 ( uxHashLength != OTA_DELTA_HASH_SIZE ) )
+        {
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+        }
+        else if( memcmp( pucHashBuffer, xStagingContext.xHeader.xDelta.ucTargetHash, OTA_DELTA_HASH_SIZE ) != 0 )
+        {
+            LogError( "Rebuilt image does not match the delta target hash." );
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalSignatureCheckFailed, 0 );
+        }
+    }
+
+    return uxOtaStatus;
+}
+
+static void prvStagedRelease( OtaPalContext_t * pxContext )
+{
+    uint32_t ulFirstSector = ( xStagingContext.ulFileAddress - FLASH_START_INACTIVE_BANK ) / FLASH_SECTOR_SIZE;
+
+    /* Leave the OTA area as a full image update would */
+    ( void ) prvEraseOtaSectors( pxContext, ulFirstSector,
+                                 OTA_STAGING_SIZE( pxContext->ulFileSize ) / FLASH_SECTOR_SIZE );
+}
+
 OtaPalStatus_t otaPal_CreateFileForRx( OtaFileContext_t * const pxFileContext )
 {
     OtaPalStatus_t uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalSuccess, 0 );
     OtaPalContext_t * pxContext = prvGetImageContext();
+    OtaPalImageFormat_t xImageFormat = prvGetImageFormat( pxFileContext );
 
 #if defined(HAL_ICACHE_MODULE_ENABLED)
 HAL_ICACHE_Disable();
@@ -1056,14 +1893,16 @@ HAL_ICACHE_Enable();
     {
         uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileTooLarge, 0 );
     }
-#if DEMO_HOME_ASSISTANT
-    else if (strstr((char *) pxFileContext->pFilePath, OTA_FILE_NAME) == NULL)
-#else
-    else if( strncmp( OTA_FILE_NAME, ( char * ) pxFileContext->pFilePath, pxFileContext->filePathMaxSize ) != 0 )
-#endif
+    else if( xImageFormat == OTA_PAL_IMAGE_INVALID )
     {
         uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
     }
+    else if( ( xImageFormat != OTA_PAL_IMAGE_RAW ) &&
+             ( OTA_STAGING_SIZE( pxFileContext->fileSize ) >= max ) )
+    {
+        /* No room left below the staged file for the image */
+        uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileTooLarge, 0 );
+    }
     else if( ( pxContext == NULL ) ||
              ( pxContext->xPalState != OTA_PAL_READY ) )
     {
@@ -1098,12 +1937,6 @@ HAL_ICACHE_Enable();
             }
         }
 
-        if( ( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess ) &&
-            ( prvEraseBank( ulTargetBank ) != pdTRUE ) )
-        {
-            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
-        }
-
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
         {
 #if !defined(LFS_USE_INTERNAL_NOR)
@@ -1112,8 +1945,26 @@ HAL_ICACHE_Enable();
 #endif
             pxContext->ulBaseAddress = base;
             pxContext->ulImageSize = pxFileContext->fileSize;
+            pxContext->ulFileSize = pxFileContext->fileSize;
+            pxContext->xImageFormat = xImageFormat;
+
+            /* Keep what was received of this file before a reset, start over otherwise */
+            if( ( prvRxStateResume( pxContext, pxFileContext ) == pdFALSE ) &&
+                ( prvEraseBank( ulTargetBank ) != pdTRUE ) )
+            {
+                uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalRxFileCreateFailed, 0 );
+            }
+        }
+
+        if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
+        {
             pxContext->xPalState = OTA_PAL_FILE_OPEN;
             pxFileContext->pFile = (otaconfigOTA_FILE_TYPE *) pxContext;
+
+            if( xImageFormat != OTA_PAL_IMAGE_RAW )
+            {
+                prvStagedOpen( pxContext );
+            }
         }
 
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
@@ -1149,7 +2000,7 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pxFileContext,
     {
         LogError( "PAL context is invalid." );
     }
-    else if( ( offset + blockSize ) > pxContext->ulImageSize )
+    else if( ( offset + blockSize ) > pxContext->ulFileSize )
     {
         LogError( "Offset and blockSize exceeds image size" );
     }
@@ -1161,11 +2012,24 @@ int16_t otaPal_WriteBlock( OtaFileContext_t * const pxFileContext,
     {
         LogError( "pData is NULL." );
     }
-    else if( prvWriteToFlash( ( pxContext->ulBaseAddress + offset ), pData, blockSize ) == HAL_OK )
+    else if( pxContext->xImageFormat != OTA_PAL_IMAGE_RAW )
+    {
+        if( prvStagedWriteBlock( pxContext, offset, pData, blockSize ) == pdTRUE )
+        {
+            sBytesWritten = ( int16_t ) blockSize;
+        }
+    }
+    else if( prvWriteImage( pxContext, offset, pData, blockSize ) == HAL_OK )
     {
+        prvRxStateMark( offset );
         sBytesWritten = ( int16_t ) blockSize;
     }
 
+    if( sBytesWritten > 0 )
+    {
+        prvRxStateUpdate();
+    }
+
     return sBytesWritten;
 }
 
@@ -1185,12 +2049,31 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const pxFileContext )
     {
         unsigned char pucHashBuffer[ MBEDTLS_MD_MAX_SIZE ];
         size_t uxHashLength = 0;
+        BaseType_t xHashResult = pdFALSE;
 
-        if( xCalculateImageHash( ( unsigned char * ) ( pxContext->ulBaseAddress ),
-                                 ( size_t ) pxContext->ulImageSize,
-                                 pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength ) != pdTRUE )
+        if( pxContext->xImageFormat != OTA_PAL_IMAGE_RAW )
         {
-            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+            uxOtaStatus = prvStagedFinish( pxContext );
+        }
+
+        if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
+        {
+            /* A delta image is signed as received, a compressed image once decompressed */
+            if( pxContext->xImageFormat == OTA_PAL_IMAGE_DELTA )
+            {
+                xHashResult = xCalculateImageHash( ( unsigned char * ) ( xStagingContext.ulFileAddress ),
+                                                   ( size_t ) pxContext->ulFileSize,
+                                                   pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength );
+            }
+            else
+            {
+                xHashResult = prvCalculateOtaImageHash( pxContext, pucHashBuffer, MBEDTLS_MD_MAX_SIZE, &uxHashLength );
+            }
+
+            if( xHashResult != pdTRUE )
+            {
+                uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+            }
         }
 
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
@@ -1202,6 +2085,22 @@ OtaPalStatus_t otaPal_CloseFile( OtaFileContext_t * const pxFileContext )
                                                 uxHashLength );
         }
 
+        if( ( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess ) &&
+            ( pxContext->xImageFormat != OTA_PAL_IMAGE_RAW ) )
+        {
+            prvStagedRelease( pxContext );
+        }
+
+        /* The bootloader installs the image as soon as its first word is programmed */
+        if( ( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess ) &&
+            ( prvWriteToFlash( pxContext->ulBaseAddress, xRxState.ucImageHead, OTA_IMAGE_HEAD_SIZE ) != HAL_OK ) )
+        {
+            LogError( "Failed to write the start of the image." );
+            uxOtaStatus = OTA_PAL_COMBINE_ERR( OtaPalFileClose, 0 );
+        }
+
+        prvRxStateDelete();
+
         if( OTA_PAL_MAIN_ERR( uxOtaStatus ) == OtaPalSuccess )
         {
             pxContext->xPalState = OTA_PAL_PENDING_ACTIVATION;
@@ -1510,6 +2409,8 @@ OtaPalStatus_t otaPal_SetPlatformImageState( OtaFileContext_t * const pxFileCont
                     case OTA_PAL_PENDING_ACTIVATION:
                     case OTA_PAL_PENDING_SELF_TEST:
                     case OTA_PAL_NEW_IMAGE_WDT_RESET:
+                        /* The job is over, do not resume its download */
+                        prvRxStateDelete();
 #if !defined(LFS_USE_INTERNAL_NOR)
                         configASSERT( prvGetActiveBank() == ulGetOtherBank( pxContext->ulTargetBank ) );
 
@@ -26,6 +26,8 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #endif
+#include "logging.h"
+#include "perf_monitor.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -65,6 +67,7 @@ extern DMA_HandleTypeDef handle_GPDMA1_Channel1;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel0;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel5;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel4;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel2;
 extern SPI_HandleTypeDef hspi2;
 extern SPI_HandleTypeDef hspi5;
 extern UART_HandleTypeDef huart1;
@@ -98,6 +101,11 @@ __attribute__( ( optimize( "O0" ) ) ) void prvGetRegistersFromStack( uint32_t *
     psr = pulFaultStackAddress[ 7 ];
     #pragma GCC diagnostic pop
 
+    #if ( LOGGING_CRASH_LOG == 1 )
+        /* Keep the fault for after the watchdog reset */
+        vLoggingCrashLogFault( pulFaultStackAddress );
+    #endif
+
     /* When the following line is hit, the variables contain the register values. */
     for( ; ; )
     {
@@ -220,11 +228,11 @@ void DebugMon_Handler(void)
 void EXTI3_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI3_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END EXTI3_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(STMOD_17_Pin);
   /* USER CODE BEGIN EXTI3_IRQn 1 */
-
+  PERF_IRQ_EXIT(EXTI3_IRQn);
   /* USER CODE END EXTI3_IRQn 1 */
 }
 
@@ -234,11 +242,11 @@ void EXTI3_IRQHandler(void)
 void EXTI4_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI4_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END EXTI4_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(STMOD_19_Pin);
   /* USER CODE BEGIN EXTI4_IRQn 1 */
-
+  PERF_IRQ_EXIT(EXTI4_IRQn);
   /* USER CODE END EXTI4_IRQn 1 */
 }
 
@@ -248,11 +256,11 @@ void EXTI4_IRQHandler(void)
 void EXTI5_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI5_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END EXTI5_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(ARD_D03_Pin);
   /* USER CODE BEGIN EXTI5_IRQn 1 */
-
+  PERF_IRQ_EXIT(EXTI5_IRQn);
   /* USER CODE END EXTI5_IRQn 1 */
 }
 
@@ -262,11 +270,11 @@ void EXTI5_IRQHandler(void)
 void EXTI13_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI13_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END EXTI13_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(USER_Button_Pin);
   /* USER CODE BEGIN EXTI13_IRQn 1 */
-
+  PERF_IRQ_EXIT(EXTI13_IRQn);
   /* USER CODE END EXTI13_IRQn 1 */
 }
 
@@ -276,11 +284,11 @@ void EXTI13_IRQHandler(void)
 void GPDMA1_Channel0_IRQHandler(void)
 {
   /* USER CODE BEGIN GPDMA1_Channel0_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END GPDMA1_Channel0_IRQn 0 */
   HAL_DMA_IRQHandler(&handle_GPDMA1_Channel0);
   /* USER CODE BEGIN GPDMA1_Channel0_IRQn 1 */
-
+  PERF_IRQ_EXIT(GPDMA1_Channel0_IRQn);
   /* USER CODE END GPDMA1_Channel0_IRQn 1 */
 }
 
@@ -290,25 +298,39 @@ void GPDMA1_Channel0_IRQHandler(void)
 void GPDMA1_Channel1_IRQHandler(void)
 {
   /* USER CODE BEGIN GPDMA1_Channel1_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END GPDMA1_Channel1_IRQn 0 */
   HAL_DMA_IRQHandler(&handle_GPDMA1_Channel1);
   /* USER CODE BEGIN GPDMA1_Channel1_IRQn 1 */
-
+  PERF_IRQ_EXIT(GPDMA1_Channel1_IRQn);
   /* USER CODE END GPDMA1_Channel1_IRQn 1 */
 }
 
+/**
+  * @brief This function handles GPDMA1 Channel 2 global interrupt.
+  */
+void GPDMA1_Channel2_IRQHandler(void)
+{
+  /* USER CODE BEGIN GPDMA1_Channel2_IRQn 0 */
+  PERF_IRQ_ENTER();
+  /* USER CODE END GPDMA1_Channel2_IRQn 0 */
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel2);
+  /* USER CODE BEGIN GPDMA1_Channel2_IRQn 1 */
+  PERF_IRQ_EXIT(GPDMA1_Channel2_IRQn);
+  /* USER CODE END GPDMA1_Channel2_IRQn 1 */
+}
+
 /**
   * @brief This function handles GPDMA1 Channel 4 global interrupt.
   */
 void GPDMA1_Channel4_IRQHandler(void)
 {
   /* USER CODE BEGIN GPDMA1_Channel4_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END GPDMA1_Channel4_IRQn 0 */
   HAL_DMA_IRQHandler(&handle_GPDMA1_Channel4);
   /* USER CODE BEGIN GPDMA1_Channel4_IRQn 1 */
-
+  PERF_IRQ_EXIT(GPDMA1_Channel4_IRQn);
   /* USER CODE END GPDMA1_Channel4_IRQn 1 */
 }
 
@@ -318,11 +340,11 @@ void GPDMA1_Channel4_IRQHandler(void)
 void GPDMA1_Channel5_IRQHandler(void)
 {
   /* USER CODE BEGIN GPDMA1_Channel5_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END GPDMA1_Channel5_IRQn 0 */
   HAL_DMA_IRQHandler(&handle_GPDMA1_Channel5);
   /* USER CODE BEGIN GPDMA1_Channel5_IRQn 1 */
-
+  PERF_IRQ_EXIT(GPDMA1_Channel5_IRQn);
   /* USER CODE END GPDMA1_Channel5_IRQn 1 */
 }
 
@@ -332,11 +354,11 @@ void GPDMA1_Channel5_IRQHandler(void)
 void IWDG_IRQHandler(void)
 {
   /* USER CODE BEGIN IWDG_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END IWDG_IRQn 0 */
   HAL_IWDG_IRQHandler(&hiwdg);
   /* USER CODE BEGIN IWDG_IRQn 1 */
-
+  PERF_IRQ_EXIT(IWDG_IRQn);
   /* USER CODE END IWDG_IRQn 1 */
 }
 
@@ -346,11 +368,11 @@ void IWDG_IRQHandler(void)
 void SPI2_IRQHandler(void)
 {
   /* USER CODE BEGIN SPI2_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END SPI2_IRQn 0 */
   HAL_SPI_IRQHandler(&hspi2);
   /* USER CODE BEGIN SPI2_IRQn 1 */
-
+  PERF_IRQ_EXIT(SPI2_IRQn);
   /* USER CODE END SPI2_IRQn 1 */
 }
 
@@ -360,11 +382,11 @@ void SPI2_IRQHandler(void)
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
-
+  PERF_IRQ_EXIT(USART1_IRQn);
   /* USER CODE END USART1_IRQn 1 */
 }
 
@@ -374,11 +396,11 @@ void USART1_IRQHandler(void)
 void SPI5_IRQHandler(void)
 {
   /* USER CODE BEGIN SPI5_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END SPI5_IRQn 0 */
   HAL_SPI_IRQHandler(&hspi5);
   /* USER CODE BEGIN SPI5_IRQn 1 */
-
+  PERF_IRQ_EXIT(SPI5_IRQn);
   /* USER CODE END SPI5_IRQn 1 */
 }
 
@@ -388,11 +410,11 @@ void SPI5_IRQHandler(void)
 void ETH_IRQHandler(void)
 {
   /* USER CODE BEGIN ETH_IRQn 0 */
-
+  PERF_IRQ_ENTER();
   /* USER CODE END ETH_IRQn 0 */
   HAL_ETH_IRQHandler(&heth);
   /* USER CODE BEGIN ETH_IRQn 1 */
-
+  PERF_IRQ_EXIT(ETH_IRQn);
   /* USER CODE END ETH_IRQn 1 */
 }
 
@@ -405,6 +427,8 @@ void ETH_IRQHandler(void)
 
 void SysTick_Handler (void)
 {
+  PERF_IRQ_ENTER();
+
 #if (configUSE_TICKLESS_IDLE != 0 )
   /* Clear overflow flag */
   SysTick->CTRL;
@@ -417,6 +441,8 @@ void SysTick_Handler (void)
   }
 
   HAL_IncTick();
+
+  PERF_IRQ_EXIT(SysTick_IRQn);
 }
 #endif
 /* USER CODE END 1 */
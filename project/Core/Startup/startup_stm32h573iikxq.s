@@ -139,8 +139,8 @@ g_pfnVectors:
 	.word	BusFault_Handler
 	.word	UsageFault_Handler
 	.word	SecureFault_Handler
-	.word	0
-	.word	0
+	.word	_image_magic	/* Reserved entries, image header read by the bootloader */
+	.word	_image_size
 	.word	0
 	.word	SVC_Handler
 	.word	DebugMon_Handler
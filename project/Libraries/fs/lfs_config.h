@@ -52,6 +52,9 @@ extern "C"
 
 #include "logging.h"
 
+/* littlefs sources log through the LFS_* macros below */
+LOG_MODULE_DEFINE();
+
 /* System includes */
 #include <stdint.h>
 #include <stdbool.h>
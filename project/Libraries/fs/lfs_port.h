@@ -37,5 +37,27 @@
     const struct lfs_config * pxInitializeInternalFlashFs( TickType_t xBlockTime );
 #endif
 
+#if !defined( LFS_USE_INTERNAL_NOR )
+
+/*
+ * Start erasing unreferenced blocks ahead of the littlefs allocator on the
+ * OSPI NOR flash. Call once the filesystem has been mounted.
+ */
+    void vLfsPortOspiEnableEraseAhead( lfs_t * pxLfs );
+#else
+
+/*
+ * Returns a read-only pointer to a range of the memory mapped internal flash
+ * partition, or NULL when the range does not fit within a single block.
+ * The pointer bypasses the littlefs caches: callers must hold the filesystem
+ * lock, c->lock() to c->unlock(), for as long as they dereference it. It only
+ * covers raw block ranges, the data of a littlefs file is not contiguous.
+ */
+    const void * pvLfsPortGetMappedAddress( const struct lfs_config * c,
+                                            lfs_block_t block,
+                                            lfs_off_t off,
+                                            lfs_size_t size );
+#endif
+
 /* Provided outside of the lfs port */
 lfs_t * pxGetDefaultFsCtx( void );
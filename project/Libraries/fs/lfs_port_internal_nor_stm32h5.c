@@ -33,8 +33,12 @@
 #include "lfs_util.h"
 #include "lfs.h"
 #include "lfs_port_prv.h"
+#include "lfs_port.h"
 
 #include "main.h"
+
+LOG_MODULE_DEFINE();
+
 #if ((!defined(HAL_OSPI_MODULE_ENABLED) || defined(LFS_USE_INTERNAL_NOR)) && defined(__STM32H5xx_HAL_CORTEX_H))
 /* Uses all pages of Bank 2
  *
@@ -45,7 +49,10 @@
 #define RESERVED_BLOCKS              ( RESERVED_OTA_SECTORS )
 #define CONFIG_LFS_FLASH_BASE        ( FLASH_BASE + FLASH_BANK_SIZE + (FLASH_SECTOR_SIZE * RESERVED_BLOCKS) )
 #define LFS_CONFIG_LOOKAHEAD_SIZE    16
-#define LFS_CONFIG_CACHE_SIZE        16
+
+/* Reads are plain memcpy from mapped flash, so a larger cache mostly trades a few
+ * hundred bytes of RAM for fewer read / prog callbacks per littlefs operation. */
+#define LFS_CONFIG_CACHE_SIZE        256
 
 #ifdef LFS_NO_MALLOC
 static uint8_t __ALIGN_BEGIN ucReadBuffer[ CONFIG_SIZE_CACHE_BUFFER ] __ALIGN_END = { 0 };
@@ -56,27 +63,58 @@ static struct LfsPortCtx xLfsCtx = { 0 };
 static StaticSemaphore_t xMutexStatic;
 #endif
 
+/*
+ * The littlefs partition lives in the memory mapped bank 2, so reads are served
+ * straight from the bus with the ICACHE left enabled. Coherency is maintained by
+ * invalidating the cache once a prog or erase has changed the flash contents.
+ */
+static void prvInvalidateICache( void )
+{
+#if defined(HAL_ICACHE_MODULE_ENABLED)
+    /* The H5 ICACHE has no per-line maintenance operation, only a full invalidate. */
+    if( HAL_ICACHE_IsEnabled() != 0U )
+    {
+        ( void ) HAL_ICACHE_Invalidate();
+    }
+#endif
+}
+
+/*
+ * Also the read path of the port, see lfs_port.h.
+ */
+const void * pvLfsPortGetMappedAddress( const struct lfs_config * c,
+                                        lfs_block_t block,
+                                        lfs_off_t off,
+                                        lfs_size_t size )
+{
+    const void * pvAddr = NULL;
+
+    configASSERT( c != NULL );
+
+    if( ( block < c->block_count ) &&
+        ( off <= c->block_size ) &&
+        ( size <= ( c->block_size - off ) ) )
+    {
+        pvAddr = ( const void * ) ( CONFIG_LFS_FLASH_BASE + block * c->block_size + off );
+    }
+
+    return pvAddr;
+}
+
 static int lfs_port_read( const struct lfs_config * c,
                           lfs_block_t block,
                           lfs_off_t off,
                           void * buffer,
                           lfs_size_t size )
 {
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Disable();
-#endif
-    HAL_FLASH_Unlock();
-    __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_ALL_ERRORS );
-
-    uint32_t src_address = CONFIG_LFS_FLASH_BASE + block * c->block_size + off;
+    const void * pvSrc = pvLfsPortGetMappedAddress( c, block, off, size );
 
-    ( void ) memcpy( buffer, ( void * ) src_address, size );
+    if( pvSrc == NULL )
+    {
+        return LFS_ERR_INVAL;
+    }
 
-    HAL_FLASH_Lock();
-
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Enable();
-#endif
+    ( void ) memcpy( buffer, pvSrc, size );
 
     return 0;
 }
@@ -97,10 +135,6 @@ static int lfs_port_prog( const struct lfs_config * c,
 
     configASSERT( xQueueGetMutexHolder( pxCtx->xMutex ) == xTaskGetCurrentTaskHandle() );
 
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Disable();
-#endif
-
 #if defined(__STM32H5xx_HAL_H) || defined(STM32L5xx_HAL_H)
   uint32_t saved_flash_latency = __HAL_FLASH_GET_LATENCY();
   __HAL_FLASH_SET_LATENCY(__HAL_FLASH_GET_LATENCY() + 2);
@@ -112,17 +146,11 @@ static int lfs_port_prog( const struct lfs_config * c,
     HAL_FLASH_Unlock();
     __HAL_FLASH_CLEAR_FLAG( FLASH_FLAG_ALL_ERRORS );
 
-    for( uint32_t i_row = 0; i_row < n_rows; i_row++ )
+    for( uint32_t i_row = 0; ( i_row < n_rows ) && ( xHAL_Status == HAL_OK ); i_row++ )
     {
         dest_address = block_base_addr + off + i_row * 4 * sizeof( uint32_t );
         src_address = ( uint32_t ) buffer + i_row * 4 * sizeof( uint32_t );
         xHAL_Status = HAL_FLASH_Program( FLASH_TYPEPROGRAM_QUADWORD, dest_address, src_address );
-
-        if( xHAL_Status != HAL_OK )
-        {
-            HAL_FLASH_Lock();
-            return -1;
-        }
     }
 
     HAL_FLASH_Lock();
@@ -132,11 +160,9 @@ static int lfs_port_prog( const struct lfs_config * c,
   (void)__HAL_FLASH_GET_LATENCY();;
 #endif
 
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Enable();
-#endif
+    prvInvalidateICache();
 
-    return 0;
+    return xHAL_Status == HAL_OK ? 0 : -1;
 }
 
 static int lfs_port_erase( const struct lfs_config * c,
@@ -148,10 +174,6 @@ static int lfs_port_erase( const struct lfs_config * c,
 
     configASSERT( xQueueGetMutexHolder( pxCtx->xMutex ) == xTaskGetCurrentTaskHandle() );
 
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Disable();
-#endif
-
 #if defined(__STM32H5xx_HAL_H) || defined(STM32L5xx_HAL_H)
   uint32_t saved_flash_latency = __HAL_FLASH_GET_LATENCY();
   __HAL_FLASH_SET_LATENCY(__HAL_FLASH_GET_LATENCY() + 2);
@@ -181,9 +203,7 @@ static int lfs_port_erase( const struct lfs_config * c,
   (void)__HAL_FLASH_GET_LATENCY();;
 #endif
 
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Enable();
-#endif
+    prvInvalidateICache();
 
     return xHAL_Status == HAL_OK ? 0 : -1;
 }
@@ -196,9 +216,6 @@ static int lfs_port_sync( const struct lfs_config * c )
 static void vPopulateConfig( struct lfs_config * pxCfg,
                              struct LfsPortCtx * pxCtx )
 {
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Disable();
-#endif
     /* Store the mutex handle as the context */
     pxCfg->context = pxCtx;
 
@@ -243,10 +260,6 @@ static void vPopulateConfig( struct lfs_config * pxCfg,
     pxCfg->file_max = 0;
     pxCfg->attr_max = 0;
     pxCfg->metadata_max = 0;
-
-#if defined(HAL_ICACHE_MODULE_ENABLED)
-  HAL_ICACHE_Enable();
-#endif
 }
 
 #ifdef LFS_NO_MALLOC
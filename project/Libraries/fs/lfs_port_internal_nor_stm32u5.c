@@ -33,8 +33,12 @@
 #include "lfs_util.h"
 #include "lfs.h"
 #include "lfs_port_prv.h"
+#include "lfs_port.h"
 
 #include "main.h"
+
+LOG_MODULE_DEFINE();
+
 #if ((!defined(HAL_OSPI_MODULE_ENABLED) || defined(LFS_USE_INTERNAL_NOR)) && defined(__STM32U5xx_HAL_CORTEX_H))
 /* Uses all pages of Bank 2
  *
@@ -55,6 +59,28 @@ static struct LfsPortCtx xLfsCtx = { 0 };
 static StaticSemaphore_t xMutexStatic;
 #endif
 
+/*
+ * See lfs_port.h.
+ */
+const void * pvLfsPortGetMappedAddress( const struct lfs_config * c,
+                                        lfs_block_t block,
+                                        lfs_off_t off,
+                                        lfs_size_t size )
+{
+    const void * pvAddr = NULL;
+
+    configASSERT( c != NULL );
+
+    if( ( block < c->block_count ) &&
+        ( off <= c->block_size ) &&
+        ( size <= ( c->block_size - off ) ) )
+    {
+        pvAddr = ( const void * ) ( CONFIG_LFS_FLASH_BASE + block * c->block_size + off );
+    }
+
+    return pvAddr;
+}
+
 static int lfs_port_read( const struct lfs_config * c,
                           lfs_block_t block,
                           lfs_off_t off,
@@ -32,19 +32,109 @@
 #include "logging.h"
 
 #include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
 #include "semphr.h"
 
 #include "lfs_util.h"
 #include "lfs.h"
+#include "lfs_port.h"
 #include "lfs_port_prv.h"
 #include "ospi_nor_mx25lmxxx45g.h"
 
+LOG_MODULE_DEFINE();
+
 extern OSPI_HandleTypeDef MX25LM_OSPI;
 
 /*
  * LittleFS port for the external NOR flash connected to the STM32U5 octo-spi interface
+ *
+ * Program and erase operations are not issued from the littlefs callbacks directly.
+ * They are queued to a flash engine task which drives the octo-spi controller, so
+ * lfs_port_prog and lfs_port_erase return as soon as the operation is queued.
+ * Syncs, and reads of a block with queued operations, drain the queue first, which
+ * keeps read-after-write ordering and reports any deferred program / erase error to
+ * littlefs. Other reads only wait for the operation the engine is running.
+ *
+ * Once the filesystem is mounted, a low priority worker also erases a small pool of
+ * blocks that littlefs does not reference, so that most erase requests from the
+ * allocator complete immediately.
+ *
+ * The port builds when the board enables the HAL OSPI module, provides MX25LM_OSPI and
+ * does not define LFS_USE_INTERNAL_NOR. The STM32H5 configurations of this project keep
+ * littlefs in internal flash, and the STM32H5 HAL drives its OCTOSPI through the XSPI
+ * module, so none of them builds it.
  */
 
+#ifndef LFS_OSPI_ENGINE_QUEUE_DEPTH
+    #define LFS_OSPI_ENGINE_QUEUE_DEPTH       ( 16 )
+#endif
+
+#ifndef LFS_OSPI_ENGINE_TASK_PRIO
+    #define LFS_OSPI_ENGINE_TASK_PRIO         ( tskIDLE_PRIORITY + 22 )
+#endif
+
+#ifndef LFS_OSPI_ENGINE_STACK_SIZE
+    #define LFS_OSPI_ENGINE_STACK_SIZE        ( 1024 )
+#endif
+
+#ifndef LFS_OSPI_ERASE_AHEAD_TASK_PRIO
+    #define LFS_OSPI_ERASE_AHEAD_TASK_PRIO    ( tskIDLE_PRIORITY + 1 )
+#endif
+
+/* Number of unreferenced blocks to keep erased ahead of the littlefs allocator */
+#ifndef LFS_OSPI_ERASE_AHEAD_POOL_SZ
+    #define LFS_OSPI_ERASE_AHEAD_POOL_SZ      ( 8 )
+#endif
+
+#define LFS_OSPI_ERASE_AHEAD_PERIOD_MS        ( 1000 )
+
+#define LFS_OSPI_NUM_BLOCKS                   ( MX25LM_MEM_SZ_USABLE / MX25LM_SECTOR_SZ )
+#define LFS_OSPI_BITMAP_WORDS                 ( ( LFS_OSPI_NUM_BLOCKS + 31 ) / 32 )
+
+typedef enum
+{
+    FLASH_OP_PROG,
+    FLASH_OP_ERASE,
+    FLASH_OP_FLUSH,
+} FlashOpType_t;
+
+typedef struct
+{
+    FlashOpType_t xType;
+    uint32_t ulAddr;
+    uint8_t ucData[ MX25LM_PROGRAM_FIFO_LEN ];
+} FlashOp_t;
+
+typedef struct
+{
+    QueueHandle_t xOpQueue;
+    SemaphoreHandle_t xFlushDone;
+    SemaphoreHandle_t xDeviceMutex; /* The octo-spi driver serves one task at a time */
+    TaskHandle_t xTaskHandle;
+    const struct lfs_config * pxCfg;
+    lfs_t * pxLfs;
+
+    /* Number of queued program / erase operations not yet completed */
+    volatile uint32_t ulPending;
+
+    /* Error from a queued operation, reported on the next flush */
+    volatile BaseType_t xDeferredError;
+
+    /* The following bitmaps are only accessed with the littlefs lock held */
+    uint32_t ulErased[ LFS_OSPI_BITMAP_WORDS ];  /* Erased and not programmed since */
+    uint32_t ulTouched[ LFS_OSPI_BITMAP_WORDS ]; /* Programmed or erased by littlefs since the last traversal */
+    uint32_t ulInUse[ LFS_OSPI_BITMAP_WORDS ];   /* Referenced by littlefs at the last traversal */
+    uint32_t ulQueued[ LFS_OSPI_BITMAP_WORDS ];  /* Programmed or erased through the queue since the last flush */
+    BaseType_t xQueuedAny;
+    uint32_t ulErasedCount;
+
+    uint32_t ulEraseAheadHits;
+    uint32_t ulEraseAheadMisses;
+} FlashEngine_t;
+
+static FlashEngine_t xFlashEngine = { 0 };
+
 #ifdef LFS_NO_MALLOC
 static uint8_t __ALIGN_BEGIN ucReadBuffer[ CONFIG_SIZE_CACHE_BUFFER ] __ALIGN_END = { 0 };
 static uint8_t __ALIGN_BEGIN ucProgBuffer[ CONFIG_SIZE_CACHE_BUFFER ] __ALIGN_END = { 0 };
@@ -73,6 +163,7 @@ static int lfs_port_erase( const struct lfs_config * pxCfg,
 
 static int lfs_port_sync( const struct lfs_config * c );
 
+static void vFlashEngineInit( const struct lfs_config * pxCfg );
 
 
 static void vPopulateConfig( struct lfs_config * pxCfg,
@@ -142,6 +233,8 @@ static void vPopulateConfig( struct lfs_config * pxCfg,
         configASSERT( xLfsCtx.xMutex != NULL );
 
         vPopulateConfig( &xLfsCfg, &xLfsCtx );
+
+        vFlashEngineInit( &xLfsCfg );
     }
 #else /* ifdef LFS_NO_MALLOC */
 
@@ -172,6 +265,8 @@ static void vPopulateConfig( struct lfs_config * pxCfg,
 
         configASSERT( xSuccess == pdTRUE );
 
+        vFlashEngineInit( pxCfg );
+
         ( void ) xSemaphoreGive( pxCtx->xMutex );
 
         return pxCfg;
@@ -179,6 +274,351 @@ static void vPopulateConfig( struct lfs_config * pxCfg,
 
 #endif /* LFS_NO_MALLOC */
 
+static inline BaseType_t xBitmapTest( const uint32_t * pulBitmap,
+                                      lfs_block_t block )
+{
+    return ( pulBitmap[ block / 32 ] & ( 1UL << ( block % 32 ) ) ) != 0 ? pdTRUE : pdFALSE;
+}
+
+static inline void vBitmapSet( uint32_t * pulBitmap,
+                               lfs_block_t block )
+{
+    pulBitmap[ block / 32 ] |= ( 1UL << ( block % 32 ) );
+}
+
+static inline void vBitmapClear( uint32_t * pulBitmap,
+                                 lfs_block_t block )
+{
+    pulBitmap[ block / 32 ] &= ~( 1UL << ( block % 32 ) );
+}
+
+static void vMarkErased( lfs_block_t block )
+{
+    if( xBitmapTest( xFlashEngine.ulErased, block ) == pdFALSE )
+    {
+        vBitmapSet( xFlashEngine.ulErased, block );
+        xFlashEngine.ulErasedCount++;
+    }
+}
+
+static void vMarkProgrammed( lfs_block_t block )
+{
+    if( xBitmapTest( xFlashEngine.ulErased, block ) == pdTRUE )
+    {
+        vBitmapClear( xFlashEngine.ulErased, block );
+        xFlashEngine.ulErasedCount--;
+    }
+}
+
+/*
+ * Execute a single queued operation. Runs in the engine task, or inline in
+ * the context of the task holding the littlefs lock when draining the queue.
+ */
+static void vFlashEngineExecute( const FlashOp_t * pxOp )
+{
+    struct LfsPortCtx * pxCtx = ( struct LfsPortCtx * ) xFlashEngine.pxCfg->context;
+    BaseType_t xSuccess = pdTRUE;
+
+    switch( pxOp->xType )
+    {
+        case FLASH_OP_PROG:
+            ( void ) xSemaphoreTake( xFlashEngine.xDeviceMutex, portMAX_DELAY );
+            xSuccess = ospi_WriteAddr( pxCtx->xpOSPIHandle,
+                                       pxOp->ulAddr,
+                                       pxOp->ucData,
+                                       MX25LM_PROGRAM_FIFO_LEN,
+                                       pdMS_TO_TICKS( MX25LM_WRITE_TIMEOUT_MS ) );
+            ( void ) xSemaphoreGive( xFlashEngine.xDeviceMutex );
+            break;
+
+        case FLASH_OP_ERASE:
+            ( void ) xSemaphoreTake( xFlashEngine.xDeviceMutex, portMAX_DELAY );
+            xSuccess = ospi_EraseSector( pxCtx->xpOSPIHandle,
+                                         pxOp->ulAddr,
+                                         pdMS_TO_TICKS( MX25LM_ERASE_TIMEOUT_MS ) );
+            ( void ) xSemaphoreGive( xFlashEngine.xDeviceMutex );
+            break;
+
+        case FLASH_OP_FLUSH:
+            ( void ) xSemaphoreGive( xFlashEngine.xFlushDone );
+            break;
+
+        default:
+            configASSERT( 0 );
+            break;
+    }
+
+    if( xSuccess != pdTRUE )
+    {
+        LogError( "Flash operation %d failed at address 0x%010lX", pxOp->xType, pxOp->ulAddr );
+        xFlashEngine.xDeferredError = pdTRUE;
+    }
+
+    if( pxOp->xType != FLASH_OP_FLUSH )
+    {
+        taskENTER_CRITICAL();
+        xFlashEngine.ulPending--;
+        taskEXIT_CRITICAL();
+    }
+}
+
+/*
+ * Queue a program or erase operation for the engine task.
+ * Must be called with the littlefs lock held.
+ */
+static BaseType_t xFlashEngineQueue( const FlashOp_t * pxOp,
+                                     TickType_t xTimeout )
+{
+    BaseType_t xResult;
+
+    taskENTER_CRITICAL();
+    xFlashEngine.ulPending++;
+    taskEXIT_CRITICAL();
+
+    xResult = xQueueSend( xFlashEngine.xOpQueue, pxOp, xTimeout );
+
+    if( xResult != pdTRUE )
+    {
+        taskENTER_CRITICAL();
+        xFlashEngine.ulPending--;
+        taskEXIT_CRITICAL();
+    }
+
+    return xResult;
+}
+
+/*
+ * Wait for all previously queued operations to complete.
+ * Must be called with the littlefs lock held.
+ * @return 0 on success, -1 if any queued operation failed.
+ */
+static int lFlashEngineFlush( void )
+{
+    static const FlashOp_t xFlushOp = { .xType = FLASH_OP_FLUSH };
+    int lReturnValue = 0;
+
+    if( xFlashEngine.ulPending > 0 )
+    {
+        ( void ) xQueueSend( xFlashEngine.xOpQueue, &xFlushOp, portMAX_DELAY );
+        ( void ) xSemaphoreTake( xFlashEngine.xFlushDone, portMAX_DELAY );
+    }
+
+    /* Nothing is queued any more, reads of any block may go straight to the device */
+    if( xFlashEngine.xQueuedAny == pdTRUE )
+    {
+        ( void ) memset( xFlashEngine.ulQueued, 0, sizeof( xFlashEngine.ulQueued ) );
+        xFlashEngine.xQueuedAny = pdFALSE;
+    }
+
+    if( xFlashEngine.xDeferredError == pdTRUE )
+    {
+        xFlashEngine.xDeferredError = pdFALSE;
+
+        /* The failed operation may have been an erase, forget what is known to be erased */
+        ( void ) memset( xFlashEngine.ulErased, 0, sizeof( xFlashEngine.ulErased ) );
+        xFlashEngine.ulErasedCount = 0;
+
+        lReturnValue = -1;
+    }
+
+    return lReturnValue;
+}
+
+static int lTraverseCallback( void * pvData,
+                              lfs_block_t block )
+{
+    ( void ) pvData;
+
+    if( block < LFS_OSPI_NUM_BLOCKS )
+    {
+        vBitmapSet( xFlashEngine.ulInUse, block );
+    }
+
+    return 0;
+}
+
+/*
+ * Erase a few blocks that littlefs does not reference so that subsequent
+ * lfs_port_erase calls can complete without waiting for the device.
+ *
+ * A block is only a candidate when it was unreferenced during the traversal
+ * and has not been programmed or erased by littlefs since the traversal began.
+ * littlefs only ever makes a block live by programming it through this port,
+ * so such a block is guaranteed to still be free.
+ */
+static void vFlashEngineEraseAhead( void )
+{
+    struct LfsPortCtx * pxCtx = ( struct LfsPortCtx * ) xFlashEngine.pxCfg->context;
+    BaseType_t xResult;
+    int lErr;
+
+    /* Only run when littlefs is idle, never delay foreground operations */
+    if( xSemaphoreTake( pxCtx->xMutex, 0 ) != pdTRUE )
+    {
+        return;
+    }
+
+    if( xFlashEngine.ulErasedCount >= LFS_OSPI_ERASE_AHEAD_POOL_SZ )
+    {
+        ( void ) xSemaphoreGive( pxCtx->xMutex );
+        return;
+    }
+
+    ( void ) memset( xFlashEngine.ulTouched, 0, sizeof( xFlashEngine.ulTouched ) );
+    ( void ) memset( xFlashEngine.ulInUse, 0, sizeof( xFlashEngine.ulInUse ) );
+    ( void ) xSemaphoreGive( pxCtx->xMutex );
+
+    /* lfs_fs_traverse takes the littlefs lock itself */
+    lErr = lfs_fs_traverse( xFlashEngine.pxLfs, lTraverseCallback, NULL );
+
+    if( lErr < 0 )
+    {
+        LogWarn( "Failed to traverse the filesystem: %d", lErr );
+        return;
+    }
+
+    /*
+     * The traversal result stays valid after the lock is released: any block
+     * littlefs starts using from now on is marked in ulTouched first.
+     */
+    while( xFlashEngine.ulErasedCount < LFS_OSPI_ERASE_AHEAD_POOL_SZ )
+    {
+        lfs_block_t xBlock = 0;
+
+        if( xSemaphoreTake( pxCtx->xMutex, 0 ) != pdTRUE )
+        {
+            break;
+        }
+
+        /* Leave queued work and its errors to the foreground task */
+        if( ( xFlashEngine.ulPending > 0 ) || ( xFlashEngine.xDeferredError == pdTRUE ) )
+        {
+            ( void ) xSemaphoreGive( pxCtx->xMutex );
+            break;
+        }
+
+        while( ( xBlock < xFlashEngine.pxCfg->block_count ) &&
+               ( ( xBitmapTest( xFlashEngine.ulInUse, xBlock ) == pdTRUE ) ||
+                 ( xBitmapTest( xFlashEngine.ulTouched, xBlock ) == pdTRUE ) ||
+                 ( xBitmapTest( xFlashEngine.ulErased, xBlock ) == pdTRUE ) ) )
+        {
+            xBlock++;
+        }
+
+        if( xBlock >= xFlashEngine.pxCfg->block_count )
+        {
+            ( void ) xSemaphoreGive( pxCtx->xMutex );
+            break;
+        }
+
+        ( void ) xSemaphoreTake( xFlashEngine.xDeviceMutex, portMAX_DELAY );
+        xResult = ospi_EraseSector( pxCtx->xpOSPIHandle,
+                                    OPI_START_ADDRESS + ( xBlock * xFlashEngine.pxCfg->block_size ),
+                                    pdMS_TO_TICKS( MX25LM_ERASE_TIMEOUT_MS ) );
+        ( void ) xSemaphoreGive( xFlashEngine.xDeviceMutex );
+
+        if( xResult != pdTRUE )
+        {
+            LogError( "Erase ahead of block %lu failed.", xBlock );
+            ( void ) xSemaphoreGive( pxCtx->xMutex );
+            break;
+        }
+
+        vMarkErased( xBlock );
+
+        /* Release the lock between erases so a waiting foreground task is not held off for long */
+        ( void ) xSemaphoreGive( pxCtx->xMutex );
+    }
+}
+
+static void vFlashEngineTask( void * pvParameters )
+{
+    static FlashOp_t xOp;
+
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        if( xQueueReceive( xFlashEngine.xOpQueue, &xOp, portMAX_DELAY ) == pdTRUE )
+        {
+            vFlashEngineExecute( &xOp );
+        }
+    }
+}
+
+/*
+ * Kept separate from the engine task: the traversal takes the littlefs lock,
+ * and the task holding that lock may itself be waiting on the engine.
+ */
+static void vEraseAheadTask( void * pvParameters )
+{
+    ( void ) pvParameters;
+
+    for( ; ; )
+    {
+        vTaskDelay( pdMS_TO_TICKS( LFS_OSPI_ERASE_AHEAD_PERIOD_MS ) );
+
+        if( xFlashEngine.ulErasedCount < LFS_OSPI_ERASE_AHEAD_POOL_SZ )
+        {
+            vFlashEngineEraseAhead();
+        }
+    }
+}
+
+static void vFlashEngineInit( const struct lfs_config * pxCfg )
+{
+    BaseType_t xResult;
+
+    configASSERT( pxCfg->block_count <= LFS_OSPI_NUM_BLOCKS );
+
+    xFlashEngine.pxCfg = pxCfg;
+    xFlashEngine.pxLfs = NULL;
+    xFlashEngine.ulPending = 0;
+    xFlashEngine.xDeferredError = pdFALSE;
+    xFlashEngine.ulErasedCount = 0;
+
+    xFlashEngine.xOpQueue = xQueueCreate( LFS_OSPI_ENGINE_QUEUE_DEPTH, sizeof( FlashOp_t ) );
+    configASSERT( xFlashEngine.xOpQueue != NULL );
+
+    xFlashEngine.xFlushDone = xSemaphoreCreateBinary();
+    configASSERT( xFlashEngine.xFlushDone != NULL );
+
+    xFlashEngine.xDeviceMutex = xSemaphoreCreateMutex();
+    configASSERT( xFlashEngine.xDeviceMutex != NULL );
+
+    xResult = xTaskCreate( vFlashEngineTask,
+                           "OspiFlash",
+                           LFS_OSPI_ENGINE_STACK_SIZE,
+                           NULL,
+                           LFS_OSPI_ENGINE_TASK_PRIO,
+                           &xFlashEngine.xTaskHandle );
+    configASSERT( xResult == pdPASS );
+}
+
+/*
+ * Start the erase ahead worker once the filesystem has been mounted.
+ * @param pxLfs Mounted littlefs instance using this block device
+ */
+void vLfsPortOspiEnableEraseAhead( lfs_t * pxLfs )
+{
+    BaseType_t xResult;
+
+    configASSERT( pxLfs != NULL );
+
+    if( xFlashEngine.pxLfs == NULL )
+    {
+        xFlashEngine.pxLfs = pxLfs;
+
+        xResult = xTaskCreate( vEraseAheadTask,
+                               "OspiErase",
+                               LFS_OSPI_ENGINE_STACK_SIZE,
+                               NULL,
+                               LFS_OSPI_ERASE_AHEAD_TASK_PRIO,
+                               NULL );
+        configASSERT( xResult == pdPASS );
+    }
+}
+
 /*
  * Read bytes from the NOR flash device
  * @param c lfs_config structure for this block device
@@ -204,13 +644,26 @@ static int lfs_port_read( const struct lfs_config * c,
 
     uint32_t ulReadAddr = OPI_START_ADDRESS + ( block * c->block_size ) + off;
 
-    if( ospi_ReadAddr( pxCtx->xpOSPIHandle,
-                       ulReadAddr,
-                       pvBuffer,
-                       size,
-                       pdMS_TO_TICKS( MX25LM_READ_TIMEOUT_MS ) ) != pdTRUE )
+    /* Operations queued on other blocks keep running, the read only waits for the current one */
+    if( xBitmapTest( xFlashEngine.ulQueued, block ) == pdTRUE )
     {
-        lReturnValue = -1;
+        lReturnValue = lFlashEngineFlush();
+    }
+
+    if( lReturnValue == 0 )
+    {
+        ( void ) xSemaphoreTake( xFlashEngine.xDeviceMutex, portMAX_DELAY );
+
+        if( ospi_ReadAddr( pxCtx->xpOSPIHandle,
+                           ulReadAddr,
+                           pvBuffer,
+                           size,
+                           pdMS_TO_TICKS( MX25LM_READ_TIMEOUT_MS ) ) != pdTRUE )
+        {
+            lReturnValue = -1;
+        }
+
+        ( void ) xSemaphoreGive( xFlashEngine.xDeviceMutex );
     }
 
     LogDebug( "Reading address 0x%010lX, size: %lu, rv: %ld", ulReadAddr, size, lReturnValue );
@@ -225,14 +678,14 @@ static int lfs_port_prog( const struct lfs_config * pxCfg,
                           const void * pvBuffer,
                           lfs_size_t size )
 {
+    static FlashOp_t xOp;
+
     /* validate arguments */
     configASSERT( pxCfg != NULL );
     configASSERT( block < pxCfg->block_count );
     configASSERT( pvBuffer != NULL );
     configASSERT( size > 0 );
 
-    struct LfsPortCtx * pxCtx = ( struct LfsPortCtx * ) pxCfg->context;
-
     int32_t lReturnValue = 0;
 
     configASSERT( ( size % MX25LM_PROGRAM_FIFO_LEN ) == 0 );
@@ -242,18 +695,22 @@ static int lfs_port_prog( const struct lfs_config * pxCfg,
 
     uint32_t ulLastAddr = ulStartAddr + size - MX25LM_PROGRAM_FIFO_LEN;
 
-    LogDebug( "Programming Start Addr: 0x%010lX, End Addr: 0x%010lX, size: %lu, block: %lu, offset: %lu, rv: %ld",
-              ulStartAddr, ulLastAddr, size, block, off, lReturnValue );
+    LogDebug( "Queuing program Start Addr: 0x%010lX, End Addr: 0x%010lX, size: %lu, block: %lu, offset: %lu",
+              ulStartAddr, ulLastAddr, size, block, off );
+
+    vMarkProgrammed( block );
+    vBitmapSet( xFlashEngine.ulTouched, block );
+    vBitmapSet( xFlashEngine.ulQueued, block );
+    xFlashEngine.xQueuedAny = pdTRUE;
+
+    xOp.xType = FLASH_OP_PROG;
 
     for( uint32_t ulWriteAddr = ulStartAddr; ulWriteAddr <= ulLastAddr; ulWriteAddr += MX25LM_PROGRAM_FIFO_LEN )
     {
-        LogDebug( "Writing block at addr: 0x%010lX, len: %lu", ulWriteAddr, MX25LM_PROGRAM_FIFO_LEN );
+        xOp.ulAddr = ulWriteAddr;
+        ( void ) memcpy( xOp.ucData, &( ( ( const uint8_t * ) pvBuffer )[ ulWriteAddr - ulStartAddr ] ), MX25LM_PROGRAM_FIFO_LEN );
 
-        if( ospi_WriteAddr( pxCtx->xpOSPIHandle,
-                            ulWriteAddr,
-                            &( ( ( uint8_t * ) pvBuffer )[ ulWriteAddr - ulStartAddr ] ),
-                            MX25LM_PROGRAM_FIFO_LEN,
-                            pdMS_TO_TICKS( MX25LM_WRITE_TIMEOUT_MS ) ) != pdTRUE )
+        if( xFlashEngineQueue( &xOp, pdMS_TO_TICKS( MX25LM_WRITE_TIMEOUT_MS ) ) != pdTRUE )
         {
             lReturnValue = -1;
             break;
@@ -266,31 +723,51 @@ static int lfs_port_prog( const struct lfs_config * pxCfg,
 static int lfs_port_erase( const struct lfs_config * pxCfg,
                            lfs_block_t block )
 {
+    static FlashOp_t xOp;
+
     configASSERT( pxCfg != NULL );
     configASSERT( block < pxCfg->block_count );
 
     int32_t lReturnValue = 0;
-    struct LfsPortCtx * pxCtx = ( struct LfsPortCtx * ) pxCfg->context;
-
-    /* Determine the 4-byte erase address */
-    uint32_t ulEraseAddr = OPI_START_ADDRESS + ( block * pxCfg->block_size );
 
-    LogDebug( "Starting erase operation addr: 0x%010lX ", ulEraseAddr );
+    vBitmapSet( xFlashEngine.ulTouched, block );
 
-    if( ospi_EraseSector( pxCtx->xpOSPIHandle,
-                          ulEraseAddr,
-                          pdMS_TO_TICKS( MX25LM_ERASE_TIMEOUT_MS ) ) != pdTRUE )
+    if( xBitmapTest( xFlashEngine.ulErased, block ) == pdTRUE )
     {
-        lReturnValue = -1;
+        /* Already erased ahead of time and not programmed since */
+        xFlashEngine.ulEraseAheadHits++;
+        LogDebug( "Block %lu was erased ahead, hits: %lu", block, xFlashEngine.ulEraseAheadHits );
     }
+    else
+    {
+        xFlashEngine.ulEraseAheadMisses++;
+
+        xOp.xType = FLASH_OP_ERASE;
+        /* Determine the 4-byte erase address */
+        xOp.ulAddr = OPI_START_ADDRESS + ( block * pxCfg->block_size );
+
+        LogDebug( "Queuing erase operation addr: 0x%010lX ", xOp.ulAddr );
 
-    LogDebug( "Erase operation completed. Address: 0x%010lX Return Value: %ld", ulEraseAddr, lReturnValue );
+        vBitmapSet( xFlashEngine.ulQueued, block );
+        xFlashEngine.xQueuedAny = pdTRUE;
+
+        if( xFlashEngineQueue( &xOp, pdMS_TO_TICKS( MX25LM_ERASE_TIMEOUT_MS ) ) != pdTRUE )
+        {
+            lReturnValue = -1;
+        }
+        else
+        {
+            vMarkErased( block );
+        }
+    }
 
     return lReturnValue;
 }
 
 static int lfs_port_sync( const struct lfs_config * c )
 {
-    return 0;
+    ( void ) c;
+
+    return lFlashEngineFlush();
 }
 #endif /* HAL_OSPI_MODULE_ENABLED */
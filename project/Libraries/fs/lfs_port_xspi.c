@@ -40,6 +40,9 @@
 #include "stm32_extmem.h"
 #include "stm32_extmem_conf.h"
 #include "xspi_nor_mx66uw1g45g.h"
+
+LOG_MODULE_DEFINE();
+
 /*
  * LittleFS port for the external NOR flash connected to the STM32U5 octo-spi interface
  */
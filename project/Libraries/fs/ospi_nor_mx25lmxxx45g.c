@@ -34,6 +34,8 @@
 
 #include "ospi_nor_mx25lmxxx45g.h"
 
+LOG_MODULE_DEFINE();
+
 static TaskHandle_t xTaskHandle = NULL;
 
 static inline void ospi_HandleCallback( OSPI_HandleTypeDef * pxOSPI,
@@ -693,7 +695,15 @@ BaseType_t ospi_WriteAddr( OSPI_HandleTypeDef * pxOSPI,
     {
         #pragma GCC diagnostic push
         #pragma GCC diagnostic ignored "-Wdiscarded-qualifiers"
-        xHalStatus = HAL_OSPI_Transmit_IT( pxOSPI, pxBuffer );
+        /* Feed the page program FIFO by DMA when HAL_OSPI_MspInit linked a channel to the handle */
+        if( pxOSPI->hdma != NULL )
+        {
+            xHalStatus = HAL_OSPI_Transmit_DMA( pxOSPI, pxBuffer );
+        }
+        else
+        {
+            xHalStatus = HAL_OSPI_Transmit_IT( pxOSPI, pxBuffer );
+        }
         #pragma GCC diagnostic pop
     }
 
@@ -708,9 +718,7 @@ BaseType_t ospi_WriteAddr( OSPI_HandleTypeDef * pxOSPI,
 
     if( xSuccess == pdTRUE )
     {
-        vTaskDelay( 1 );
-
-        /* Wait for idle condition (WIP bit should be 0) */
+        /* Auto-polling raises the status match interrupt as soon as the program completes */
         xSuccess = ospi_OPI_WaitForStatus( pxOSPI,
                                            MX25LM_REG_SR_WIP | MX25LM_REG_SR_WEL,
                                            0x0,
@@ -811,8 +819,7 @@ BaseType_t ospi_EraseSector( OSPI_HandleTypeDef * pxOSPI,
 
     if( xSuccess == pdTRUE )
     {
-        vTaskDelay( 1 );
-        /* Wait for idle condition (WIP bit should be 0) */
+        /* Auto-polling raises the status match interrupt as soon as the erase completes */
         xSuccess = ospi_OPI_WaitForStatus( pxOSPI,
                                            MX25LM_REG_SR_WEL | MX25LM_REG_SR_WIP,
                                            0x0,
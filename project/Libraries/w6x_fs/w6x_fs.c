@@ -31,6 +31,8 @@
 #include "w6x_types.h"
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
 /* Private typedef -----------------------------------------------------------*/
 
 /* Private Macro -------------------------------------------------------------*/
@@ -26,15 +26,30 @@
 #define LOG_LEVEL    LOG_INFO
 
 #include "FreeRTOS.h"
-#include "queue.h"
+#include "task.h"
 #include "semphr.h"
+#include "stream_buffer.h"
 
 #include "core_mqtt_serializer.h"
 #include "core_mqtt.h"
 
 #include "w6x_api.h"
+#include "w6x_mqtt_rx.h"
 #include <string.h>
 
+LOG_MODULE_DEFINE();
+
+/**
+ * @brief Header of a publish in the receive buffer, followed by the topic and
+ * the payload.
+ */
+typedef struct
+{
+  uint16_t usTopicLength;
+  uint16_t usReserved;
+  uint32_t ulPayloadLength;
+} W6XMqttRxHeader_t;
+
 /* Private Macro -------------------------------------------------------------*/
 #ifndef MQTT_PRE_SEND_HOOK
 
@@ -72,7 +87,14 @@
 /* Private Variables ---------------------------------------------------------*/
 W6X_MQTT_Data_t *pxMQTTRecvData;
 
-QueueHandle_t xSubMsgQueue = NULL;
+/* Receive buffer: xW6XMqttRxPush, its only writer, appends the publishes and the
+ * subscription task copies them out one at a time into ucRxPublish to deliver them.
+ * A publish only takes the bytes it needs. */
+static StreamBufferHandle_t xRxStream = NULL;
+static uint8_t ucRxPublish[MQTT_AGENT_NETWORK_BUFFER_SIZE]; /* Topic followed by the payload */
+static W6XMqttRxStats_t xRxStats;
+
+static TaskHandle_t xSubTaskHandle = NULL;
 
 static SemaphoreHandle_t xW6XMutex;
 /* Private Function prototypes -----------------------------------------------*/
@@ -375,6 +397,19 @@ static bool matchTopicFilter( const char * pTopicName,
 
 /*-----------------------------------------------------------*/
 
+/**
+ * @brief Read exactly xLength bytes from the receive buffer, waiting for them as needed.
+ */
+static void prvRxRead(uint8_t *pucData, size_t xLength)
+{
+  size_t xRead = 0;
+
+  while (xRead < xLength)
+  {
+    xRead += xStreamBufferReceive(xRxStream, &pucData[xRead], xLength - xRead, portMAX_DELAY);
+  }
+}
+
 /**
  * @brief prvIncomingPublishCallback
  * @param pvParameters Pointer to parameters (unused in this task)
@@ -394,33 +429,115 @@ static void prvIncomingPublishCallback(void *pvParameters)
   /* Main processing loop */
   for (;;)
   {
-    int32_t xStatus = pdTRUE;
+    W6XMqttRxHeader_t xHeader;
 
-    xStatus = xQueueReceive(xSubMsgQueue, &mqtt_data, portMAX_DELAY);
+    /* xW6XMqttRxPush checked that the publish fits in ucRxPublish */
+    prvRxRead((uint8_t *)&xHeader, sizeof(xHeader));
+    prvRxRead(ucRxPublish, (size_t)xHeader.usTopicLength + xHeader.ulPayloadLength);
 
-    if (xStatus == pdTRUE)
-    {
-      deserializedInfo.packetIdentifier      = 0;
-      deserializedInfo.deserializationResult = MQTTSuccess;
-      deserializedInfo.pPublishInfo          = &mqtt_data;
+    mqtt_data.qos    = MQTTQoS0;
+    mqtt_data.retain = false;
+    mqtt_data.dup    = false;
 
-      IncomingPacket.headerLength    = sizeof(MQTTPacketInfo_t);
-      IncomingPacket.pRemainingData  = NULL;
-      IncomingPacket.remainingLength = 0;
-      IncomingPacket.type            = MQTT_PACKET_TYPE_PUBLISH;
+    mqtt_data.pTopicName      = (const char *)ucRxPublish;
+    mqtt_data.topicNameLength = xHeader.usTopicLength;
+    mqtt_data.pPayload        = &ucRxPublish[xHeader.usTopicLength];
+    mqtt_data.payloadLength   = xHeader.ulPayloadLength;
 
-      pContext->appCallback( pContext, &IncomingPacket, &deserializedInfo );
+    deserializedInfo.packetIdentifier      = 0;
+    deserializedInfo.deserializationResult = MQTTSuccess;
+    deserializedInfo.pPublishInfo          = &mqtt_data;
 
-      /* Free the allocated topic and message */
-      vPortFree((char * )mqtt_data.pTopicName);
-      vPortFree((char * )mqtt_data.pPayload);
-    }
+    IncomingPacket.headerLength    = sizeof(MQTTPacketInfo_t);
+    IncomingPacket.pRemainingData  = NULL;
+    IncomingPacket.remainingLength = 0;
+    IncomingPacket.type            = MQTT_PACKET_TYPE_PUBLISH;
+
+    pContext->appCallback( pContext, &IncomingPacket, &deserializedInfo );
   }
 
   /* Suspend the task (unlikely to reach here) */
   vTaskSuspend(NULL);
 }
 
+/*-----------------------------------------------------------*/
+
+BaseType_t xW6XMqttRxPush(const char *pcTopic, uint16_t usTopicLength,
+                          const void *pvPayload, size_t xPayloadLength)
+{
+  W6XMqttRxHeader_t xHeader;
+  size_t xLength = sizeof(xHeader) + usTopicLength + xPayloadLength;
+  uint32_t ulOverflow;
+  size_t xInUse;
+
+  if (xRxStream == NULL)
+  {
+    return pdFAIL;
+  }
+
+  if ((((size_t)usTopicLength + xPayloadLength) > sizeof(ucRxPublish)) ||
+      (xLength > W6X_MQTT_RX_BUFFER_SIZE))
+  {
+    taskENTER_CRITICAL();
+    xRxStats.ulOversize++;
+    taskEXIT_CRITICAL();
+    LogWarn("Publish of %u bytes does not fit in the receive buffer, dropped.",
+            (unsigned int)(usTopicLength + xPayloadLength));
+    return pdFAIL;
+  }
+
+  /* Being the only writer, the space can only grow until the whole publish is written */
+  if (xStreamBufferSpacesAvailable(xRxStream) < xLength)
+  {
+    taskENTER_CRITICAL();
+    ulOverflow = ++xRxStats.ulOverflow;
+    taskEXIT_CRITICAL();
+    LogWarn("MQTT receive buffer full, publish dropped (%lu overflows).", (unsigned long)ulOverflow);
+    return pdFAIL;
+  }
+
+  xHeader.usTopicLength = usTopicLength;
+  xHeader.usReserved = 0;
+  xHeader.ulPayloadLength = (uint32_t)xPayloadLength;
+
+  /* Each send wakes the subscription task, prvRxRead waits for the rest of the publish */
+  (void) xStreamBufferSend(xRxStream, &xHeader, sizeof(xHeader), 0);
+  if (usTopicLength > 0U)
+  {
+    (void) xStreamBufferSend(xRxStream, pcTopic, usTopicLength, 0);
+  }
+  if (xPayloadLength > 0U)
+  {
+    (void) xStreamBufferSend(xRxStream, pvPayload, xPayloadLength, 0);
+  }
+  xInUse = xStreamBufferBytesAvailable(xRxStream);
+
+  taskENTER_CRITICAL();
+  xRxStats.ulReceived++;
+  if (xInUse > xRxStats.ulHighWater)
+  {
+    xRxStats.ulHighWater = (uint32_t)xInUse;
+  }
+  taskEXIT_CRITICAL();
+
+  return pdPASS;
+}
+
+/*-----------------------------------------------------------*/
+
+void vW6XMqttRxGetStats(W6XMqttRxStats_t *pxStats, uint32_t ulReset)
+{
+  taskENTER_CRITICAL();
+  *pxStats = xRxStats;
+  pxStats->ulBufferSize = W6X_MQTT_RX_BUFFER_SIZE;
+  if (ulReset != 0U)
+  {
+    (void) memset(&xRxStats, 0, sizeof(xRxStats));
+    xRxStats.xStartTick = xTaskGetTickCount();
+  }
+  taskEXIT_CRITICAL();
+}
+
 /*-----------------------------------------------------------*/
 #if 0
 static MQTTStatus_t handleIncomingPublish( MQTTContext_t * pContext,
@@ -805,16 +922,27 @@ MQTTStatus_t MQTT_Init( MQTTContext_t * pContext,
       /* Create W6X Mutex */
       xW6XMutex = xSemaphoreCreateMutex();
 
-      /* Create a queue for subscribed messages */
-      xSubMsgQueue = xQueueCreate(10, sizeof(MQTTPublishInfo_t));
-
-      if (xSubMsgQueue == NULL)
+      /* The subscription task delivers the publishes stored in the receive buffer */
+      if (xSubTaskHandle == NULL)
       {
-        LogError("Failed to create message queue.");
-        vTaskSuspend(NULL);
-      }
+        xRxStats.xStartTick = xTaskGetTickCount();
 
-      xTaskCreate(prvIncomingPublishCallback, "mqtt_sub", TASK_STACK_SIZE_SUBSCRIPTION, pContext, TASK_PRIO_SUBSCRIPTION, NULL);
+        /* Trigger level of one byte, a short topic and payload may be less than a header */
+        xRxStream = xStreamBufferCreate(W6X_MQTT_RX_BUFFER_SIZE, 1);
+
+        if (xRxStream == NULL)
+        {
+          LogError("Failed to create the receive buffer.");
+          vTaskSuspend(NULL);
+        }
+
+        if (xTaskCreate(prvIncomingPublishCallback, "mqtt_sub", TASK_STACK_SIZE_SUBSCRIPTION, pContext,
+                        TASK_PRIO_SUBSCRIPTION, &xSubTaskHandle) != pdPASS)
+        {
+          LogError("Failed to create the subscription task.");
+          vTaskSuspend(NULL);
+        }
+      }
   }
 
   return status;
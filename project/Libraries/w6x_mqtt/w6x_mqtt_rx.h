@@ -0,0 +1,59 @@
+/* USER CODE BEGIN Header */
+/**
+ ******************************************************************************
+ * @file           : w6x_mqtt_rx.h
+ * @date           :
+ * @brief          : Stream buffer holding the publishes received from the
+ *                   ST67W6X MQTT client until the subscription task delivers them.
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2024 STMicroelectronics.
+ * All rights reserved.
+ *
+ * This software is licensed under terms that can be found in the LICENSE file
+ * in the root directory of this software component.
+ * If no LICENSE file comes with this software, it is provided AS-IS.
+ *
+ ******************************************************************************
+ */
+/* USER CODE END Header */
+#ifndef _W6X_MQTT_RX_
+#define _W6X_MQTT_RX_
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t   ulReceived;    /* Publishes stored in the ring */
+  uint32_t   ulOverflow;    /* Publishes dropped, not enough free space in the buffer */
+  uint32_t   ulOversize;    /* Publishes dropped, topic + payload larger than the buffer */
+  uint32_t   ulHighWater;   /* Most bytes in use at once */
+  uint32_t   ulBufferSize;  /* W6X_MQTT_RX_BUFFER_SIZE */
+  TickType_t xStartTick;    /* Tick of the last reset of the counters */
+} W6XMqttRxStats_t;
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported macro ------------------------------------------------------------*/
+
+/* Exported functions prototypes ---------------------------------------------*/
+
+/**
+ * @brief Copy a received publish into the receive buffer, which wakes the subscription task.
+ *        Called from the ST67W6X MQTT event callback, the driver buffers are reused afterwards.
+ * @return pdPASS, or pdFAIL if the publish was dropped (counted in the statistics).
+ */
+BaseType_t xW6XMqttRxPush(const char *pcTopic, uint16_t usTopicLength,
+                          const void *pvPayload, size_t xPayloadLength);
+
+/**
+ * @brief Get the receive buffer statistics, optionally clearing the counters afterwards.
+ */
+void vW6XMqttRxGetStats(W6XMqttRxStats_t *pxStats, uint32_t ulReset);
+
+#endif /* _W6X_MQTT_RX_ */
@@ -827,7 +827,9 @@ W6X_Status_t W6X_OTA_Send(uint8_t *buff, uint32_t len);
   * @param  result_fn: Callback function to call when the request is done
   * @param  callback_arg: Argument to pass to the callback function
   * @param  headers_done_fn: Callback function to call when the headers are received
-  * @param  data_fn: Callback function to call when data is received
+  * @param  data_fn: Callback function to call when data is received. It is called once more with a
+  *         NULL buffer when the request ends, unless it returned an error itself: err is 0 at the
+  *         end of the body, -1 when the request failed
   * @param  settings: Settings to use for the HTTP request
   * @return Operation status.
   */
@@ -1253,6 +1253,9 @@ typedef struct
   void *recv_fn_arg;                          /*!< Receive callback argument */
   uint32_t timeout;                           /*!< Timeout */
   uint32_t max_response_len;                  /*!< Maximum response length */
+  uint8_t use_range;                          /*!< Request a byte range of the resource (GET only) */
+  uint32_t range_start;                       /*!< First byte of the range, inclusive */
+  uint32_t range_end;                         /*!< Last byte of the range, inclusive */
 } W6X_HTTP_connection_t;
 
 /** @} */
@@ -23,6 +23,8 @@
 #include "w6x_internal.h"
 #include "w61_io.h"        /* Prototypes of the BUS functions to be registered */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
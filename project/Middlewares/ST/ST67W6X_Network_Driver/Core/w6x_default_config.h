@@ -151,6 +151,14 @@ extern "C" {
 #define W6X_NET_RECV_BUFFER_SIZE                (2 * 3 * 1536)
 #endif /* W6X_NET_RECV_BUFFER_SIZE */
 
+#ifndef W6X_NET_RECV_RING_SIZE
+/** Size of the host buffer allocated per TCP/SSL connection on its first partial read.
+  * When W6X_Net_Recv() asks for less than the NCP holds, up to this many bytes are pulled
+  * in one AT exchange and the following reads are served from the buffer.
+  * Set to 0 to always pull exactly the requested length */
+#define W6X_NET_RECV_RING_SIZE                  2048
+#endif /* W6X_NET_RECV_RING_SIZE */
+
 /** @} */
 
 /** @addtogroup ST67W6X_API_HTTP_Public_Constants
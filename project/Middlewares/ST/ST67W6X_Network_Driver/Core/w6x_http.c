@@ -73,6 +73,8 @@
 #include "common_parser.h" /* Common Parser functions */
 #include "w6x_default_config.h"
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /** @defgroup ST67W6X_Private_HTTP_Types ST67W6X HTTP Types
@@ -187,6 +189,23 @@ struct http_request_task_obj
 #define HTTPC_REQ_11_HOST_FORMAT(uri, srv_name) \
   HTTPC_REQ_11_HOST, uri, W6X_HTTP_CLIENT_AGENT, srv_name
 
+/** GET request of a byte range with host */
+#define HTTPC_REQ_11_HOST_RANGE                                                        \
+  "GET %s HTTP/1.1\r\n"   /* URI */                                                    \
+  "User-Agent: %s\r\n"    /* User-Agent */                                             \
+  "Accept: */*\r\n"                                                                    \
+  "Host: %s\r\n"          /* server name */                                            \
+  "Range: bytes=%" PRIu32 "-%" PRIu32 "\r\n" /* first and last byte of the range */   \
+  "Connection: Close\r\n" /* we don't support persistent connections, yet */           \
+  "\r\n"
+
+/** GET request of a byte range with host format */
+#define HTTPC_REQ_11_HOST_RANGE_FORMAT(uri, srv_name, start, end) \
+  HTTPC_REQ_11_HOST_RANGE, uri, W6X_HTTP_CLIENT_AGENT, srv_name, start, end
+
+/** Room for the two decimal range bounds of HTTPC_REQ_11_HOST_RANGE */
+#define HTTPC_REQ_RANGE_DIGITS              20U
+
 /** GET request with proxy */
 #define HTTPC_REQ_11_PROXY                                                             \
   "GET http://%s%s HTTP/1.1\r\n" /* HOST, URI */                                       \
@@ -480,6 +499,7 @@ static void W6X_HTTP_Client_task(void *arg)
   uint8_t *req_buffer = NULL;
   int32_t count_done;
   int32_t error = -1;
+  int32_t recv_error = 0;
   W6X_HTTP_buffer_t *buff_head;
   W6X_HTTP_Status_Code_e http_status = HTTP_VERSION_NOT_SUPPORTED;
   W6X_HTTP_Status_Category_e http_category = HTTP_CATEGORY_UNKNOWN;
@@ -525,6 +545,26 @@ static void W6X_HTTP_Client_task(void *arg)
     /* Prepare send request */
     req_len2 = snprintf((char *)req_buffer, req_len, HTTPC_REQ_HEAD_11_FORMAT(Obj->uri, host_name));
   }
+  else if ((strncmp(Obj->method, "GET", 3) == 0) && (Obj->settings.use_range != 0))
+  {
+    /* Ranges are used for virtual hosted resources, send the server name when it is known */
+    const char *range_host = (Obj->settings.server_name != NULL) ? Obj->settings.server_name : host_name;
+
+    method = W6X_HTTP_REQ_TYPE_GET;
+    /* Get the length of the HTTP request */
+    req_len = strlen(HTTPC_REQ_11_HOST_RANGE) + strlen(Obj->uri) + strlen(W6X_HTTP_CLIENT_AGENT) + strlen(range_host)
+              + HTTPC_REQ_RANGE_DIGITS;
+    /* Allocate dynamically the HTTP request based on previous result */
+    req_buffer = pvPortMalloc(req_len);
+    if (req_buffer == NULL)
+    {
+      goto _err;
+    }
+    /* Prepare send request */
+    req_len2 = snprintf((char *)req_buffer, req_len,
+                        HTTPC_REQ_11_HOST_RANGE_FORMAT(Obj->uri, range_host,
+                                                       Obj->settings.range_start, Obj->settings.range_end));
+  }
   else if (strncmp(Obj->method, "GET", 3) == 0)
   {
     method = W6X_HTTP_REQ_TYPE_GET;
@@ -669,6 +709,7 @@ static void W6X_HTTP_Client_task(void *arg)
     if ((Obj->settings.recv_fn) && ((Obj->settings.recv_fn)(Obj->settings.recv_fn_arg, buff_head, 0) < 0))
     {
       LogError("User function for received data processing returned an error");
+      recv_error = -1;
       break;
     }
     if ((content_length > 0) && (total_recv_data >= content_length))
@@ -679,6 +720,12 @@ static void W6X_HTTP_Client_task(void *arg)
     buff_head->length = W6X_Net_Recv(Obj->sock, &buff_head->data[0], W6X_HTTP_HEAD_MAX_RESP_BUFFER_SIZE, 0);
   }
 
+  /* Signal the end of the body so that the callback can tell a complete body from a short one */
+  if ((Obj->settings.recv_fn) && (recv_error == 0))
+  {
+    (void)(Obj->settings.recv_fn)(Obj->settings.recv_fn_arg, NULL, 0);
+  }
+
   vPortFree(buff_head);
   error = 0;
 
@@ -25,6 +25,8 @@
 #include "w61_io.h"        /* Prototypes of the BUS functions to be registered */
 #include "common_parser.h" /* Common Parser functions */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /** @defgroup ST67W6X_Private_Net_Types ST67W6X Net Types
@@ -96,6 +98,9 @@ typedef struct
   uint8_t RemoteIP[4];              /*!< IP address of device */
   SemaphoreHandle_t DataAvailable;  /*!< Semaphore for data available */
   uint32_t DataAvailableSize;       /*!< Counter for data available */
+  uint8_t *RxRing;                  /*!< Data pulled ahead from the NCP, allocated on first use */
+  uint32_t RxRingHead;              /*!< Offset of the next byte to return from RxRing */
+  uint32_t RxRingCount;             /*!< Number of bytes left in RxRing */
 } W6X_Net_Connection_t;
 
 /**
@@ -197,6 +202,12 @@ static int32_t W6X_Net_Poll_UDP_Sockets(struct sockaddr_in *remote_addr);
   */
 static int32_t W6X_Net_Wait_Pull_Data(int32_t sock, int32_t connection_id, void *buf, size_t max_len);
 
+/**
+  * @brief  Drop the data pulled ahead on a connection and release its buffer
+  * @param  connection_id: connection number
+  */
+static void W6X_Net_Free_RxRing(int32_t connection_id);
+
 /** @} */
 
 /* Functions Definition ------------------------------------------------------*/
@@ -313,6 +324,7 @@ void W6X_Net_DeInit(void)
   for (uint32_t i = 0; i < W61_NET_MAX_CONNECTIONS; i++) /* Delete all the socket semaphores */
   {
     vSemaphoreDelete(p_net_ctx->Connection[i].DataAvailable);
+    W6X_Net_Free_RxRing(i);
   }
 
   W61_Net_DeInit(p_DrvObj); /* Deinitialize the Net context */
@@ -489,6 +501,7 @@ int32_t W6X_Net_Close(int32_t sock)
     taskENTER_CRITICAL();
     p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].DataAvailableSize = 0;
     taskEXIT_CRITICAL();
+    W6X_Net_Free_RxRing(p_net_ctx->Sockets[sock].Number);
     p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].SocketConnected = 0;
   }
 
@@ -650,6 +663,7 @@ int32_t W6X_Net_Connect(int32_t sock, const struct sockaddr *addr, socklen_t add
   }
   /* Set the connection number */
   p_net_ctx->Sockets[sock].Number = conn_to_use;
+  W6X_Net_Free_RxRing(conn_to_use); /* Drop data left from a previous use of the connection */
 
   /* Set the connection parameters */
   conn.Number = p_net_ctx->Sockets[sock].Number;
@@ -933,6 +947,7 @@ int32_t W6X_Net_Accept(int32_t sock, struct sockaddr *addr, socklen_t *addrlen)
           p_net_ctx->Sockets[new_socket].IsConnected = 1;
           p_net_ctx->Sockets[new_socket].Client = 0;
           p_net_ctx->Sockets[new_socket].RecvTimeout = p_net_ctx->Sockets[sock].RecvTimeout;
+          W6X_Net_Free_RxRing(i);
           p_net_ctx->Sockets[new_socket].Status = W6X_SOCKET_CONNECTED;
           return new_socket;
         }
@@ -984,7 +999,8 @@ ssize_t W6X_Net_Recv(int32_t sock, void *buf, size_t max_len, int32_t flags)
     return ret;
   }
   if ((p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].SocketConnected == 0) &&
-      (p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].DataAvailableSize == 0))
+      (p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].DataAvailableSize == 0) &&
+      (p_net_ctx->Connection[p_net_ctx->Sockets[sock].Number].RxRingCount == 0))
   {
     return -1;
   }
@@ -1614,6 +1630,11 @@ static void W6X_Net_cb(W61_event_id_t event_id, void *event_args)
     case W61_NET_EVT_SOCK_DISCONNECTED_ID:
       LogDebug("Socket %" PRIu32 " disconnected\n", p_param_net_data->socket_id);
       p_net_ctx->Connection[p_param_net_data->socket_id].SocketConnected = 0;
+      /* Wake up a receiver waiting for data on this connection */
+      if (p_net_ctx->Connection[p_param_net_data->socket_id].DataAvailable != NULL)
+      {
+        (void)xSemaphoreGive(p_net_ctx->Connection[p_param_net_data->socket_id].DataAvailable);
+      }
       break;
 
     default:
@@ -1714,77 +1735,134 @@ static int32_t W6X_Net_Poll_UDP_Sockets(struct sockaddr_in *remote_addr)
 
 static int32_t W6X_Net_Wait_Pull_Data(int32_t sock, int32_t connection_id, void *buf, size_t max_len)
 {
+  W6X_Net_Connection_t *p_conn;
   uint32_t received_data_len = 0;
-  int32_t ret = -1;
+  uint32_t pull_len;
+  uint8_t *pull_buf;
+  TimeOut_t wait_start;
+  TickType_t wait_ticks;
+  int32_t ret;
   NULL_ASSERT(p_net_ctx, W6X_Ctx_Null_str);
 
-  int32_t cpt = 0;
-  BaseType_t sem_taken = pdFALSE;
-  do
+  p_conn = &p_net_ctx->Connection[connection_id];
+
+  /* Serve the data pulled ahead by a previous call without any AT exchange */
+  if (p_conn->RxRingCount > 0)
   {
-    if ((p_net_ctx->Connection[connection_id].SocketConnected == 1) ||
-        (p_net_ctx->Connection[connection_id].DataAvailableSize > 0))
+    if (max_len > p_conn->RxRingCount)
     {
-      if (p_net_ctx->Connection[connection_id].DataAvailable != NULL)
-      {
-        sem_taken = xSemaphoreTake(p_net_ctx->Connection[connection_id].DataAvailable,
-                                   (TickType_t)(100));
-      }
+      max_len = p_conn->RxRingCount;
     }
-    cpt ++;
-  } while (sem_taken != pdTRUE && cpt < (p_net_ctx->Sockets[sock].RecvTimeout / 100));
+    memcpy(buf, &p_conn->RxRing[p_conn->RxRingHead], max_len);
+    p_conn->RxRingHead += max_len;
+    p_conn->RxRingCount -= max_len;
+    return (int32_t)max_len;
+  }
 
-  /* Check recv len before semaphore take (in case previous set of data was not completely read) */
-  if (sem_taken == pdTRUE)
+  /* Block until the data event or the disconnection of the connection. The semaphore
+   * may still be given for data read by a previous call, so check the counter again */
+  wait_ticks = (TickType_t)((p_net_ctx->Sockets[sock].RecvTimeout / 100) * 100);
+  if (wait_ticks == 0)
   {
-    if (max_len > p_net_ctx->Sockets[sock].RecvBuffSize) /* Attempt read */
-    {
-      max_len = p_net_ctx->Sockets[sock].RecvBuffSize;
-    }
-    if (p_net_ctx->Connection[connection_id].DataAvailableSize < max_len)
-    {
-      (void)xSemaphoreTake(p_net_ctx->Connection[connection_id].DataAvailable, (TickType_t) 3);
-    }
-    if (max_len > p_net_ctx->Connection[connection_id].DataAvailableSize) /* Attempt read */
+    wait_ticks = (TickType_t) 100;
+  }
+  vTaskSetTimeOutState(&wait_start);
+  while ((p_conn->DataAvailableSize == 0) && (p_conn->SocketConnected == 1) &&
+         (p_conn->DataAvailable != NULL) && (xTaskCheckForTimeOut(&wait_start, &wait_ticks) == pdFALSE))
+  {
+    (void)xSemaphoreTake(p_conn->DataAvailable, wait_ticks);
+  }
+
+  if (p_conn->DataAvailableSize == 0)
+  {
+    return 0;
+  }
+
+  if (max_len > p_net_ctx->Sockets[sock].RecvBuffSize) /* Attempt read */
+  {
+    max_len = p_net_ctx->Sockets[sock].RecvBuffSize;
+  }
+  pull_len = p_conn->DataAvailableSize;
+  pull_buf = (uint8_t *)buf;
+
+  /* When the caller asks for less than what the NCP holds, pull as much as fits in the
+   * connection buffer so that the next small reads (e.g. TLS record headers) are served
+   * from it. Datagram sockets always read directly to keep one payload per read */
+  if ((max_len < pull_len) && (W6X_NET_RECV_RING_SIZE > 0) &&
+      (p_net_ctx->Sockets[sock].Protocol != W6X_NET_UDP_PROTOCOL))
+  {
+    if (p_conn->RxRing == NULL)
     {
-      max_len = p_net_ctx->Connection[connection_id].DataAvailableSize;
+      p_conn->RxRing = pvPortMalloc(W6X_NET_RECV_RING_SIZE);
     }
-    /* Request data from the socket */
-    ret = W6X_Net_TranslateErrorStatus(W61_Net_PullDataFromSocket(p_DrvObj, connection_id,
-                                                                  (uint32_t)max_len, (uint8_t *)buf,
-                                                                  &received_data_len, W6X_NET_PULL_DATA_TIMEOUT));
-    if (ret != 0)
+    if (p_conn->RxRing != NULL)
     {
-      if (ret != -2)
+      pull_buf = p_conn->RxRing;
+      if (pull_len > W6X_NET_RECV_RING_SIZE)
       {
-        LogError("Pull data from socket failed\n");
+        pull_len = W6X_NET_RECV_RING_SIZE;
       }
-      return ret;
     }
-    /* Should not happen */
-    taskENTER_CRITICAL();
-    if (received_data_len > p_net_ctx->Connection[connection_id].DataAvailableSize || received_data_len < max_len)
+  }
+  if ((pull_buf == (uint8_t *)buf) && (pull_len > max_len))
+  {
+    pull_len = (uint32_t)max_len;
+  }
+
+  /* Request data from the socket */
+  ret = W6X_Net_TranslateErrorStatus(W61_Net_PullDataFromSocket(p_DrvObj, connection_id,
+                                                                pull_len, pull_buf,
+                                                                &received_data_len, W6X_NET_PULL_DATA_TIMEOUT));
+  if (ret != 0)
+  {
+    if (ret != -2)
     {
-      p_net_ctx->Connection[connection_id].DataAvailableSize = 0;
+      LogError("Pull data from socket failed\n");
     }
-    else
+    return ret;
+  }
+  /* Should not happen */
+  taskENTER_CRITICAL();
+  if (received_data_len > p_conn->DataAvailableSize || received_data_len < pull_len)
+  {
+    p_conn->DataAvailableSize = 0;
+  }
+  else
+  {
+    p_conn->DataAvailableSize -= received_data_len;
+  }
+  taskEXIT_CRITICAL();
+
+  if (pull_buf != (uint8_t *)buf)
+  {
+    if (received_data_len > pull_len)
     {
-      p_net_ctx->Connection[connection_id].DataAvailableSize -= received_data_len;
+      received_data_len = pull_len;
     }
-    taskEXIT_CRITICAL();
-
-    /* Check if remaining data is available */
-    /* Notify the user if remaining data is available */
-    if (p_net_ctx->Connection[connection_id].DataAvailableSize > 0)
+    if (max_len > received_data_len)
     {
-      if (p_net_ctx->Connection[connection_id].DataAvailable != NULL)
-      {
-        (void)xSemaphoreGive(p_net_ctx->Connection[connection_id].DataAvailable);
-      }
+      max_len = received_data_len;
     }
+    memcpy(buf, pull_buf, max_len);
+    p_conn->RxRingHead = max_len;
+    p_conn->RxRingCount = received_data_len - max_len;
+    received_data_len = max_len;
   }
 
   return received_data_len;
 }
 
+static void W6X_Net_Free_RxRing(int32_t connection_id)
+{
+  W6X_Net_Connection_t *p_conn = &p_net_ctx->Connection[connection_id];
+
+  p_conn->RxRingHead = 0;
+  p_conn->RxRingCount = 0;
+  if (p_conn->RxRing != NULL)
+  {
+    vPortFree(p_conn->RxRing);
+    p_conn->RxRing = NULL;
+  }
+}
+
 /** @} */
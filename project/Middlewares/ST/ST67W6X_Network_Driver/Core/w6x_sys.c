@@ -26,6 +26,8 @@
 #include "w61_io.h"        /* Prototypes of the BUS functions to be registered */
 #include "common_parser.h" /* Common Parser functions */
 
+LOG_MODULE_DEFINE();
+
 /* Private defines -----------------------------------------------------------*/
 /** @defgroup ST67W6X_Private_System_Constants ST67W6X System Constants
   * @ingroup  ST67W6X_Private_System
@@ -25,6 +25,8 @@
 #include "common_parser.h" /* Common Parser functions */
 #include "event_groups.h"
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /** @defgroup ST67W6X_Private_WiFi_Types ST67W6X Wi-Fi Types
@@ -968,6 +968,20 @@ typedef struct
   */
 typedef void (*W61_AT_Event_cb_t)(void *hObj, const uint8_t *p_evt, int32_t evt_len);
 
+/**
+  * @brief  AT command channel statistics
+  */
+typedef struct
+{
+  uint32_t Commands;                        /*!< AT commands sent */
+  uint32_t LockContended;                   /*!< Commands that had to wait for another task's command */
+  uint32_t LockBusy;                        /*!< Commands not sent because the channel stayed busy */
+  uint32_t StaleResponses;                  /*!< Late responses of previous commands discarded */
+  uint32_t HoldTimeTotalMs;                 /*!< Time the channel was held, summed over the commands */
+  uint32_t HoldTimeMaxMs;                   /*!< Longest time the channel was held by one command */
+  TickType_t StartTick;                     /*!< Tick of the last statistics reset */
+} W61_AT_Stats_t;
+
 /**
   * @brief  W61 Object structure
   */
@@ -980,8 +994,8 @@ typedef struct
   uint8_t *ATD_RecvBuf;                     /*!< Rx buffer for AT responses and events */
   W61_LowPowerCfg_t LowPowerCfg;            /*!< Low Power configuration */
   /* Task and buffer specific to Command/Responses */
-  QueueHandle_t ATD_Resp_Queue;             /*!< AT Response queue handle */
-  QueueHandle_t ATD_Evt_Queue;              /*!< AT Event queue handle */
+  MessageBufferHandle_t ATD_Resp_xMessageBuffer; /*!< AT Response message buffer handle */
+  MessageBufferHandle_t ATD_Evt_xMessageBuffer;  /*!< AT Event message buffer handle */
   uint8_t *CmdResp;                         /*!< Buffer for AT commands formatting and Rx Responses */
   /* Task and buffers specific to async Events */
   TaskHandle_t ATD_EvtPooling_task_handle;  /*!< AT Event parser task handle (dedicated Events) */
@@ -992,6 +1006,8 @@ typedef struct
     * Note: should NOT be used by RxPoolingTask.
     */
   SemaphoreHandle_t xCmdMutex;
+  TickType_t CmdLockTick;                   /*!< Tick at which xCmdMutex was taken */
+  W61_AT_Stats_t ATStats;                   /*!< AT command channel statistics */
   W61_AT_Event_cb_t Ble_event_cb;           /*!< BLE event callback function */
   W61_AT_Event_cb_t WiFi_event_cb;          /*!< Wi-Fi event callback function */
   W61_AT_Event_cb_t Net_event_cb;           /*!< Net event callback function */
@@ -1020,6 +1036,14 @@ typedef struct
   */
 W61_Object_t *W61_ObjGet(void);
 
+/**
+  * @brief  Get the AT command channel statistics
+  * @param  Obj: pointer to module handle
+  * @param  p_stats: pointer to the statistics copy
+  * @param  reset: clear the statistics once copied if not 0
+  */
+void W61_AT_GetStats(W61_Object_t *Obj, W61_AT_Stats_t *p_stats, uint32_t reset);
+
 /**
   * @brief  Register the upper layer callbacks
   * @param  Obj: pointer to module handle
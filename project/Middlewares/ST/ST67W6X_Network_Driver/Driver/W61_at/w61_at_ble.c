@@ -26,6 +26,8 @@
 #include "w61_io.h" /* SPI_XFER_MTU_BYTES */
 #include "common_parser.h" /* Common Parser functions */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
@@ -347,7 +349,7 @@ W61_Status_t W61_Ble_GetConnection(W61_Object_t *Obj, uint32_t *ConnectionHandle
   {
     /* Query the BLE connection handle */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+BLECONN?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_BLE_TIMEOUT);
       if (recv_len <= 0)
@@ -479,7 +481,7 @@ W61_Status_t W61_Ble_GetBDAddress(W61_Object_t *Obj, uint8_t *BdAddr)
   {
     /* Query the BLE address */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+BLEADDR?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_BLE_TIMEOUT);
       if (recv_len <= 0)
@@ -946,7 +948,7 @@ W61_Status_t W61_Ble_Connect(W61_Object_t *Obj, uint32_t conn_handle, uint8_t *R
              "\"\r\n",
              conn_handle, RemoteBDAddr[0], RemoteBDAddr[1], RemoteBDAddr[2],
              RemoteBDAddr[3], RemoteBDAddr[4], RemoteBDAddr[5]);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* W61_ATD_Recv Timeout is increased to manage connection processing time */
       if (W61_ATD_Recv(Obj, (uint8_t *)status_buf, W61_ATD_RSP_SIZE, W61_BLE_CONNECT_TIMEOUT) != 0)
@@ -1063,7 +1065,7 @@ W61_Status_t W61_Ble_GetService(W61_Object_t *Obj, W61_Ble_Service_t *ServiceInf
        +BLEGATTSSRV:<ServiceIndex>,<ServiceUUID>,<ServiceType>,<UUIDType>
        Multiple services can be returned in the response. */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+BLEGATTSSRV?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       resp_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_BLE_TIMEOUT);
       if (resp_len <= 0)
@@ -1183,7 +1185,7 @@ W61_Status_t W61_Ble_GetCharacteristic(W61_Object_t *Obj, W61_Ble_Characteristic
        +BLEGATTSCHAR:<ServiceIndex>,<CharIndex>,<CharUUID>,<CharProperty>,<CharPermission>,<UUIDType>
        Multiple characteristics can be returned in the response. */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+BLEGATTSCHAR?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       resp_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_BLE_TIMEOUT);
       if (resp_len <= 0)
@@ -1343,7 +1345,7 @@ W61_Status_t W61_Ble_ServerSendIndication(W61_Object_t *Obj, uint8_t service_ind
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
              "AT+BLEGATTSIND=%" PRIu16 ",%" PRIu16 ",%" PRIu32 "\r\n",
              service_index, char_index, req_len);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Timeout) > 0)
+    if (W61_AT_SendCmdTimeout(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Timeout) > 0)
     {
       /* Send the data to the client */
       ret = W61_AT_RequestSendData(Obj, pdata, req_len, Timeout);
@@ -1400,7 +1402,7 @@ W61_Status_t W61_Ble_ServerSetReadData(W61_Object_t *Obj, uint8_t service_index,
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
              "AT+BLEGATTSRD=%" PRIu16 ",%" PRIu16 ",%" PRIu32 "\r\n",
              service_index, char_index, req_len);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       ret = W61_AT_RequestSendData(Obj, pdata, req_len, Timeout);
     }
@@ -1493,7 +1495,7 @@ W61_Status_t W61_Ble_ClientWriteData(W61_Object_t *Obj, uint8_t conn_handle, uin
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
              "AT+BLEGATTCWR=%" PRIu16 ",%" PRIu16 ",%" PRIu16 ",%" PRIu32 "\r\n",
              conn_handle, service_index, char_index, req_len);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* Send the data to the server */
       ret = W61_AT_RequestSendData(Obj, pdata, req_len, Timeout);
@@ -1786,7 +1788,7 @@ W61_Status_t W61_Ble_SecurityGetBondedDeviceList(W61_Object_t *Obj,
        +BLESECGETLTKLIST: BONDADDR <bonded_device_list>
        Multiple bonded devices can be returned in the response. */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+BLESECGETLTKLIST?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_BLE_TIMEOUT);
       if (recv_len <= 0)
@@ -26,6 +26,8 @@
 #include "trcRecorder.h"
 #endif /* SYS_DBG_ENABLE_TA4 */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
@@ -53,6 +55,14 @@
   */
 static uint32_t W61_AT_GetBytesNumberReceived(uint8_t *pdata);
 
+/**
+  * @brief  Write the decimal representation of a number
+  * @param  p_buf: output buffer, at least 10 bytes
+  * @param  value: number to write
+  * @retval number of characters written
+  */
+static uint32_t W61_AT_FormatUint(uint8_t *p_buf, uint32_t value);
+
 /* Functions Definition ------------------------------------------------------*/
 W61_Status_t W61_AT_ParseOkErr(char *p_resp)
 {
@@ -87,7 +97,7 @@ W61_Status_t W61_AT_Common_SetExecute(W61_Object_t *Obj, uint8_t *p_cmd, uint32_
   cmd_len = strlen((char *)p_cmd);
 
   /* Send the command and check if the returned length is the same as the command length */
-  if (W61_ATsend(Obj, p_cmd, cmd_len, Obj->NcpTimeout) == cmd_len)
+  if (W61_AT_SendCmd(Obj, p_cmd, cmd_len) == cmd_len)
   {
     /* Receive the status and check if the returned length is greater than 0 */
     status_len = W61_ATD_Recv(Obj, (uint8_t *)status_buf, sizeof(AT_ERROR_STRING) - 1, timeout_ms);
@@ -129,7 +139,7 @@ W61_Status_t W61_AT_Common_Query(W61_Object_t *Obj, uint8_t *p_cmd, uint8_t *p_r
   cmd_len = strlen((char *)p_cmd);
 
   /* Send the command and check if the returned length is the same as the command length */
-  if (W61_ATsend(Obj, p_cmd, cmd_len, Obj->NcpTimeout) == cmd_len)
+  if (W61_AT_SendCmd(Obj, p_cmd, cmd_len) == cmd_len)
   {
     /* Receive the response and check if the returned length is greater than 0 */
     resp_len = W61_ATD_Recv(Obj, p_resp, W61_ATD_CMDRSP_STRING_SIZE, timeout_ms);
@@ -220,7 +230,15 @@ bool W61_ATlock(W61_Object_t *Obj, uint32_t busy_timeout_ms)
    * The sequence W61_ATlock, W61_ATsend, W61_ATD_Recv.
    * W61_ATunlock assures that the thread sending the AT command gets its response
    */
-  ret = xSemaphoreTake(Obj->xCmdMutex, busy_timeout_ms);
+  ret = xSemaphoreTake(Obj->xCmdMutex, 0);
+  if (ret != pdTRUE)
+  {
+    /* Another task has a command in progress */
+    taskENTER_CRITICAL();
+    Obj->ATStats.LockContended++;
+    taskEXIT_CRITICAL();
+    ret = xSemaphoreTake(Obj->xCmdMutex, busy_timeout_ms);
+  }
 
 #if (LOCK_RETRY_MAX_NR > 0)
   /* In multitask applications the NCP access might be locked (resource taken by another task),
@@ -237,6 +255,17 @@ bool W61_ATlock(W61_Object_t *Obj, uint32_t busy_timeout_ms)
   }
 #endif /* LOCK_RETRY_MAX_NR */
 
+  if (ret == pdTRUE)
+  {
+    Obj->CmdLockTick = xTaskGetTickCount();
+  }
+  else
+  {
+    taskENTER_CRITICAL();
+    Obj->ATStats.LockBusy++;
+    taskEXIT_CRITICAL();
+  }
+
   return (ret == pdTRUE);
 }
 
@@ -245,6 +274,15 @@ bool W61_ATunlock(W61_Object_t *Obj)
   /* This ends the sequence W61_ATlock, W61_ATsend, W61_ATD_Recv. W61_ATunlock */
   /* The sequence shall be on the same OS thread */
   /* If another OS thread tries to get the lock it has to wait current OS thread unlocks */
+  uint32_t hold_time_ms = pdTICKS_TO_MS(xTaskGetTickCount() - Obj->CmdLockTick);
+
+  taskENTER_CRITICAL();
+  Obj->ATStats.HoldTimeTotalMs += hold_time_ms;
+  if (hold_time_ms > Obj->ATStats.HoldTimeMaxMs)
+  {
+    Obj->ATStats.HoldTimeMaxMs = hold_time_ms;
+  }
+  taskEXIT_CRITICAL();
 
   return (xSemaphoreGive(Obj->xCmdMutex) == pdTRUE);
 }
@@ -257,6 +295,61 @@ int32_t W61_ATsend(W61_Object_t *Obj, uint8_t *pBuf, uint32_t len, uint32_t time
   return Obj->fops.IO_Send(pBuf, len, timeout_ms);
 }
 
+int32_t W61_AT_SendCmd(W61_Object_t *Obj, uint8_t *p_cmd, uint32_t cmd_len)
+{
+  return W61_AT_SendCmdTimeout(Obj, p_cmd, cmd_len, Obj->NcpTimeout);
+}
+
+int32_t W61_AT_SendCmdTimeout(W61_Object_t *Obj, uint8_t *p_cmd, uint32_t cmd_len, uint32_t timeout_ms)
+{
+  uint32_t stale = W61_ATD_FlushResp(Obj);
+
+  taskENTER_CRITICAL();
+  Obj->ATStats.StaleResponses += stale;
+  Obj->ATStats.Commands++;
+  taskEXIT_CRITICAL();
+
+  return W61_ATsend(Obj, p_cmd, cmd_len, timeout_ms);
+}
+
+int32_t W61_AT_BuildCmd(uint8_t *p_buf, const char *p_prefix, const uint32_t *p_args, uint32_t nb_args)
+{
+  uint32_t len = strlen(p_prefix);
+
+  /* Worst case: 10 digits and a separator per parameter, then CRLF and the terminator */
+  if ((len + (nb_args * 11) + 3) > W61_AT_CMD_TEMPLATE_SIZE)
+  {
+    return -1;
+  }
+
+  memcpy(p_buf, p_prefix, len);
+  for (uint32_t i = 0; i < nb_args; i++)
+  {
+    if (i > 0)
+    {
+      p_buf[len++] = ',';
+    }
+    len += W61_AT_FormatUint(&p_buf[len], p_args[i]);
+  }
+  p_buf[len++] = '\r';
+  p_buf[len++] = '\n';
+  p_buf[len] = '\0';
+
+  return (int32_t)len;
+}
+
+void W61_AT_GetStats(W61_Object_t *Obj, W61_AT_Stats_t *p_stats, uint32_t reset)
+{
+  taskENTER_CRITICAL();
+  *p_stats = Obj->ATStats;
+  if (reset != 0)
+  {
+    memset(&Obj->ATStats, 0, sizeof(W61_AT_Stats_t));
+    Obj->ATStats.StartTick = xTaskGetTickCount();
+  }
+  taskEXIT_CRITICAL();
+}
+
 void W61_AT_Logger(uint8_t *pBuf, uint32_t len, char *inOut)
 {
   char log_message[W61_MAX_AT_LOG_LENGTH];
@@ -277,6 +370,26 @@ void W61_AT_Logger(uint8_t *pBuf, uint32_t len, char *inOut)
 }
 
 /* Private Functions Definition ----------------------------------------------*/
+static uint32_t W61_AT_FormatUint(uint8_t *p_buf, uint32_t value)
+{
+  uint8_t digits[10];
+  uint32_t count = 0;
+  uint32_t len;
+
+  do
+  {
+    digits[count++] = (uint8_t)('0' + (value % 10));
+    value /= 10;
+  } while (value > 0);
+
+  for (len = 0; len < count; len++)
+  {
+    p_buf[len] = digits[count - len - 1];
+  }
+
+  return len;
+}
+
 static uint32_t W61_AT_GetBytesNumberReceived(uint8_t *pdata)
 {
   char bytes_received_by_W61[6] = {'\0'};
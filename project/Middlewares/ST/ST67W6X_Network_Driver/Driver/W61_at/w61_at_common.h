@@ -45,6 +45,9 @@ extern "C" {
 /** Maximum size of header for receiving data */
 #define W61_MAX_RECEIVE_DATA_HEADER_SIZE        24
 
+/** Size of the buffer of a command built by W61_AT_BuildCmd */
+#define W61_AT_CMD_TEMPLATE_SIZE                48
+
 #ifndef W61_ASSERT_EN
 /** it detect miss-usage of the driver by the application */
 #define W61_ASSERT_EN                           1
@@ -179,6 +182,39 @@ bool W61_ATunlock(W61_Object_t *Obj);
   */
 int32_t W61_ATsend(W61_Object_t *Obj, uint8_t *pBuf, uint32_t len, uint32_t timeout_ms);
 
+/**
+  * @brief  Send an AT command within the W61_ATlock W61_ATunlock protection.
+  *         Responses left by previous commands are discarded first.
+  * @param  Obj: pointer to module handle
+  * @param  p_cmd: pointer to the command string
+  * @param  cmd_len: command length
+  * @retval int32_t: the actual data size that has been sent.
+  */
+int32_t W61_AT_SendCmd(W61_Object_t *Obj, uint8_t *p_cmd, uint32_t cmd_len);
+
+/**
+  * @brief  Same as W61_AT_SendCmd, for commands with a send timeout of their own.
+  * @param  Obj: pointer to module handle
+  * @param  p_cmd: pointer to the command string
+  * @param  cmd_len: command length
+  * @param  timeout_ms: timeout in ms
+  * @retval int32_t: the actual data size that has been sent.
+  */
+int32_t W61_AT_SendCmdTimeout(W61_Object_t *Obj, uint8_t *p_cmd, uint32_t cmd_len, uint32_t timeout_ms);
+
+/**
+  * @brief  Build a command made of a constant prefix and numeric parameters, without snprintf.
+  *         e.g. prefix "AT+CIPSEND=" and args {1, 512} give "AT+CIPSEND=1,512\r\n".
+  *         Commands built before W61_ATlock, in a buffer of the caller, keep the channel
+  *         free for other tasks while they are formatted.
+  * @param  p_buf: output buffer of W61_AT_CMD_TEMPLATE_SIZE bytes
+  * @param  p_prefix: command prefix, including the '=' separator
+  * @param  p_args: numeric parameters, separated by commas in the command
+  * @param  nb_args: number of parameters
+  * @retval int32_t: command length, -1 if it does not fit in W61_AT_CMD_TEMPLATE_SIZE.
+  */
+int32_t W61_AT_BuildCmd(uint8_t *p_buf, const char *p_prefix, const uint32_t *p_args, uint32_t nb_args);
+
 /**
   * @brief  Check if response OK or ERROR.
   * @param  p_resp: pointer to string
@@ -29,6 +29,8 @@
 #include "trcRecorder.h"
 #endif /* SYS_DBG_ENABLE_TA4 */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
@@ -148,7 +150,7 @@ W61_Status_t W61_MQTT_GetUserConfiguration(W61_Object_t *Obj, uint8_t *ClientId,
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+MQTTUSERCFG?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_NET_TIMEOUT);
       if (recv_len > 0)
@@ -474,7 +476,7 @@ W61_Status_t W61_MQTT_GetSubscribedTopics(W61_Object_t *Obj)
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+MQTTSUB?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       do
       {
@@ -537,7 +539,7 @@ W61_Status_t W61_MQTT_Unsubscribe(W61_Object_t *Obj, uint8_t *Topic)
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+MQTTUNSUB=0,\"%s\"\r\n", Topic);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* Check the command has been sent correctly, OK is received */
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, 5000);
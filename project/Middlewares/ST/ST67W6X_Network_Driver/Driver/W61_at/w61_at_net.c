@@ -30,6 +30,8 @@
 #include "trcRecorder.h"
 #endif /* SYS_DBG_ENABLE_TA4 */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
@@ -182,7 +184,7 @@ W61_Status_t W61_Net_Ping(W61_Object_t *Obj, char *location, uint16_t length, ui
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
              "AT+PING=\"%s\",%" PRIu16 ",%" PRIu16 ",%" PRIu16 "\r\n",
              location, length, count, interval);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* Parse the OK/ERROR response */
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_NET_PING_TIMEOUT);
@@ -418,6 +420,8 @@ W61_Status_t W61_Net_SendData(W61_Object_t *Obj, uint8_t Socket, uint8_t *pdata,
                               uint32_t *SentLen, uint32_t Timeout)
 {
   W61_Status_t ret = W61_STATUS_ERROR;
+  uint8_t cmd[W61_AT_CMD_TEMPLATE_SIZE];
+  uint32_t args[2];
   W61_NULL_ASSERT(Obj);
   W61_NULL_ASSERT(pdata);
   W61_NULL_ASSERT(SentLen);
@@ -429,6 +433,11 @@ W61_Status_t W61_Net_SendData(W61_Object_t *Obj, uint8_t Socket, uint8_t *pdata,
 
   *SentLen = Reqlen;
 
+  /* Format the command before taking the lock */
+  args[0] = Socket;
+  args[1] = Reqlen;
+  (void)W61_AT_BuildCmd(cmd, "AT+CIPSEND=", args, 2);
+
   if (W61_ATlock(Obj, Timeout))
   {
     /* W61_AT_SetExecute timeout should let the time to NCP to return SEND:ERROR message */
@@ -436,9 +445,7 @@ W61_Status_t W61_Net_SendData(W61_Object_t *Obj, uint8_t Socket, uint8_t *pdata,
     {
       Timeout = W61_NET_TIMEOUT;
     }
-    snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
-             "AT+CIPSEND=%" PRIu16 ",%" PRIu32 "\r\n", Socket, Reqlen);
-    ret = W61_AT_SetExecute(Obj, Obj->CmdResp, Timeout);
+    ret = W61_AT_SetExecute(Obj, cmd, Timeout);
     if (ret == W61_STATUS_OK)
     {
       ret = W61_AT_RequestSendData(Obj, pdata, Reqlen, Timeout);
@@ -567,7 +574,7 @@ W61_Status_t W61_Net_IsDataAvailableOnSocket(W61_Object_t *Obj, uint8_t Socket,
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CIPRECVLEN?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
 
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_NET_TIMEOUT);
@@ -626,6 +633,9 @@ W61_Status_t W61_Net_PullDataFromSocket(W61_Object_t *Obj, uint8_t Socket, uint3
 {
   W61_Status_t ret = W61_STATUS_ERROR;
   int32_t recv_len;
+  int32_t cmd_len;
+  uint8_t cmd[W61_AT_CMD_TEMPLATE_SIZE];
+  uint32_t args[2];
   W61_NULL_ASSERT(Obj);
   W61_NULL_ASSERT(pData);
   W61_NULL_ASSERT(Receivedlen);
@@ -636,13 +646,16 @@ W61_Status_t W61_Net_PullDataFromSocket(W61_Object_t *Obj, uint8_t Socket, uint3
     Reqlen = (SPI_XFER_MTU_BYTES - W61_NET_AT_HEADER_DATA_SIZE);
   }
 
+  /* Format the command before taking the lock */
+  args[0] = Socket;
+  args[1] = Reqlen;
+  cmd_len = W61_AT_BuildCmd(cmd, "AT+CIPRECVDATA=", args, 2);
+
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     Obj->NetCtx.AppBuffRecvData = pData;
     Obj->NetCtx.AppBuffRecvDataSize = Reqlen;
-    snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
-             "AT+CIPRECVDATA=%" PRIu16 ",%" PRIu32 "\r\n", Socket, Reqlen);
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, cmd, cmd_len) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, Timeout);
       Obj->NetCtx.AppBuffRecvData = NULL;
@@ -984,7 +997,7 @@ W61_Status_t W61_Net_GetTCPOpt(W61_Object_t *Obj, uint8_t Socket, int16_t *Linge
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CIPTCPOPT?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       for (int32_t cur_conn = 0; cur_conn < 5; cur_conn++)
       {
@@ -1094,7 +1107,7 @@ W61_Status_t W61_Net_GetSocketInformation(W61_Object_t *Obj, uint8_t Socket, uin
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CIPSTATE?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       for (int32_t cur_conn = 0; cur_conn < 5; cur_conn++)
       {
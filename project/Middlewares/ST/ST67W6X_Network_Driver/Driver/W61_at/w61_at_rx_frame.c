@@ -0,0 +1,443 @@
+/**
+  ******************************************************************************
+  * @file    w61_at_rx_frame.c
+  * @author  GPM Application Team
+  * @brief   This file provides the implementation of the AT messages framing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "w61_at_rx_frame.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Private_Types ST67W61 AT Driver Rx Frame Private Types
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/**
+  * @brief  AT events list structure
+  */
+typedef struct
+{
+  /** Event keyword */
+  const char keyword[8];
+  /** Length of the event keyword */
+  const uint8_t keyword_len;
+  /** Type of the event */
+  const uint8_t type;
+} W61_ATD_FrameEvt_t;
+
+/**
+  * @brief  AT data messages list structure.
+  *         The header is the keyword, skip_fields fields, then len_fields payload length fields, each ended by a comma.
+  *         The payload length is the sum of the length fields plus len_extra.
+  */
+typedef struct
+{
+  /** Data message keyword */
+  const char keyword[16];
+  /** Length of the data message keyword */
+  const uint8_t keyword_len;
+  /** Number of fields before the payload length */
+  const uint8_t skip_fields;
+  /** Number of payload length fields */
+  const uint8_t len_fields;
+  /** Payload bytes not counted by the length fields */
+  const uint8_t len_extra;
+  /** Type of the data */
+  const uint8_t type;
+} W61_ATD_FrameDataEvt_t;
+
+/** @} */
+
+/* Private defines -----------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Private_Constants ST67W61 AT Driver Rx Frame Private Constants
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/** size of /r/n string */
+#define CRLF_SIZE                     2
+
+/** Size of the "\r\n>" send prompt */
+#define SEND_PROMPT_SIZE              3
+
+/** Largest payload length accepted in a data header */
+#define DATA_LEN_MAX                  0x00FFFFFFU
+
+/** Data header incomplete, more bytes are needed */
+#define DATA_HEADER_INCOMPLETE        0
+
+/** Not a data header, the message is processed as a line */
+#define DATA_HEADER_NONE              -1
+
+/** @} */
+
+/* Private macros ------------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Private_Macros ST67W61 AT Driver Rx Frame Private Macros
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/** Number of items in a keyword list */
+#define ITEMS_IN_LIST(list)           (sizeof(list) / sizeof((list)[0]))
+
+/** Check if the character is a decimal digit */
+#define IS_CHAR_DIGIT(ch)             (((ch) >= '0') && ((ch) <= '9'))
+
+/** @} */
+
+/* Private variables ---------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Private_Variables ST67W61 AT Driver Rx Frame Private Variables
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/** AT events list */
+static const W61_ATD_FrameEvt_t FrameEvtList[] =
+{
+  { "+IPD:",   sizeof("+IPD:") - 1,   RECV_TYPE_NET},
+  { "+CIP:",   sizeof("+CIP:") - 1,   RECV_TYPE_NET},
+  { "+MQTT:",  sizeof("+MQTT:") - 1,  RECV_TYPE_MQTT},
+  { "+BLE:",   sizeof("+BLE:") - 1,   RECV_TYPE_BLE},
+  { "+CW:",    sizeof("+CW:") - 1,    RECV_TYPE_WIFI},
+  { "+CWLAP:", sizeof("+CWLAP:") - 1, RECV_TYPE_WIFI},
+};
+
+/** AT data messages list */
+static const W61_ATD_FrameDataEvt_t FrameDataEvtList[] =
+{
+  /* +CIPRECVDATA:<len>, */
+  { "+CIPRECVDATA:",   sizeof("+CIPRECVDATA:") - 1,   0, 1, 0, RECV_TYPE_NET},
+  /* +MQTT:SUBRECV:<link_id>,<topic_len>,<msg_len>,"<topic>",<msg> */
+  { "+MQTT:SUBRECV:",  sizeof("+MQTT:SUBRECV:") - 1,  1, 2, 3, RECV_TYPE_MQTT},
+  /* +BLE:GATTWRITE:<conn>,<srv>,<char>,<len>, */
+  { "+BLE:GATTWRITE:", sizeof("+BLE:GATTWRITE:") - 1, 3, 1, 0, RECV_TYPE_BLE},
+  /* +BLE:GATTREAD:<conn>,<srv>,<char>,<len>, */
+  { "+BLE:GATTREAD:",  sizeof("+BLE:GATTREAD:") - 1,  3, 1, 0, RECV_TYPE_BLE},
+  /* +BLE:NOTIDATA:<conn>,<len>, */
+  { "+BLE:NOTIDATA:",  sizeof("+BLE:NOTIDATA:") - 1,  1, 1, 0, RECV_TYPE_BLE},
+};
+
+/** @} */
+
+/* Private function prototypes -----------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Private_Functions ST67W61 AT Driver Rx Frame Private Functions
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/**
+  * @brief  Parse the header of a data message
+  * @param  p_data_evt: data message description
+  * @param  p_msg: message, starting with the data message keyword
+  * @param  len: number of bytes available at p_msg
+  * @param  p_data_len: returns the payload length
+  * @retval int32_t: offset of the payload, DATA_HEADER_INCOMPLETE or DATA_HEADER_NONE
+  */
+static int32_t W61_ATD_FrameDataHeader(const W61_ATD_FrameDataEvt_t *p_data_evt, const uint8_t *p_msg, uint32_t len,
+                                       uint32_t *p_data_len);
+
+/**
+  * @brief  Search the end of a line, i.e. the CRLF delimiter
+  * @param  p_msg: message
+  * @param  len: number of bytes available at p_msg
+  * @retval uint32_t: length of the line including CRLF, 0 if the line is incomplete
+  */
+static uint32_t W61_ATD_FrameLineEnd(const uint8_t *p_msg, uint32_t len);
+
+/**
+  * @brief  Check if a line contains a string
+  * @param  p_msg: line
+  * @param  len: line length
+  * @param  p_str: string to search
+  * @param  str_len: string length
+  * @retval uint32_t: 1 if found, 0 otherwise
+  */
+static uint32_t W61_ATD_FrameContains(const uint8_t *p_msg, uint32_t len, const char *p_str, uint32_t str_len);
+
+/** @} */
+
+/* Functions Definition ------------------------------------------------------*/
+/** @addtogroup ST67W61_AT_RX_Frame_Functions
+  * @{
+  */
+
+void W61_ATD_FrameInit(W61_ATD_Frame_t *p_frame, const W61_ATD_FrameCb_t *p_cb, void *p_ctx)
+{
+  memset(p_frame, 0, sizeof(W61_ATD_Frame_t));
+  p_frame->p_cb = p_cb;
+  p_frame->p_ctx = p_ctx;
+  p_frame->data_type = RECV_TYPE_NONE;
+}
+
+uint32_t W61_ATD_FrameParse(W61_ATD_Frame_t *p_frame, const uint8_t *p_in, uint32_t len)
+{
+  const W61_ATD_FrameCb_t *p_cb = p_frame->p_cb;
+  uint32_t consumed = 0;
+
+  while (consumed < len)
+  {
+    const uint8_t *p_msg = &p_in[consumed];
+    uint32_t avail = len - consumed;
+    uint32_t msg_len;
+    uint32_t i;
+
+    /* ------------------- Data payload in progress ----------------------------------------------------------------- */
+    if (p_frame->data_type != RECV_TYPE_NONE)
+    {
+      if (p_frame->data_done < p_frame->data_len)
+      {
+        msg_len = p_frame->data_len - p_frame->data_done;
+        if (msg_len > avail)
+        {
+          msg_len = avail;
+        }
+        p_cb->Data(p_frame->p_ctx, p_frame->data_type, p_frame->data_done, p_msg, msg_len);
+        p_frame->data_done += msg_len;
+        consumed += msg_len;
+        avail -= msg_len;
+        if (p_frame->data_done < p_frame->data_len)
+        {
+          break; /* Wait for the rest of the payload */
+        }
+      }
+
+      /* The payload is followed by CRLF */
+      msg_len = (p_frame->data_trailer < avail) ? p_frame->data_trailer : avail;
+      p_frame->data_trailer -= msg_len;
+      consumed += msg_len;
+      if (p_frame->data_trailer > 0)
+      {
+        break; /* Wait for the rest of the trailer */
+      }
+
+      p_cb->DataEnd(p_frame->p_ctx, p_frame->data_type, p_frame->data_header, W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER);
+      p_frame->data_type = RECV_TYPE_NONE;
+      continue;
+    }
+
+    /* ------------------- Messages --------------------------------------------------------------------------------- */
+    /* \r\n at the begin of the message are skipped, except in "\r\n>" which has no \r\n afterwards */
+    if ((avail > CRLF_SIZE) && (p_msg[0] == '\r') && (p_msg[1] == '\n') && (p_msg[2] != '>'))
+    {
+      consumed += CRLF_SIZE;
+      continue;
+    }
+
+    if (avail < SEND_PROMPT_SIZE)
+    {
+      break; /* Too short to be a complete message */
+    }
+
+    if ((p_msg[0] == '\r') && (p_msg[1] == '\n'))
+    {
+      /* p_msg[2] is '>', the send prompt is forwarded as a response */
+      p_cb->Resp(p_frame->p_ctx, p_msg, SEND_PROMPT_SIZE);
+      consumed += SEND_PROMPT_SIZE;
+      continue;
+    }
+
+    if (p_msg[0] == '+')
+    {
+      int32_t data_offset = DATA_HEADER_NONE;
+      uint32_t data_len = 0;
+
+      /* Check if a data payload follows, it is not delimited by CRLF */
+      for (i = 0; i < ITEMS_IN_LIST(FrameDataEvtList); i++)
+      {
+        if ((avail >= FrameDataEvtList[i].keyword_len) &&
+            (memcmp(p_msg, FrameDataEvtList[i].keyword, FrameDataEvtList[i].keyword_len) == 0))
+        {
+          data_offset = W61_ATD_FrameDataHeader(&FrameDataEvtList[i], p_msg, avail, &data_len);
+          break;
+        }
+      }
+
+      if (data_offset == DATA_HEADER_INCOMPLETE)
+      {
+        break; /* Wait for the rest of the header */
+      }
+
+      if (data_offset > 0)
+      {
+        msg_len = ((uint32_t)data_offset < W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER) ?
+                  (uint32_t)data_offset : W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER;
+        memset(p_frame->data_header, 0, sizeof(p_frame->data_header));
+        memcpy(p_frame->data_header, p_msg, msg_len);
+        p_frame->data_type = FrameDataEvtList[i].type;
+        p_frame->data_len = data_len;
+        p_frame->data_done = 0;
+        p_frame->data_trailer = CRLF_SIZE;
+        consumed += (uint32_t)data_offset;
+        continue;
+      }
+    }
+
+    msg_len = W61_ATD_FrameLineEnd(p_msg, avail);
+    if (msg_len == 0)
+    {
+      break; /* Wait for the rest of the line */
+    }
+
+    if (W61_ATD_FrameEventType(p_msg, msg_len) != RECV_TYPE_NONE)
+    {
+      p_cb->Event(p_frame->p_ctx, p_msg, msg_len);
+    }
+    else if ((W61_ATD_FrameContains(p_msg, msg_len, "SEND OK", sizeof("SEND OK") - 1) == 0) &&
+             (W61_ATD_FrameContains(p_msg, msg_len, "SEND FAIL", sizeof("SEND FAIL") - 1) == 0))
+    {
+      p_cb->Resp(p_frame->p_ctx, p_msg, msg_len);
+    }
+    else
+    {
+      /* SEND OK and SEND FAIL are filtered */
+    }
+    consumed += msg_len;
+  }
+
+  return consumed;
+}
+
+uint32_t W61_ATD_FrameEventType(const uint8_t *p_msg, uint32_t len)
+{
+  uint32_t i;
+
+  if ((len == 0) || (p_msg[0] != '+'))
+  {
+    return RECV_TYPE_NONE;
+  }
+
+  for (i = 0; i < ITEMS_IN_LIST(FrameEvtList); i++)
+  {
+    if ((len >= FrameEvtList[i].keyword_len) &&
+        (memcmp(p_msg, FrameEvtList[i].keyword, FrameEvtList[i].keyword_len) == 0))
+    {
+      return FrameEvtList[i].type;
+    }
+  }
+
+  return RECV_TYPE_NONE;
+}
+
+/** @} */
+
+/* Private Functions Definition ----------------------------------------------*/
+/** @addtogroup ST67W61_AT_RX_Frame_Private_Functions
+  * @{
+  */
+
+static int32_t W61_ATD_FrameDataHeader(const W61_ATD_FrameDataEvt_t *p_data_evt, const uint8_t *p_msg, uint32_t len,
+                                       uint32_t *p_data_len)
+{
+  uint32_t fields = p_data_evt->skip_fields + p_data_evt->len_fields;
+  uint32_t field = 0;
+  uint32_t value = 0;
+  uint32_t digits = 0;
+  uint32_t total = p_data_evt->len_extra;
+  uint32_t i;
+
+  for (i = p_data_evt->keyword_len; i < len; i++)
+  {
+    uint8_t ch = p_msg[i];
+
+    if (ch == '\n')
+    {
+      return DATA_HEADER_NONE; /* The line ends before the payload length */
+    }
+
+    if (ch == ',')
+    {
+      if (field >= p_data_evt->skip_fields)
+      {
+        if (digits == 0)
+        {
+          return DATA_HEADER_NONE;
+        }
+        total += value;
+        if (total > DATA_LEN_MAX)
+        {
+          return DATA_HEADER_NONE;
+        }
+      }
+
+      field++;
+      value = 0;
+      digits = 0;
+      if (field == fields)
+      {
+        *p_data_len = total;
+        return (int32_t)(i + 1); /* The payload starts after the comma */
+      }
+    }
+    else if (field >= p_data_evt->skip_fields)
+    {
+      if (!IS_CHAR_DIGIT(ch) || (value > DATA_LEN_MAX))
+      {
+        return DATA_HEADER_NONE;
+      }
+      value = (value * 10U) + (uint32_t)(ch - '0');
+      digits++;
+    }
+    else
+    {
+      /* Field before the payload length, ignored */
+    }
+  }
+
+  return DATA_HEADER_INCOMPLETE;
+}
+
+static uint32_t W61_ATD_FrameLineEnd(const uint8_t *p_msg, uint32_t len)
+{
+  /* Lines have always at least CRLF_SIZE characters before the ending \r\n,
+     this avoids the "\r\n" before ">" to be considered as a line */
+  uint32_t i = CRLF_SIZE;
+
+  while (i < len)
+  {
+    const uint8_t *p_lf = memchr(&p_msg[i], '\n', len - i);
+    if (p_lf == NULL)
+    {
+      break;
+    }
+
+    i = (uint32_t)(p_lf - p_msg);
+    if (p_msg[i - 1] == '\r')
+    {
+      return i + 1;
+    }
+    i++;
+  }
+
+  return 0;
+}
+
+static uint32_t W61_ATD_FrameContains(const uint8_t *p_msg, uint32_t len, const char *p_str, uint32_t str_len)
+{
+  uint32_t i;
+
+  for (i = 0; i + str_len <= len; i++)
+  {
+    if ((p_msg[i] == (uint8_t)p_str[0]) && (memcmp(&p_msg[i], p_str, str_len) == 0))
+    {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/** @} */
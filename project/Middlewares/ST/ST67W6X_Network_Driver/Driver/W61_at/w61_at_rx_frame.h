@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    w61_at_rx_frame.h
+  * @author  GPM Application Team
+  * @brief   This file provides the definitions of the AT messages framing
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef W61_AT_RX_FRAME_H
+#define W61_AT_RX_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/** @defgroup ST67W61_AT_RX_Frame ST67W61 AT Driver Rx Frame
+  * @ingroup  ST67W61_AT
+  * @brief    Split the byte stream received from the module into responses, events and data messages.
+  *           The framing has no OS dependency so it can also be built on a host,
+  *           see tools/at_bench/at_parse_bench.py.
+  */
+
+/* Exported constants --------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Constants ST67W61 AT Driver Rx Frame Constants
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/** Receive command, response or events type */
+#define RECV_TYPE_NONE                0
+
+/** Receive Wi-Fi type */
+#define RECV_TYPE_WIFI                1
+
+/** Receive BLE type */
+#define RECV_TYPE_BLE                 2
+
+/** Receive Net type */
+#define RECV_TYPE_NET                 3
+
+/** Receive MQTT type */
+#define RECV_TYPE_MQTT                4
+
+/**
+  * Should contain one of the following:
+  * +CIPRECVDATA:[size],
+  * +BLE:GATTWRITE:y,y,y,[size]
+  * +MQTT:SUBRECV,y,[size1],[size2]
+  */
+#define W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER     28
+
+/** @} */
+
+/* Exported types ------------------------------------------------------------*/
+/** @defgroup ST67W61_AT_RX_Frame_Types ST67W61 AT Driver Rx Frame Types
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/**
+  * @brief  Message handlers. The messages are slices of the buffer given to W61_ATD_FrameParse(),
+  *         only valid during the call.
+  */
+typedef struct
+{
+  /** Response to the command in progress (CRLF included), or the "\r\n>" send prompt */
+  void (*Resp)(void *p_ctx, const uint8_t *p_msg, uint32_t len);
+  /** Unsolicited event (CRLF included), of the RECV_TYPE given by W61_ATD_FrameEventType() */
+  void (*Event)(void *p_ctx, const uint8_t *p_msg, uint32_t len);
+  /** Part of the payload of a data message, at offset from the start of the payload */
+  void (*Data)(void *p_ctx, uint32_t type, uint32_t offset, const uint8_t *p_data, uint32_t len);
+  /** End of a data message, p_header holds W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER bytes of its header */
+  void (*DataEnd)(void *p_ctx, uint32_t type, uint8_t *p_header, uint32_t len);
+} W61_ATD_FrameCb_t;
+
+/**
+  * @brief  Framing state, kept between the receptions
+  */
+typedef struct
+{
+  const W61_ATD_FrameCb_t *p_cb;  /*!< Message handlers */
+  void *p_ctx;                    /*!< First parameter of the handlers */
+  uint32_t data_type;             /*!< RECV_TYPE of the data message in progress, RECV_TYPE_NONE if none */
+  uint32_t data_len;              /*!< Payload length of the data message in progress */
+  uint32_t data_done;             /*!< Payload bytes of the data message already handed over */
+  uint32_t data_trailer;          /*!< CRLF bytes still to skip after the payload */
+  /** Header of the data message in progress, zero padded */
+  uint8_t data_header[W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER + 1];
+} W61_ATD_Frame_t;
+
+/** @} */
+
+/* Exported functions ------------------------------------------------------- */
+/** @defgroup ST67W61_AT_RX_Frame_Functions ST67W61 AT Driver Rx Frame Functions
+  * @ingroup  ST67W61_AT_RX_Frame
+  * @{
+  */
+
+/**
+  * @brief  Initialize the framing state
+  * @param  p_frame: framing state
+  * @param  p_cb: message handlers
+  * @param  p_ctx: first parameter of the handlers
+  */
+void W61_ATD_FrameInit(W61_ATD_Frame_t *p_frame, const W61_ATD_FrameCb_t *p_cb, void *p_ctx);
+
+/**
+  * @brief  Hand the complete messages of p_in over to the handlers.
+  *         Data payloads are handed over as they arrive. An incomplete message at the end of p_in
+  *         is not consumed, the caller must give it again, followed by the next bytes received.
+  * @param  p_frame: framing state
+  * @param  p_in: received bytes
+  * @param  len: number of received bytes
+  * @retval uint32_t: number of bytes consumed from p_in
+  */
+uint32_t W61_ATD_FrameParse(W61_ATD_Frame_t *p_frame, const uint8_t *p_in, uint32_t len);
+
+/**
+  * @brief  Get the type of an event handed over by the Event handler
+  * @param  p_msg: event message
+  * @param  len: event message length
+  * @retval uint32_t: RECV_TYPE of the event, RECV_TYPE_NONE if it is not a known event
+  */
+uint32_t W61_ATD_FrameEventType(const uint8_t *p_msg, uint32_t len);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* W61_AT_RX_FRAME_H */
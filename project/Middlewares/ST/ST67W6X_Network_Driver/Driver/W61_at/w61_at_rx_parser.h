@@ -27,6 +27,7 @@ extern "C" {
 /* Includes ------------------------------------------------------------------*/
 #include "w61_at_api.h"
 #include "w61_default_config.h"
+#include "w61_at_rx_frame.h"
 
 /** @defgroup ST67W61_AT_RX_Parser ST67W61 AT Driver Rx Parser
   * @ingroup  ST67W61_AT
@@ -75,19 +76,18 @@ extern "C" {
 #define W61_ATD_EVENT_STRING_SIZE               192
 #endif /* W61_ATD_EVENT_STRING_SIZE */
 
-/** when calling ATRecv() this is given as max size param */
-#define W61_ATD_RSP_SIZE                        W61_ATD_CMDRSP_STRING_SIZE
+#ifndef W61_ATD_RESP_XBUF_SIZE
+/** Size of the message buffer holding the responses not yet read by W61_ATD_Recv() */
+#define W61_ATD_RESP_XBUF_SIZE                  1024
+#endif /* W61_ATD_RESP_XBUF_SIZE */
 
-/** the dispatcher doesn't need the entire string to dispatch nominal events */
-#define W61_ATD_EVT_SEGMENT_NEEDED              10
+#ifndef W61_ATD_EVT_XBUF_SIZE
+/** Size of the message buffer holding the events not yet dispatched, e.g. a burst of scan results */
+#define W61_ATD_EVT_XBUF_SIZE                   3072
+#endif /* W61_ATD_EVT_XBUF_SIZE */
 
-/**
-  * Should contain one of the following:
-  * +CIPRECVDATA:[size],
-  * +BLE:GATTWRITE:y,y,y,[size]
-  * +MQTT:SUBRECV,y,[size1],[size2]
-  */
-#define W61_ATD_MAX_SIZEOF_RECV_DATA_HEADER     28
+/** when calling ATRecv() this is given as max size param */
+#define W61_ATD_RSP_SIZE                        W61_ATD_CMDRSP_STRING_SIZE
 
 /** @} */
 
@@ -119,16 +119,17 @@ void W61_ATD_RxParserDeInit(W61_Object_t *Obj);
 void W61_ATD_RxPooling_task(void *arg);
 
 /**
-  * @brief  Pool Events from ATD_Resp_Queue and dispatch it to the correspondent module
+  * @brief  Pool Events from ATD_Evt_xMessageBuffer and dispatch it to the correspondent module
   * @param  arg: pointer to module handle
   */
 void W61_ATD_EventsPooling_task(void *arg);
 
 /**
-  * @brief  Receive Response from the Obj->ATD_Resp_Queue.
-  *         This function receives data from the Obj->ATD_Resp_Queue, the
-  *         data is fetched from a queue that is asynchronously
+  * @brief  Receive Response from the Obj->ATD_Resp_xMessageBuffer.
+  *         This function receives data from the Obj->ATD_Resp_xMessageBuffer, the
+  *         data is fetched from a message buffer that is asynchronously
   *         and continuously filled with by the W61_ATD_RxPooling_task().
+  *         A response longer than len is truncated.
   * @note   Internal function shall only be called by the CMD/RSP function (applicative task).
   *         and within the W61_ATlock W61_ATunlock protection.
   * @param  Obj: pointer to module handle
@@ -139,6 +140,17 @@ void W61_ATD_EventsPooling_task(void *arg);
   */
 int32_t W61_ATD_Recv(W61_Object_t *Obj, uint8_t *pBuf, uint32_t len, uint32_t timeout_ms);
 
+/**
+  * @brief  Discard the responses left in the Obj->ATD_Resp_xMessageBuffer.
+  *         The responses are not tagged, so any response queued before a command is sent
+  *         belongs to a previous command (e.g. one that timed out) and must not be taken
+  *         as the response of the new one.
+  * @note   Internal function shall only be called within the W61_ATlock W61_ATunlock protection.
+  * @param  Obj: pointer to module handle
+  * @retval uint32_t: number of responses discarded.
+  */
+uint32_t W61_ATD_FlushResp(W61_Object_t *Obj);
+
 /** @} */
 
 #ifdef __cplusplus
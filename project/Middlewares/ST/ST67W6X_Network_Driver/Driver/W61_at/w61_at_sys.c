@@ -30,6 +30,8 @@
 #include "trcRecorder.h"
 #endif /* SYS_DBG_ENABLE_TA4 */
 
+LOG_MODULE_DEFINE();
+
 /* Private typedef -----------------------------------------------------------*/
 /** @addtogroup ST67W61_AT_System_Types
   * @{
@@ -575,7 +577,7 @@ W61_Status_t W61_FS_ReadFile(W61_Object_t *Obj, char *filename, uint32_t offset,
              "AT+FS=0,3,\"%s\",%" PRIu32 ",%" PRIu32 "\r\n",
              filename, offset, len);
 
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* Wait the response '+FS:READ,' */
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, W61_SYS_TIMEOUT);
@@ -692,7 +694,7 @@ W61_Status_t W61_FS_ListFiles(W61_Object_t *Obj, W61_FS_FilesList_t *files_list)
 
     /* Operation 5: List the NCP files in root path */
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+FS=0,5,\".\"\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       /* Wait the first response +FS:LIST */
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, W61_SYS_TIMEOUT);
@@ -769,7 +771,7 @@ W61_Status_t W61_GetModuleInfo(W61_Object_t *Obj)
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+GMR\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       W61_VersionInfo_t version_table[] =
       {
@@ -1236,7 +1238,7 @@ W61_Status_t W61_SetPowerMode(W61_Object_t *Obj, uint32_t ps_mode, uint32_t hbn_
                "AT+PWR=%" PRIu32 ",%" PRIu32 "\r\n", ps_mode, hbn_level);
       int32_t cmd_len = strlen((char *)Obj->CmdResp);
       /* send only. No response from the ST67W when in hibernate ps mode*/
-      if (W61_ATsend(Obj, Obj->CmdResp, cmd_len, Obj->NcpTimeout) == cmd_len)
+      if (W61_AT_SendCmd(Obj, Obj->CmdResp, cmd_len) == cmd_len)
       {
         ret = W61_STATUS_OK;
       }
@@ -1302,7 +1304,7 @@ W61_Status_t W61_SetClockSource(W61_Object_t *Obj, uint32_t source)
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE,
              "AT+SET_CLOCK=%" PRIu32 "\r\n", source);
 
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, CLOCK_TIMEOUT);
       if (recv_len > 0)
@@ -1359,7 +1361,7 @@ W61_Status_t W61_ExeATCommand(W61_Object_t *Obj, char *at_cmd)
     uint32_t cmd_len = strlen((char *)Obj->CmdResp);
     uint32_t rcvlen = 0;
 
-    if (W61_ATsend(Obj, (uint8_t *)Obj->CmdResp, cmd_len, W61_SYS_TIMEOUT) == cmd_len)
+    if (W61_AT_SendCmdTimeout(Obj, (uint8_t *)Obj->CmdResp, cmd_len, W61_SYS_TIMEOUT) == cmd_len)
     {
       LogInfo("%s", Obj->CmdResp);
       /* Receive the responses and check if the returned length is greater than 0 */
@@ -30,6 +30,8 @@
 #include "trcRecorder.h"
 #endif /* SYS_DBG_ENABLE_TA4 */
 
+LOG_MODULE_DEFINE();
+
 /* Global variables ----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
 /** @addtogroup ST67W61_AT_WiFi_Constants
@@ -665,7 +667,7 @@ W61_Status_t W61_WiFi_GetStaIpAddress(W61_Object_t *Obj)
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CIPSTA?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, Obj->NcpTimeout);
       if (recv_len <= 0)
@@ -1299,7 +1301,7 @@ W61_Status_t W61_WiFi_ListConnectedSta(W61_Object_t *Obj, W61_WiFi_Connected_Sta
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CWLIF\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, W61_WIFI_TIMEOUT);
       if (recv_len <= 0)
@@ -1488,7 +1490,7 @@ W61_Status_t W61_WiFi_GetApIpAddress(W61_Object_t *Obj)
   if (W61_ATlock(Obj, W61_AT_LOCK_TIMEOUT))
   {
     snprintf((char *)Obj->CmdResp, W61_ATD_CMDRSP_STRING_SIZE, "AT+CIPAP?\r\n");
-    if (W61_ATsend(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp), Obj->NcpTimeout) > 0)
+    if (W61_AT_SendCmd(Obj, Obj->CmdResp, strlen((char *)Obj->CmdResp)) > 0)
     {
       recv_len = W61_ATD_Recv(Obj, Obj->CmdResp, W61_ATD_RSP_SIZE, Obj->NcpTimeout);
       if (recv_len <= 0)
@@ -40,6 +40,8 @@
 #include "spi_iface.h"
 #include "spi_port.h"
 
+LOG_MODULE_DEFINE();
+
 #define SPI_HEADER_MAGIC_CODE 0x55AA
 
 #ifndef SPI_THREAD_STACK_SIZE
@@ -36,6 +36,8 @@
 /* Defender API include. */
 #include "defender.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief Get the topic length for a given defender API.
  *
@@ -33,6 +33,7 @@
 /* Shadow includes. */
 #include "shadow.h"
 
+LOG_MODULE_DEFINE();
 
 /**
  * @brief Maximum shadow name length.
@@ -35,6 +35,8 @@
 /* Fleet Provisioning API include. */
 #include "fleet_provisioning.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief Identifier for which of the topic suffixes for a given format and
  * Fleet Provisioning MQTT API.
@@ -71,6 +71,7 @@
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
 
+LOG_MODULE_DEFINE();
 
 /**
  * @brief Offset helper.
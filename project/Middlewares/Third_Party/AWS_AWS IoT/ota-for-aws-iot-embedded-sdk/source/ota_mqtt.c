@@ -44,6 +44,8 @@
 /* Include firmware version struct definition. */
 #include "ota_appversion32.h"
 
+LOG_MODULE_DEFINE();
+
 /* Stream GET message constants. */
 #define OTA_CLIENT_TOKEN             "rdy"                  /*!< Arbitrary client token sent in the stream "GET" message. */
 
@@ -40,6 +40,8 @@
 #include "ota.h"
 #include "ota_private.h"
 
+LOG_MODULE_DEFINE();
+
 /* OTA Event queue attributes.*/
 #define MAX_MESSAGES    20
 #define MAX_MSG_SIZE    sizeof( OtaEventMsg_t )
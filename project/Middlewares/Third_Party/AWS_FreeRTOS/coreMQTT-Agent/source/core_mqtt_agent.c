@@ -49,6 +49,8 @@
 /* MQTT Agent default logging configuration include. */
 #include "core_mqtt_agent_default_logging.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 #if ( MQTT_AGENT_USE_QOS_1_2_PUBLISH != 0 )
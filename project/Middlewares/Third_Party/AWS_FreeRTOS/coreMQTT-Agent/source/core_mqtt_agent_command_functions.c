@@ -39,6 +39,8 @@
 /* MQTT Agent default logging configuration include. */
 #include "core_mqtt_agent_default_logging.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 MQTTStatus_t MQTTAgentCommand_ProcessLoop( MQTTAgentContext_t * pMqttAgentContext,
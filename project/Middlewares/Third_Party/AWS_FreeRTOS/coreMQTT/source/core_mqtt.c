@@ -37,6 +37,8 @@
 
 #include "core_mqtt_default_logging.h"
 
+LOG_MODULE_DEFINE();
+
 #ifndef MQTT_PRE_SEND_HOOK
 
 /**
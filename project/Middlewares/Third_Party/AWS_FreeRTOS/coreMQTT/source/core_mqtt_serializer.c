@@ -36,6 +36,8 @@
 
 #include "core_mqtt_default_logging.h"
 
+LOG_MODULE_DEFINE();
+
 /**
  * @brief MQTT protocol version 3.1.1.
  */
@@ -35,6 +35,8 @@
 
 #include "core_mqtt_default_logging.h"
 
+LOG_MODULE_DEFINE();
+
 /*-----------------------------------------------------------*/
 
 /**
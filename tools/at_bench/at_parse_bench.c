@@ -0,0 +1,250 @@
+/**
+  ******************************************************************************
+  * @file    at_parse_bench.c
+  * @brief   Host benchmark of the ST67W6X AT messages framing (w61_at_rx_frame.c)
+  *          fed with a recorded trace of the bytes returned by IO_Receive.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2024 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+
+/*
+ * Built and run by at_parse_bench.py, or by hand:
+ *   cc -O2 -I<W61_at dir> at_parse_bench.c <W61_at dir>/w61_at_rx_frame.c -Wl,--wrap=malloc -o at_parse_bench
+ *   ./at_parse_bench trace.bin [chunk size, 0 for random sizes] [iterations] [seed]
+ *
+ * The trace is first parsed in one call, then through a receive buffer of RX_BUFFER_SIZE bytes
+ * refilled by chunks, the way W61_ATD_RxPooling_task() does. Both runs must hand over the same messages.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "w61_at_rx_frame.h"
+
+/** Receive buffer size, SPI_XFER_MTU_BYTES on the target */
+#define RX_BUFFER_SIZE        (6 * 1024)
+
+/** Messages handed over by the framing */
+typedef struct
+{
+  uint32_t resp;        /*!< Number of responses */
+  uint32_t evt;         /*!< Number of events */
+  uint32_t data;        /*!< Number of data messages */
+  uint64_t data_bytes;  /*!< Payload bytes */
+  uint32_t hash;        /*!< FNV-1a hash of the messages, in order */
+} Bench_Stats_t;
+
+/** Number of malloc calls */
+static uint32_t MallocCount;
+
+void *__real_malloc(size_t size);
+
+/** Counts the allocations, the framing is linked with -Wl,--wrap=malloc */
+void *__wrap_malloc(size_t size)
+{
+  MallocCount++;
+  return __real_malloc(size);
+}
+
+static uint32_t Bench_Hash(uint32_t hash, const uint8_t *p, uint32_t len)
+{
+  uint32_t i;
+
+  for (i = 0; i < len; i++)
+  {
+    hash = (hash ^ p[i]) * 16777619U;
+  }
+  return hash;
+}
+
+static void Bench_Resp(void *p_ctx, const uint8_t *p_msg, uint32_t len)
+{
+  Bench_Stats_t *stats = p_ctx;
+
+  stats->resp++;
+  stats->hash = Bench_Hash(stats->hash ^ 'R', p_msg, len);
+}
+
+static void Bench_Event(void *p_ctx, const uint8_t *p_msg, uint32_t len)
+{
+  Bench_Stats_t *stats = p_ctx;
+  uint8_t type = (uint8_t)W61_ATD_FrameEventType(p_msg, len);
+
+  stats->evt++;
+  stats->hash = Bench_Hash(stats->hash ^ 'E', &type, 1);
+  stats->hash = Bench_Hash(stats->hash, p_msg, len);
+}
+
+static void Bench_Data(void *p_ctx, uint32_t type, uint32_t offset, const uint8_t *p_data, uint32_t len)
+{
+  Bench_Stats_t *stats = p_ctx;
+
+  (void)type;
+  (void)offset;
+  stats->data_bytes += len;
+  stats->hash = Bench_Hash(stats->hash, p_data, len);
+}
+
+static void Bench_DataEnd(void *p_ctx, uint32_t type, uint8_t *p_header, uint32_t len)
+{
+  Bench_Stats_t *stats = p_ctx;
+  uint8_t t = (uint8_t)type;
+
+  stats->data++;
+  stats->hash = Bench_Hash(stats->hash ^ 'D', &t, 1);
+  stats->hash = Bench_Hash(stats->hash, p_header, len);
+}
+
+static const W61_ATD_FrameCb_t BenchCb =
+{
+  Bench_Resp,
+  Bench_Event,
+  Bench_Data,
+  Bench_DataEnd,
+};
+
+static double Bench_Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/** Feed the trace through the receive buffer, as W61_ATD_RxPooling_task() does */
+static void Bench_Run(const uint8_t *p_trace, size_t trace_len, uint32_t chunk, uint32_t *p_seed,
+                      uint8_t *p_rx_buf, Bench_Stats_t *p_stats)
+{
+  W61_ATD_Frame_t frame;
+  size_t pos = 0;
+  uint32_t fill = 0;
+
+  memset(p_stats, 0, sizeof(Bench_Stats_t));
+  p_stats->hash = 2166136261U;
+  W61_ATD_FrameInit(&frame, &BenchCb, p_stats);
+
+  while (pos < trace_len)
+  {
+    uint32_t room = RX_BUFFER_SIZE - fill;
+    uint32_t n = (chunk != 0) ? chunk : (uint32_t)(rand_r(p_seed) % RX_BUFFER_SIZE) + 1;
+    uint32_t consumed;
+
+    if (n > room)
+    {
+      n = room;
+    }
+    if (n > trace_len - pos)
+    {
+      n = (uint32_t)(trace_len - pos);
+    }
+    memcpy(&p_rx_buf[fill], &p_trace[pos], n);
+    pos += n;
+    fill += n;
+
+    consumed = W61_ATD_FrameParse(&frame, p_rx_buf, fill);
+    fill -= consumed;
+    if (fill == RX_BUFFER_SIZE)
+    {
+      fprintf(stderr, "message longer than the receive buffer at offset %zu, dropped\n", pos - fill);
+      fill = 0;
+    }
+    else if ((consumed > 0) && (fill > 0))
+    {
+      memmove(p_rx_buf, &p_rx_buf[consumed], fill);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  W61_ATD_Frame_t frame;
+  Bench_Stats_t ref;
+  Bench_Stats_t stats;
+  uint8_t *p_trace;
+  uint8_t *p_rx_buf;
+  size_t trace_len;
+  uint32_t chunk = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0;
+  uint32_t iterations = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 20;
+  uint32_t seed = (argc > 4) ? (uint32_t)strtoul(argv[4], NULL, 0) : 1;
+  uint32_t messages;
+  uint32_t allocs;
+  uint32_t i;
+  double start;
+  double elapsed;
+  FILE *f;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "usage: %s trace.bin [chunk] [iterations] [seed]\n", argv[0]);
+    return 2;
+  }
+
+  f = fopen(argv[1], "rb");
+  if (f == NULL)
+  {
+    perror(argv[1]);
+    return 2;
+  }
+  fseek(f, 0, SEEK_END);
+  trace_len = (size_t)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  p_trace = malloc(trace_len);
+  p_rx_buf = malloc(RX_BUFFER_SIZE);
+  if ((p_trace == NULL) || (p_rx_buf == NULL) || (fread(p_trace, 1, trace_len, f) != trace_len))
+  {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 2;
+  }
+  fclose(f);
+
+  /* Reference: the whole trace in one call */
+  memset(&ref, 0, sizeof(ref));
+  ref.hash = 2166136261U;
+  W61_ATD_FrameInit(&frame, &BenchCb, &ref);
+  if (W61_ATD_FrameParse(&frame, p_trace, (uint32_t)trace_len) != trace_len)
+  {
+    fprintf(stderr, "warning: trace ends with an incomplete message\n");
+  }
+
+  MallocCount = 0;
+  start = Bench_Now();
+  for (i = 0; i < iterations; i++)
+  {
+    Bench_Run(p_trace, trace_len, chunk, &seed, p_rx_buf, &stats);
+    if ((stats.resp != ref.resp) || (stats.evt != ref.evt) || (stats.data != ref.data) ||
+        (stats.data_bytes != ref.data_bytes) || (stats.hash != ref.hash))
+    {
+      fprintf(stderr, "mismatch at iteration %u: resp %u/%u evt %u/%u data %u/%u bytes %llu/%llu hash %08x/%08x\n",
+              i, stats.resp, ref.resp, stats.evt, ref.evt, stats.data, ref.data,
+              (unsigned long long)stats.data_bytes, (unsigned long long)ref.data_bytes, stats.hash, ref.hash);
+      return 1;
+    }
+  }
+  elapsed = Bench_Now() - start;
+  allocs = MallocCount;
+
+  messages = ref.resp + ref.evt + ref.data;
+  printf("trace %zu bytes: %u responses, %u events, %u data messages (%llu payload bytes)\n",
+         trace_len, ref.resp, ref.evt, ref.data, (unsigned long long)ref.data_bytes);
+  printf("chunk %-6s %8.1f MB/s %10.0f msg/s %6.3f allocs/msg\n",
+         (chunk != 0) ? argv[2] : "random",
+         (double)trace_len * iterations / elapsed / 1e6,
+         (double)messages * iterations / elapsed,
+         (messages != 0) ? (double)allocs / ((double)messages * iterations) : 0.0);
+
+  free(p_rx_buf);
+  free(p_trace);
+  return 0;
+}
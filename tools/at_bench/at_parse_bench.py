@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : at_parse_bench.py
+# * @brief          : Build and run the host benchmark of the ST67W6X AT
+# *                   messages framing (w61_at_rx_frame.c) on a recorded or
+# *                   synthetic trace of the module output.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python at_parse_bench.py
+#   python at_parse_bench.py --chunk 0 64 1024 --payload 1460
+#   python at_parse_bench.py --trace capture.bin --save-trace synthetic.bin
+#
+# A recorded trace is the raw concatenation of the buffers returned by
+# IO_Receive, e.g. dumped from AT_LOG_HOST_IN. Without --trace, a trace mixing
+# command responses, send prompts, socket and MQTT data and Wi-Fi events is
+# generated.
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+W61_AT_DIR = os.path.normpath(os.path.join(HERE, "..", "..", "project", "Middlewares", "ST",
+                                           "ST67W6X_Network_Driver", "Driver", "W61_at"))
+
+
+def synthetic_trace(rng, count, payload):
+    """Module output for count socket/MQTT exchanges."""
+    out = bytearray()
+    for i in range(count):
+        link = i % 4
+        size = rng.randint(1, payload)
+        data = bytes(rng.getrandbits(8) for _ in range(size))
+        # Socket send: prompt, then SEND OK filtered by the parser
+        out += b"\r\n>"
+        out += b"\r\nRecv %d bytes\r\n\r\nSEND OK\r\n" % size
+        # Socket receive: data event then pull
+        out += b"+IPD:%d,%d\r\n" % (link, size)
+        out += b"+CIPRECVDATA:%d," % size + data + b"\r\n\r\nOK\r\n"
+        if i % 4 == 0:
+            topic = b"sensors/%d/telemetry" % link
+            msg = data[: min(size, 256)]
+            out += b"+MQTT:SUBRECV:0,%d,%d,\"%s\"," % (len(topic), len(msg), topic) + msg + b"\r\n"
+        if i % 16 == 0:
+            out += b"AT+CIPSTATUS?\r\n+CIPSTATUS:%d,\"TCP\",\"192.168.1.10\",8883,50123,0\r\n\r\nOK\r\n" % link
+            out += b"+CW:RSSI -%d\r\n" % rng.randint(30, 90)
+    return bytes(out)
+
+
+def build(workdir, cc, cflags):
+    exe = os.path.join(workdir, "at_parse_bench")
+    cmd = [cc] + cflags.split() + ["-I", W61_AT_DIR,
+                                   os.path.join(HERE, "at_parse_bench.c"),
+                                   os.path.join(W61_AT_DIR, "w61_at_rx_frame.c"),
+                                   "-Wl,--wrap=malloc", "-o", exe]
+    subprocess.run(cmd, check=True)
+    return exe
+
+
+def main():
+    parser = argparse.ArgumentParser(description="AT messages framing benchmark")
+    parser.add_argument("--trace", help="recorded trace, raw IO_Receive bytes")
+    parser.add_argument("--save-trace", help="write the synthetic trace to this file")
+    parser.add_argument("--exchanges", type=int, default=2000, help="synthetic trace length")
+    parser.add_argument("--payload", type=int, default=1460, help="largest synthetic payload")
+    parser.add_argument("--chunk", type=int, nargs="+", default=[0, 64, 512, 2048],
+                        help="bytes per IO_Receive, 0 for random sizes")
+    parser.add_argument("--iterations", type=int, default=20)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default="-O2 -Wall -Wextra")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as workdir:
+        if args.trace:
+            trace = args.trace
+        else:
+            data = synthetic_trace(random.Random(args.seed), args.exchanges, args.payload)
+            trace = args.save_trace or os.path.join(workdir, "trace.bin")
+            with open(trace, "wb") as f:
+                f.write(data)
+
+        exe = build(workdir, args.cc, args.cflags)
+        for chunk in args.chunk:
+            result = subprocess.run([exe, trace, str(chunk), str(args.iterations), str(args.seed)])
+            if result.returncode != 0:
+                return result.returncode
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -13,8 +13,11 @@
 # *                        opensource.org/licenses/BSD-3-Clause
 # ******************************************************************************
 
+import argparse
 import socket
 import sys
+import threading
+import time
 
 def test_echo_server(host, port):
     try:
@@ -55,11 +58,67 @@ def test_echo_server(host, port):
     except Exception as e:
         print(f"An unexpected error occurred: {e}")
 
+def bench_echo_server(host, port, megabytes, chunk):
+    """Stream megabytes through the echo server and report the throughput.
+
+    Sending and receiving run concurrently so the TCP windows stay full. Run
+    "perf top" on the device console meanwhile to get the CPU load of the
+    tcpip and EthData tasks, CPU time per MB is load * seconds / MB.
+    """
+    total = megabytes * 1024 * 1024
+    payload = bytes(i & 0xFF for i in range(chunk))
+    pattern = payload * (65536 // chunk + 2)
+    received = 0
+    errors = []
+
+    def receiver(sock):
+        nonlocal received
+        try:
+            while received < total:
+                data = sock.recv(65536)
+                if not data:
+                    break
+                offset = received % chunk
+                if data != pattern[offset:offset + len(data)]:
+                    raise ValueError(f"data mismatch after {received} bytes")
+                received += len(data)
+        except (socket.error, ValueError) as e:
+            errors.append(e)
+
+    with socket.create_connection((host, port), timeout=30) as s:
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        thread = threading.Thread(target=receiver, args=(s,))
+        start = time.monotonic()
+        thread.start()
+
+        sent = 0
+        while sent < total:
+            block = payload[:min(chunk, total - sent)]
+            s.sendall(block)
+            sent += len(block)
+
+        thread.join()
+        elapsed = time.monotonic() - start
+
+    if errors:
+        print(f"Echo failed after {received} bytes - {errors[0]}")
+        return 1
+
+    print(f"Echoed {received / (1024 * 1024):.1f} MB in {elapsed:.2f} s: "
+          f"{received * 8 / elapsed / 1e6:.2f} Mbit/s each way")
+    return 0
+
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
-        print("Usage: python script.py <host> <port>")
-        sys.exit(1)
+    parser = argparse.ArgumentParser(description="Echo server client")
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("--bench-mb", type=int, default=0,
+                        help="stream this many MB through the server and report throughput")
+    parser.add_argument("--chunk", type=int, default=1024,
+                        help="bytes per send in benchmark mode")
+    args = parser.parse_args()
+
+    if args.bench_mb > 0:
+        sys.exit(bench_echo_server(args.host, args.port, args.bench_mb, args.chunk))
 
-    host = sys.argv[1]
-    port = int(sys.argv[2])
-    test_echo_server(host, port)
+    test_echo_server(args.host, args.port)
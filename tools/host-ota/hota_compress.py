@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : hota_compress.py
+# * @brief          : Build and check LZSS compressed OTA images for the ota_pal
+# *                   decompressor (project/Core/Src/ota_pal/ota_lzss.c)
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python hota_compress.py compress --image v0.9.2.bin
+#   python hota_compress.py decompress --image v0.9.2.bin.lzss --out rebuilt.bin
+#   python hota_compress.py verify --link-kBps 40 v0.9.1.bin v0.9.2.bin
+#
+# The compressed file is uploaded under the name of the image followed by ".lzss"
+# (see hota_update.py --compress). The device writes the decompressed image to the
+# OTA area while blocks arrive, the job signature is computed over the decompressed
+# image so it is checked exactly like for an uncompressed update.
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+LZSS_SUFFIX = ".lzss"  # OTA_LZSS_FILE_SUFFIX
+MAGIC = 0x535A4C4F  # "OLZS"
+FORMAT_VERSION = 1
+HEADER_FORMAT = "<IHHBBHI"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+MIN_MATCH = 3          # OTA_LZSS_MIN_MATCH
+MAX_WINDOW_BITS = 16   # OTA_LZSS_MAX_WINDOW_BITS
+MAX_LENGTH_BITS = 8    # OTA_LZSS_MAX_LENGTH_BITS
+
+WINDOW_BITS = 13
+LENGTH_BITS = 4
+MAX_CHAIN = 32         # Positions tried per match search
+
+BLOCK_SIZE = 2048      # 1 << otaconfigLOG2_FILE_BLOCK_SIZE
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def write(self, value, bits):
+        self.acc = (self.acc << bits) | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.acc >> self.count) & 0xFF)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count:
+            self.out.append((self.acc << (8 - self.count)) & 0xFF)
+            self.count = 0
+            self.acc = 0
+        return bytes(self.out)
+
+
+def compress(data, window_bits=WINDOW_BITS, length_bits=LENGTH_BITS):
+    if not 0 < window_bits <= MAX_WINDOW_BITS or not 0 < length_bits <= MAX_LENGTH_BITS:
+        raise ValueError("unsupported window or length bits")
+
+    window = 1 << window_bits
+    max_len = MIN_MATCH + (1 << length_bits) - 1
+    head = {}
+    prev = [0] * len(data)
+    bits = BitWriter()
+    stats = {"literals": 0, "matches": 0, "match_bytes": 0}
+
+    def insert(pos):
+        if pos + MIN_MATCH <= len(data):
+            key = data[pos:pos + MIN_MATCH]
+            prev[pos] = head.get(key, -1)
+            head[key] = pos
+
+    def longest(pos):
+        best_len = 0
+        best_dist = 0
+        if pos + MIN_MATCH > len(data):
+            return best_len, best_dist
+        limit = min(max_len, len(data) - pos)
+        candidate = head.get(data[pos:pos + MIN_MATCH], -1)
+        chain = MAX_CHAIN
+        while candidate >= 0 and pos - candidate <= window and chain:
+            length = MIN_MATCH
+            while length < limit and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_dist = length, pos - candidate
+                if length == limit:
+                    break
+            candidate = prev[candidate]
+            chain -= 1
+        return best_len, best_dist
+
+    pos = 0
+    while pos < len(data):
+        length, dist = longest(pos)
+
+        # One step lazy evaluation, emit a literal when the next position has a
+        # clearly longer match.
+        if length >= MIN_MATCH and length < max_len:
+            insert(pos)
+            next_len, _ = longest(pos + 1)
+            if next_len > length + 1:
+                length = 0
+        else:
+            insert(pos)
+
+        if length >= MIN_MATCH:
+            bits.write(0, 1)
+            bits.write(dist - 1, window_bits)
+            bits.write(length - MIN_MATCH, length_bits)
+            stats["matches"] += 1
+            stats["match_bytes"] += length
+            for p in range(pos + 1, pos + length):
+                insert(p)
+            pos += length
+        else:
+            bits.write(1, 1)
+            bits.write(data[pos], 8)
+            stats["literals"] += 1
+            pos += 1
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, FORMAT_VERSION, HEADER_SIZE,
+                         window_bits, length_bits, 0, len(data))
+    return header + bits.finish(), stats
+
+
+def parse_header(blob):
+    if len(blob) < HEADER_SIZE:
+        raise ValueError("file shorter than its header")
+    magic, version, header_size, window_bits, length_bits, _, size = \
+        struct.unpack_from(HEADER_FORMAT, blob)
+    if magic != MAGIC or version != FORMAT_VERSION or header_size != HEADER_SIZE:
+        raise ValueError("not an LZSS image")
+    if not 0 < window_bits <= MAX_WINDOW_BITS or not 0 < length_bits <= MAX_LENGTH_BITS or not size:
+        raise ValueError("unsupported LZSS parameters")
+    return window_bits, length_bits, size
+
+
+def decompress(blob):
+    """Reference decoder, same checks as xOtaLzssApply()."""
+    window_bits, length_bits, size = parse_header(blob)
+    stream = blob[HEADER_SIZE:]
+    out = bytearray()
+    acc = 0
+    count = 0
+    pos = 0
+
+    def read(bits):
+        nonlocal acc, count, pos
+        while count < bits:
+            if pos >= len(stream):
+                raise ValueError("truncated stream")
+            acc = (acc << 8) | stream[pos]
+            pos += 1
+            count += 8
+        count -= bits
+        return (acc >> count) & ((1 << bits) - 1)
+
+    while len(out) < size:
+        if read(1):
+            out.append(read(8))
+        else:
+            dist = read(window_bits) + 1
+            length = read(length_bits) + MIN_MATCH
+            if dist > len(out) or len(out) + length > size:
+                raise ValueError("match outside of the image")
+            for _ in range(length):
+                out.append(out[-dist])
+
+    if pos != len(stream):
+        raise ValueError("trailing data after the image")
+    return bytes(out)
+
+
+def blocks(size):
+    return (size + BLOCK_SIZE - 1) // BLOCK_SIZE
+
+
+def report(name, image, packed, stats, link_kBps):
+    deflate = len(zlib.compress(image, 9))
+    print(f"{name}: image {len(image)} B, lzss {len(packed)} B "
+          f"({100.0 * len(packed) / len(image):.1f} %), zlib -9 reference "
+          f"{100.0 * deflate / len(image):.1f} %, "
+          f"{blocks(len(image))} -> {blocks(len(packed))} blocks of {BLOCK_SIZE} B")
+    print(f"  {stats['literals']} literals, {stats['matches']} matches ({stats['match_bytes']} B)")
+    if link_kBps:
+        raw = len(image) / (link_kBps * 1024.0)
+        lzss = len(packed) / (link_kBps * 1024.0)
+        print(f"  transfer at {link_kBps} kB/s: {raw:.1f} s -> {lzss:.1f} s")
+
+
+def read_file(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def cmd_compress(args):
+    image = read_file(args.image)
+    packed, stats = compress(image, args.window_bits, args.length_bits)
+    out = args.out or args.image + LZSS_SUFFIX
+    with open(out, "wb") as f:
+        f.write(packed)
+    report(out, image, packed, stats, args.link_kBps)
+    return 0
+
+
+def cmd_decompress(args):
+    image = decompress(read_file(args.image))
+    with open(args.out, "wb") as f:
+        f.write(image)
+    print(f"{args.out}: {len(image)} B")
+    return 0
+
+
+def cmd_verify(args):
+    failures = 0
+    for path in args.images:
+        image = read_file(path)
+        start = time.monotonic()
+        packed, stats = compress(image, args.window_bits, args.length_bits)
+        elapsed = time.monotonic() - start
+        try:
+            ok = decompress(packed) == image
+        except ValueError as e:
+            print(f"  {e}")
+            ok = False
+        report(path, image, packed, stats, args.link_kBps)
+        print(f"  round trip {'OK' if ok else 'FAILED'}, compressed in {elapsed:.1f} s")
+        failures += 0 if ok else 1
+
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compressed OTA image tool")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    def add_params(p):
+        p.add_argument("--window-bits", type=int, default=WINDOW_BITS,
+                       help=f"log2 of the match window, up to {MAX_WINDOW_BITS}")
+        p.add_argument("--length-bits", type=int, default=LENGTH_BITS,
+                       help=f"bits of the match length field, up to {MAX_LENGTH_BITS}")
+        p.add_argument("--link-kBps", type=float, default=0.0,
+                       help="estimate the transfer time at this link throughput")
+
+    p = sub.add_parser("compress", help="build a compressed image")
+    p.add_argument("--image", required=True)
+    p.add_argument("--out", help="output file, default <image>.lzss")
+    add_params(p)
+    p.set_defaults(func=cmd_compress)
+
+    p = sub.add_parser("decompress", help="rebuild an image from a compressed image")
+    p.add_argument("--image", required=True)
+    p.add_argument("--out", required=True)
+    p.set_defaults(func=cmd_decompress)
+
+    p = sub.add_parser("verify", help="round trip images")
+    p.add_argument("images", nargs="+")
+    add_params(p)
+    p.set_defaults(func=cmd_verify)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,326 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : hota_delta.py
+# * @brief          : Build and check delta OTA images for the ota_pal delta
+# *                   decoder (project/Core/Src/ota_pal/ota_delta.c)
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python hota_delta.py diff --base v0.9.1.bin --target v0.9.2.bin --base-version 0.9.1
+#   python hota_delta.py apply --base v0.9.1.bin --delta v0.9.2.bin.delta --out rebuilt.bin
+#   python hota_delta.py verify v0.9.0.bin v0.9.1.bin v0.9.1.bin v0.9.2.bin
+#
+# The delta is uploaded and signed like a full image, under the name of the image
+# followed by ".delta" (see hota_update.py --base-file). The device stages it at the
+# top of the OTA area, rebuilds the target image at the bottom of the area while
+# blocks arrive, and only activates it when the rebuilt image matches the target
+# hash of the header and the delta signature is valid.
+
+import argparse
+import hashlib
+import struct
+import sys
+
+DELTA_SUFFIX = ".delta"  # OTA_DELTA_FILE_SUFFIX
+MAGIC = 0x544C444F  # "ODLT"
+FORMAT_VERSION = 1
+HEADER_FORMAT = "<IHHIII32s32s"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+OP_COPY = 0x80
+OP_LENGTH_EXT = 0x7F
+OP_LENGTH_BIAS = 128
+
+KGRAM = 8               # Length of the base image index keys
+MIN_COPY = 12           # Shortest COPY found through the index
+MIN_RESUME = 4          # Shortest COPY that resumes the previous displacement
+MAX_CANDIDATES = 8      # Base positions kept per index key
+
+BLOCK_SIZE = 2048       # 1 << otaconfigLOG2_FILE_BLOCK_SIZE
+
+
+def parse_version(text):
+    """"major.minor.build" to the AppVersion32_t value."""
+    if not text:
+        return 0
+    major, minor, build = (int(x) for x in text.split("."))
+    return (major << 24) | (minor << 16) | build
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value) << 1) - 1
+
+
+def op_header(copy, length):
+    flag = OP_COPY if copy else 0
+    if length < OP_LENGTH_EXT + 1:
+        return bytes([flag | (length - 1)])
+    return bytes([flag | OP_LENGTH_EXT]) + varint(length - OP_LENGTH_BIAS)
+
+
+def match_length(base, base_pos, target, target_pos):
+    """Length of the common run of base[base_pos:] and target[target_pos:]."""
+    limit = min(len(base) - base_pos, len(target) - target_pos)
+    length = 0
+    step = 64
+    while length < limit:
+        n = min(step, limit - length)
+        if base[base_pos + length:base_pos + length + n] == target[target_pos + length:target_pos + length + n]:
+            length += n
+            step = min(step * 2, 4096)
+        elif n == 1:
+            break
+        else:
+            step = max(n // 2, 1)
+    return length
+
+
+class DeltaEncoder:
+    def __init__(self, base):
+        self.base = base
+        self.index = {}
+        for pos in range(len(base) - KGRAM + 1):
+            key = base[pos:pos + KGRAM]
+            slot = self.index.get(key)
+            if slot is None:
+                self.index[key] = [pos]
+            elif len(slot) < MAX_CANDIDATES:
+                slot.append(pos)
+
+    def encode(self, target):
+        base = self.base
+        ops = bytearray()
+        stats = {"copy_ops": 0, "copy_bytes": 0, "add_ops": 0, "add_bytes": 0}
+        cursor = 0          # End of the previous COPY in the base image
+        displacement = 0    # base position - target position of the previous COPY
+        literal = 0         # Start of the pending ADD run
+        pos = 0
+
+        def flush_literal(end):
+            if end > literal:
+                ops.extend(op_header(False, end - literal))
+                ops.extend(target[literal:end])
+                stats["add_ops"] += 1
+                stats["add_bytes"] += end - literal
+
+        while pos < len(target):
+            best_len = 0
+            best_base = 0
+
+            resume = pos + displacement
+            if 0 <= resume < len(base):
+                length = match_length(base, resume, target, pos)
+                if length >= MIN_RESUME:
+                    best_len, best_base = length, resume
+
+            if pos + KGRAM <= len(target):
+                for candidate in self.index.get(target[pos:pos + KGRAM], ()):
+                    if candidate == best_base and best_len:
+                        continue
+                    length = match_length(base, candidate, target, pos)
+                    if length > best_len + 2 and length >= MIN_COPY:
+                        best_len, best_base = length, candidate
+
+            if best_len == 0:
+                pos += 1
+                continue
+
+            # Grow the match backwards into the pending literal run
+            while pos > literal and best_base > 0 and base[best_base - 1] == target[pos - 1]:
+                pos -= 1
+                best_base -= 1
+                best_len += 1
+
+            flush_literal(pos)
+            ops.extend(op_header(True, best_len))
+            ops.extend(varint(zigzag(best_base - cursor)))
+            stats["copy_ops"] += 1
+            stats["copy_bytes"] += best_len
+
+            cursor = best_base + best_len
+            displacement = best_base - pos
+            pos += best_len
+            literal = pos
+
+        flush_literal(len(target))
+        return bytes(ops), stats
+
+
+def make_delta(base, target, base_version=0):
+    ops, stats = DeltaEncoder(base).encode(target)
+    header = struct.pack(HEADER_FORMAT, MAGIC, FORMAT_VERSION, HEADER_SIZE, base_version,
+                         len(base), len(target), hashlib.sha256(base).digest(),
+                         hashlib.sha256(target).digest())
+    return header + ops, stats
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise ValueError("truncated or oversized varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def parse_header(delta):
+    if len(delta) < HEADER_SIZE:
+        raise ValueError("delta shorter than its header")
+    fields = struct.unpack_from(HEADER_FORMAT, delta)
+    magic, version, header_size = fields[:3]
+    if magic != MAGIC or version != FORMAT_VERSION or header_size != HEADER_SIZE:
+        raise ValueError("not a delta image")
+    keys = ("base_version", "base_size", "target_size", "base_hash", "target_hash")
+    return dict(zip(keys, fields[3:]))
+
+
+def apply_delta(base, delta):
+    """Reference decoder, same checks as xOtaDeltaApply()."""
+    header = parse_header(delta)
+    if hashlib.sha256(base[:header["base_size"]]).digest() != header["base_hash"]:
+        raise ValueError("base image does not match the delta")
+
+    out = bytearray()
+    cursor = 0
+    pos = HEADER_SIZE
+    while len(out) < header["target_size"]:
+        op = delta[pos]
+        pos += 1
+        length = (op & OP_LENGTH_EXT) + 1
+        if (op & OP_LENGTH_EXT) == OP_LENGTH_EXT:
+            length, pos = read_varint(delta, pos)
+            length += OP_LENGTH_BIAS
+        if len(out) + length > header["target_size"]:
+            raise ValueError("operation past the end of the target image")
+        if op & OP_COPY:
+            value, pos = read_varint(delta, pos)
+            start = cursor + ((value >> 1) ^ -(value & 1))
+            if start < 0 or start + length > header["base_size"]:
+                raise ValueError("COPY outside of the base image")
+            out += base[start:start + length]
+            cursor = start + length
+        else:
+            if pos + length > len(delta):
+                raise ValueError("truncated ADD")
+            out += delta[pos:pos + length]
+            pos += length
+
+    if pos != len(delta):
+        raise ValueError("trailing data after the target image")
+    if hashlib.sha256(out).digest() != header["target_hash"]:
+        raise ValueError("rebuilt image does not match the target hash")
+    return bytes(out)
+
+
+def blocks(size):
+    return (size + BLOCK_SIZE - 1) // BLOCK_SIZE
+
+
+def report(name, base, target, delta, stats):
+    print(f"{name}: base {len(base)} B, target {len(target)} B, delta {len(delta)} B "
+          f"({100.0 * len(delta) / len(target):.1f} %), "
+          f"{blocks(len(target))} -> {blocks(len(delta))} blocks of {BLOCK_SIZE} B")
+    print(f"  {stats['copy_ops']} COPY ({stats['copy_bytes']} B), "
+          f"{stats['add_ops']} ADD ({stats['add_bytes']} B)")
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def cmd_diff(args):
+    base = read(args.base)
+    target = read(args.target)
+    delta, stats = make_delta(base, target, parse_version(args.base_version))
+    out = args.out or args.target + DELTA_SUFFIX
+    with open(out, "wb") as f:
+        f.write(delta)
+    report(out, base, target, delta, stats)
+    return 0
+
+
+def cmd_apply(args):
+    target = apply_delta(read(args.base), read(args.delta))
+    with open(args.out, "wb") as f:
+        f.write(target)
+    print(f"{args.out}: {len(target)} B")
+    return 0
+
+
+def cmd_verify(args):
+    if len(args.images) < 2 or len(args.images) % 2:
+        print("verify expects pairs of base and target images")
+        return 1
+
+    failures = 0
+    for base_path, target_path in zip(args.images[0::2], args.images[1::2]):
+        base = read(base_path)
+        target = read(target_path)
+        delta, stats = make_delta(base, target)
+        try:
+            ok = apply_delta(base, delta) == target
+        except ValueError as e:
+            print(f"  {e}")
+            ok = False
+        report(f"{base_path} -> {target_path}", base, target, delta, stats)
+        print(f"  round trip {'OK' if ok else 'FAILED'}")
+        failures += 0 if ok else 1
+
+    return 1 if failures else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Delta OTA image tool")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("diff", help="build a delta image")
+    p.add_argument("--base", required=True, help="image running on the device")
+    p.add_argument("--target", required=True, help="new image")
+    p.add_argument("--base-version", default="", help="version of the base image, major.minor.build")
+    p.add_argument("--out", help="output file, default <target>.delta")
+    p.set_defaults(func=cmd_diff)
+
+    p = sub.add_parser("apply", help="rebuild an image from a base image and a delta")
+    p.add_argument("--base", required=True)
+    p.add_argument("--delta", required=True)
+    p.add_argument("--out", required=True)
+    p.set_defaults(func=cmd_apply)
+
+    p = sub.add_parser("verify", help="round trip base/target image pairs")
+    p.add_argument("images", nargs="+", help="base1 target1 [base2 target2 ...]")
+    p.set_defaults(func=cmd_verify)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -20,6 +20,8 @@ from utils.AWSHelper import *
 import random
 import time
 import os
+import hota_delta
+import hota_compress
 
 parser = argparse.ArgumentParser(description='Script to start OTA update')
 parser.add_argument("-d", action="store_true", help="degub output flag")
@@ -36,6 +38,10 @@ parser.add_argument("--sessiontoken", help="AWS SESSION TOKEN",default="", requi
 parser.add_argument("--certarn", help="signing certificate arn", required=False)
 parser.add_argument("--board", help="target board", required=True)
 parser.add_argument("--version", help="Firmware version to include in OTA job", required=True)
+parser.add_argument("--base-file", help="Image running on the target, send a delta against it instead of the full image", required=False)
+parser.add_argument("--base-version", help="Firmware version of the base image, major.minor.build", default="", required=False)
+parser.add_argument("--compress", action="store_true", help="Send the image LZSS compressed, requires --signing-key")
+parser.add_argument("--signing-key", help="ECDSA P-256 private key (ecdsasigner-priv-key.pem) to sign the image locally", required=False)
 
 group = parser.add_mutually_exclusive_group(required=True)
 group.add_argument("--thing-group", help="The thing group name")
@@ -43,6 +49,11 @@ group.add_argument("--thing", help="The thing name")
 
 args=parser.parse_args()
 
+if (args.compress and args.base_file):
+    parser.error("--compress and --base-file are exclusive")
+if (args.compress and not args.signing_key):
+    parser.error("--compress signs the decompressed image, --signing-key is required")
+
 
 trust_policy ={
     "Version": "2012-10-17",
@@ -97,6 +108,52 @@ def main(argv):
       logger.error(file_path + " file not found!")
       exit()
 
+    upload_file = args.bin_file
+
+    if (args.base_file):
+        with open(args.base_file, "rb") as f:
+            base = f.read()
+        with open(file_path, "rb") as f:
+            target = f.read()
+
+        delta, stats = hota_delta.make_delta(base, target, hota_delta.parse_version(args.base_version))
+        upload_file = args.bin_file + hota_delta.DELTA_SUFFIX
+
+        with open(args.path + upload_file, "wb") as f:
+            f.write(delta)
+
+        logger.info("Delta image             : " + upload_file + " " + str(len(delta)) + " bytes, "
+                    + str(round(100.0 * len(delta) / len(target), 1)) + "% of " + str(len(target)))
+
+    signature = None
+
+    if (args.signing_key):
+        from cryptography.hazmat.primitives import hashes, serialization
+        from cryptography.hazmat.primitives.asymmetric import ec
+
+        with open(args.signing_key, "rb") as f:
+            key = serialization.load_pem_private_key(f.read(), password=None)
+        with open(file_path, "rb") as f:
+            image = f.read()
+
+        # The device checks the signature over the image it writes to flash,
+        # for a compressed update that is the decompressed image.
+        if (args.base_file):
+            with open(args.path + upload_file, "rb") as f:
+                signature = key.sign(f.read(), ec.ECDSA(hashes.SHA256()))
+        else:
+            signature = key.sign(image, ec.ECDSA(hashes.SHA256()))
+
+        if (args.compress):
+            packed, stats = hota_compress.compress(image)
+            upload_file = args.bin_file + hota_compress.LZSS_SUFFIX
+
+            with open(args.path + upload_file, "wb") as f:
+                f.write(packed)
+
+            logger.info("Compressed image        : " + upload_file + " " + str(len(packed)) + " bytes, "
+                        + str(round(100.0 * len(packed) / len(image), 1)) + "% of " + str(len(image)))
+
     logger.info("Initializing AWS Session")
 
     if (args.profile):
@@ -156,19 +213,20 @@ def main(argv):
     logger.info("Creating S3 Bucket      : " + args.bucket)
     aws.create_bucket(bucket=args.bucket)
 
-    logger.info("Uploading to S3 Bucket  : "+args.bin_file+" ")
-    aws.upload_file_to_s3(file=args.bin_file, bucket=args.bucket, path=args.path)
+    logger.info("Uploading to S3 Bucket  : "+upload_file+" ")
+    aws.upload_file_to_s3(file=upload_file, bucket=args.bucket, path=args.path)
 
     time.sleep(7)
 
     logger.info("Creating OTA Update     : " + updateID)
     ota = aws.push_ota_update(updateID=updateID, 
                         targetArn=targetArn, 
-                        file=args.bin_file,
+                        file=upload_file,
                         bucket=args.bucket, 
                         signer=args.signer,
                         roleArn=roleArn,
-                        version=args.version)
+                        version=args.version,
+                        signature=signature)
     
     logger.info('Update Arn              : ' + ota['otaUpdateArn'])
     logger.info('Update ID               : ' + ota['otaUpdateId'])
@@ -0,0 +1,502 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : lfs_bench.py
+# * @brief          : Host model of the littlefs block devices used by the
+# *                   firmware, counting block device callbacks and simulating
+# *                   NOR program / erase timing per workload.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Requires littlefs-python (pip install littlefs-python).
+#
+# Examples:
+#   python lfs_bench.py --cache-size 16 256
+#   python lfs_bench.py --geometry ospi_mx25lm --workload seq_write --engine sync async
+#   python lfs_bench.py --geometry xspi_mx66uw --workload kvstore \
+#       --cache-size 512 4096 --lookahead-size 16 256 --wear
+#   python lfs_bench.py --workload ota_image_state --backing file:h5.img --erase-us 3000
+#
+# The simulated clock only accounts for flash device time, CPU time on the
+# target is not modelled.
+
+import argparse
+import mmap
+import os
+import random
+import statistics
+import struct
+import sys
+
+from littlefs import LittleFS, UserContext
+
+# Geometry of the littlefs ports in project/Libraries/fs
+GEOMETRIES = {
+    # lfs_port_internal_nor_stm32h5.c: bank 2 minus RESERVED_OTA_SECTORS
+    "h5_internal": {
+        "read_size": 1,
+        "prog_size": 16,
+        "block_size": 8 * 1024,
+        "block_count": 128 - 96,
+        "lookahead_size": 16,
+        "block_cycles": 500,
+    },
+    # lfs_port_ospi.c: MX25LM51245G, 4 KB sectors after the first 10 blocks
+    "ospi_mx25lm": {
+        "read_size": 1,
+        "prog_size": 256,
+        "block_size": 4 * 1024,
+        "block_count": 1024 - 10,
+        "lookahead_size": 256,
+        "block_cycles": 500,
+    },
+    # lfs_port_xspi.c: MX66UW1G45G, 4 KB sectors after MX66LM_RESERVED_BLOCKS
+    "xspi_mx66uw": {
+        "read_size": 1,
+        "prog_size": 256,
+        "block_size": 4 * 1024,
+        "block_count": 1024 - 64,
+        "lookahead_size": 256,
+        "block_cycles": 500,
+    },
+}
+
+DEFAULT_CACHE_SIZE = {
+    "h5_internal": 256,
+    "ospi_mx25lm": 4096,
+    "xspi_mx66uw": 4096,
+}
+
+# Typical datasheet timings, in microseconds
+TIMINGS = {
+    "h5_internal": {
+        "read_setup_us": 0.0,
+        "read_us_per_byte": 0.004,
+        "prog_unit": 16,
+        "prog_unit_us": 50.0,
+        "erase_us": 2000.0,
+    },
+    "ospi_mx25lm": {
+        "read_setup_us": 1.0,
+        "read_us_per_byte": 0.02,
+        "prog_unit": 256,
+        "prog_unit_us": 150.0,
+        "erase_us": 25000.0,
+    },
+    "xspi_mx66uw": {
+        "read_setup_us": 1.0,
+        "read_us_per_byte": 0.005,
+        "prog_unit": 256,
+        "prog_unit_us": 150.0,
+        "erase_us": 25000.0,
+    },
+}
+
+
+class CountingBlockDevice(UserContext):
+    """RAM backed block device recording every littlefs callback.
+
+    With engine="async" program and erase operations are queued to a simulated
+    flash engine, and only reads / syncs wait for the device to become idle,
+    matching lfs_port_ospi.c. Blocks left erased by the erase ahead worker
+    complete littlefs erase requests immediately.
+    """
+
+    def __init__(self, block_size, block_count, timing, engine="sync", erase_ahead_pool=0,
+                 backing_file=None):
+        super().__init__(block_size * block_count)
+
+        if backing_file is not None:
+            # Keep the image on disk so it can be inspected or reused across runs
+            size = block_size * block_count
+            with open(backing_file, "wb") as f:
+                f.write(b"\xff" * size)
+            self._file = open(backing_file, "r+b")
+            self.buffer = mmap.mmap(self._file.fileno(), size)
+
+        self.block_size = block_size
+        self.block_count = block_count
+        self.timing = timing
+        self.engine = engine
+        self.erase_ahead_pool = erase_ahead_pool
+
+        # Blocks erased and not programmed since
+        self.erased = set()
+        self.programmed = set()
+        self.wear = [0] * block_count
+        self.now_us = 0.0
+        self.busy_until_us = 0.0
+        self.reset_counters()
+
+    def reset_counters(self):
+        self.reads = 0
+        self.read_bytes = 0
+        self.progs = 0
+        self.prog_bytes = 0
+        self.erases = 0
+        self.erase_ahead_hits = 0
+
+    def _device_op(self, cost_us):
+        if self.engine == "async":
+            self.busy_until_us = max(self.busy_until_us, self.now_us) + cost_us
+        else:
+            self.now_us += cost_us
+
+    def _flush(self):
+        self.now_us = max(self.now_us, self.busy_until_us)
+
+    def read(self, cfg, block, off, size):
+        self.reads += 1
+        self.read_bytes += size
+        self._flush()
+        self.now_us += self.timing["read_setup_us"] + size * self.timing["read_us_per_byte"]
+        return super().read(cfg, block, off, size)
+
+    def prog(self, cfg, block, off, data):
+        self.progs += 1
+        self.prog_bytes += len(data)
+        self.erased.discard(block)
+        self.programmed.add(block)
+        units = -(-len(data) // self.timing["prog_unit"])
+        self._device_op(units * self.timing["prog_unit_us"])
+        return super().prog(cfg, block, off, data)
+
+    def erase(self, cfg, block):
+        if self.engine == "async" and block in self.erased:
+            self.erase_ahead_hits += 1
+            return 0
+
+        self.erases += 1
+        self.wear[block] += 1
+        self.erased.add(block)
+        self._device_op(self.timing["erase_us"])
+        return super().erase(cfg, block)
+
+    def sync(self, cfg):
+        self._flush()
+        return 0
+
+    def idle(self, idle_us):
+        """Let the erase ahead worker run for idle_us of wall time.
+
+        The worker can only erase blocks it knows to be unreferenced. Without a
+        filesystem traversal on the host, blocks never programmed are used as the
+        candidates, which is exact on a fresh device and pessimistic once littlefs
+        has wrapped around the device.
+        """
+        end_us = self.now_us + idle_us
+        t = max(self.now_us, self.busy_until_us)
+
+        if self.engine == "async":
+            candidates = (b for b in range(self.block_count)
+                          if b not in self.programmed and b not in self.erased)
+            pooled = len(self.erased)
+
+            for block in candidates:
+                if pooled >= self.erase_ahead_pool or t + self.timing["erase_us"] > end_us:
+                    break
+                self.erases += 1
+                self.wear[block] += 1
+                self.erased.add(block)
+                pooled += 1
+                t += self.timing["erase_us"]
+
+            self.busy_until_us = max(self.busy_until_us, t)
+
+        self.now_us = end_us
+
+    def counters(self):
+        return {
+            "reads": self.reads,
+            "read_bytes": self.read_bytes,
+            "progs": self.progs,
+            "prog_bytes": self.prog_bytes,
+            "erases": self.erases,
+            "erase_ahead_hits": self.erase_ahead_hits,
+        }
+
+
+def make_fs(geometry_name, cache_size, engine="sync", erase_ahead_pool=0,
+            lookahead_size=None, block_cycles=None, timing=None, backing_file=None):
+    geometry = dict(GEOMETRIES[geometry_name])
+
+    if lookahead_size is not None:
+        geometry["lookahead_size"] = lookahead_size
+
+    if block_cycles is not None:
+        geometry["block_cycles"] = block_cycles
+
+    bd = CountingBlockDevice(geometry["block_size"], geometry["block_count"],
+                             timing or TIMINGS[geometry_name], engine, erase_ahead_pool,
+                             backing_file)
+    fs = LittleFS(context=bd, mount=False, cache_size=cache_size, **geometry)
+    fs.format()
+    fs.mount()
+    return fs, bd
+
+
+def timed(bd, latencies, fn, *args):
+    start = bd.now_us
+    result = fn(*args)
+    latencies.append(bd.now_us - start)
+    return result
+
+
+def workload_pkcs11_read(fs, bd, iterations, idle_us, latencies):
+    """Provision a handful of PKCS#11 sized objects, then read them back
+    repeatedly the way core_pkcs11_pal_littlefs.c does on every session."""
+    objects = {
+        "/cfg/corePKCS11_Certificate.dat": 1200,
+        "/cfg/corePKCS11_Key.dat": 320,
+        "/cfg/corePKCS11_CodeSignKey.dat": 180,
+        "/cfg/corePKCS11_RootCA.dat": 1400,
+    }
+
+    fs.mkdir("/cfg")
+
+    for path, size in objects.items():
+        with fs.open(path, "wb") as f:
+            f.write(os.urandom(size))
+
+    bd.reset_counters()
+    ops = 0
+
+    def read_object(path, size):
+        with fs.open(path, "rb") as f:
+            assert len(f.read(size)) == size
+
+    for _ in range(iterations):
+        for path, size in objects.items():
+            timed(bd, latencies, read_object, path, size)
+            bd.idle(idle_us)
+            ops += 1
+
+    return ops
+
+
+def workload_seq_write(fs, bd, iterations, idle_us, latencies):
+    """Rewrite a 16 KB file in 1 KB synced chunks, like a log or an image
+    staging area, which makes littlefs allocate and erase fresh blocks."""
+    chunk = os.urandom(1024)
+    ops = 0
+
+    for i in range(iterations):
+        with fs.open(f"/data{i % 4}.bin", "wb") as f:
+            for _ in range(16):
+                def write_chunk():
+                    f.write(chunk)
+                    f.flush()
+                timed(bd, latencies, write_chunk)
+                bd.idle(idle_us)
+                ops += 1
+
+    return ops
+
+
+# Keys and value sizes of Common/kvstore with the littlefs backend
+KVSTORE_KEYS = {
+    "thing_name": 32,
+    "mqtt_endpoint": 64,
+    "mqtt_port": 4,
+    "time_hwm": 8,
+    "wifi_ssid": 16,
+    "wifi_credential": 32,
+}
+
+
+def workload_kvstore(fs, bd, iterations, idle_us, latencies):
+    """Commit kvstore values as TLV files under /cfg, with the time high
+    watermark rewritten far more often than the configuration keys."""
+    fs.mkdir("/cfg")
+    rng = random.Random(0)
+    ops = 0
+
+    def commit(key, size):
+        with fs.open(f"/cfg/{key}", "wb") as f:
+            f.write(struct.pack("<II", 0, size) + os.urandom(size))
+
+    def load(key, size):
+        with fs.open(f"/cfg/{key}", "rb") as f:
+            f.read(8 + size)
+
+    for key, size in KVSTORE_KEYS.items():
+        commit(key, size)
+
+    bd.reset_counters()
+
+    for _ in range(iterations):
+        key = "time_hwm" if rng.random() < 0.8 else rng.choice(list(KVSTORE_KEYS))
+        timed(bd, latencies, commit, key, KVSTORE_KEYS[key])
+        bd.idle(idle_us)
+        timed(bd, latencies, load, key, KVSTORE_KEYS[key])
+        bd.idle(idle_us)
+        ops += 2
+
+    return ops
+
+
+def workload_pkcs11(fs, bd, iterations, idle_us, latencies):
+    """PKCS#11 PAL mix: mostly object reads, with the occasional key or
+    certificate re-provisioning through a truncating write."""
+    rng = random.Random(0)
+    ops = workload_pkcs11_read(fs, bd, 1, idle_us, latencies)
+
+    def rewrite(path, size):
+        with fs.open(path, "wb") as f:
+            f.write(os.urandom(size))
+
+    for _ in range(iterations):
+        if rng.random() < 0.1:
+            timed(bd, latencies, rewrite, "/cfg/corePKCS11_Certificate.dat", 1200)
+        else:
+            with fs.open("/cfg/corePKCS11_Key.dat", "rb") as f:
+                timed(bd, latencies, f.read, 320)
+        bd.idle(idle_us)
+        ops += 1
+
+    return ops
+
+
+def workload_ota_image_state(fs, bd, iterations, idle_us, latencies):
+    """Walk the OTA PAL state machine, rewriting /ota/image_state
+    (OtaPalNvContext_t) on every transition as ota_pal_stm32_ntz.c does."""
+    fs.mkdir("/ota")
+    states = [1, 2, 3, 4, 5, 8]
+    ops = 0
+
+    def write_state(state):
+        with fs.open("/ota/image_state", "wb") as f:
+            f.write(struct.pack("<II", state, 1))
+
+    def read_state():
+        with fs.open("/ota/image_state", "rb") as f:
+            f.read(8)
+
+    bd.reset_counters()
+
+    for i in range(iterations):
+        timed(bd, latencies, write_state, states[i % len(states)])
+        bd.idle(idle_us)
+        timed(bd, latencies, read_state)
+        bd.idle(idle_us)
+        ops += 2
+
+    return ops
+
+
+WORKLOADS = {
+    "kvstore": workload_kvstore,
+    "pkcs11": workload_pkcs11,
+    "pkcs11_read": workload_pkcs11_read,
+    "ota_image_state": workload_ota_image_state,
+    "seq_write": workload_seq_write,
+}
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def run(geometry_name, workload, cache_size, iterations, engine="sync",
+        erase_ahead_pool=0, idle_us=0.0, lookahead_size=None, block_cycles=None,
+        timing=None, backing_file=None):
+    fs, bd = make_fs(geometry_name, cache_size, engine, erase_ahead_pool,
+                     lookahead_size, block_cycles, timing, backing_file)
+
+    bd.reset_counters()
+    latencies = []
+    start_us = bd.now_us
+    ops = WORKLOADS[workload](fs, bd, iterations, idle_us, latencies)
+    busy_us = (bd.now_us - start_us) - len(latencies) * idle_us
+    fs.unmount()
+
+    result = bd.counters()
+    result["ops"] = ops
+    result["ops_per_s"] = ops / (busy_us / 1e6) if busy_us > 0 else float("inf")
+    result["p50_us"] = percentile(latencies, 50)
+    result["p99_us"] = percentile(latencies, 99)
+    result["max_us"] = max(latencies)
+    result["wear"] = bd.wear
+    return result
+
+
+def wear_summary(wear):
+    used = [w for w in wear if w > 0]
+    if not used:
+        return "no erases"
+    return (f"blocks erased {len(used)}/{len(wear)}, min {min(used)}, "
+            f"mean {statistics.mean(used):.1f}, max {max(used)}, "
+            f"stdev {statistics.pstdev(used):.2f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="littlefs block device model")
+    parser.add_argument("--geometry", choices=GEOMETRIES.keys(), default="h5_internal")
+    parser.add_argument("--workload", choices=WORKLOADS.keys(), nargs="+", default=["pkcs11_read"])
+    parser.add_argument("--cache-size", type=int, nargs="+")
+    parser.add_argument("--lookahead-size", type=int, nargs="+")
+    parser.add_argument("--block-cycles", type=int)
+    parser.add_argument("--engine", choices=["sync", "async"], nargs="+", default=["sync"])
+    parser.add_argument("--erase-ahead-pool", type=int, default=8,
+                        help="pre-erased blocks kept by the async engine")
+    parser.add_argument("--idle-ms", type=float, default=0.0,
+                        help="idle time between operations available to the erase ahead worker")
+    parser.add_argument("--iterations", type=int, default=100)
+    parser.add_argument("--prog-us", type=float, help="program time per program unit")
+    parser.add_argument("--erase-us", type=float, help="block erase time")
+    parser.add_argument("--read-us-per-byte", type=float)
+    parser.add_argument("--backing", default="ram",
+                        help="'ram' or 'file:<path>' to keep the flash image on disk")
+    parser.add_argument("--wear", action="store_true", help="print the erase count distribution")
+    args = parser.parse_args()
+
+    timing = dict(TIMINGS[args.geometry])
+    if args.prog_us is not None:
+        timing["prog_unit_us"] = args.prog_us
+    if args.erase_us is not None:
+        timing["erase_us"] = args.erase_us
+    if args.read_us_per_byte is not None:
+        timing["read_us_per_byte"] = args.read_us_per_byte
+
+    backing_file = None
+    if args.backing.startswith("file:"):
+        backing_file = args.backing[len("file:"):]
+    elif args.backing != "ram":
+        parser.error("--backing must be 'ram' or 'file:<path>'")
+
+    cache_sizes = args.cache_size or [DEFAULT_CACHE_SIZE[args.geometry]]
+    lookahead_sizes = args.lookahead_size or [GEOMETRIES[args.geometry]["lookahead_size"]]
+
+    print(f"{'workload':>15} {'engine':>6} {'cache':>6} {'lkahd':>5} {'reads/op':>9} "
+          f"{'progs':>7} {'erases':>7} {'hits':>6} {'ops/s':>9} {'p50 us':>9} "
+          f"{'p99 us':>9} {'max us':>9}")
+
+    for workload in args.workload:
+        for engine in args.engine:
+            for cache_size in cache_sizes:
+                for lookahead_size in lookahead_sizes:
+                    r = run(args.geometry, workload, cache_size, args.iterations,
+                            engine, args.erase_ahead_pool, args.idle_ms * 1000.0,
+                            lookahead_size, args.block_cycles, timing, backing_file)
+                    print(f"{workload:>15} {engine:>6} {cache_size:>6} {lookahead_size:>5} "
+                          f"{r['reads'] / r['ops']:>9.1f} {r['progs']:>7} {r['erases']:>7} "
+                          f"{r['erase_ahead_hits']:>6} {r['ops_per_s']:>9.1f} "
+                          f"{r['p50_us']:>9.1f} {r['p99_us']:>9.1f} {r['max_us']:>9.1f}")
+
+                    if args.wear:
+                        print(f"{'':>15} wear: {wear_summary(r['wear'])}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
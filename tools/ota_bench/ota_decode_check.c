@@ -0,0 +1,392 @@
+/*
+ * FreeRTOS STM32 Reference Integration
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file  ota_decode_check.c
+ * @brief Host check of the OTA PAL stream decoders (ota_lzss.c, ota_delta.c)
+ * against files produced by tools/host-ota/hota_compress.py and hota_delta.py.
+ *
+ * Built and run by ota_decode_check.py, or by hand:
+ *   cc -O2 -I<ota_pal dir> ota_decode_check.c <ota_pal dir>/ota_lzss.c <ota_pal dir>/ota_delta.c -o ota_decode_check
+ *   ./ota_decode_check lzss <file.lzss> <image> [chunk size, 0 for random sizes] [seed]
+ *   ./ota_decode_check delta <base> <file.delta> <image> [chunk size, 0 for random sizes] [seed]
+ *
+ * The file body is fed in chunks the way the OTA PAL feeds received blocks. The write
+ * callback programs an erased image buffer like the PAL does: the first OTA_IMAGE_HEAD_SIZE
+ * bytes are held aside and only put in place once the image is complete, so an LZSS
+ * match reading the start of the image back from flash would see 0xFF. The rebuilt image
+ * must match the expected one, and the same file cut short by one byte must be reported
+ * as incomplete.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ota_lzss.h"
+#include "ota_delta.h"
+
+/* Start of the image programmed last by the PAL, OTA_IMAGE_HEAD_SIZE in ota_pal_stm32_ntz.c */
+#define OTA_IMAGE_HEAD_SIZE    ( 16UL )
+
+/* Largest chunk when the chunk size is random, one OTA file block */
+#define MAX_CHUNK_SIZE         ( 4096UL )
+
+typedef struct
+{
+    uint8_t * pucImage;   /* Erased image buffer, also the LZSS history. */
+    uint32_t ulSize;      /* Size of the image buffer. */
+    uint32_t ulNext;      /* Offset the next write must start at. */
+    uint32_t ulChunkSize; /* Decoder output chunk size. */
+    uint8_t ucHead[ OTA_IMAGE_HEAD_SIZE ];
+    int32_t lFailed;
+} CheckImage_t;
+
+typedef struct
+{
+    const char * pcName;
+    int32_t ( * xRun )( const uint8_t * pucBase,
+                        uint32_t ulBaseSize,
+                        const uint8_t * pucFile,
+                        size_t uxFileSize,
+                        CheckImage_t * pxImage,
+                        uint32_t ulChunk,
+                        int32_t * plFinish );
+} CheckCodec_t;
+
+static uint32_t ulRandState;
+
+static uint32_t prvRand( void )
+{
+    ulRandState ^= ulRandState << 13;
+    ulRandState ^= ulRandState >> 17;
+    ulRandState ^= ulRandState << 5;
+    return ulRandState;
+}
+
+static size_t prvNextChunk( uint32_t ulChunk,
+                            size_t uxLeft )
+{
+    size_t uxSize = ( ulChunk != 0 ) ? ulChunk : ( 1U + ( prvRand() % MAX_CHUNK_SIZE ) );
+
+    return ( uxSize < uxLeft ) ? uxSize : uxLeft;
+}
+
+static uint8_t * prvReadFile( const char * pcPath,
+                              size_t * puxSize )
+{
+    FILE * pxFile = fopen( pcPath, "rb" );
+    uint8_t * pucData = NULL;
+    long lSize;
+
+    if( pxFile == NULL )
+    {
+        fprintf( stderr, "cannot open %s\n", pcPath );
+        return NULL;
+    }
+
+    if( ( fseek( pxFile, 0, SEEK_END ) == 0 ) && ( ( lSize = ftell( pxFile ) ) >= 0 ) &&
+        ( fseek( pxFile, 0, SEEK_SET ) == 0 ) )
+    {
+        pucData = malloc( ( size_t ) lSize + 1U );
+
+        if( ( pucData != NULL ) && ( fread( pucData, 1, ( size_t ) lSize, pxFile ) != ( size_t ) lSize ) )
+        {
+            free( pucData );
+            pucData = NULL;
+        }
+
+        *puxSize = ( size_t ) lSize;
+    }
+
+    fclose( pxFile );
+
+    if( pucData == NULL )
+    {
+        fprintf( stderr, "cannot read %s\n", pcPath );
+    }
+
+    return pucData;
+}
+
+static int32_t prvImageWrite( void * pvWriteCtx,
+                              uint32_t ulOffset,
+                              const uint8_t * pucData,
+                              uint32_t ulLength )
+{
+    CheckImage_t * pxImage = ( CheckImage_t * ) pvWriteCtx;
+    uint32_t ulHead = 0;
+
+    if( ( ulOffset != pxImage->ulNext ) || ( ulLength > ( pxImage->ulSize - ulOffset ) ) )
+    {
+        fprintf( stderr, "write of %u bytes at %u, expected offset %u\n",
+                 ( unsigned ) ulLength, ( unsigned ) ulOffset, ( unsigned ) pxImage->ulNext );
+        pxImage->lFailed = 1;
+        return -1;
+    }
+
+    /* Only the last chunk of the image may be shorter than the decoder output buffer */
+    if( ( ulLength != pxImage->ulChunkSize ) && ( ( ulOffset + ulLength ) != pxImage->ulSize ) )
+    {
+        fprintf( stderr, "short write of %u bytes at %u\n", ( unsigned ) ulLength, ( unsigned ) ulOffset );
+        pxImage->lFailed = 1;
+    }
+
+    if( ulOffset < OTA_IMAGE_HEAD_SIZE )
+    {
+        ulHead = OTA_IMAGE_HEAD_SIZE - ulOffset;
+        ulHead = ( ulHead < ulLength ) ? ulHead : ulLength;
+        memcpy( &pxImage->ucHead[ ulOffset ], pucData, ulHead );
+    }
+
+    memcpy( &pxImage->pucImage[ ulOffset + ulHead ], &pucData[ ulHead ], ulLength - ulHead );
+    pxImage->ulNext = ulOffset + ulLength;
+
+    return 0;
+}
+
+static int32_t prvRunLzss( const uint8_t * pucBase,
+                           uint32_t ulBaseSize,
+                           const uint8_t * pucFile,
+                           size_t uxFileSize,
+                           CheckImage_t * pxImage,
+                           uint32_t ulChunk,
+                           int32_t * plFinish )
+{
+    static OtaLzssContext_t xCtx;
+    OtaLzssHeader_t xHeader;
+    size_t uxOffset = OTA_LZSS_HEADER_SIZE;
+    size_t uxSize;
+
+    ( void ) pucBase;
+    ( void ) ulBaseSize;
+
+    if( xOtaLzssParseHeader( pucFile, uxFileSize, &xHeader ) != OtaLzssSuccess )
+    {
+        fprintf( stderr, "bad LZSS header\n" );
+        return -1;
+    }
+
+    if( xHeader.ulTargetSize != pxImage->ulSize )
+    {
+        fprintf( stderr, "LZSS image size %u, expected %u\n",
+                 ( unsigned ) xHeader.ulTargetSize, ( unsigned ) pxImage->ulSize );
+        return -1;
+    }
+
+    pxImage->ulChunkSize = OTA_LZSS_OUT_BUFFER_SIZE;
+    vOtaLzssInit( &xCtx, &xHeader, pxImage->pucImage, prvImageWrite, pxImage );
+
+    while( uxOffset < uxFileSize )
+    {
+        uxSize = prvNextChunk( ulChunk, uxFileSize - uxOffset );
+        ( void ) xOtaLzssApply( &xCtx, &pucFile[ uxOffset ], uxSize );
+        uxOffset += uxSize;
+    }
+
+    *plFinish = ( int32_t ) xOtaLzssFinish( &xCtx );
+
+    return 0;
+}
+
+static int32_t prvRunDelta( const uint8_t * pucBase,
+                            uint32_t ulBaseSize,
+                            const uint8_t * pucFile,
+                            size_t uxFileSize,
+                            CheckImage_t * pxImage,
+                            uint32_t ulChunk,
+                            int32_t * plFinish )
+{
+    static OtaDeltaContext_t xCtx;
+    OtaDeltaHeader_t xHeader;
+    size_t uxOffset = OTA_DELTA_HEADER_SIZE;
+    size_t uxSize;
+
+    if( xOtaDeltaParseHeader( pucFile, uxFileSize, &xHeader ) != OtaDeltaSuccess )
+    {
+        fprintf( stderr, "bad delta header\n" );
+        return -1;
+    }
+
+    if( ( xHeader.ulTargetSize != pxImage->ulSize ) || ( xHeader.ulBaseSize != ulBaseSize ) )
+    {
+        fprintf( stderr, "delta sizes %u -> %u, expected %u -> %u\n",
+                 ( unsigned ) xHeader.ulBaseSize, ( unsigned ) xHeader.ulTargetSize,
+                 ( unsigned ) ulBaseSize, ( unsigned ) pxImage->ulSize );
+        return -1;
+    }
+
+    pxImage->ulChunkSize = OTA_DELTA_OUT_BUFFER_SIZE;
+    vOtaDeltaInit( &xCtx, &xHeader, pucBase, prvImageWrite, pxImage );
+
+    while( uxOffset < uxFileSize )
+    {
+        uxSize = prvNextChunk( ulChunk, uxFileSize - uxOffset );
+        ( void ) xOtaDeltaApply( &xCtx, &pucFile[ uxOffset ], uxSize );
+        uxOffset += uxSize;
+    }
+
+    *plFinish = ( int32_t ) xOtaDeltaFinish( &xCtx );
+
+    return 0;
+}
+
+static int32_t prvDecode( const CheckCodec_t * pxCodec,
+                          const uint8_t * pucBase,
+                          uint32_t ulBaseSize,
+                          const uint8_t * pucFile,
+                          size_t uxFileSize,
+                          CheckImage_t * pxImage,
+                          uint32_t ulChunk,
+                          int32_t * plFinish )
+{
+    memset( pxImage->pucImage, 0xFF, pxImage->ulSize );
+    memset( pxImage->ucHead, 0xFF, sizeof( pxImage->ucHead ) );
+    pxImage->ulNext = 0;
+    pxImage->lFailed = 0;
+
+    if( pxCodec->xRun( pucBase, ulBaseSize, pucFile, uxFileSize, pxImage, ulChunk, plFinish ) != 0 )
+    {
+        return -1;
+    }
+
+    /* Program the start of the image last, as the PAL does once the image is verified */
+    memcpy( pxImage->pucImage, pxImage->ucHead,
+            ( pxImage->ulSize < OTA_IMAGE_HEAD_SIZE ) ? pxImage->ulSize : OTA_IMAGE_HEAD_SIZE );
+
+    return 0;
+}
+
+int main( int argc,
+          char * argv[] )
+{
+    static const CheckCodec_t xCodecs[] =
+    {
+        { "lzss",  prvRunLzss  },
+        { "delta", prvRunDelta },
+    };
+    const CheckCodec_t * pxCodec = NULL;
+    uint8_t * pucBase = NULL;
+    uint8_t * pucFile;
+    uint8_t * pucExpected;
+    size_t uxBaseSize = 0;
+    size_t uxFileSize = 0;
+    size_t uxExpectedSize = 0;
+    CheckImage_t xImage = { 0 };
+    uint32_t ulChunk;
+    int32_t lFinish = -1;
+    int32_t lArg = 2;
+    size_t uxIdx;
+    clock_t xStart;
+    double dSeconds;
+
+    for( uxIdx = 0; ( argc > 1 ) && ( uxIdx < ( sizeof( xCodecs ) / sizeof( xCodecs[ 0 ] ) ) ); uxIdx++ )
+    {
+        if( strcmp( argv[ 1 ], xCodecs[ uxIdx ].pcName ) == 0 )
+        {
+            pxCodec = &xCodecs[ uxIdx ];
+        }
+    }
+
+    if( ( pxCodec == NULL ) ||
+        ( argc < ( ( pxCodec->xRun == prvRunDelta ) ? 5 : 4 ) ) )
+    {
+        fprintf( stderr, "usage: %s lzss <file.lzss> <image> [chunk] [seed]\n"
+                         "       %s delta <base> <file.delta> <image> [chunk] [seed]\n", argv[ 0 ], argv[ 0 ] );
+        return 2;
+    }
+
+    if( pxCodec->xRun == prvRunDelta )
+    {
+        pucBase = prvReadFile( argv[ lArg++ ], &uxBaseSize );
+    }
+
+    pucFile = prvReadFile( argv[ lArg++ ], &uxFileSize );
+    pucExpected = prvReadFile( argv[ lArg++ ], &uxExpectedSize );
+    ulChunk = ( argc > lArg ) ? ( uint32_t ) strtoul( argv[ lArg ], NULL, 0 ) : 0U;
+    lArg++;
+    ulRandState = ( argc > lArg ) ? ( uint32_t ) strtoul( argv[ lArg ], NULL, 0 ) : 1U;
+    ulRandState = ( ulRandState != 0U ) ? ulRandState : 1U;
+
+    if( ( pucFile == NULL ) || ( pucExpected == NULL ) ||
+        ( ( pxCodec->xRun == prvRunDelta ) && ( pucBase == NULL ) ) )
+    {
+        return 2;
+    }
+
+    xImage.ulSize = ( uint32_t ) uxExpectedSize;
+    xImage.pucImage = malloc( uxExpectedSize + 1U );
+
+    if( xImage.pucImage == NULL )
+    {
+        return 2;
+    }
+
+    xStart = clock();
+
+    if( prvDecode( pxCodec, pucBase, ( uint32_t ) uxBaseSize, pucFile, uxFileSize,
+                   &xImage, ulChunk, &lFinish ) != 0 )
+    {
+        return 1;
+    }
+
+    dSeconds = ( double ) ( clock() - xStart ) / CLOCKS_PER_SEC;
+
+    if( ( lFinish != 0 ) || ( xImage.lFailed != 0 ) || ( xImage.ulNext != xImage.ulSize ) ||
+        ( memcmp( xImage.pucImage, pucExpected, uxExpectedSize ) != 0 ) )
+    {
+        fprintf( stderr, "%s chunk %u: decode failed, status %d, %u of %u bytes written\n",
+                 pxCodec->pcName, ( unsigned ) ulChunk, ( int ) lFinish,
+                 ( unsigned ) xImage.ulNext, ( unsigned ) xImage.ulSize );
+
+        for( uxIdx = 0; uxIdx < uxExpectedSize; uxIdx++ )
+        {
+            if( xImage.pucImage[ uxIdx ] != pucExpected[ uxIdx ] )
+            {
+                fprintf( stderr, "first difference at offset %u\n", ( unsigned ) uxIdx );
+                break;
+            }
+        }
+
+        return 1;
+    }
+
+    /* The same stream without its last byte must not decode to a complete image */
+    if( ( prvDecode( pxCodec, pucBase, ( uint32_t ) uxBaseSize, pucFile, uxFileSize - 1U,
+                     &xImage, ulChunk, &lFinish ) != 0 ) || ( lFinish == 0 ) )
+    {
+        fprintf( stderr, "%s chunk %u: truncated stream not detected\n", pxCodec->pcName, ( unsigned ) ulChunk );
+        return 1;
+    }
+
+    printf( "%-5s chunk %5u: %8u -> %8u bytes OK, %7.1f MB/s\n",
+            pxCodec->pcName, ( unsigned ) ulChunk, ( unsigned ) uxFileSize, ( unsigned ) uxExpectedSize,
+            ( dSeconds > 0.0 ) ? ( ( double ) uxExpectedSize / dSeconds / 1e6 ) : 0.0 );
+
+    free( xImage.pucImage );
+    free( pucExpected );
+    free( pucFile );
+    free( pucBase );
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : ota_decode_check.py
+# * @brief          : Build the OTA PAL stream decoders (ota_lzss.c, ota_delta.c)
+# *                   for the host and check them against the files produced by
+# *                   tools/host-ota/hota_compress.py and hota_delta.py.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python ota_decode_check.py
+#   python ota_decode_check.py --image-kb 512 --window-bits 10 13 16 --chunk 0 1 2048
+#   python ota_decode_check.py --image v0.9.2.bin --base v0.9.1.bin
+#
+# Without --image, synthetic firmware-like images are generated. The target of the
+# delta check is the image with code inserted, removed and patched, which moves
+# most of it and changes the literal pool values the way a rebuild does.
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+OTA_PAL_DIR = os.path.normpath(os.path.join(HERE, "..", "..", "project", "Core", "Src", "ota_pal"))
+sys.path.insert(0, os.path.normpath(os.path.join(HERE, "..", "host-ota")))
+
+import hota_compress  # noqa: E402
+import hota_delta  # noqa: E402
+
+
+def synthetic_image(rng, size):
+    """Thumb-like code: a few recurring instruction patterns, literal pools and tables."""
+    patterns = [bytes(rng.getrandbits(8) for _ in range(rng.choice((2, 4, 6, 8)))) for _ in range(64)]
+    out = bytearray()
+    while len(out) < size:
+        kind = rng.random()
+        if kind < 0.75:
+            out += rng.choice(patterns)
+        elif kind < 0.9:
+            out += struct.pack("<I", (0x08000000 + rng.randrange(0, size)) & ~1)
+        elif kind < 0.97:
+            out += bytes(rng.getrandbits(8) for _ in range(rng.randint(1, 16)))
+        else:
+            out += b"\x00" * rng.randint(4, 64)
+    return bytes(out[:size])
+
+
+def rebuilt_image(rng, base):
+    """base with functions inserted, removed and patched."""
+    out = bytearray(base)
+    for _ in range(8):
+        pos = rng.randrange(0, len(out))
+        if rng.random() < 0.5:
+            out[pos:pos] = bytes(rng.getrandbits(8) for _ in range(rng.randint(16, 1024)))
+        else:
+            del out[pos:pos + rng.randint(16, 1024)]
+    for _ in range(len(out) // 512):
+        pos = rng.randrange(0, len(out) - 4)
+        out[pos:pos + 4] = struct.pack("<I", rng.getrandbits(32))
+    return bytes(out)
+
+
+def build(workdir, cc, cflags):
+    exe = os.path.join(workdir, "ota_decode_check")
+    cmd = [cc] + cflags.split() + ["-I", OTA_PAL_DIR,
+                                   os.path.join(HERE, "ota_decode_check.c"),
+                                   os.path.join(OTA_PAL_DIR, "ota_lzss.c"),
+                                   os.path.join(OTA_PAL_DIR, "ota_delta.c"),
+                                   "-o", exe]
+    subprocess.run(cmd, check=True)
+    return exe
+
+
+def write(workdir, name, data):
+    path = os.path.join(workdir, name)
+    with open(path, "wb") as f:
+        f.write(data)
+    return path
+
+
+def run(cmd):
+    result = subprocess.run(cmd)
+    return 0 if result.returncode == 0 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OTA PAL decoders against the host-ota encoders")
+    parser.add_argument("--image", help="image to compress, and target of the delta check")
+    parser.add_argument("--base", help="base of the delta check, default a rebuild of the image")
+    parser.add_argument("--image-kb", type=int, default=128, help="synthetic image size")
+    parser.add_argument("--window-bits", type=int, nargs="+", default=[10, hota_compress.WINDOW_BITS, 16])
+    parser.add_argument("--length-bits", type=int, nargs="+", default=[hota_compress.LENGTH_BITS, 8])
+    parser.add_argument("--chunk", type=int, nargs="+", default=[0, 1, 16, hota_compress.BLOCK_SIZE],
+                        help="file bytes fed per call, 0 for random sizes")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default="-O2 -Wall -Wextra")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    if args.image:
+        with open(args.image, "rb") as f:
+            image = f.read()
+    else:
+        image = synthetic_image(rng, args.image_kb * 1024)
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+    else:
+        base = rebuilt_image(rng, image)
+
+    failures = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        exe = build(workdir, args.cc, args.cflags)
+        image_path = write(workdir, "image.bin", image)
+        base_path = write(workdir, "base.bin", base)
+
+        for window_bits in args.window_bits:
+            for length_bits in args.length_bits:
+                packed, _ = hota_compress.compress(image, window_bits, length_bits)
+                packed_path = write(workdir, "image.lzss", packed)
+                print(f"lzss window {window_bits} bits, length {length_bits} bits: "
+                      f"{len(image)} -> {len(packed)} B")
+                for chunk in args.chunk:
+                    failures += run([exe, "lzss", packed_path, image_path, str(chunk), str(args.seed)])
+
+        delta, _ = hota_delta.make_delta(base, image)
+        delta_path = write(workdir, "image.delta", delta)
+        print(f"delta: {len(base)} -> {len(image)} B in {len(delta)} B")
+        for chunk in args.chunk:
+            failures += run([exe, "delta", base_path, delta_path, image_path, str(chunk), str(args.seed)])
+
+    print(f"{failures} failure(s)")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
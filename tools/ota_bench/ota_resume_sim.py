@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : ota_resume_sim.py
+# * @brief          : Host model of an OTA download interrupted by resets,
+# *                   comparing a restart from scratch with the resume from the
+# *                   saved block bitmap of ota_pal_stm32_ntz.c.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python ota_resume_sim.py
+#   python ota_resume_sim.py --mtbf-s 30 60 120 --link-kBps 20 --image-kb 700
+#   python ota_resume_sim.py --save-period-ms 0 1000 5000 20000
+#
+# Blocks arrive in request windows of --window blocks, in random order within a
+# window. Resets occur after an exponentially distributed time of mean --mtbf-s,
+# each costs --reboot-s to reconnect and fetch the job again. On resume the PAL
+# keeps the flash sectors whose blocks were all recorded at the last save of the
+# bitmap (every --save-period-ms) and downloads everything else again.
+
+import argparse
+import random
+import sys
+
+BLOCK_SIZE = 2048       # 1 << otaconfigLOG2_FILE_BLOCK_SIZE
+SECTOR_SIZE = 8192      # FLASH_SECTOR_SIZE
+BLOCKS_PER_SECTOR = SECTOR_SIZE // BLOCK_SIZE
+
+
+def kept_blocks(saved, num_blocks):
+    """Blocks kept by prvRxStateRestore() from the saved bitmap."""
+    kept = set()
+    sectors = (num_blocks + BLOCKS_PER_SECTOR - 1) // BLOCKS_PER_SECTOR
+    for sector in range(sectors):
+        blocks = range(sector * BLOCKS_PER_SECTOR, min((sector + 1) * BLOCKS_PER_SECTOR, num_blocks))
+        if all(b in saved for b in blocks):
+            kept.update(blocks)
+    if len(kept) == num_blocks:
+        kept -= set(range((sectors - 1) * BLOCKS_PER_SECTOR, num_blocks))
+    return kept
+
+
+def download(rng, args, resume, save_period_s):
+    """Returns (completion time, bytes downloaded, resets) of one update."""
+    num_blocks = (args.image_kb * 1024 + BLOCK_SIZE - 1) // BLOCK_SIZE
+    block_s = BLOCK_SIZE / (args.link_kBps * 1024.0)
+    now = 0.0
+    downloaded = 0
+    resets = 0
+    have = set()
+
+    while True:
+        reset_at = now + rng.expovariate(1.0 / args.mtbf_s)
+        saved = set(have)
+        saved_at = now
+        missing = [b for b in range(num_blocks) if b not in have]
+
+        for start in range(0, len(missing), args.window):
+            window = missing[start:start + args.window]
+            rng.shuffle(window)
+            for block in window:
+                if now + block_s > reset_at:
+                    break
+                now += block_s
+                downloaded += BLOCK_SIZE
+                have.add(block)
+                if save_period_s > 0 and now - saved_at >= save_period_s:
+                    saved = set(have)
+                    saved_at = now
+            else:
+                continue
+            break
+        else:
+            return now, downloaded, resets
+
+        resets += 1
+        if resets > args.max_resets:
+            return None, downloaded, resets
+
+        now = reset_at + args.reboot_s
+        have = kept_blocks(saved, num_blocks) if resume and save_period_s > 0 else set()
+
+
+def run(args, mtbf_s, save_period_ms, resume):
+    rng = random.Random(args.seed)
+    args.mtbf_s = mtbf_s
+    times = []
+    volume = 0
+    resets = 0
+    failed = 0
+
+    for _ in range(args.trials):
+        elapsed, downloaded, count = download(rng, args, resume, save_period_ms / 1000.0)
+        volume += downloaded
+        resets += count
+        if elapsed is None:
+            failed += 1
+        else:
+            times.append(elapsed)
+
+    mean = sum(times) / len(times) if times else float("nan")
+    return mean, volume / args.trials / 1024.0, resets / args.trials, failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OTA resume model")
+    parser.add_argument("--image-kb", type=int, default=450)
+    parser.add_argument("--link-kBps", type=float, default=40.0)
+    parser.add_argument("--window", type=int, default=8, help="blocks per request window")
+    parser.add_argument("--mtbf-s", type=float, nargs="+", default=[10.0, 20.0, 60.0],
+                        help="mean time between resets")
+    parser.add_argument("--reboot-s", type=float, default=15.0,
+                        help="reboot, reconnection and job fetch time")
+    parser.add_argument("--save-period-ms", type=int, nargs="+", default=[5000],
+                        help="otapalconfigRESUME_SAVE_PERIOD_MS")
+    parser.add_argument("--max-resets", type=int, default=200,
+                        help="give up on an update after this many resets")
+    parser.add_argument("--trials", type=int, default=200)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    full_s = args.image_kb / args.link_kBps
+    print(f"image {args.image_kb} kB at {args.link_kBps} kB/s: {full_s:.1f} s without resets")
+    print(f"{'mtbf s':>7} {'mode':>14} {'time s':>9} {'kB sent':>9} {'resets':>7} {'failed':>7}")
+
+    for mtbf_s in args.mtbf_s:
+        modes = [("restart", 0, False)] + [(f"resume {p} ms", p, True) for p in args.save_period_ms]
+        for name, period, resume in modes:
+            mean, kbytes, resets, failed = run(args, mtbf_s, period, resume)
+            print(f"{mtbf_s:>7.0f} {name:>14} {mean:>9.1f} {kbytes:>9.0f} {resets:>7.1f} "
+                  f"{failed:>4}/{args.trials}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
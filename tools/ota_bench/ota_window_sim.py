@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : ota_window_sim.py
+# * @brief          : Host model of the OTA MQTT stream data plane, comparing
+# *                   the fixed block request window with the adaptive window
+# *                   of ota_update_task.c against a local broker stand-in.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python ota_window_sim.py
+#   python ota_window_sim.py --rtt-ms 40 300 --loss 0 0.02 --image-kb 1024
+#   python ota_window_sim.py --http --http-ranges 1 3 4
+#
+# The broker stand-in answers each stream request with the requested number of
+# blocks, one block every --block-ms after the round trip, and drops each block
+# with probability --loss. The device consumes a block every --write-ms (flash
+# programming in otaPal_WriteBlock) and holds a data buffer until then.
+
+import argparse
+import random
+import sys
+
+WINDOW_INITIAL = 2
+WINDOW_LIMIT = 8
+DATA_BUFFERS = WINDOW_LIMIT + 1
+WAIT_MIN_MS = 2000
+WAIT_MAX_MS = 10000
+
+
+class AdaptiveWindow:
+    """Mirror of OtaDataWindow_t and prvDataWindowOnRequest/OnBlock."""
+
+    def __init__(self):
+        self.window = WINDOW_INITIAL
+        self.ssthresh = WINDOW_LIMIT
+        self.requested = 0
+        self.received = 0
+        self.dropped = 0
+        self.requests = 0
+        self.srtt = 0
+        self.rttvar = 0
+        self.request_ms = 0.0
+        self.rtt_pending = False
+
+    def get(self):
+        return self.window
+
+    def wait_ms(self):
+        if self.srtt == 0:
+            return WAIT_MAX_MS
+        return min(max(2 * (self.srtt + 4 * self.rttvar), WAIT_MIN_MS), WAIT_MAX_MS)
+
+    def on_request(self, now_ms, free_buffers):
+        sent = self.window
+        window = self.window
+        complete = self.requested > 0 and self.received >= self.requested
+
+        if self.requests > 0:
+            if self.dropped > 0 or not complete:
+                self.ssthresh = window // 2 if window > 2 else 1
+                window = self.ssthresh
+            elif window < self.ssthresh:
+                window *= 2
+            else:
+                window += 1
+
+        window = min(window, WINDOW_LIMIT)
+        if free_buffers > 1:
+            window = min(window, free_buffers - 1)
+        self.window = max(window, 1)
+
+        self.requested = sent
+        self.received = 0
+        self.dropped = 0
+        self.requests += 1
+        self.request_ms = now_ms
+        self.rtt_pending = True
+
+    def on_block(self, now_ms, dropped):
+        if dropped:
+            self.dropped += 1
+        else:
+            self.received += 1
+
+        if self.rtt_pending:
+            self.rtt_pending = False
+            sample = int(now_ms - self.request_ms)
+            if self.srtt == 0:
+                self.srtt = max(sample, 1)
+                self.rttvar = sample // 2
+            else:
+                self.rttvar = (3 * self.rttvar + abs(self.srtt - sample)) // 4
+                self.srtt = (7 * self.srtt + sample) // 8
+
+
+class FixedWindow(AdaptiveWindow):
+    """The previous configuration: otaconfigMAX_NUM_BLOCKS_REQUEST = 2 and a
+    10 s otaconfigFILE_REQUEST_WAIT_MS."""
+
+    def __init__(self, window):
+        super().__init__()
+        self.window = window
+
+    def wait_ms(self):
+        return WAIT_MAX_MS
+
+    def on_request(self, now_ms, free_buffers):
+        self.requests += 1
+
+
+def simulate(policy, image_bytes, block_size, rtt_ms, block_ms, write_ms, loss, seed):
+    rng = random.Random(seed)
+    num_blocks = (image_bytes + block_size - 1) // block_size
+    missing = set(range(num_blocks))
+    now = 0.0
+    device_free_at = 0.0
+    timeouts = 0
+
+    while missing:
+        window = policy.get()
+        # Buffers still held by blocks queued to the OTA agent at request time
+        free = DATA_BUFFERS - max(0, min(DATA_BUFFERS, int((device_free_at - now) / write_ms)))
+        policy.on_request(now, free)
+
+        # The stream service returns the lowest missing blocks of the bitmap
+        blocks = sorted(missing)[:window]
+        arrival = now + rtt_ms
+        delivered = 0
+
+        for block in blocks:
+            arrival += block_ms
+            if rng.random() < loss:
+                continue
+
+            held = int(max(0.0, device_free_at - arrival) / write_ms)
+            if held >= DATA_BUFFERS:
+                policy.on_block(arrival, True)
+                continue
+
+            policy.on_block(arrival, False)
+            device_free_at = max(device_free_at, arrival) + write_ms
+            missing.discard(block)
+            delivered += 1
+
+        if delivered == len(blocks):
+            # The agent asks for the next window once the last block is written
+            now = max(arrival, device_free_at)
+        else:
+            now = now + policy.wait_ms()
+            timeouts += 1
+
+    return {
+        "time_s": now / 1000.0,
+        "requests": policy.requests,
+        "timeouts": timeouts,
+        "throughput_kBps": image_bytes / 1024.0 / (now / 1000.0),
+    }
+
+
+def simulate_http(image_bytes, block_size, rtt_ms, write_ms, ranges, blocks_per_range,
+                  handshake_rtts, conn_kBps):
+    """Model of ota_http_w6x.c: rounds of up to `ranges` concurrent range requests
+    of `blocks_per_range` blocks, each on a fresh TLS connection. The next round
+    starts once every block of the round is written to flash."""
+    num_blocks = (image_bytes + block_size - 1) // block_size
+    block_ms = block_size / conn_kBps  # kB/s == B/ms
+    now = 0.0
+    requests = 0
+    next_block = 0
+
+    while next_block < num_blocks:
+        arrivals = []
+        for _ in range(ranges):
+            if next_block >= num_blocks:
+                break
+            count = min(blocks_per_range, num_blocks - next_block)
+            start = now + (handshake_rtts + 1) * rtt_ms
+            arrivals += [start + (i + 1) * block_ms for i in range(count)]
+            next_block += count
+            requests += 1
+
+        # Blocks of all ranges share the single flash writer
+        writer = now
+        for arrival in sorted(arrivals):
+            writer = max(writer, arrival) + write_ms
+        now = writer
+
+    return {
+        "time_s": now / 1000.0,
+        "requests": requests,
+        "timeouts": 0,
+        "throughput_kBps": image_bytes / 1024.0 / (now / 1000.0),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OTA stream request window model")
+    parser.add_argument("--image-kb", type=int, default=1024)
+    parser.add_argument("--block-size", type=int, default=2048,
+                        help="1 << otaconfigLOG2_FILE_BLOCK_SIZE")
+    parser.add_argument("--rtt-ms", type=float, nargs="+", default=[20.0, 80.0, 250.0])
+    parser.add_argument("--loss", type=float, nargs="+", default=[0.0, 0.01, 0.05])
+    parser.add_argument("--block-ms", type=float, default=2.0,
+                        help="time on the wire per block")
+    parser.add_argument("--write-ms", type=float, default=1.5,
+                        help="otaPal_WriteBlock time per block")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--http", action="store_true",
+                        help="also model the HTTP range data plane (loss free)")
+    parser.add_argument("--http-ranges", type=int, nargs="+", default=[1, 3])
+    parser.add_argument("--http-blocks-per-range", type=int, default=16)
+    parser.add_argument("--http-handshake-rtts", type=float, default=3.0,
+                        help="round trips spent on TCP and TLS setup per range")
+    parser.add_argument("--http-conn-kBps", type=float, default=150.0,
+                        help="throughput of a single connection")
+    args = parser.parse_args()
+
+    image_bytes = args.image_kb * 1024
+
+    print(f"{'rtt ms':>7} {'loss':>5} {'policy':>9} {'time s':>8} {'requests':>9} "
+          f"{'timeouts':>9} {'kB/s':>8}")
+
+    for rtt_ms in args.rtt_ms:
+        for loss in args.loss:
+            for name, policy in (("fixed-2", FixedWindow(2)), ("adaptive", AdaptiveWindow())):
+                r = simulate(policy, image_bytes, args.block_size, rtt_ms, args.block_ms,
+                             args.write_ms, loss, args.seed)
+                print(f"{rtt_ms:>7.0f} {loss:>5.2f} {name:>9} {r['time_s']:>8.1f} "
+                      f"{r['requests']:>9} {r['timeouts']:>9} {r['throughput_kBps']:>8.1f}")
+
+        if args.http:
+            for ranges in args.http_ranges:
+                r = simulate_http(image_bytes, args.block_size, rtt_ms, args.write_ms, ranges,
+                                  args.http_blocks_per_range, args.http_handshake_rtts,
+                                  args.http_conn_kBps)
+                name = f"http-{ranges}"
+                print(f"{rtt_ms:>7.0f} {0.0:>5.2f} {name:>9} {r['time_s']:>8.1f} "
+                      f"{r['requests']:>9} {r['timeouts']:>9} {r['throughput_kBps']:>8.1f}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
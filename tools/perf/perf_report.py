@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+#******************************************************************************
+# * @file           : perf_report.py
+# * @brief          : Symbolize the samples of the "perf profile dump" CLI
+# *                   command against the application ELF and print a flat
+# *                   profile of the hot functions and of their callers.
+# ******************************************************************************
+# * @attention
+# *
+# * <h2><center>&copy; Copyright (c) 2024 STMicroelectronics.
+# * All rights reserved.</center></h2>
+# *
+# * This software component is licensed by ST under BSD 3-Clause license,
+# * the "License"; You may not use this file except in compliance with the
+# * License. You may obtain a copy of the License at:
+# *                        opensource.org/licenses/BSD-3-Clause
+# ******************************************************************************
+#
+# Examples:
+#   python perf_report.py console.log project/Debug/b_u585i_iot02a_ntz.elf
+#   python perf_report.py console.log app.elf --top 20 --callers 5
+#
+# The console log may contain anything around the dump, only the lines between
+# "-----BEGIN PERF SAMPLES-----" and "-----END PERF SAMPLES-----" are read, the
+# last dump of the log is used. Each sample is the interrupted PC and LR. LR is
+# only the caller when the PC is in a function that did not save it yet or does
+# not call anything, so callers are an indication rather than a call graph.
+
+import argparse
+import bisect
+import collections
+import re
+import subprocess
+import sys
+
+BEGIN_MARKER = "-----BEGIN PERF SAMPLES-----"
+END_MARKER = "-----END PERF SAMPLES-----"
+SAMPLE_IN_HANDLER = 0x1     # PERF_SAMPLE_IN_HANDLER
+SAMPLE_RE = re.compile(r"([0-9a-fA-F]{8}):([0-9a-fA-F]{8})")
+
+
+def read_samples(path):
+    """Returns (header, [(pc, lr, in_handler)]) of the last dump in the log."""
+    header = None
+    samples = None
+    dump = None
+
+    with open(path, "r", errors="replace") as log:
+        for line in log:
+            if BEGIN_MARKER in line:
+                dump = []
+                header = line.split(BEGIN_MARKER, 1)[1].strip()
+            elif END_MARKER in line and dump is not None:
+                samples = dump
+                dump = None
+            elif dump is not None:
+                for pc, lr in SAMPLE_RE.findall(line):
+                    pc = int(pc, 16)
+                    dump.append((pc & ~SAMPLE_IN_HANDLER, int(lr, 16), bool(pc & SAMPLE_IN_HANDLER)))
+
+    return header, samples
+
+
+class Symbols:
+    """Function symbols of the ELF from nm, sorted by address."""
+
+    def __init__(self, nm, elf):
+        output = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                                check=True, capture_output=True, text=True).stdout
+        self.addresses = []
+        self.entries = []
+
+        for line in output.splitlines():
+            fields = line.split()
+            if len(fields) == 4 and fields[2] in "tTwW":
+                address, size, name = int(fields[0], 16), int(fields[1], 16), fields[3]
+            elif len(fields) == 3 and fields[1] in "tTwW":
+                address, size, name = int(fields[0], 16), None, fields[2]
+            else:
+                continue
+            # Thumb functions have bit 0 set in some toolchains
+            address &= ~1
+            self.addresses.append(address)
+            self.entries.append((address, size, name))
+
+    def lookup(self, address):
+        index = bisect.bisect_right(self.addresses, address) - 1
+        if index < 0:
+            return f"0x{address:08x}"
+        start, size, name = self.entries[index]
+        if size is not None and address >= start + size:
+            return f"0x{address:08x}"
+        return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Profile report of perf profile dump")
+    parser.add_argument("log", help="console log containing the output of perf profile dump")
+    parser.add_argument("elf", help="ELF of the firmware that was profiled")
+    parser.add_argument("--nm", default="arm-none-eabi-nm")
+    parser.add_argument("--top", type=int, default=30, help="functions to list")
+    parser.add_argument("--callers", type=int, default=3,
+                        help="callers to list under each function, 0 for none")
+    args = parser.parse_args()
+
+    header, samples = read_samples(args.log)
+    if not samples:
+        print(f"no complete dump between {BEGIN_MARKER} and {END_MARKER} in {args.log}",
+              file=sys.stderr)
+        return 1
+
+    symbols = Symbols(args.nm, args.elf)
+    functions = collections.Counter()
+    callers = collections.defaultdict(collections.Counter)
+    in_handler = 0
+
+    for pc, lr, handler in samples:
+        function = symbols.lookup(pc)
+        functions[function] += 1
+        # The return address points after the call, bit 0 is the Thumb bit
+        callers[function][symbols.lookup((lr & ~1) - 1)] += 1
+        in_handler += handler
+
+    total = len(samples)
+    print(f"{total} samples ({header}), {100.0 * in_handler / total:.1f}% in interrupt handlers")
+    print(f"{'samples':>8} {'%':>6}  function")
+
+    for function, count in functions.most_common(args.top):
+        print(f"{count:>8} {100.0 * count / total:>6.1f}  {function}")
+        for caller, caller_count in callers[function].most_common(args.callers):
+            print(f"{'':>16}    {100.0 * caller_count / count:>5.1f}% from {caller}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
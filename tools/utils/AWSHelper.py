@@ -507,7 +507,7 @@ class AwsHelper:
         except  ClientError as error:
             raise ValueError(error)
             
-    def push_ota_update(self, updateID:str, targetArn:str, file:str, bucket:str, signer:str, roleArn:str, version:str):
+    def push_ota_update(self, updateID:str, targetArn:str, file:str, bucket:str, signer:str, roleArn:str, version:str, signature:bytes=None):
         """
         - Attempts to create an OTA job
 
@@ -517,9 +517,35 @@ class AwsHelper:
         :param bucket: s3 bucket that holds the firmware image
         :param signer: signing profile name
         :param roleArn: the update role arn
+        :param signature: DER ECDSA SHA-256 signature computed locally, used instead of the signing profile
         """
         self.logger.debug('Creating an OTA update')
 
+        codeSigning = {
+            "startSigningJobParameter": {
+            "signingProfileName": signer,
+            "destination": {
+                "s3Destination": {
+                "bucket": bucket
+                }
+            }
+            }
+        }
+
+        if signature is not None:
+            codeSigning = {
+                "customCodeSigning": {
+                "signature": {
+                    "inlineDocument": signature
+                },
+                "certificateChain": {
+                    "certificateName": "ota_signer_pub"
+                },
+                "hashAlgorithm": "SHA256",
+                "signatureAlgorithm": "ECDSA"
+                }
+            }
+
         try:
             ota_update = self.iot.create_ota_update(
                 otaUpdateId = updateID,
@@ -537,16 +563,7 @@ class AwsHelper:
                         "version": self.bucketVersion
                         }
                     },
-                    "codeSigning": {
-                        "startSigningJobParameter": {
-                        "signingProfileName": signer,
-                        "destination": {
-                            "s3Destination": {
-                            "bucket": bucket
-                            }
-                        }
-                        }
-                    }
+                    "codeSigning": codeSigning
                     }
                 ],
                 roleArn = roleArn